@@ -388,6 +388,30 @@ void gf_mesh_set(getfemint::mexargs_in& m_in,
        );
 
 
+    /*@SET ('reorder'[, @str ordering])
+    Renumber the convexes and the points for a better memory locality.
+
+    The convexes are ordered along a space filling curve through their
+    barycenters (`ordering` = 'hilbert', the default, or 'morton') or in
+    the reverse Cuthill-McKee order (`ordering` = 'rcm'). The points are
+    then numbered in the order of their first appearance in the convexes.
+    The regions are updated and the numbering is compacted as with
+    MESH:SET('optimize structure').@*/
+    sub_command
+      ("reorder", 0, 1, 0, 0,
+       getfem::mesh_ordering ord = getfem::MESH_ORDERING_HILBERT;
+       if (in.remaining()) {
+         std::string s = in.pop().to_string();
+         if (cmd_strmatch(s, "hilbert")) ord = getfem::MESH_ORDERING_HILBERT;
+         else if (cmd_strmatch(s, "morton"))
+           ord = getfem::MESH_ORDERING_MORTON;
+         else if (cmd_strmatch(s, "rcm")) ord = getfem::MESH_ORDERING_RCM;
+         else THROW_BADARG("Unknown ordering: " << s);
+       }
+       pmesh->reorder(ord);
+       );
+
+
     /*@SET ('refine'[, @ivec CVIDs])
     Use a Bank strategy for mesh refinement.
 
@@ -210,6 +210,15 @@ void gf_model_get(getfemint::mexargs_in& m_in,
        );
 
 
+    /*@GET ('assembly profile')
+      print to the output the times accumulated by the assemblies since the
+      profiling has been enabled with MODEL:SET('assembly profiling').@*/
+    sub_command
+      ("assembly profile", 0, 0, 0, 0,
+       md->assembly_profile().print(infomsg());
+       );
+
+
     /*@GET ('brick list')
       print to the output the list of bricks of the model.@*/
     sub_command
@@ -408,12 +417,18 @@ void gf_model_get(getfemint::mexargs_in& m_in,
     - 'lsolver', @str SOLVER_NAME
        select explicitely the solver used for the linear systems (the
        default value is 'auto', which lets getfem choose itself).
-       Possible values are 'superlu', 'mumps' (if supported),
-       'cg/ildlt', 'gmres/ilu' and 'gmres/ilut'.
+       Possible values are 'superlu', 'superlu_mixed',
+       'gmres/superlu_mixed', 'mumps' (if supported),
+       'cg/ildlt', 'gmres/ilu', 'gmres/ilut', 'cg/amg' and 'gmres/amg'.
     - 'lsearch', @str LINE_SEARCH_NAME
        select explicitely the line search method used for the linear systems (the
        default value is 'default').
        Possible values are 'simplest', 'systematic', 'quadratic' or 'basic'.
+    - 'newton', @str NEWTON_NAME
+       select a Newton variant reusing the factorization of the tangent
+       matrix for the nonlinear problems. Possible values are 'classical'
+       (the default, the tangent matrix is computed at each iteration),
+       'modified', 'broyden' or 'jacobian free'.
 
       Return the number of iterations, if an iterative method is used.
       
@@ -425,10 +440,11 @@ void gf_model_get(getfemint::mexargs_in& m_in,
 
       @*/
     sub_command
-      ("solve", 0, 17, 0, 2,
+      ("solve", 0, 19, 0, 2,
        getfemint::interruptible_iteration iter;
        std::string lsolver = "auto";
        std::string lsearch = "default";
+       std::string newton = "classical";
        scalar_type alpha_max_ratio(-1);
        scalar_type alpha_min(-1);
        scalar_type alpha_mult(-1);
@@ -453,6 +469,9 @@ void gf_model_get(getfemint::mexargs_in& m_in,
          } else if (cmd_strmatch(opt, "lsearch")) {
            if (in.remaining()) lsearch = in.pop().to_string();
            else THROW_BADARG("missing line search name for " << opt);
+         } else if (cmd_strmatch(opt, "newton")) {
+           if (in.remaining()) newton = in.pop().to_string();
+           else THROW_BADARG("missing Newton variant name for " << opt);
          } else if (cmd_strmatch(opt, "alpha mult")) {
            if (in.remaining()) alpha_mult = in.pop().to_scalar();
            else THROW_BADARG("missing line search value for " << opt);
@@ -497,15 +516,36 @@ void gf_model_get(getfemint::mexargs_in& m_in,
          ls = &quadratic_ls;
        else GMM_ASSERT1(false, "unknown line search");
 
+       getfem::newton_tangent_reuse strategy;
+       bool classical_newton = false;
+       if (cmd_strmatch(newton, "classical"))
+         classical_newton = true;
+       else if (cmd_strmatch(newton, "modified"))
+         strategy.method = getfem::newton_tangent_reuse::MODIFIED_NEWTON;
+       else if (cmd_strmatch(newton, "broyden"))
+         strategy.method = getfem::newton_tangent_reuse::BROYDEN;
+       else if (cmd_strmatch(newton, "jacobian free"))
+         strategy.method = getfem::newton_tangent_reuse::JACOBIAN_FREE;
+       else THROW_BADARG("unknown Newton variant: " << newton);
 
        if (!md->is_complex()) {
-         getfem::standard_solve(*md, iter,
-                                getfem::rselect_linear_solver(*md,
-                                                              lsolver), *ls);
+         if (classical_newton)
+           getfem::standard_solve(*md, iter,
+                                  getfem::rselect_linear_solver(*md,
+                                                                lsolver), *ls);
+         else
+           getfem::standard_solve(*md, iter,
+                                  getfem::rselect_linear_solver(*md, lsolver),
+                                  *ls, strategy);
        } else {
-         getfem::standard_solve(*md, iter,
-                                getfem::cselect_linear_solver(*md,
-                                                              lsolver), *ls);
+         if (classical_newton)
+           getfem::standard_solve(*md, iter,
+                                  getfem::cselect_linear_solver(*md,
+                                                                lsolver), *ls);
+         else
+           getfem::standard_solve(*md, iter,
+                                  getfem::cselect_linear_solver(*md, lsolver),
+                                  *ls, strategy);
        }
        if (out.remaining()) out.pop().from_integer(int(iter.get_iteration()));
        if (out.remaining()) out.pop().from_integer(int(iter.converged()));
@@ -387,6 +387,29 @@ void gf_model_set(getfemint::mexargs_in& m_in,
        md->delete_brick(ib);
        );
 
+    /*@SET ('assembly profiling', @int enable)
+      Enable (`enable` = 1) or disable (`enable` = 0) the profiling of the
+      assembly. When enabled, the time spent in each brick and in each
+      expression and instruction of the generic assembly is accumulated.
+      The previous statistics are cleared. See MODEL:GET('assembly
+      profile').@*/
+    sub_command
+      ("assembly profiling", 1, 1, 0, 0,
+       bool enable = (in.pop().to_integer(0, 1) != 0);
+       md->set_assembly_profiling(enable);
+       md->clear_assembly_profile();
+       );
+
+    /*@SET ('incremental assembly', @int enable)
+      Enable (`enable` = 1) or disable (`enable` = 0) the incremental
+      assembly of the tangent matrix. When enabled, the matrix terms of the
+      linear bricks are kept in a constant part of the tangent matrix which
+      is only rebuilt for the bricks whose terms have changed.@*/
+    sub_command
+      ("incremental assembly", 1, 1, 0, 0,
+       md->set_incremental_assembly(in.pop().to_integer(0, 1) != 0);
+       );
+
     /*@SET ('define variable group', @str name[, @str varname, ...])
       Defines a group of variables for the interpolation (mainly for the
       raytracing interpolation transformation.@*/
@@ -331,6 +331,169 @@ namespace bgeot {
     return (it != ct.end()) ? (it - ct.begin()): size_type(-1);
   }
 
+  /* ********************************************************************* */
+  /*                                                                       */
+  /*  Compact read-only copy of a mesh structure.                          */
+  /*                                                                       */
+  /* ********************************************************************* */
+
+  void mesh_structure_csr::clear() {
+    cv_index.clear(); cv_struct.clear();
+    cv_pts_start.assign(1, 0); cv_pts.clear();
+    pt_cvs_start.assign(1, 0); pt_cvs.clear();
+    cv_faces_start.assign(1, 0);
+    face_neighbours.clear(); face_adjacent_faces.clear();
+    coords.clear();
+  }
+
+  // True if the convex icv contains all the points of pt.
+  template <typename CONT>
+  static bool csr_convex_having_points(const mesh_structure_csr &ms,
+                                       size_type icv, const CONT &pt) {
+    mesh_structure_csr::ind_ct cvpts = ms.ind_points_of_convex(icv);
+    for (size_type ip : pt)
+      if (std::find(cvpts.begin(), cvpts.end(), ip) == cvpts.end())
+        return false;
+    return true;
+  }
+
+  void mesh_structure_csr::build(const mesh_structure &ms) {
+    clear();
+    cv_index = ms.convex_index();
+    size_type nbcv = cv_index.card() ? cv_index.last_true() + 1 : 0;
+    size_type nbpt = ms.nb_max_points();
+
+    size_type nbcvpts = 0, nbfaces = 0;
+    for (dal::bv_visitor ic(cv_index); !ic.finished(); ++ic) {
+      nbcvpts += ms.nb_points_of_convex(ic);
+      nbfaces += ms.nb_faces_of_convex(ic);
+    }
+    cv_struct.assign(nbcv, pconvex_structure());
+    cv_pts_start.resize(nbcv + 1); cv_pts.reserve(nbcvpts);
+    cv_faces_start.resize(nbcv + 1);
+    for (size_type ic = 0; ic < nbcv; ++ic) {
+      cv_pts_start[ic] = cv_pts.size();
+      cv_faces_start[ic+1] = cv_faces_start[ic];
+      if (cv_index.is_in(ic)) {
+        cv_struct[ic] = ms.structure_of_convex(ic);
+        const mesh_structure::ind_cv_ct &pts = ms.ind_points_of_convex(ic);
+        cv_pts.insert(cv_pts.end(), pts.begin(), pts.end());
+        cv_faces_start[ic+1] += ms.nb_faces_of_convex(ic);
+      }
+    }
+    cv_pts_start[nbcv] = cv_pts.size();
+
+    // The convexes of each point are kept in the order of the original
+    // structure, for the neighbour found first to be the same one.
+    size_type nbptcvs = 0;
+    for (size_type ip = 0; ip < nbpt; ++ip)
+      nbptcvs += ms.convex_to_point(ip).size();
+    pt_cvs_start.resize(nbpt + 1); pt_cvs.reserve(nbptcvs);
+    for (size_type ip = 0; ip < nbpt; ++ip) {
+      pt_cvs_start[ip] = pt_cvs.size();
+      const mesh_structure::ind_cv_ct &cvs = ms.convex_to_point(ip);
+      pt_cvs.insert(pt_cvs.end(), cvs.begin(), cvs.end());
+    }
+    pt_cvs_start[nbpt] = pt_cvs.size();
+
+    face_neighbours.assign(nbfaces, size_type(-1));
+    face_adjacent_faces.assign(nbfaces, short_type(-1));
+    for (dal::bv_visitor ic(cv_index); !ic.finished(); ++ic) {
+      short_type nbf = nb_faces_of_convex(ic);
+      dim_type d = cv_struct[ic]->dim();
+      for (short_type f = 0; f < nbf; ++f) {
+        ind_pt_face_ct pt = ind_points_of_face_of_convex(ic, f);
+        size_type icv = size_type(-1);
+        for (size_type jcv : convex_to_point(pt[0]))
+          if (jcv != ic && cv_struct[jcv]->dim() == d
+              && csr_convex_having_points(*this, jcv, pt))
+            { icv = jcv; break; }
+        if (icv == size_type(-1)) continue;
+        size_type i = cv_faces_start[ic] + f;
+        face_neighbours[i] = icv;
+        for (short_type g = 0; g < nb_faces_of_convex(icv); ++g) {
+          ind_pt_face_ct ptg = ind_points_of_face_of_convex(icv, g);
+          bool found = true;
+          for (size_type ip : pt)
+            if (std::find(ptg.begin(), ptg.end(), ip) == ptg.end())
+              { found = false; break; }
+          if (found) { face_adjacent_faces[i] = g; break; }
+        }
+      }
+    }
+  }
+
+  void mesh_structure_csr::neighbours_of_convex
+  (size_type ic, short_type f, mesh_structure::ind_set &s) const {
+    s.resize(0);
+    ind_pt_face_ct pt = ind_points_of_face_of_convex(ic, f);
+    dim_type d = cv_struct[ic]->dim();
+    for (size_type icv : convex_to_point(pt[0]))
+      if (icv != ic && cv_struct[icv]->dim() == d
+          && csr_convex_having_points(*this, icv, pt))
+        s.push_back(icv);
+  }
+
+  void mesh_structure_csr::neighbours_of_convex
+  (size_type ic, const std::vector<short_type> &ftab,
+   mesh_structure::ind_set &s) const {
+    s.resize(0);
+    std::vector<size_type> ipts;
+
+    switch (ftab.size()) {
+    case 0:
+      {
+        ind_ct pt = ind_points_of_convex(ic);
+        ipts.assign(pt.begin(), pt.end());
+      }
+      break;
+
+    case 1:
+      {
+        ind_pt_face_ct pt = ind_points_of_face_of_convex(ic, ftab[0]);
+        ipts.assign(pt.begin(), pt.end());
+      }
+      break;
+
+    default:
+      {
+        const convex_ind_ct &ind
+          = cv_struct[ic]->ind_common_points_of_faces(ftab);
+        if (ind.size() == 0) { // neighbours through all the faces
+          mesh_structure::ind_set sf;
+          for (short_type f = 0; f < nb_faces_of_convex(ic); ++f) {
+            neighbours_of_convex(ic, f, sf);
+            for (size_type icv : sf)
+              if (std::find(s.begin(), s.end(), icv) == s.end())
+                s.push_back(icv);
+          }
+          return;
+        }
+        ind_ct pt = ind_points_of_convex(ic);
+        ipts.resize(ind.size());
+        auto it = ind.cbegin();
+        for (size_type &ipt : ipts) ipt = pt[*it++];
+      }
+      break;
+    }
+
+    if (ipts.size() == 0) return;
+    for (size_type icv : convex_to_point(ipts[0]))
+      if (icv != ic && csr_convex_having_points(*this, icv, ipts))
+        s.push_back(icv);
+  }
+
+  size_type mesh_structure_csr::memsize() const {
+    return sizeof(mesh_structure_csr) + cv_index.memsize()
+      + cv_struct.capacity() * sizeof(pconvex_structure)
+      + (cv_pts_start.capacity() + cv_pts.capacity()
+         + pt_cvs_start.capacity() + pt_cvs.capacity()
+         + cv_faces_start.capacity() + face_neighbours.capacity())
+      * sizeof(size_type)
+      + face_adjacent_faces.capacity() * sizeof(short_type)
+      + coords.capacity() * sizeof(scalar_type);
+  }
+
   /* ********************************************************************* */
   /*                                                                       */
   /*  Gives the list of edges of a convex face.                            */
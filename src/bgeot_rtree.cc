@@ -23,200 +23,40 @@
 
 namespace bgeot {
 
-  struct rtree_node : public rtree_elt_base {
-    std::unique_ptr<rtree_elt_base> left, right;
-    rtree_node(const base_node& bmin, const base_node& bmax,
-               std::unique_ptr<rtree_elt_base> &&left_,
-               std::unique_ptr<rtree_elt_base> &&right_)
-      : rtree_elt_base(false, bmin, bmax), left(std::move(left_)),
-        right( std::move(right_)) { }
-  };
-
-  struct rtree_leaf : public rtree_elt_base {
-    rtree::pbox_cont lst;
-    rtree_leaf(const base_node& bmin, const base_node& bmax,
-               rtree::pbox_cont& lst_)
-      : rtree_elt_base(true, bmin, bmax) { lst.swap(lst_); }
-  };
-
-  /* enlarge box to hold [a..b] */
-  static void update_box(base_node& bmin, base_node& bmax,
-                         const base_node& a, const base_node& b) {
-    base_node::iterator itmin=bmin.begin(), itmax=bmax.begin();
-    for (size_type i=0; i < a.size(); ++i) {
-      itmin[i] = std::min(itmin[i], a.at(i));
-      itmax[i] = std::max(itmax[i], b.at(i));
-    }
-  }
-
-  inline static bool r1_ge_r2(const base_node& min1, const base_node& max1,
-                       const base_node& min2, const base_node& max2) {
-    for (size_type i=0; i < min1.size(); ++i)
-      if (!(min1[i] <= min2[i] && max1[i] >= max2[i])) return false;
-    return true;
-  }
-
-  inline static bool r1_inter_r2(const base_node& min1, const base_node& max1,
-                          const base_node& min2, const base_node& max2) {
-    for (size_type i=0; i < min1.size(); ++i)
-      if (max1[i] < min2[i] || min1[i] > max2[i]) return false;
-    return true;
-  }
-
-  /* some predicates for searches */
-  struct intersection_p {
-    const base_node min,max;
-    intersection_p(const base_node& min_, const base_node& max_)
-      : min(min_), max(max_) {}
-    bool operator()(const base_node& min2, const base_node& max2)
-    { return r1_inter_r2(min,max,min2,max2); }
-    bool accept(const base_node& min2, const base_node& max2)
-    { return operator()(min2,max2); }
-  };
-
-  /* match boxes containing [min..max] */
-  struct contains_p {
-    const base_node min,max;
-    contains_p(const base_node& min_, const base_node& max_)
-      : min(min_), max(max_) {}
-    bool operator()(const base_node& min2, const base_node& max2)
-    { return r1_ge_r2(min2,max2,min,max); }
-    bool accept(const base_node& min2, const base_node& max2)
-    { return r1_inter_r2(min,max,min2,max2); }
-  };
-
-  /* match boxes contained in [min..max] */
-  struct contained_p {
-    const base_node min,max;
-    contained_p(const base_node& min_, const base_node& max_)
-      : min(min_), max(max_) {}
-    bool accept(const base_node& min2, const base_node& max2)
-    { return r1_inter_r2(min,max,min2,max2); }
-    bool operator()(const base_node& min2, const base_node& max2)
-    { return r1_ge_r2(min,max,min2,max2); }
-  };
-
-  /* match boxes containing P */
-  struct has_point_p {
-    const base_node P;
-    has_point_p(const base_node& P_) : P(P_) {}
-    bool operator()(const base_node& min2, const base_node& max2) {
-      for (size_type i=0; i < P.size(); ++i)
-        if (P[i] < min2[i] || P[i] > max2[i]) return false;
-      return true;
-    }
-    bool accept(const base_node& min2, const base_node& max2)
-    { return operator()(min2,max2); }
-  };
-
-  /* match boxes intersecting the line passing through org and of
-     direction vector dirv.*/
-  struct intersect_line {
-    const base_node org;
-    const base_small_vector dirv;
-    intersect_line(const base_node& org_, const base_small_vector &dirv_)
-      : org(org_), dirv(dirv_) {}
-    bool operator()(const base_node& min2, const base_node& max2) {
-      size_type N = org.size();
-      GMM_ASSERT1(N == min2.size(), "Dimensions mismatch");
-      for (size_type i = 0; i < N; ++i)
-        if (dirv[i] != scalar_type(0)) {
-          scalar_type a1=(min2[i]-org[i])/dirv[i], a2=(max2[i]-org[i])/dirv[i];
-          bool interf1 = true, interf2 = true;
-          for (size_type j = 0; j < N; ++j)
-            if (j != i) {
-              scalar_type y1 = org[j] + a1*dirv[j], y2 = org[j] + a2*dirv[j];
-              if (y1 < min2[j] || y1 > max2[j]) interf1 = false;
-              if (y2 < min2[j] || y2 > max2[j]) interf2 = false;
-            }
-          if (interf1 || interf2) return true;
-        }
-      return false;
-    }
-    bool accept(const base_node& min2, const base_node& max2)
-    { return operator()(min2,max2); }
-  };
-
-  /* match boxes intersecting the line passing through org and of
-     direction vector dirv.*/
-  struct intersect_line_and_box {
-    const base_node org;
-    const base_small_vector dirv;
-    const base_node min,max;
-    intersect_line_and_box(const base_node& org_,
-                           const base_small_vector &dirv_,
-                           const base_node& min_, const base_node& max_)
-      : org(org_), dirv(dirv_), min(min_), max(max_) {}
-    bool operator()(const base_node& min2, const base_node& max2) {
-      size_type N = org.size();
-      GMM_ASSERT1(N == min2.size(), "Dimensions mismatch");
-      if (!(r1_inter_r2(min,max,min2,max2))) return false;
-      for (size_type i = 0; i < N; ++i)
-        if (dirv[i] != scalar_type(0)) {
-          scalar_type a1=(min2[i]-org[i])/dirv[i], a2=(max2[i]-org[i])/dirv[i];
-          bool interf1 = true, interf2 = true;
-          for (size_type j = 0; j < N; ++j)
-            if (j != i) {
-              scalar_type y1 = org[j] + a1*dirv[j], y2 = org[j] + a2*dirv[j];
-              if (y1 < min2[j] || y1 > max2[j]) interf1 = false;
-              if (y2 < min2[j] || y2 > max2[j]) interf2 = false;
-            }
-          if (interf1 || interf2) return true;
-        }
-      return false;
-    }
-    bool accept(const base_node& min2, const base_node& max2)
-    { return operator()(min2,max2); }
-  };
-
-
-  template <typename Predicate>
-  static void find_matching_boxes_(rtree_elt_base *n, rtree::pbox_set& boxlst,
-                                   Predicate p) {
-    if (n->isleaf()) {
-      const rtree_leaf *rl = static_cast<rtree_leaf*>(n);
-      for (rtree::pbox_cont::const_iterator it = rl->lst.begin();
-           it != rl->lst.end(); ++it) {
-        if (p((*it)->min, (*it)->max)) { boxlst.insert(*it); }
-      }
-    } else {
-      const rtree_node *rn = static_cast<rtree_node*>(n);
-      if (p.accept(rn->left->rmin,rn->left->rmax))
-        bgeot::find_matching_boxes_(rn->left.get(), boxlst, p);
-      if (p.accept(rn->right->rmin,rn->right->rmax))
-        bgeot::find_matching_boxes_(rn->right.get(), boxlst, p);
-    }
-  }
-
   void rtree::find_intersecting_boxes(const base_node& bmin,
                                       const base_node& bmax,
                                       pbox_set& boxlst) {
-    boxlst.clear(); if (!root) build_tree();
-    if (root) find_matching_boxes_(root.get(),boxlst,intersection_p(bmin,bmax));
+    boxlst.clear();
+    for_each_intersecting_box(bmin, bmax, [&boxlst](const box_index *b)
+                              { boxlst.insert(b); });
   }
 
   void rtree::find_containing_boxes(const base_node& bmin,
                                     const base_node& bmax, pbox_set& boxlst) {
-    boxlst.clear(); if (!root) build_tree();
-    if (root) find_matching_boxes_(root.get(), boxlst, contains_p(bmin,bmax));
+    boxlst.clear();
+    for_each_containing_box(bmin, bmax, [&boxlst](const box_index *b)
+                            { boxlst.insert(b); });
   }
 
   void rtree::find_contained_boxes(const base_node& bmin,
                                    const base_node& bmax, pbox_set& boxlst) {
-    boxlst.clear(); if (!root) build_tree();
-    if (root) find_matching_boxes_(root.get(), boxlst, contained_p(bmin,bmax));
+    boxlst.clear();
+    for_each_contained_box(bmin, bmax, [&boxlst](const box_index *b)
+                           { boxlst.insert(b); });
   }
 
   void rtree::find_boxes_at_point(const base_node& P, pbox_set& boxlst) {
-    boxlst.clear(); if (!root) build_tree();
-    if (root) find_matching_boxes_(root.get(), boxlst, has_point_p(P));
+    boxlst.clear();
+    for_each_box_at_point(P, [&boxlst](const box_index *b)
+                          { boxlst.insert(b); });
   }
 
   void rtree::find_line_intersecting_boxes(const base_node& org,
                                            const base_small_vector& dirv,
                                            pbox_set& boxlst) {
-    boxlst.clear(); if (!root) build_tree();
-    if (root) find_matching_boxes_(root.get(),boxlst,intersect_line(org, dirv));
+    boxlst.clear();
+    for_each_line_intersecting_box(org, dirv, [&boxlst](const box_index *b)
+                                   { boxlst.insert(b); });
   }
 
   void rtree::find_line_intersecting_boxes(const base_node& org,
@@ -224,131 +64,190 @@ namespace bgeot {
                                            const base_node& bmin,
                                            const base_node& bmax,
                                            pbox_set& boxlst) {
-    boxlst.clear(); if (!root) build_tree();
-    if (root)
-      find_matching_boxes_(root.get(), boxlst,
-                           intersect_line_and_box(org, dirv, bmin, bmax));
+    boxlst.clear();
+    for_each_line_intersecting_box(org, dirv, bmin, bmax,
+                                   [&boxlst](const box_index *b)
+                                   { boxlst.insert(b); });
   }
 
-  /*
-     try to split at the approximate center of the box. Could be much more
-     sophisticated
-  */
-  static bool split_test(const rtree::pbox_cont& b,
-                         const base_node& bmin, const base_node& bmax,
-                         unsigned dir, scalar_type& split_v) {
-    scalar_type v = bmin[dir] + (bmax[dir] - bmin[dir])/2; split_v = v;
-    size_type cnt = 0;
-    for (rtree::pbox_cont::const_iterator it = b.begin(); it!=b.end(); ++it) {
-      if ((*it)->max[dir] < v) {
-        if (cnt == 0) split_v = (*it)->max[dir];
-        else split_v = std::max((*it)->max[dir],split_v);
-        cnt++;
-      }
+  static bool box_id_less(const box_index *a, const box_index *b)
+  { return a->id < b->id; }
+
+  void rtree::find_intersecting_boxes(const std::vector<base_node>& bmins,
+                                      const std::vector<base_node>& bmaxs,
+                                      std::vector<size_type>& offsets,
+                                      pbox_cont& boxlst) {
+    GMM_ASSERT1(bmins.size() == bmaxs.size(), "Dimensions mismatch");
+    offsets.resize(bmins.size()+1); offsets[0] = 0; boxlst.resize(0);
+    for (size_type i = 0; i < bmins.size(); ++i) {
+      walk(rtree_intersection_p(bmins[i], bmaxs[i]),
+           [&boxlst](const box_index *b) { boxlst.push_back(b); });
+      std::sort(boxlst.begin()+offsets[i], boxlst.end(), box_id_less);
+      offsets[i+1] = boxlst.size();
     }
-    return (cnt > 0 && cnt < b.size());
   }
 
-  /*
-     there are many flavors of rtree ... this one is more or less a quadtree
-     where splitting does not occurs at predefined positions (hence the
-     split_test function above).
-     Regions of the tree do not overlap (box are splitted).
-  */
-  static std::unique_ptr<rtree_elt_base> build_tree_(rtree::pbox_cont b,
-                                                     const base_node& bmin,
-                                                     const base_node& bmax,
-                                                     unsigned last_dir) {
-    size_type N=bmin.size();
-    scalar_type split_v(0);
-    unsigned split_dir = unsigned((last_dir+1)%N);
-    bool split_ok = false;
-    if (b.size() > rtree_elt_base::RECTS_PER_LEAF) {
-      for (size_type itry=0; itry < N; ++itry) {
-        if (split_test(b, bmin, bmax, split_dir, split_v))
-          { split_ok = true; break; }
-        split_dir = unsigned((split_dir+1)%N);
-      }
+  void rtree::find_boxes_at_points(const std::vector<base_node>& pts,
+                                   std::vector<size_type>& offsets,
+                                   pbox_cont& boxlst) {
+    offsets.resize(pts.size()+1); offsets[0] = 0; boxlst.resize(0);
+    for (size_type i = 0; i < pts.size(); ++i) {
+      walk(rtree_has_point_p(pts[i]),
+           [&boxlst](const box_index *b) { boxlst.push_back(b); });
+      std::sort(boxlst.begin()+offsets[i], boxlst.end(), box_id_less);
+      offsets[i+1] = boxlst.size();
     }
-    if (split_ok) {
-      size_type cnt1=0,cnt2=0;
-      for (rtree::pbox_cont::const_iterator it = b.begin();
-           it != b.end(); ++it) {
-        if ((*it)->min[split_dir] < split_v) cnt1++;
-        if ((*it)->max[split_dir] > split_v) cnt2++;
-      }
-      assert(cnt1); assert(cnt2);
-      GMM_ASSERT1(cnt1+cnt2 >= b.size(), "internal error");
-      rtree::pbox_cont v1(cnt1), v2(cnt2);
-      base_node bmin1(bmax), bmax1(bmin);
-      base_node bmin2(bmax), bmax2(bmin);
-      cnt1 = cnt2 = 0;
-      for (rtree::pbox_cont::const_iterator it = b.begin();
-           it != b.end(); ++it) {
-        if ((*it)->min[split_dir] < split_v) {
-          v1[cnt1++] = *it;
-          update_box(bmin1,bmax1,(*it)->min,(*it)->max);
-        }
-        if ((*it)->max[split_dir] > split_v) {
-          v2[cnt2++] = *it;
-          update_box(bmin2,bmax2,(*it)->min,(*it)->max);
-        }
+  }
+
+  /* Sort-Tile-Recursive ordering of the boxes [b,e) along the directions
+     dir, dir+1, ... N-1: the boxes are sorted by their center along dir
+     and divided into slabs of an integer number of nodes, each of which
+     is sorted along the next directions. */
+  static void str_sort(rtree::pbox_cont::iterator b,
+                       rtree::pbox_cont::iterator e,
+                       size_type dir, size_type N) {
+    size_type n = e - b;
+    std::sort(b, e, [dir](const box_index *b1, const box_index *b2)
+              { return b1->min[dir] + b1->max[dir]
+                  < b2->min[dir] + b2->max[dir]; });
+    if (dir+1 >= N || n <= rtree::RECTS_PER_NODE) return;
+    size_type nb_nodes = (n + rtree::RECTS_PER_NODE - 1)/rtree::RECTS_PER_NODE;
+    size_type nb_slabs = size_type(ceil(pow(double(nb_nodes),
+                                            1./double(N-dir)) - 1E-10));
+    size_type slab_size
+      = rtree::RECTS_PER_NODE * ((nb_nodes + nb_slabs - 1) / nb_slabs);
+    for (size_type i = 0; i < n; i += slab_size)
+      str_sort(b+i, b+std::min(i+slab_size, n), dir+1, N);
+  }
+
+  void rtree::clear_tree() {
+    sorted_boxes = pbox_cont(); box_coords = std::vector<scalar_type>();
+    node_coords = std::vector<scalar_type>();
+    level_sizes.clear(); level_start.clear(); N = 0; tree_quality = 0;
+    tree_built = false; boxes_moved = false;
+  }
+
+  /* copy the corners of the boxes b in coords. */
+  static void copy_box_coords(const rtree::pbox_cont &b, size_type N,
+                              std::vector<scalar_type> &coords) {
+    coords.resize(2*N*b.size());
+    for (size_type i = 0; i < b.size(); ++i) {
+      GMM_ASSERT1(b[i]->min.size() == N && b[i]->max.size() == N,
+                  "Boxes of different dimensions in the same rtree");
+      std::copy(b[i]->min.begin(), b[i]->min.end(), &coords[2*N*i]);
+      std::copy(b[i]->max.begin(), b[i]->max.end(), &coords[2*N*i+N]);
+    }
+  }
+
+  /* each node is the bounding box of its children, computed level by
+     level from the leaves. */
+  void rtree::compute_node_boxes() {
+    for (size_type l = 1; l < level_sizes.size(); ++l) {
+      const scalar_type *c = (l == 1) ? &box_coords[0]
+        : &node_coords[2*N*level_start[l-1]];
+      for (size_type i = 0; i < level_sizes[l]; ++i) {
+        scalar_type *nc = &node_coords[2*N*(level_start[l]+i)];
+        size_type first = i*RECTS_PER_NODE;
+        size_type last = std::min(first+RECTS_PER_NODE, level_sizes[l-1]);
+        std::copy(c+2*N*first, c+2*N*(first+1), nc);
+        for (size_type j = first+1; j < last; ++j)
+          for (size_type k = 0; k < N; ++k) {
+            nc[k] = std::min(nc[k], c[2*N*j+k]);
+            nc[N+k] = std::max(nc[N+k], c[2*N*j+N+k]);
+          }
       }
-      for (size_type k=0; k < N; ++k) {
-        bmin1[k] = std::max(bmin1[k],bmin[k]);
-        bmax1[k] = std::min(bmax1[k],bmax[k]);
-        bmin2[k] = std::max(bmin2[k],bmin[k]);
-        bmax2[k] = std::min(bmax2[k],bmax[k]);
+    }
+  }
+
+  /* sum of the extents of the nodes (except the root) divided by the
+     extent of the root. It grows when the nodes overlap. */
+  scalar_type rtree::nodes_extent() const {
+    size_type nb_nodes = node_coords.size() / (2*N);
+    scalar_type e(0), e_root(0);
+    for (size_type i = 0; i < nb_nodes; ++i)
+      for (size_type k = 0; k < N; ++k) {
+        scalar_type h = node_coords[2*N*i+N+k] - node_coords[2*N*i+k];
+        if (i+1 < nb_nodes) e += h; else e_root += h;
       }
-      bmax1[split_dir] = std::min(bmax1[split_dir], split_v);
-      bmin2[split_dir] = std::max(bmin2[split_dir], split_v);
-      assert(cnt1 == v1.size()); assert(cnt2 == v2.size());
-      return std::make_unique<rtree_node>
-        (bmin, bmax,
-         build_tree_(v1, bmin1, bmax1, split_dir),
-         build_tree_(v2, bmin2, bmax2, split_dir));
-    } else {
-      return std::make_unique<rtree_leaf>(bmin, bmax, b);
+    return (e_root > scalar_type(0)) ? e / e_root : scalar_type(0);
+  }
+
+  void rtree::bulk_load() {
+    clear_tree();
+    size_type n = boxes.size();
+    if (n) {
+      N = boxes.front().min.size();
+      sorted_boxes.resize(n);
+      for (size_type i = 0; i < n; ++i) sorted_boxes[i] = &(boxes[i]);
+      str_sort(sorted_boxes.begin(), sorted_boxes.end(), 0, N);
+      copy_box_coords(sorted_boxes, N, box_coords);
+
+      level_sizes.push_back(n); level_start.push_back(0);
+      size_type nb_nodes = 0;
+      do {
+        level_start.push_back(nb_nodes);
+        level_sizes.push_back((level_sizes.back() + RECTS_PER_NODE - 1)
+                              / RECTS_PER_NODE);
+        nb_nodes += level_sizes.back();
+      } while (level_sizes.back() > 1);
+
+      node_coords.resize(2*N*nb_nodes);
+      compute_node_boxes();
+      tree_quality = nodes_extent();
+    }
+    tree_built = true;
+  }
+
+  bool rtree::refit_boxes() {
+    bool rebuilt = false;
+    if (boxes.size()) {
+      copy_box_coords(sorted_boxes, N, box_coords);
+      compute_node_boxes();
+      if (nodes_extent() > rebuild_ratio * tree_quality)
+        { bulk_load(); rebuilt = true; }
     }
+    boxes_moved = false;
+    return rebuilt;
   }
 
   void rtree::build_tree() {
-    if (boxes.size() == 0) return;
     getfem::local_guard lock = locks_.get_lock();
-    assert(root == 0);
-    pbox_cont b(boxes.size());
-    pbox_cont::iterator b_it = b.begin();
-    base_node bmin(boxes.front().min), bmax(boxes.front().max);
-    for (box_cont::const_iterator it=boxes.begin(); it != boxes.end(); ++it) {
-      update_box(bmin,bmax,(*it).min,(*it).max);
-      *b_it++ = &(*it);
-    }
-    root = build_tree_(b, bmin, bmax, 0);
+    if (!tree_built) bulk_load();
+    else if (boxes_moved) refit_boxes();
   }
 
-  static void dump_tree_(rtree_elt_base *p, int level, size_type& count) {
-    if (!p) return;
-    for (int i=0; i < level; ++i) cout << "  ";
-    cout << "span=" << p->rmin << ".." << p->rmax << " ";
-    if (p->isleaf()) {
-      rtree_leaf *rl = static_cast<rtree_leaf*>(p);
-      cout << "Leaf [" << rl->lst.size() << " elts] = ";
-      for (size_type i=0; i < rl->lst.size(); ++i)
-        cout << " " << rl->lst[i]->id; cout << "\n";
-      count += rl->lst.size();
-    } else {
-      cout << "Node\n";
-      const rtree_node *rn = static_cast<rtree_node*>(p);
-      if (rn->left) { dump_tree_(rn->left.get(), level+1, count); }
-      if (rn->right) { dump_tree_(rn->right.get(), level+1, count); }
-    }
+  bool rtree::refit() {
+    getfem::local_guard lock = locks_.get_lock();
+    if (!tree_built) { bulk_load(); return true; }
+    return refit_boxes();
+  }
+
+  static void dump_corners(const scalar_type *c, size_type N) {
+    cout << "span=(";
+    for (size_type k = 0; k < N; ++k) cout << (k ? "," : "") << c[k];
+    cout << ")..(";
+    for (size_type k = 0; k < N; ++k) cout << (k ? "," : "") << c[N+k];
+    cout << ") ";
   }
 
   void rtree::dump() {
     cout << "tree dump follows\n";
-    if (!root) build_tree();
+    if (!tree_built) build_tree();
     size_type count = 0;
-    dump_tree_(root.get(), 0, count);
+    for (size_type l = level_sizes.size()-1; l > 0; --l)
+      for (size_type i = 0; i < level_sizes[l]; ++i) {
+        for (size_type k = l; k < level_sizes.size()-1; ++k) cout << "  ";
+        dump_corners(&node_coords[2*N*(level_start[l]+i)], N);
+        size_type first = i*RECTS_PER_NODE;
+        size_type last = std::min(first+RECTS_PER_NODE, level_sizes[l-1]);
+        if (l == 1) {
+          cout << "Leaf [" << last-first << " elts] = ";
+          for (size_type j = first; j < last; ++j)
+            cout << " " << sorted_boxes[j]->id;
+          cout << "\n";
+          count += last-first;
+        } else cout << "Node [" << last-first << " children]\n";
+      }
     cout << " --- end of tree dump, nb of rectangles: " << boxes.size()
          << ", rectangle ref in tree: " << count << "\n";
   }
@@ -379,7 +379,7 @@ namespace bgeot {
     ~geotrans_precomp_pool() {
       for (std::set<pgeotrans_precomp>::iterator it = precomps.begin();
            it != precomps.end(); ++it)
-        delete_geotrans_precomp(*it);
+        dal::del_stored_object(*it, true);
     }
   };
 
@@ -246,6 +246,116 @@ namespace bgeot {
      */
     size_type ind_in_convex_of_point(size_type ic, size_type ip) const;
   };
+  /** Compact read-only copy of a mesh_structure.
+
+      The points of the convexes, the convexes of the points and the
+      neighbour of each face of each convex are stored in compressed
+      row storage, i.e. in a few contiguous arrays instead of one
+      vector per convex and per point, and the neighbours are computed
+      once. The point coordinates of a mesh can also be stored
+      contiguously with copy_points(). The copy is not updated when the
+      original structure is modified.
+  */
+  class APIDECL mesh_structure_csr {
+
+  public :
+
+    typedef gmm::tab_ref<std::vector<size_type>::const_iterator> ind_ct;
+    typedef mesh_structure::ind_pt_face_ct ind_pt_face_ct;
+
+  protected :
+
+    dal::bit_vector cv_index;
+    std::vector<pconvex_structure> cv_struct;
+    std::vector<size_type> cv_pts_start, cv_pts;   // convex -> points
+    std::vector<size_type> pt_cvs_start, pt_cvs;   // point -> convexes
+    std::vector<size_type> cv_faces_start;         // convex -> faces
+    std::vector<size_type> face_neighbours;        // face -> neighbour
+    std::vector<short_type> face_adjacent_faces;   // face -> adjacent face
+    std::vector<scalar_type> coords;
+    dim_type N;
+
+  public :
+
+    /// Build the copy of the structure ms.
+    void build(const mesh_structure &ms);
+    /// Store the coordinates of the points of pts contiguously.
+    template<class PT_TAB> void copy_points(const PT_TAB &pts, dim_type n);
+    void clear();
+
+    const dal::bit_vector &convex_index() const { return cv_index; }
+    size_type nb_convex() const { return cv_index.card(); }
+    size_type nb_allocated_convex() const { return cv_struct.size(); }
+    size_type nb_max_points() const { return pt_cvs_start.size() - 1; }
+    bool is_point_valid(size_type ip) const
+    { return pt_cvs_start[ip+1] != pt_cvs_start[ip]; }
+
+    /// Points of the convex ic, ordered as in structure_of_convex(ic).
+    ind_ct ind_points_of_convex(size_type ic) const {
+      return ind_ct(cv_pts.begin() + cv_pts_start[ic],
+                    cv_pts.begin() + cv_pts_start[ic+1]);
+    }
+    pconvex_structure structure_of_convex(size_type ic) const
+    { return cv_struct[ic]; }
+    short_type nb_points_of_convex(size_type ic) const
+    { return short_type(cv_pts_start[ic+1] - cv_pts_start[ic]); }
+    short_type nb_faces_of_convex(size_type ic) const
+    { return short_type(cv_faces_start[ic+1] - cv_faces_start[ic]); }
+    ind_pt_face_ct ind_points_of_face_of_convex(size_type ic,
+                                                short_type f) const {
+      const convex_ind_ct &p = cv_struct[ic]->ind_points_of_face(f);
+      return ind_pt_face_ct(cv_pts.begin() + cv_pts_start[ic],
+                            p.begin(), p.end());
+    }
+    /// Convexes attached to the point ip.
+    ind_ct convex_to_point(size_type ip) const {
+      return ind_ct(pt_cvs.begin() + pt_cvs_start[ip],
+                    pt_cvs.begin() + pt_cvs_start[ip+1]);
+    }
+
+    /** Same result as mesh_structure::neighbour_of_convex, without any
+        search. */
+    size_type neighbour_of_convex(size_type ic, short_type f) const
+    { return face_neighbours[cv_faces_start[ic] + f]; }
+    /** Same result as mesh_structure::adjacent_face, without any search. */
+    convex_face adjacent_face(size_type ic, short_type f) const {
+      size_type i = cv_faces_start[ic] + f;
+      if (face_neighbours[i] == size_type(-1)
+          || face_adjacent_faces[i] == short_type(-1))
+        return convex_face::invalid_face();
+      return convex_face(face_neighbours[i], face_adjacent_faces[i]);
+    }
+    bool is_convex_having_neighbour(size_type ic, short_type f) const
+    { return (neighbour_of_convex(ic, f) != size_type(-1)); }
+    /// Same result as the corresponding mesh_structure function.
+    void neighbours_of_convex(size_type ic, short_type f,
+                              mesh_structure::ind_set &s) const;
+    /// Same result as the corresponding mesh_structure function.
+    void neighbours_of_convex(size_type ic,
+                              const std::vector<short_type> &ftab,
+                              mesh_structure::ind_set &s) const;
+
+    dim_type dim() const { return N; }
+    /** Coordinates of the point ip (only if copy_points() has been
+        called). */
+    const scalar_type *coordinates_of_point(size_type ip) const
+    { return &(coords[ip * N]); }
+
+    size_type memsize() const;
+
+    mesh_structure_csr() : N(0) { clear(); }
+    explicit mesh_structure_csr(const mesh_structure &ms) : N(0)
+    { build(ms); }
+  };
+
+  template<class PT_TAB>
+  void mesh_structure_csr::copy_points(const PT_TAB &pts, dim_type n) {
+    N = n;
+    size_type nbpt = std::max(nb_max_points(), pts.index().last_true()+1);
+    coords.assign(nbpt * N, scalar_type(0));
+    for (dal::bv_visitor ip(pts.index()); !ip.finished(); ++ip)
+      std::copy(pts[ip].begin(), pts[ip].end(), coords.begin() + ip * N);
+  }
   ///@}
 
 
@@ -39,6 +39,7 @@
 */
 
 #include <set>
+#include <atomic>
 #include "bgeot_small_vector.h"
 
 namespace bgeot {
@@ -47,24 +48,118 @@ namespace bgeot {
     size_type id;
     base_node min, max;
   };
- 
-  struct rtree_elt_base {
-    enum { RECTS_PER_LEAF=8 };
-    bool isleaf_;
-    bool isleaf() const { return isleaf_; }
-    base_node rmin, rmax;
-    rtree_elt_base(bool leaf, const base_node& rmin_, const base_node& rmax_) 
-      : isleaf_(leaf), rmin(rmin_), rmax(rmax_) {}
-    virtual ~rtree_elt_base() {}
+
+  /* Predicates on the boxes of the rtree, which are given by pointers on
+     their lower and upper corners. match() selects the boxes and
+     accept() tells if a node of the tree may contain a selected box. The
+     template parameter D is the dimension when it is known at compile
+     time, 0 otherwise. */
+
+  /* match boxes intersecting [min..max] */
+  struct rtree_intersection_p {
+    const scalar_type *min, *max; size_type N;
+    rtree_intersection_p(const base_node& min_, const base_node& max_)
+      : min(&*min_.begin()), max(&*max_.begin()), N(min_.size()) {}
+    template <size_type D>
+    bool match(const scalar_type *min2, const scalar_type *max2) const {
+      for (size_type i=0; i < (D ? D : N); ++i)
+        if (max[i] < min2[i] || min[i] > max2[i]) return false;
+      return true;
+    }
+    template <size_type D>
+    bool accept(const scalar_type *min2, const scalar_type *max2) const
+    { return match<D>(min2, max2); }
+  };
+
+  /* match boxes containing [min..max] */
+  struct rtree_contains_p : public rtree_intersection_p {
+    rtree_contains_p(const base_node& min_, const base_node& max_)
+      : rtree_intersection_p(min_, max_) {}
+    template <size_type D>
+    bool match(const scalar_type *min2, const scalar_type *max2) const {
+      for (size_type i=0; i < (D ? D : N); ++i)
+        if (!(min2[i] <= min[i] && max2[i] >= max[i])) return false;
+      return true;
+    }
+  };
+
+  /* match boxes contained in [min..max] */
+  struct rtree_contained_p : public rtree_intersection_p {
+    rtree_contained_p(const base_node& min_, const base_node& max_)
+      : rtree_intersection_p(min_, max_) {}
+    template <size_type D>
+    bool match(const scalar_type *min2, const scalar_type *max2) const {
+      for (size_type i=0; i < (D ? D : N); ++i)
+        if (!(min[i] <= min2[i] && max[i] >= max2[i])) return false;
+      return true;
+    }
+  };
+
+  /* match boxes containing P */
+  struct rtree_has_point_p : public rtree_intersection_p {
+    rtree_has_point_p(const base_node& P) : rtree_intersection_p(P, P) {}
+  };
+
+  /* match boxes intersecting the line passing through org and of
+     direction vector dirv, and intersecting [min..max] if bounded. */
+  struct rtree_intersect_line_p {
+    const scalar_type *org, *dirv, *min, *max; size_type N;
+    rtree_intersect_line_p(const base_node& org_,
+                           const base_small_vector &dirv_)
+      : org(&*org_.begin()), dirv(&*dirv_.begin()), min(0), max(0),
+        N(org_.size())
+    { GMM_ASSERT1(N == dirv_.size(), "Dimensions mismatch"); }
+    rtree_intersect_line_p(const base_node& org_,
+                           const base_small_vector &dirv_,
+                           const base_node& min_, const base_node& max_)
+      : org(&*org_.begin()), dirv(&*dirv_.begin()), min(&*min_.begin()),
+        max(&*max_.begin()), N(org_.size())
+    { GMM_ASSERT1(N == dirv_.size(), "Dimensions mismatch"); }
+    template <size_type D>
+    bool match(const scalar_type *min2, const scalar_type *max2) const {
+      const size_type n = D ? D : N;
+      if (min)
+        for (size_type i = 0; i < n; ++i)
+          if (max[i] < min2[i] || min[i] > max2[i]) return false;
+      for (size_type i = 0; i < n; ++i)
+        if (dirv[i] != scalar_type(0)) {
+          scalar_type a1=(min2[i]-org[i])/dirv[i], a2=(max2[i]-org[i])/dirv[i];
+          bool interf1 = true, interf2 = true;
+          for (size_type j = 0; j < n; ++j)
+            if (j != i) {
+              scalar_type y1 = org[j] + a1*dirv[j], y2 = org[j] + a2*dirv[j];
+              if (y1 < min2[j] || y1 > max2[j]) interf1 = false;
+              if (y2 < min2[j] || y2 > max2[j]) interf2 = false;
+            }
+          if (interf1 || interf2) return true;
+        }
+      return false;
+    }
+    template <size_type D>
+    bool accept(const scalar_type *min2, const scalar_type *max2) const
+    { return match<D>(min2, max2); }
   };
 
   /** Balanced tree of n-dimensional rectangles.
    *
-   * This is not a dynamic structure. Once a query has been made on the
-   * tree, new boxes should not be added.
+   * The tree is bulk-loaded at the first query (or by build_tree()) with
+   * the Sort-Tile-Recursive algorithm: the boxes are sorted into tiles of
+   * RECTS_PER_NODE boxes and each level of the tree groups RECTS_PER_NODE
+   * consecutive nodes of the level below. The coordinates of the boxes and
+   * of the nodes are stored contiguously, level by level, so that a query
+   * does not allocate anything except for its output. Adding a box after
+   * a query invalidates the tree, which is rebuilt at the next query.
+   * Moving a box with set_box() keeps the tree, which is refitted at the
+   * next query (see refit()).
+   *
+   * The results can be obtained in a std::set (sorted by address), in a
+   * std::vector sorted by id, or by a callback which is called in the
+   * order of the traversal of the tree. Once the tree is built, concurrent
+   * queries from several threads are safe.
    */
   class rtree : public boost::noncopyable {
   public:
+    enum { RECTS_PER_NODE=8 };
     typedef std::deque<box_index> box_cont;
     typedef std::vector<const box_index*> pbox_cont;
     typedef std::set<const box_index*> pbox_set;
@@ -73,9 +168,48 @@ namespace bgeot {
       box_index bi; bi.min = min; bi.max = max;
       bi.id = (id + 1) ? id : boxes.size();
       boxes.push_back(bi);
+      tree_built = false;
+    }
+    /** Change the corners of the i-th added box. */
+    void set_box(size_type i, const base_node &min, const base_node &max) {
+      GMM_ASSERT1(i < boxes.size(), "Box index out of range");
+      boxes[i].min = min; boxes[i].max = max;
+      boxes_moved = true;
     }
     size_type nb_boxes() const { return boxes.size(); }
-    void clear() { root = std::unique_ptr<rtree_elt_base>(); boxes.clear(); }
+    void clear() { boxes.clear(); clear_tree(); }
+
+    /** Update the tree after some boxes have been moved by set_box(). The
+        bounding boxes of the nodes are recomputed from the leaves, the
+        structure of the tree being kept, unless the sum of the extents of
+        the nodes, relative to the extent of the root, has grown by more
+        than the rebuild ratio since the tree has been built. The tree is
+        rebuilt in that case. Return true if the tree has been (re)built.
+        This is done automatically at the next query.
+    */
+    bool refit();
+    void set_rebuild_ratio(scalar_type r) { rebuild_ratio = r; }
+
+    /* Call f(const box_index *) for each box of the tree matching the
+       query. */
+    template <typename F> void for_each_intersecting_box
+    (const base_node& bmin, const base_node& bmax, F f)
+    { walk(rtree_intersection_p(bmin, bmax), f); }
+    template <typename F> void for_each_containing_box
+    (const base_node& bmin, const base_node& bmax, F f)
+    { walk(rtree_contains_p(bmin, bmax), f); }
+    template <typename F> void for_each_contained_box
+    (const base_node& bmin, const base_node& bmax, F f)
+    { walk(rtree_contained_p(bmin, bmax), f); }
+    template <typename F> void for_each_box_at_point
+    (const base_node& P, F f) { walk(rtree_has_point_p(P), f); }
+    template <typename F> void for_each_line_intersecting_box
+    (const base_node& org, const base_small_vector& dirv, F f)
+    { walk(rtree_intersect_line_p(org, dirv), f); }
+    template <typename F> void for_each_line_intersecting_box
+    (const base_node& org, const base_small_vector& dirv,
+     const base_node& bmin, const base_node& bmax, F f)
+    { walk(rtree_intersect_line_p(org, dirv, bmin, bmax), f); }
 
     void find_intersecting_boxes(const base_node& bmin, const base_node& bmax,
                                  pbox_set& boxlst);
@@ -93,55 +227,147 @@ namespace bgeot {
                                       const base_node& bmax,
                                       pbox_set& boxlst);
 
+    /* Versions with the boxes stored in a vector sorted by id. */
     void find_intersecting_boxes(const base_node& bmin, const base_node& bmax,
-                                 std::vector<size_type>& idvec) {
-      pbox_set bs;
-      find_intersecting_boxes(bmin, bmax, bs);
-      pbox_set_to_idvec(bs, idvec);
-    }
+                                 pbox_cont& boxlst)
+    { find_matching_boxes(rtree_intersection_p(bmin, bmax), boxlst); }
     void find_containing_boxes(const base_node& bmin, const base_node& bmax,
-                               std::vector<size_type>& idvec) {
-      pbox_set bs;
-      find_containing_boxes(bmin, bmax, bs);
-      pbox_set_to_idvec(bs, idvec);
+                               pbox_cont& boxlst)
+    { find_matching_boxes(rtree_contains_p(bmin, bmax), boxlst); }
+    void find_contained_boxes(const base_node& bmin, const base_node& bmax,
+                              pbox_cont& boxlst)
+    { find_matching_boxes(rtree_contained_p(bmin, bmax), boxlst); }
+    void find_boxes_at_point(const base_node& P, pbox_cont& boxlst)
+    { find_matching_boxes(rtree_has_point_p(P), boxlst); }
+    void find_line_intersecting_boxes(const base_node& org,
+                                      const base_small_vector& dirv,
+                                      pbox_cont& boxlst)
+    { find_matching_boxes(rtree_intersect_line_p(org, dirv), boxlst); }
+    void find_line_intersecting_boxes(const base_node& org,
+                                      const base_small_vector& dirv,
+                                      const base_node& bmin,
+                                      const base_node& bmax,
+                                      pbox_cont& boxlst) {
+      find_matching_boxes(rtree_intersect_line_p(org, dirv, bmin, bmax),
+                          boxlst);
     }
+
+    /* Versions returning the sorted ids of the boxes. */
+    void find_intersecting_boxes(const base_node& bmin, const base_node& bmax,
+                                 std::vector<size_type>& idvec)
+    { find_matching_ids(rtree_intersection_p(bmin, bmax), idvec); }
+    void find_containing_boxes(const base_node& bmin, const base_node& bmax,
+                               std::vector<size_type>& idvec)
+    { find_matching_ids(rtree_contains_p(bmin, bmax), idvec); }
     void find_contained_boxes(const base_node& bmin,
                               const base_node& bmax,
-                              std::vector<size_type>& idvec) {
-      pbox_set bs;
-      find_contained_boxes(bmin, bmax, bs);
-      pbox_set_to_idvec(bs, idvec);
-    }
+                              std::vector<size_type>& idvec)
+    { find_matching_ids(rtree_contained_p(bmin, bmax), idvec); }
     void find_boxes_at_point(const base_node& P, std::vector<size_type>& idvec)
-    { pbox_set bs; find_boxes_at_point(P, bs);  pbox_set_to_idvec(bs, idvec); }
+    { find_matching_ids(rtree_has_point_p(P), idvec); }
     void find_line_intersecting_boxes(const base_node& org,
                                       const base_small_vector& dirv,
-                                      std::vector<size_type>& idvec) {
-      pbox_set bs;
-      find_line_intersecting_boxes(org, dirv, bs);
-      pbox_set_to_idvec(bs, idvec);
-    }
+                                      std::vector<size_type>& idvec)
+    { find_matching_ids(rtree_intersect_line_p(org, dirv), idvec); }
     void find_line_intersecting_boxes(const base_node& org,
                                       const base_small_vector& dirv,
                                       const base_node& bmin,
                                       const base_node& bmax,
                                       std::vector<size_type>& idvec) {
-      pbox_set bs;
-      find_line_intersecting_boxes(org, dirv, bmin, bmax, bs);
-      pbox_set_to_idvec(bs, idvec);
+      find_matching_ids(rtree_intersect_line_p(org, dirv, bmin, bmax),
+                        idvec);
     }
 
+    /** Batched queries: the boxes matching the i-th query are stored,
+        sorted by id, in boxlst[offsets[i]] ... boxlst[offsets[i+1]-1].
+    */
+    void find_intersecting_boxes(const std::vector<base_node>& bmins,
+                                 const std::vector<base_node>& bmaxs,
+                                 std::vector<size_type>& offsets,
+                                 pbox_cont& boxlst);
+    void find_boxes_at_points(const std::vector<base_node>& pts,
+                              std::vector<size_type>& offsets,
+                              pbox_cont& boxlst);
+
     void dump();
     void build_tree();
+
+    rtree() : N(0), rebuild_ratio(2), tree_quality(0), tree_built(false),
+              boxes_moved(false) {}
+
   private:
-    static void pbox_set_to_idvec(pbox_set bs, std::vector<size_type>& idvec) {
-      idvec.reserve(bs.size()); idvec.resize(0);
-      for (pbox_set::const_iterator it=bs.begin(); it != bs.end(); ++it)
-        idvec.push_back((*it)->id);
+    template <typename Predicate>
+    void find_matching_boxes(const Predicate &p, pbox_cont& boxlst) {
+      boxlst.resize(0);
+      walk(p, [&boxlst](const box_index *b) { boxlst.push_back(b); });
+      std::sort(boxlst.begin(), boxlst.end(),
+                [](const box_index *a, const box_index *b)
+                { return a->id < b->id; });
+    }
+
+    template <typename Predicate>
+    void find_matching_ids(const Predicate &p, std::vector<size_type>& idvec) {
+      idvec.resize(0);
+      walk(p, [&idvec](const box_index *b) { idvec.push_back(b->id); });
+      std::sort(idvec.begin(), idvec.end());
+    }
+
+    template <typename Predicate, typename F>
+    void walk(const Predicate &p, F f) {
+      if (!tree_built || boxes_moved) build_tree();
+      if (boxes.size() == 0) return;
+      GMM_ASSERT1(p.N == N, "Dimensions mismatch");
+      switch (N) {
+      case 1 : walk_root<1>(p, f); break;
+      case 2 : walk_root<2>(p, f); break;
+      case 3 : walk_root<3>(p, f); break;
+      default : walk_root<0>(p, f); break;
+      }
     }
 
+    template <size_type D, typename Predicate, typename F>
+    void walk_root(const Predicate &p, F &f) const {
+      size_type top = level_sizes.size() - 1;
+      const scalar_type *c = &node_coords[level_start[top]*2*N];
+      if (p.template accept<D>(c, c+N)) walk_node<D>(top, 0, p, f);
+    }
+
+    /* visit the children of the node i of the level l */
+    template <size_type D, typename Predicate, typename F>
+    void walk_node(size_type l, size_type i, const Predicate &p, F &f) const {
+      const size_type n = D ? D : N;
+      size_type first = i*RECTS_PER_NODE;
+      size_type last = std::min(first+RECTS_PER_NODE, level_sizes[l-1]);
+      if (l == 1) {
+        const scalar_type *c = &box_coords[first*2*n];
+        for (size_type j = first; j < last; ++j, c += 2*n)
+          if (p.template match<D>(c, c+n)) f(sorted_boxes[j]);
+      } else {
+        const scalar_type *c = &node_coords[(level_start[l-1]+first)*2*n];
+        for (size_type j = first; j < last; ++j, c += 2*n)
+          if (p.template accept<D>(c, c+n)) walk_node<D>(l-1, j, p, f);
+      }
+    }
+
+    void clear_tree();
+    void bulk_load();
+    bool refit_boxes();
+    void compute_node_boxes();
+    scalar_type nodes_extent() const;
+
     box_cont boxes;
-    std::unique_ptr<rtree_elt_base> root;
+    size_type N;
+    pbox_cont sorted_boxes; // boxes in the order of the leaves of the tree
+    /* lower and upper corners of the boxes (in the order of sorted_boxes)
+       and of the nodes of the tree, level by level. */
+    std::vector<scalar_type> box_coords, node_coords;
+    /* number of boxes (level 0) and of nodes of each level, and index of
+       the first node of each level in node_coords. */
+    std::vector<size_type> level_sizes, level_start;
+    /* sum of the extents of the nodes relative to the one of the root,
+       when the tree has been built. */
+    scalar_type rebuild_ratio, tree_quality;
+    std::atomic<bool> tree_built, boxes_moved;
     getfem::lock_factory locks_;
   };
 
@@ -115,16 +115,53 @@ namespace bgeot {
     return o;
   }
 
-  template<class T> class tensor : public std::vector<T> {
+  /** Allocator of the components of a tensor. The default one allocates
+   *  on the heap. The one built on an external storage of capacity n
+   *  returns this storage for any allocation of at most n components and
+   *  never releases it, which allows a set of tensors to be laid out in a
+   *  common arena (see tensor::set_storage). A copy of a tensor is always
+   *  allocated on the heap.
+   */
+  template<class T> class tensor_allocator {
+    T *p_;
+    size_t n_;
+
+  public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    typedef std::false_type propagate_on_container_copy_assignment;
+
+    T *allocate(size_t n)
+    { return (p_ && n <= n_) ? p_ : std::allocator<T>().allocate(n); }
+    void deallocate(T *p, size_t n)
+    { if (p != p_) std::allocator<T>().deallocate(p, n); }
+    tensor_allocator select_on_container_copy_construction() const
+    { return tensor_allocator(); }
+
+    bool operator ==(const tensor_allocator &a) const
+    { return p_ == a.p_ && n_ == a.n_; }
+    bool operator !=(const tensor_allocator &a) const
+    { return !(*this == a); }
+
+    tensor_allocator() : p_(0), n_(0) {}
+    tensor_allocator(T *p, size_t n) : p_(p), n_(n) {}
+    template<class U> tensor_allocator(const tensor_allocator<U> &)
+      : p_(0), n_(0) {}
+  };
+
+  template<class T> class tensor
+    : public std::vector<T, tensor_allocator<T> > {
     protected:
 
     multi_index sizes_, coeff;
 
     public:
 
-    typedef typename std::vector<T>::size_type size_type;
-    typedef typename std::vector<T>::iterator iterator;
-    typedef typename std::vector<T>::const_iterator const_iterator;
+    typedef std::vector<T, tensor_allocator<T> > vector_type;
+    typedef typename vector_type::size_type size_type;
+    typedef typename vector_type::iterator iterator;
+    typedef typename vector_type::const_iterator const_iterator;
 
     template<class CONT> inline const T& operator ()(const CONT &c) const {
       typename CONT::const_iterator it = c.begin();
@@ -194,7 +231,7 @@ namespace bgeot {
       return *(this->begin() + d);
     }
 
-    inline size_type size(void) const { return std::vector<T>::size(); }
+    inline size_type size(void) const { return vector_type::size(); }
     inline size_type size(size_type i) const { return sizes_[i]; }
     inline const multi_index &sizes(void) const { return sizes_; }
     inline size_type order(void) const { return sizes_.size(); }
@@ -292,8 +329,20 @@ namespace bgeot {
         + sizeof(*this) + sizes_.memsize() + coeff.memsize();
     }
 
-    std::vector<T> &as_vector(void) { return *this; }
-    const std::vector<T> &as_vector(void) const { return *this; }
+    vector_type &as_vector(void) { return *this; }
+    const vector_type &as_vector(void) const { return *this; }
+
+    /** Move the components to the external storage p of capacity n, which
+     *  has to be kept by the caller as long as the tensor uses it, or back
+     *  to the heap if p is null. The components go back to the heap if the
+     *  tensor is later resized beyond n.
+     */
+    void set_storage(T *p, size_type n) {
+      vector_type v((tensor_allocator<T>(p, n)));
+      v.reserve(p ? std::max(n, this->size()) : this->size());
+      v.assign(this->begin(), this->end());
+      vector_type::operator =(std::move(v));
+    }
 
 
     tensor<T>& operator +=(const tensor<T>& w)
@@ -356,18 +405,20 @@ namespace bgeot {
           mi[k] = size_type(sizes()[k] - 1);
         pf += dd; pft += ddt;
       } else {
-        const_iterator pl = pft; iterator pt = tmp.begin();
+        const_iterator pl = pft;
+        typename std::vector<T>::iterator pt = tmp.begin();
         *pt++ = *pl;
         for(size_type k = 1; k < dimt; ++k, ++pt) { pl += cot; *pt = *pl;}
 
         iterator pff = pf;
         for (size_type k = 0; k < dim; ++k) {
           if (k) pff += co;
-          *pff = T(0); pt = tmp.begin(); pl = m.begin() + k;
-          *pff += (*pl) * (*pt); ++pt;
+          typename std::vector<T>::const_iterator pm = m.begin() + k;
+          *pff = T(0); pt = tmp.begin();
+          *pff += (*pm) * (*pt); ++pt;
           for (size_type l = 1; l < dimt; ++l, ++pt) {
-            pl += dim;
-            *pff += (*pl) * (*pt);
+            pm += dim;
+            *pff += (*pm) * (*pt);
           }
         }
       }
@@ -422,16 +473,18 @@ namespace bgeot {
         pf += dd; pft += ddt;
       }
       else {
-        const_iterator pl = pft; iterator pt = tmp.begin();
+        const_iterator pl = pft;
+        typename std::vector<T>::iterator pt = tmp.begin();
         *pt++ = *pl;
         for(size_type k = 1; k < dimt; ++k, ++pt) { pl += cot; *pt = *pl; }
 
-        iterator pff = pf; pl = m.begin();
+        iterator pff = pf;
+        typename std::vector<T>::const_iterator pm = m.begin();
         for (size_type k = 0; k < dim; ++k) {
           if (k) pff += co;
           *pff = T(0); pt = tmp.begin();
-          for (size_type l = 0; l < dimt; ++l, ++pt, ++pl)
-            *pff += (*pl) * (*pt);
+          for (size_type l = 0; l < dimt; ++l, ++pt, ++pm)
+            *pff += (*pm) * (*pt);
         }
       }
     }
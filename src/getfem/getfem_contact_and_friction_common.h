@@ -608,6 +608,8 @@ namespace getfem {
     // Compute the influence boxes of master boundary elements. To be run
     // before the detection of contact pairs. The influence box is the
     // bounding box extended by a distance equal to the release distance.
+    // The rtree of the previous call is refitted if the master faces are
+    // unchanged.
     void compute_influence_boxes(void);
 
     // For delaunay triangulation. Advantages compared to influence boxes:
@@ -179,6 +179,46 @@ namespace getfem {
   void ga_undefine_function(const std::string &name);
   bool ga_function_exists(const std::string &name);
 
+  //=========================================================================
+  // Profiling of the assembly.
+  //=========================================================================
+
+  /** Execution times (in seconds) and numbers of executions accumulated
+   *  by the assemblies of a workspace or a model on which the profiling
+   *  has been enabled. The times of the instructions executed in parallel
+   *  by several threads are summed.
+   */
+  struct ga_assembly_profile {
+    struct entry {
+      scalar_type time;
+      size_type count;
+      entry() : time(0), count(0) {}
+    };
+    /// By type of instruction.
+    std::map<std::string, entry> instructions;
+    /// By expression. An instruction shared by several expressions is
+    /// accounted for the first one which has been compiled.
+    std::map<std::string, entry> expressions;
+    /// By integration method and region (the count is the number of
+    /// assemblies).
+    std::map<std::string, entry> regions;
+    /// By brick of a model (the count is the number of assemblies).
+    std::map<std::string, entry> bricks;
+    /// Measured cost of a reading of the clock. It is subtracted from the
+    /// time of each execution of an instruction, and from the times of the
+    /// regions for each instruction executed.
+    scalar_type clock_overhead;
+
+    ga_assembly_profile() : clock_overhead(0) {}
+    void clear();
+    /** Accumulate the entries of another profile, for instance the one of
+     *  a thread of an assembly distributed on several workspaces (the
+     *  regions are then counted once per thread). */
+    void add(const ga_assembly_profile &p);
+    /** Print the entries sorted by decreasing time. */
+    void print(std::ostream &ost) const;
+  };
+
   //=========================================================================
   // Structure dealing with user defined environment : constant, variables,
   // functions, operators.
@@ -293,11 +333,25 @@ namespace getfem {
 
 
     std::shared_ptr<model_real_sparse_matrix> K;
+    gmm::bsr_matrix<scalar_type> *K_bsr = 0;
     model_real_sparse_matrix unreduced_K;
     std::shared_ptr<base_vector> V;
     base_vector unreduced_V;
     scalar_type E = scalar_type(0.);
     base_tensor assemb_t;
+    bool colored_assembly = false;
+    bool fixed_pattern_assembly = true;
+    bool batched_base_evaluation = true;
+    bool sum_factorization = true;
+    bool unrolled_instructions = true;
+    bool tensor_arena = true;
+    ga_assembly_profile *profile = 0;
+
+    // Compiled instructions of the previous assemblies for each order.
+    // Cleared by any modification of the expressions, variables, groups,
+    // macros or transformations of the workspace.
+    struct compiled_instructions;
+    std::map<size_type, std::shared_ptr<compiled_instructions>> compiled;
 
   public:
 
@@ -310,7 +364,19 @@ namespace getfem {
     void set_assembled_matrix(model_real_sparse_matrix &K_) {
       K = std::shared_ptr<model_real_sparse_matrix>
           (std::shared_ptr<model_real_sparse_matrix>(), &K_);
+      K_bsr = 0;
     }
+    /** Assemble the matrix terms directly into the block sparse row matrix
+     *  K_ instead of the assembled matrix, until another matrix is set.
+     *  All the matrix terms have to be on variables sharing the same
+     *  non reduced mesh_fem of scalar fems, the block size being its qdim,
+     *  without interpolate transformation. The pattern of the blocks is
+     *  built from the element connectivity of the mesh_fem at the first
+     *  assembly, then kept while the compiled instructions are reused.
+     */
+    void set_assembled_matrix(gmm::bsr_matrix<scalar_type> &K_)
+    { K_bsr = &K_; }
+    gmm::bsr_matrix<scalar_type> *assembled_bsr_matrix() { return K_bsr; }
     void set_assembled_vector(base_vector &V_) {
       V = std::shared_ptr<base_vector>
           (std::shared_ptr<base_vector>(), &V_);
@@ -322,6 +388,87 @@ namespace getfem {
     { return unreduced_K; }
     base_vector &unreduced_vector() { return unreduced_V; }
 
+    /** Enable or disable the multithreaded execution of the assembly
+     *  based on a coloring of the elements (disabled by default, as
+     *  for the model, see model::set_colored_assembly). It is
+     *  used only when the assembly is called outside a parallel section
+     *  with several threads and when all the terms only contribute to the
+     *  dofs of the current element (no interpolate transformation and no
+     *  fixed size test variable). Each thread then adds its contributions
+     *  directly to the assembled matrix or vector.
+     */
+    void set_colored_assembly(bool b) { colored_assembly = b; }
+    bool is_colored_assembly() const { return colored_assembly; }
+
+    /** Enable or disable the assembly of the tangent matrix on a fixed
+     *  pattern (enabled by default). When the compiled instructions are
+     *  reused, the sparsity pattern of the matrix terms is recorded once,
+     *  and the element matrices of the following assemblies are directly
+     *  added into a compressed sparse column matrix having this pattern,
+     *  the position of each entry being computed once for each element.
+     *  This compressed matrix is then added to the assembled matrix, the
+     *  relative threshold of 1E-14 under which the entries are neglected
+     *  being applied on each column instead of each element matrix.
+     */
+    void set_fixed_pattern_assembly(bool b) { fixed_pattern_assembly = b; }
+    bool is_fixed_pattern_assembly() const { return fixed_pattern_assembly; }
+
+    /** Enable or disable the evaluation of the gradients and Hessians of
+     *  the base functions for all the integration points of an element at
+     *  once (enabled by default). It applies to standard fems on elements
+     *  with a linear geometric transformation. The instructions already
+     *  compiled are discarded when the option changes.
+     */
+    void set_batched_base_evaluation(bool b) {
+      if (b != batched_base_evaluation) compiled.clear();
+      batched_base_evaluation = b;
+    }
+    bool is_batched_base_evaluation() const
+    { return batched_base_evaluation; }
+
+    /** Enable or disable the interpolation of the values and gradients of
+     *  the fem variables by sum factorization on the elements having a
+     *  tensor product structure (enabled by default). The instructions
+     *  already compiled are discarded when the option changes.
+     */
+    void set_sum_factorization(bool b) {
+      if (b != sum_factorization) compiled.clear();
+      sum_factorization = b;
+    }
+    bool is_sum_factorization() const { return sum_factorization; }
+
+    /** Enable or disable the instructions whose size is fixed at compile
+     *  time for the operations on small tensors not depending on the test
+     *  functions (enabled by default). The instructions already compiled
+     *  are discarded when the option changes.
+     */
+    void set_unrolled_instructions(bool b) {
+      if (b != unrolled_instructions) compiled.clear();
+      unrolled_instructions = b;
+    }
+    bool is_unrolled_instructions() const { return unrolled_instructions; }
+
+    /** Enable or disable the layout of the intermediary tensors of the
+     *  compiled expressions in a common arena, the tensors evaluated on
+     *  each integration point sharing their storage when their values are
+     *  not used at the same time (enabled by default). The instructions
+     *  already compiled are discarded when the option changes.
+     */
+    void set_tensor_arena(bool b) {
+      if (b != tensor_arena) compiled.clear();
+      tensor_arena = b;
+    }
+    bool is_tensor_arena() const { return tensor_arena; }
+
+    /** Enable the profiling of the assembly, the execution statistics of
+     *  the following assemblies being accumulated into the given profile,
+     *  or disable it if p is null (default). The execution of each
+     *  instruction being timed, the assembly is slower when enabled. The
+     *  measured cost of the clock is subtracted from the reported times.
+     */
+    void set_assembly_profile(ga_assembly_profile *p) { profile = p; }
+    ga_assembly_profile *assembly_profile() const { return profile; }
+
     /** Add an expression, perform the semantic analysis, split into
      *  terms in separated test functions, derive if necessary to obtain
      *  the tangent terms. Return the maximal order found in the expression.
@@ -417,7 +564,7 @@ namespace getfem {
     bool macro_exists(const std::string &name) const;
 
     void add_macro(const std::string &name, const std::string &expr)
-    { macros[name] = expr; }
+    { compiled.clear(); macros[name] = expr; }
 
     const std::string& get_macro(const std::string &name) const;
 
@@ -436,7 +583,7 @@ namespace getfem {
 
     void add_elementary_transformation(const std::string &name,
                                        pelementary_transformation ptrans)
-    { elem_transformations[name] = ptrans; }
+    { compiled.clear(); elem_transformations[name] = ptrans; }
 
     bool elementary_transformation_exists(const std::string &name) const;
 
@@ -451,7 +598,18 @@ namespace getfem {
     std::string extract_Neumann_term(const std::string &varname);
 
 
-    void assembly(size_type order);
+    /** Assembly of the terms of the given order. The compiled instructions
+     *  are kept and reused by the next assemblies as long as the involved
+     *  meshes, mesh_fems and mesh_ims are unchanged, the variables have the
+     *  same storage and intervals and the fixed size data the same values.
+     *  If with_residual is true and the order is 2, the terms of order 1
+     *  are assembled into the assembled vector in the same loop on the
+     *  elements as the terms of order 2. The subexpressions common to the
+     *  residual and the tangent terms (the deformation gradient of a
+     *  hyperelastic law for instance) are then computed only once on each
+     *  Gauss point.
+     */
+    void assembly(size_type order, bool with_residual = false);
 
 
     ga_workspace(const getfem::model &md_, bool enable_all_variables = false)
@@ -468,6 +626,44 @@ namespace getfem {
 
   };
 
+  /** Matrix-free tangent operator of a workspace. The product y = K x,
+   *  where K is the tangent matrix of the order 2 terms of the workspace,
+   *  is computed by the assembly of the weak form obtained by replacing the
+   *  second test functions by the corresponding fields of x, so that
+   *  neither the global sparse matrix nor the element matrices are formed.
+   *  The vectors have the size of the unknowns of the workspace, which has
+   *  to remain unchanged during the lifetime of the operator. It can be
+   *  used with the iterative solvers of gmm (gmm::cg, gmm::gmres ...).
+   */
+  class ga_tangent_operator {
+    ga_workspace &parent;
+    mutable ga_workspace workspace;
+    // Fields of the input vector for each variable of the second test
+    // functions.
+    mutable std::map<std::string, model_real_plain_vector> X;
+
+  public:
+    void mult(const base_vector &x, base_vector &y) const;
+    explicit ga_tangent_operator(ga_workspace &w);
+  };
+
+  template <typename V1, typename V2>
+  inline void mult(const ga_tangent_operator &K, const V1 &x, V2 &y) {
+    base_vector xx(gmm::vect_size(x)), yy(gmm::vect_size(y));
+    gmm::copy(x, xx);
+    K.mult(xx, yy);
+    gmm::copy(yy, y);
+  }
+
+  template <typename V1, typename V2, typename V3>
+  inline void mult(const ga_tangent_operator &K, const V1 &x, const V2 &b,
+                   V3 &y) {
+    base_vector xx(gmm::vect_size(x)), yy(gmm::vect_size(y));
+    gmm::copy(x, xx);
+    K.mult(xx, yy);
+    gmm::add(b, yy, y);
+  }
+
   // Small tool to make basic substitutions into an assembly string
   std::string ga_substitute(const std::string &expr,
                             const std::map<std::string, std::string> &dict);
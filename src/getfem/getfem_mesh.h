@@ -58,6 +58,13 @@ namespace getfem {
   /**@addtogroup mesh*/
   /**@{*/
 
+  /** Orderings of the convexes of a mesh for mesh::reorder. */
+  enum mesh_ordering {
+    MESH_ORDERING_RCM,     /* reverse Cuthill-McKee */
+    MESH_ORDERING_HILBERT, /* Hilbert curve through the barycenters */
+    MESH_ORDERING_MORTON   /* Morton (Z-order) curve through the barycenters */
+  };
+
   /** Describe a mesh (collection of convexes (elements) and points).
       Note that mesh object have no copy constructor, use
       mesh::copy_from instead.  This class inherits from
@@ -122,6 +129,9 @@ namespace getfem {
     mutable bool cuthill_mckee_uptodate;
     dal::dynamic_array<gmm::uint64_type> cvs_v_num;
     mutable std::vector<size_type> cmk_order; // cuthill-mckee
+    mutable std::shared_ptr<const bgeot::mesh_structure_csr> frozen;
+    mutable atomic_bool frozen_uptodate;
+    lock_factory frozen_locks_;
     void init();
 
 #if GETFEM_PARA_LEVEL > 1
@@ -133,6 +143,7 @@ namespace getfem {
 
     void touch() {
       modified = true; cuthill_mckee_uptodate = false;
+      frozen_uptodate = false; frozen.reset();
       context_dependencies::touch();
     }
     void compute_mpi_region() const ;
@@ -150,8 +161,11 @@ namespace getfem {
     }
     void intersect_with_mpi_region(mesh_region &rg) const;
 #else
-    void touch()
-    { cuthill_mckee_uptodate = false; context_dependencies::touch(); }
+    void touch() {
+      cuthill_mckee_uptodate = false; frozen_uptodate = false;
+      frozen.reset();
+      context_dependencies::touch();
+    }
   public :
     const mesh_region get_mpi_region() const
     { return mesh_region::all_convexes(); }
@@ -174,7 +188,8 @@ namespace getfem {
     using basic_mesh::dim;
     /// Return the array of PT.
     using basic_mesh::points;
-    PT_TAB &points() { return pts; } // non-const version
+    PT_TAB &points() // non-const version
+    { frozen_uptodate = false; return pts; }
 
     /// Return a (pseudo)container of the points of a given convex
     using basic_mesh::points_of_convex;
@@ -200,7 +215,8 @@ namespace getfem {
     void sup_point(size_type i) { if (!is_point_valid(i)) pts.sup_node(i); }
     /// Swap the indexes of points of index i and j in the whole structure.
     void swap_points(size_type i, size_type j)
-    { if (i != j) { pts.swap_points(i,j); mesh_structure::swap_points(i,j); } }
+    { if (i != j) { pts.swap_points(i,j); mesh_structure::swap_points(i,j);
+                    frozen_uptodate = false; } }
     /** Search a point given its coordinates.
         @param pt the point that is searched.
         @return the point index if pt was found in (or approximatively in)
@@ -444,8 +460,25 @@ namespace getfem {
     /** Pack the mesh : renumber convexes and nodes such that there
         is no holes in their numbering. Do NOT do the Cuthill-McKee. */
     void optimize_structure(bool with_renumbering = true);
+    /** Pack the mesh and renumber the convexes along a space filling
+        curve or in the reverse Cuthill-McKee order. The points are then
+        numbered in the order of their first appearance in the convexes
+        and the regions are updated. Improves the memory locality of the
+        loops on elements and reduces the bandwidth of the matrices of
+        the mesh_fem enumerated afterwards. */
+    void reorder(mesh_ordering ord = MESH_ORDERING_HILBERT);
     /// Return the list of convex IDs for a Cuthill-McKee ordering
     const std::vector<size_type> &cuthill_mckee_ordering() const;
+    /** Return a compact read-only copy of the mesh structure and of the
+        point coordinates. To be used by the loops on the whole mesh which
+        only read it, it is faster to traverse than the mesh itself. The
+        copy is built at the first call and kept by the mesh, in addition
+        to its own structure, until the next modification of the mesh
+        (about the memory of the convex structure and of the points).
+        A copy held by a caller is not modified by the later modifications
+        of the mesh, the next call building a new one. */
+    std::shared_ptr<const bgeot::mesh_structure_csr>
+    frozen_structure() const;
     /// Erase the mesh.
     void clear();
     /** Write the mesh to a file. The format is getfem-specific.
@@ -473,6 +506,10 @@ namespace getfem {
     friend class mesh_region;
   private:
     void swap_convex_in_regions(size_type c1, size_type c2);
+    void swap_convex_except_regions(size_type i, size_type j);
+    /* Renumber the convexes such that the convex i is the convex ord[i] of
+       the previous numbering. The regions are renumbered at once. */
+    void permute_convexes(const std::vector<size_type> &ord);
     void touch_from_region(size_type /*id*/) { touch(); }
     void to_edges() {} /* to be done, the to_edges of mesh_structure does   */
                        /* not handle geotrans */
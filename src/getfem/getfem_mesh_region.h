@@ -43,14 +43,8 @@
 #include "dal_bit_vector.h"
 #include "bgeot_convex_structure.h"
 #include "getfem_config.h"
-
-// #if __cplusplus > 199711L
-// #include <unordered_map>
-// #elif defined(GETFEM_HAVE_BOOST) && BOOST_VERSION >= 103600
-// #include <boost/unordered_map.hpp>
-// #else
-#include <map>
-// #endif
+#include "getfem_context.h"
+#include <vector>
 
 // #ifdef GETFEM_HAVE_BOOST
 // #include <boost/shared_ptr.hpp>
@@ -67,21 +61,32 @@ namespace getfem {
   public:
     typedef std::bitset<MAX_FACES_PER_CV+1> face_bitset;
 
-    // #if __cplusplus > 199711L
-    //    typedef std::unordered_map<size_type,face_bitset> map_t;
-    // #elif defined(GETFEM_HAVE_BOOST) && BOOST_VERSION >= 103600
-    // typedef boost::unordered_map<size_type,face_bitset> map_t;
-    // #else
-    typedef std::map<size_type,face_bitset> map_t;
-    // #endif
+    /** Contiguous list of the convexes of the region and of their faces
+        (the bit 0 is for the convex itself and the bit f+1 for its face
+        f), sorted by convex number and without empty entry. */
+    typedef std::vector<std::pair<size_type, face_bitset> > flat_map_t;
 
   private:
 
-    typedef map_t::const_iterator const_iterator;
+    typedef flat_map_t::const_iterator const_iterator;
 
     struct impl {
-      mutable map_t m;
+      mutable flat_map_t m;
+      /* convexes added out of order, merged into m at the next access
+         (see add(cv, f)) */
+      mutable flat_map_t pending;
+      mutable atomic_bool has_pending;
+      lock_factory locks_;
       mutable omp_distribute<dal::bit_vector> index_;
+      void merge_pending() const;
+      impl() : has_pending(false) {}
+      impl &operator =(const impl &from) {
+        from.merge_if_pending();
+        m = from.m; index_ = from.index_;
+        pending.clear(); has_pending = false;
+        return *this;
+      }
+      void merge_if_pending() const { if (has_pending) merge_pending(); }
     };
 
     // #ifdef GETFEM_HAVE_BOOST
@@ -103,15 +108,8 @@ namespace getfem {
     mesh *parent_mesh; /* used for mesh_region "extracted" from
                           a mesh (to provide feedback) */
 
-
-    //cashing iterators for paritions
-    mutable omp_distribute<const_iterator> itbegin;
-    mutable omp_distribute<const_iterator> itend;
-    mutable omp_distribute<bool> index_updated;
-    void update_partition_iterators() const;
-
-    impl &wp() { return *p.get(); }
-    const impl &rp() const { return *p.get(); }
+    impl &wp() { p->merge_if_pending(); return *p.get(); }
+    const impl &rp() const { p->merge_if_pending(); return *p.get(); }
     void clean();
     /** tells the owner mesh that the region is valid */
     void touch_parent_mesh();
@@ -214,6 +212,9 @@ namespace getfem {
     void sup_all(size_type cv);
     void clear();
     void swap_convex(size_type cv1, size_type cv2);
+    /** Renumber the convexes of the region: the convex cv becomes the
+        convex new_num[cv] (unchanged if cv >= new_num.size()). */
+    void renumber_convexes(const std::vector<size_type> &new_num);
     bool is_in(size_type cv, short_type f = short_type(-1)) const;
     bool is_in(size_type cv, short_type f, const mesh &m) const;
 
@@ -248,7 +249,7 @@ namespace getfem {
     */
     class visitor {
 
-      typedef mesh_region::map_t::const_iterator const_iterator;
+      typedef mesh_region::flat_map_t::const_iterator const_iterator;
       bool whole_mesh;
       dal::bit_const_iterator itb, iteb;
       const_iterator it, ite;
@@ -81,15 +81,69 @@ namespace getfem {
   struct abstract_linear_solver {
     virtual void operator ()(const MAT &, VECT &, const VECT &,
                              gmm::iteration &) const  = 0;
+
+    /* Factorization (or preconditioner) of a matrix kept for the
+       subsequent calls to solve_factorized (used by the Newton variants
+       reusing the tangent matrix). The matrix is not copied, it has to be
+       kept until the next factorization. The default version only keeps
+       a pointer on the matrix and solves from scratch with it. */
+    virtual void factorize(const MAT &M, gmm::iteration &iter) const {
+      pM = &M;
+      fact_size = gmm::mat_nrows(M);
+      iter.enforce_converged(true);
+    }
+    virtual void solve_factorized(VECT &x, const VECT &b,
+                                  gmm::iteration &iter) const
+    { (*this)(*pM, x, b, iter); }
+    /* Size of the factorized matrix, 0 if none. */
+    size_type factorized_size() const { return fact_size; }
+
+    abstract_linear_solver() : pM(0), fact_size(0) {}
     virtual ~abstract_linear_solver() {}
+
+  protected:
+    mutable const MAT *pM;
+    mutable size_type fact_size;
   };
 
-  template <typename MAT, typename VECT>
-  struct linear_solver_cg_preconditioned_ildlt
+  /* Iterative solvers with a preconditioner of type PRECOND. The
+     preconditioner built by factorize is kept, with a pointer on the
+     matrix, for the subsequent calls to solve_factorized. */
+  template <typename MAT, typename VECT, typename PRECOND>
+  struct linear_solver_preconditioned
     : public abstract_linear_solver<MAT, VECT> {
+    virtual void build_precond(const MAT &M, PRECOND &P) const
+    { P.build_with(M); }
+    virtual void solve(const MAT &M, VECT &x, const VECT &b,
+                       const PRECOND &P, gmm::iteration &iter) const = 0;
+
     void operator ()(const MAT &M, VECT &x, const VECT &b,
-                     gmm::iteration &iter)  const {
-      gmm::ildlt_precond<MAT> P(M);
+                     gmm::iteration &iter) const {
+      PRECOND P;
+      build_precond(M, P);
+      solve(M, x, b, P, iter);
+    }
+    void factorize(const MAT &M, gmm::iteration &iter) const {
+      build_precond(M, Pfact);
+      this->pM = &M;
+      this->fact_size = gmm::mat_nrows(M);
+      iter.enforce_converged(true);
+    }
+    void solve_factorized(VECT &x, const VECT &b,
+                          gmm::iteration &iter) const
+    { solve(*(this->pM), x, b, Pfact, iter); }
+
+  protected:
+    mutable PRECOND Pfact;
+  };
+
+  template <typename MAT, typename VECT>
+  struct linear_solver_cg_preconditioned_ildlt
+    : public linear_solver_preconditioned<MAT, VECT,
+                                          gmm::ildlt_precond<MAT> > {
+    void solve(const MAT &M, VECT &x, const VECT &b,
+               const gmm::ildlt_precond<MAT> &P,
+               gmm::iteration &iter) const {
       gmm::cg(M, x, b, P, iter);
       if (!iter.converged()) GMM_WARNING2("cg did not converge!");
     }
@@ -97,10 +151,11 @@ namespace getfem {
 
   template <typename MAT, typename VECT>
   struct linear_solver_gmres_preconditioned_ilu
-    : public abstract_linear_solver<MAT, VECT> {
-    void operator ()(const MAT &M, VECT &x, const VECT &b,
-                     gmm::iteration &iter)  const {
-      gmm::ilu_precond<MAT> P(M);
+    : public linear_solver_preconditioned<MAT, VECT,
+                                          gmm::ilu_precond<MAT> > {
+    void solve(const MAT &M, VECT &x, const VECT &b,
+               const gmm::ilu_precond<MAT> &P,
+               gmm::iteration &iter) const {
       gmm::gmres(M, x, b, P, 500, iter);
       if (!iter.converged()) GMM_WARNING2("gmres did not converge!");
     }
@@ -119,10 +174,13 @@ namespace getfem {
 
   template <typename MAT, typename VECT>
   struct linear_solver_gmres_preconditioned_ilut
-    : public abstract_linear_solver<MAT, VECT> {
-    void operator ()(const MAT &M, VECT &x, const VECT &b,
-                     gmm::iteration &iter)  const {
-      gmm::ilut_precond<MAT> P(M, 40, 1E-7);
+    : public linear_solver_preconditioned<MAT, VECT,
+                                          gmm::ilut_precond<MAT> > {
+    void build_precond(const MAT &M, gmm::ilut_precond<MAT> &P) const
+    { P.build_with(M, 40, 1E-7); }
+    void solve(const MAT &M, VECT &x, const VECT &b,
+               const gmm::ilut_precond<MAT> &P,
+               gmm::iteration &iter) const {
       gmm::gmres(M, x, b, P, 500, iter);
       if (!iter.converged()) GMM_WARNING2("gmres did not converge!");
     }
@@ -130,28 +188,256 @@ namespace getfem {
 
   template <typename MAT, typename VECT>
   struct linear_solver_gmres_preconditioned_ilutp
-    : public abstract_linear_solver<MAT, VECT> {
-    void operator ()(const MAT &M, VECT &x, const VECT &b,
-                     gmm::iteration &iter)  const {
-      gmm::ilutp_precond<MAT> P(M, 20, 1E-7);
+    : public linear_solver_preconditioned<MAT, VECT,
+                                          gmm::ilutp_precond<MAT> > {
+    void build_precond(const MAT &M, gmm::ilutp_precond<MAT> &P) const
+    { P.build_with(M, 20, 1E-7); }
+    void solve(const MAT &M, VECT &x, const VECT &b,
+               const gmm::ilutp_precond<MAT> &P,
+               gmm::iteration &iter) const {
       gmm::gmres(M, x, b, P, 500, iter);
       if (!iter.converged()) GMM_WARNING2("gmres did not converge!");
     }
   };
 
+  /** Rigid body modes of a vector field described by mf (translations
+      and rotations if the dimension of the field is the one of the mesh,
+      constant components otherwise), one by column of B. Used as near
+      nullspace by the algebraic multigrid preconditioner. */
+  void rigid_body_modes(const mesh_fem &mf,
+                        gmm::dense_matrix<scalar_type> &B);
+
+  /** Near nullspace of the tangent matrix of a model: the rigid body modes
+      of each unknown variable on its dofs. bs is the number of components
+      of the variable if there is only one, 1 otherwise. */
+  void model_near_nullspace(const model &md,
+                            gmm::dense_matrix<scalar_type> &B,
+                            size_type &bs);
+
+  /* Algebraic multigrid preconditioner, the near nullspace is computed
+     from the variables of the model at the first solve. */
+  template <typename MAT, typename VECT>
+  struct linear_solver_amg_base
+    : public linear_solver_preconditioned<MAT, VECT, gmm::amg_precond<MAT> > {
+    const model &md;
+    mutable gmm::dense_matrix<scalar_type> B;
+    mutable size_type bs;
+
+    void build_precond(const MAT &M, gmm::amg_precond<MAT> &P) const {
+      if (gmm::mat_nrows(B) != gmm::mat_nrows(M))
+        model_near_nullspace(md, B, bs);
+      if (gmm::mat_nrows(B) == gmm::mat_nrows(M) && gmm::mat_ncols(B))
+        P.build_with(M, B, bs);
+      else
+        P.build_with(M);
+    }
+    linear_solver_amg_base(const model &md_) : md(md_), bs(1) {}
+  };
+
+  template <typename MAT, typename VECT>
+  struct linear_solver_cg_preconditioned_amg
+    : public linear_solver_amg_base<MAT, VECT> {
+    void solve(const MAT &M, VECT &x, const VECT &b,
+               const gmm::amg_precond<MAT> &P,
+               gmm::iteration &iter) const {
+      gmm::cg(M, x, b, P, iter);
+      if (!iter.converged()) GMM_WARNING2("cg did not converge!");
+    }
+    linear_solver_cg_preconditioned_amg(const model &md_)
+      : linear_solver_amg_base<MAT, VECT>(md_) {}
+  };
+
+  template <typename MAT, typename VECT>
+  struct linear_solver_gmres_preconditioned_amg
+    : public linear_solver_amg_base<MAT, VECT> {
+    void solve(const MAT &M, VECT &x, const VECT &b,
+               const gmm::amg_precond<MAT> &P,
+               gmm::iteration &iter) const {
+      gmm::gmres(M, x, b, P, 500, iter);
+      if (!iter.converged()) GMM_WARNING2("gmres did not converge!");
+    }
+    linear_solver_gmres_preconditioned_amg(const model &md_)
+      : linear_solver_amg_base<MAT, VECT>(md_) {}
+  };
+
+  /* The factorization is kept by the solver object: the ordering and the
+     symbolic analysis are reused from one call to the next one as long as
+     the sparsity pattern of the matrix does not change. */
   template <typename MAT, typename VECT>
   struct linear_solver_superlu
     : public abstract_linear_solver<MAT, VECT> {
     void operator ()(const MAT &M, VECT &x, const VECT &b,
                      gmm::iteration &iter)  const {
-      double rcond;
       /*gmm::HarwellBoeing_IO::write("test.hb", M);
       std::fstream f("bbb", std::ios::out);
       for (unsigned i=0; i < gmm::vect_size(b); ++i) f << b[i] << "\n";*/
-      int info = SuperLU_solve(M, x, b, rcond);
-      iter.enforce_converged(info == 0);
-      if (iter.get_noisy()) cout << "condition number: " << 1.0/rcond<< endl;
+      gmm::iteration iter_fact = iter;
+      factor.set_rcond_estimation(iter.get_noisy() != 0);
+      factorize(M, iter_fact);
+      if (iter_fact.converged()) factor.solve(x, b);
+      else GMM_WARNING1("SuperLU solve failed: singular matrix");
+      iter.enforce_converged(iter_fact.converged());
+      if (iter.get_noisy() && factor.analysis_reused())
+        cout << "reuse of the SuperLU symbolic analysis" << endl;
+      if (iter.get_noisy() && factor.rcond() > 0.)
+        cout << "condition number: " << 1.0/factor.rcond() << endl;
+    }
+
+    void factorize(const MAT &M, gmm::iteration &iter) const {
+      this->fact_size = 0;
+      try {
+        factor.build_with(M);
+        this->fact_size = gmm::mat_nrows(M);
+      } catch (const gmm::gmm_error &) {} // Singular matrix
+      iter.enforce_converged(this->fact_size != 0);
+    }
+    void solve_factorized(VECT &x, const VECT &b,
+                          gmm::iteration &iter) const {
+      factor.solve(x, b);
+      iter.enforce_converged(true);
+    }
+
+  private:
+    mutable gmm::SuperLU_factor<typename gmm::linalg_traits<MAT>::value_type>
+    factor;
+  };
+
+  /* Value type of the single precision factorization used by the mixed
+     precision solver. The complex matrices are still factorized in double
+     precision (no conversion of complex sparse matrices in gmm). */
+  template <typename T> struct lower_precision_type { typedef T type; };
+  template <> struct lower_precision_type<double> { typedef float type; };
+
+  /* Solve with a lower precision factor, the vectors being explicitly
+     rounded to its precision. Also used as a preconditioner for gmres. */
+  template <typename TL> struct lower_precision_precond {
+    const gmm::SuperLU_factor<TL> &factor;
+    template <typename V1, typename V2>
+    void solve(const V1 &b, V2 &x) const {
+      typedef typename gmm::linalg_traits<V2>::value_type T;
+      std::vector<TL> &rhs = factor.rhs();
+      for (size_type i = 0; i < rhs.size(); ++i) rhs[i] = TL(b[i]);
+      factor.solve();
+      const std::vector<TL> &sol = factor.sol();
+      for (size_type i = 0; i < sol.size(); ++i) x[i] = T(sol[i]);
+    }
+    lower_precision_precond(const gmm::SuperLU_factor<TL> &f) : factor(f) {}
+  };
+
+  template <typename TL, typename V1, typename V2> inline
+  void mult(const lower_precision_precond<TL> &P, const V1 &b, V2 &x)
+  { P.solve(b, x); }
+
+  template <typename TL, typename V1, typename V2> inline
+  void mult(const lower_precision_precond<TL> &P, const V1 &b, const V2 &x)
+  { P.solve(b, const_cast<V2 &>(x)); }
+
+  /* SuperLU factorization of a single precision copy of the matrix (half
+     the memory of the double precision one). The double precision accuracy
+     is recovered by iterative refinement on the double precision residual.
+     If the refinement stagnates (badly conditioned matrix), or if
+     use_gmres is true, gmres preconditioned by the single precision
+     factor is used instead. As a last resort, when gmres does not
+     converge either, the matrix is factorized once in double precision
+     and this factorization is used until the next one. The matrix given
+     to factorize is not copied, it is used to compute the residuals of
+     solve_factorized and has to be kept until the next factorization. */
+  template <typename MAT, typename VECT>
+  struct linear_solver_superlu_mixed
+    : public abstract_linear_solver<MAT, VECT> {
+    typedef typename gmm::linalg_traits<MAT>::value_type T;
+    typedef typename gmm::number_traits<T>::magnitude_type R;
+    typedef typename lower_precision_type<T>::type TL;
+
+    void operator ()(const MAT &M, VECT &x, const VECT &b,
+                     gmm::iteration &iter)  const {
+      gmm::iteration iter_fact = iter;
+      factorize(M, iter_fact);
+      if (iter_fact.converged()) solve_factorized(x, b, iter);
+      else {
+        GMM_WARNING1("SuperLU solve failed: singular matrix");
+        iter.enforce_converged(false);
+      }
+    }
+
+    void factorize(const MAT &M, gmm::iteration &iter) const {
+      this->fact_size = 0; this->pM = &M; factor_d.reset();
+      try {
+        gmm::csc_matrix<TL> ML;
+        { // Explicit rounding of the values to the lower precision.
+          gmm::csc_matrix<T> Mc;
+          Mc.init_with(M);
+          ML.nr = Mc.nr; ML.nc = Mc.nc;
+          ML.ir.swap(Mc.ir); ML.jc.swap(Mc.jc);
+          ML.pr.resize(Mc.pr.size());
+          for (size_type i = 0; i < Mc.pr.size(); ++i) ML.pr[i] = TL(Mc.pr[i]);
+        }
+        factor.build_with(ML);
+        this->fact_size = gmm::mat_nrows(M);
+      } catch (const gmm::gmm_error &) {} // Singular matrix
+      iter.enforce_converged(this->fact_size != 0);
+    }
+
+    void solve_factorized(VECT &x, const VECT &b,
+                          gmm::iteration &iter) const {
+      const MAT &M = *(this->pM);
+      size_type n = gmm::vect_size(b);
+      nb_refinements = 0; gmres_used = false;
+      iter.set_rhsnorm(gmm::vect_norm2(b));
+      if (iter.get_rhsnorm() == 0.0)
+        { gmm::clear(x); iter.enforce_converged(true); return; }
+      VECT r(n);
+      if (!factor_d) {
+        lower_precision_precond<TL> P(factor);
+        if (!use_gmres) {
+          VECT d(n);
+          P.solve(b, x);
+          R res_old(0);
+          for (bool first = true; ; first = false) {
+            gmm::mult(M, gmm::scaled(x, T(-1)), b, r);
+            R res = gmm::vect_norm2(r);
+            if (iter.finished(res)) break;
+            if (!first && res > R(0.5) * res_old) break; // Stagnation
+            res_old = res;
+            P.solve(r, d);
+            gmm::add(d, x);
+            ++iter; ++nb_refinements;
+          }
+          if (iter.converged()) return;
+        }
+        gmres_used = true;
+        gmm::gmres(M, x, b, P, 100, iter);
+        if (iter.converged()) return;
+        GMM_WARNING1("gmres did not converge, the matrix is too badly "
+                     "conditioned for the single precision factorization, "
+                     "it is factorized in double precision");
+        factor_d = std::make_shared<gmm::SuperLU_factor<T>>();
+        factor_d->build_with(M);
+      }
+      factor_d->solve(x, b);
+      gmm::mult(M, gmm::scaled(x, T(-1)), b, r);
+      if (!iter.converged(gmm::vect_norm2(r))) {
+        GMM_WARNING1("SuperLU solve failed: residual "
+                     << gmm::vect_norm2(r) / iter.get_rhsnorm());
+        iter.enforce_converged(false);
+      }
     }
+
+    /* Number of refinement steps of the last solve, and whether it needed
+       gmres or the double precision factorization. */
+    size_type nb_refinement_steps() const { return nb_refinements; }
+    bool used_gmres() const { return gmres_used; }
+    bool used_double_precision() const { return bool(factor_d); }
+
+    linear_solver_superlu_mixed(bool use_gmres_ = false)
+      : use_gmres(use_gmres_), nb_refinements(0), gmres_used(false) {}
+
+  private:
+    bool use_gmres;
+    mutable gmm::SuperLU_factor<TL> factor;
+    mutable std::shared_ptr<gmm::SuperLU_factor<T>> factor_d;
+    mutable size_type nb_refinements;
+    mutable bool gmres_used;
   };
 
   template <typename MAT, typename VECT>
@@ -164,25 +450,63 @@ namespace getfem {
       gmm::lu_solve(MM, x, b);
       iter.enforce_converged(true);
     }
+
+    void factorize(const MAT &M, gmm::iteration &iter) const {
+      gmm::resize(LU, gmm::mat_nrows(M), gmm::mat_ncols(M));
+      gmm::copy(M, LU);
+      ipvt.resize(gmm::mat_nrows(M));
+      size_type info = gmm::lu_factor(LU, ipvt);
+      this->fact_size = info ? 0 : gmm::mat_nrows(M);
+      iter.enforce_converged(info == 0);
+    }
+    void solve_factorized(VECT &x, const VECT &b,
+                          gmm::iteration &iter) const {
+      gmm::lu_solve(LU, ipvt, x, b);
+      iter.enforce_converged(true);
+    }
+
+  private:
+    mutable gmm::dense_matrix<typename gmm::linalg_traits<MAT>::value_type> LU;
+    mutable std::vector<int> ipvt;
   };
 
 #ifdef GMM_USES_MUMPS
-  template <typename MAT, typename VECT>
-  struct linear_solver_mumps : public abstract_linear_solver<MAT, VECT> {
+  /* As for SuperLU, the analysis phase of MUMPS is done again only when
+     the sparsity pattern of the matrix changes. */
+  template <typename MAT, typename VECT, bool SYM>
+  struct linear_solver_mumps_factor : public abstract_linear_solver<MAT, VECT> {
     void operator ()(const MAT &M, VECT &x, const VECT &b,
                      gmm::iteration &iter) const {
-      bool ok = gmm::MUMPS_solve(M, x, b, false);
-      iter.enforce_converged(ok);
+      gmm::iteration iter_fact = iter;
+      factorize(M, iter_fact);
+      if (iter_fact.converged()) factor.solve(x, b);
+      iter.enforce_converged(iter_fact.converged());
+      if (iter.get_noisy() && factor.analysis_reused())
+        cout << "reuse of the MUMPS analysis" << endl;
     }
-  };
-  template <typename MAT, typename VECT>
-  struct linear_solver_mumps_sym : public abstract_linear_solver<MAT, VECT> {
-    void operator ()(const MAT &M, VECT &x, const VECT &b,
-                     gmm::iteration &iter) const {
-      bool ok = gmm::MUMPS_solve(M, x, b, true);
+
+    void factorize(const MAT &M, gmm::iteration &iter) const {
+      bool ok = factor.build_with(M, SYM);
+      this->fact_size = ok ? gmm::mat_nrows(M) : 0;
       iter.enforce_converged(ok);
     }
+    void solve_factorized(VECT &x, const VECT &b,
+                          gmm::iteration &iter) const {
+      factor.solve(x, b);
+      iter.enforce_converged(true);
+    }
+
+  private:
+    mutable gmm::MUMPS_factor<typename gmm::linalg_traits<MAT>::value_type>
+    factor;
   };
+
+  template <typename MAT, typename VECT>
+  struct linear_solver_mumps
+    : public linear_solver_mumps_factor<MAT, VECT, false> {};
+  template <typename MAT, typename VECT>
+  struct linear_solver_mumps_sym
+    : public linear_solver_mumps_factor<MAT, VECT, true> {};
 #endif
 
 #if GETFEM_PARA_LEVEL > 1 && GETFEM_PARA_SOLVER == MUMPS_PARA_SOLVER
@@ -436,6 +760,226 @@ namespace getfem {
   }
 
 
+  /* ***************************************************************** */
+  /*     Newton variants reusing the tangent matrix.                   */
+  /* ***************************************************************** */
+
+  /** Strategy of the Newton variants which reuse the factorization of a
+      tangent matrix computed at a previous iteration, or at a previous
+      solve (a previous time step for instance) when the same linear solver
+      object is given again:
+      - MODIFIED_NEWTON: the factorized tangent matrix is used as it is.
+      - BROYDEN: the inverse of the factorized tangent matrix is corrected
+        by the "good" Broyden rank one updates, one for each iteration.
+      - JACOBIAN_FREE: the Newton system is solved by a gmres applying the
+        tangent operator by finite differences of the residual,
+        preconditioned by the factorized tangent matrix.
+      The tangent matrix is recomputed and factorized when the residual
+      norm is not reduced by a factor max_contraction at an iteration,
+      when the line search step is smaller than min_alpha, or after
+      max_reuse iterations (which is also the maximal number of Broyden
+      updates). The number of factorizations is counted in
+      nb_factorizations.
+  */
+  struct newton_tangent_reuse {
+    enum method_type { MODIFIED_NEWTON, BROYDEN, JACOBIAN_FREE };
+    method_type method;
+    size_type max_reuse;
+    scalar_type max_contraction, min_alpha;
+    scalar_type fd_eps; // Relative increment of the finite differences.
+    size_type nb_factorizations;
+
+    newton_tangent_reuse(method_type m = MODIFIED_NEWTON,
+                         size_type mr = 20, scalar_type mc = 0.5,
+                         scalar_type ma = 0.5)
+      : method(m), max_reuse(mr), max_contraction(mc), min_alpha(ma),
+        fd_eps(1E-7), nb_factorizations(0) {}
+  };
+
+  /* Tangent operator by finite differences of the residual around the
+     current state, for the jacobian free Newton-Krylov method. The state
+     of the problem is modified, it has to be restored afterwards. */
+  template <typename PB> struct newton_fd_tangent_operator {
+    typedef typename PB::VECTOR VECTOR;
+    typedef typename gmm::linalg_traits<VECTOR>::value_type T;
+    typedef typename gmm::number_traits<T>::magnitude_type R;
+
+    PB &pb;
+    const VECTOR &state0, &rhs0;
+    R eps;
+
+    void mult(const VECTOR &v, VECTOR &y) const {
+      R nv = gmm::vect_norm2(v);
+      if (nv == R(0)) { gmm::clear(y); return; }
+      R h = eps * std::max(R(1), gmm::vect_norm2(state0)) / nv;
+      gmm::add(state0, gmm::scaled(v, T(h)), pb.state);
+      pb.compute_residual();
+      gmm::add(rhs0, gmm::scaled(pb.residual(), T(-1)), y);
+      gmm::scale(y, pb.scale_residual() / T(h));
+    }
+
+    newton_fd_tangent_operator(PB &pb_, const VECTOR &st, const VECTOR &r,
+                               R e)
+      : pb(pb_), state0(st), rhs0(r), eps(e) {}
+  };
+
+  template <typename PB, typename V1, typename V2>
+  inline void mult(const newton_fd_tangent_operator<PB> &J, const V1 &x,
+                   V2 &y) {
+    typename PB::VECTOR xx(gmm::vect_size(x)), yy(gmm::vect_size(y));
+    gmm::copy(x, xx);
+    J.mult(xx, yy);
+    gmm::copy(yy, y);
+  }
+
+  template <typename PB, typename V1, typename V2, typename V3>
+  inline void mult(const newton_fd_tangent_operator<PB> &J, const V1 &x,
+                   const V2 &b, V3 &y) {
+    typename PB::VECTOR xx(gmm::vect_size(x)), yy(gmm::vect_size(y));
+    gmm::copy(x, xx);
+    J.mult(xx, yy);
+    gmm::add(b, yy, y);
+  }
+
+  /* A factorized matrix of a linear solver used as a preconditioner. */
+  template <typename MAT, typename VECT> struct factorized_preconditioner {
+    const abstract_linear_solver<MAT, VECT> &linear_solver;
+    factorized_preconditioner(const abstract_linear_solver<MAT, VECT> &ls)
+      : linear_solver(ls) {}
+  };
+
+  template <typename MAT, typename VECT, typename V1, typename V2>
+  inline void mult(const factorized_preconditioner<MAT, VECT> &P,
+                   const V1 &x, V2 &y) {
+    VECT xx(gmm::vect_size(x)), yy(gmm::vect_size(y));
+    gmm::copy(x, xx);
+    gmm::iteration iter;
+    P.linear_solver.solve_factorized(yy, xx, iter);
+    gmm::copy(yy, y);
+  }
+
+  template <typename PB>
+  void Newton_with_tangent_reuse(PB &pb, gmm::iteration &iter,
+                                 const abstract_linear_solver
+                                 <typename PB::MATRIX, typename PB::VECTOR>
+                                 &linear_solver,
+                                 newton_tangent_reuse &strategy) {
+    typedef typename PB::VECTOR VECTOR;
+    typedef typename gmm::linalg_traits<VECTOR>::value_type T;
+    typedef typename gmm::number_traits<T>::magnitude_type R;
+    gmm::iteration iter_linsolv0 = iter;
+    iter_linsolv0.reduce_noisy();
+    iter_linsolv0.set_resmax(iter.get_resmax()/20.0);
+    iter_linsolv0.set_maxiter(10000); // arbitrary
+
+    pb.compute_residual();
+
+    size_type n = gmm::vect_size(pb.residual());
+    VECTOR dr(n), b(n), dr_prev(n);
+    std::vector<VECTOR> bs, bu; // Broyden updates (I + u s^T) of the inverse
+    R alpha_prev(0);
+    bool refresh = (linear_solver.factorized_size() != n), fresh = false;
+    size_type nreuse = 0;
+
+    scalar_type crit = pb.residual_norm()
+      / std::max(1E-25, pb.approx_external_load_norm());
+    while (!iter.finished(crit)) {
+      gmm::iteration iter_linsolv = iter_linsolv0;
+
+      if (refresh) {
+        int is_singular = 1;
+        while (is_singular) {
+          if (iter.get_noisy() > 1)
+            cout << "starting computing tangent matrix" << endl;
+          pb.compute_tangent_matrix();
+          iter_linsolv.init();
+          linear_solver.factorize(pb.tangent_matrix(), iter_linsolv);
+          if (!iter_linsolv.converged()) {
+            is_singular++;
+            if (is_singular <= 4) {
+              if (iter.get_noisy())
+                cout << "Singular tangent matrix:"
+                  " perturbation of the state vector." << endl;
+              pb.perturbation();
+              pb.compute_residual();
+            } else {
+              if (iter.get_noisy())
+                cout << "Singular tangent matrix: perturbation failed, "
+                  "aborting." << endl;
+              return;
+            }
+          }
+          else is_singular = 0;
+        }
+        ++(strategy.nb_factorizations);
+        refresh = false; fresh = true; nreuse = 0;
+        bs.clear(); bu.clear();
+      }
+
+      gmm::clear(dr);
+      gmm::copy(gmm::scaled(pb.residual(), pb.scale_residual()), b);
+      if (iter.get_noisy() > 1) cout << "starting linear solver" << endl;
+      iter_linsolv.init();
+      if (strategy.method == newton_tangent_reuse::JACOBIAN_FREE) {
+        // Inexact Newton: the finite differences limit the accuracy of
+        // the tangent operator to about the square root of fd_eps.
+        iter_linsolv.set_resmax(std::max(iter_linsolv.get_resmax(),
+                                         gmm::sqrt(strategy.fd_eps)));
+        VECTOR state0(pb.state), rhs0(pb.residual());
+        newton_fd_tangent_operator<PB> J(pb, state0, rhs0, strategy.fd_eps);
+        factorized_preconditioner<typename PB::MATRIX, VECTOR>
+          P(linear_solver);
+        gmm::gmres(J, dr, b, P, 50, iter_linsolv);
+        gmm::copy(state0, pb.state);
+        pb.compute_residual();
+      } else
+        linear_solver.solve_factorized(dr, b, iter_linsolv);
+
+      if (!iter_linsolv.converged()) {
+        if (!fresh) { refresh = true; continue; }
+        if (iter.get_noisy())
+          cout << "Linear solve failed with a new tangent matrix, aborting."
+               << endl;
+        return;
+      }
+
+      if (strategy.method == newton_tangent_reuse::BROYDEN) {
+        // dr = H_k b, with H_k = (I + u_{k-1} s_{k-1}^T) ... (I + u_0 s_0^T)
+        // times the inverse of the factorized tangent matrix. The update
+        // of the last step s is u = (s - H y) / (s^T H y), where
+        // H y = H (b_prev - b) = dr_prev - dr.
+        for (size_type j = 0; j < bs.size(); ++j)
+          gmm::add(gmm::scaled(bu[j], gmm::vect_sp(bs[j], dr)), dr);
+        if (!fresh) {
+          VECTOR s(n), u(n);
+          gmm::copy(gmm::scaled(dr_prev, T(alpha_prev)), s);
+          gmm::add(dr_prev, gmm::scaled(dr, T(-1)), u);
+          T den = gmm::vect_sp(s, u);
+          if (gmm::abs(den) <= 1E-14 * gmm::vect_norm2(s)*gmm::vect_norm2(u))
+            { refresh = true; continue; }
+          gmm::add(s, gmm::scaled(u, T(-1)), u);
+          gmm::scale(u, T(1) / den);
+          gmm::add(gmm::scaled(u, gmm::vect_sp(s, dr)), dr);
+          bs.push_back(s); bu.push_back(u);
+        }
+      }
+
+      if (iter.get_noisy() > 1) cout << "linear solver done" << endl;
+      R res0 = pb.residual_norm();
+      R alpha = pb.line_search(dr, iter); //it is assumed that the linesearch
+                                          //executes a pb.compute_residual();
+      if (iter.get_noisy()) cout << "alpha = " << std::setw(6) << alpha << " ";
+      ++iter; ++nreuse; fresh = false;
+      gmm::copy(dr, dr_prev); alpha_prev = alpha;
+      crit = std::min(pb.residual_norm()
+                      / std::max(1E-25, pb.approx_external_load_norm()),
+                      gmm::vect_norm1(dr) / std::max(1E-25, pb.state_norm()));
+      refresh = (nreuse >= strategy.max_reuse || alpha < strategy.min_alpha
+                 || pb.residual_norm() > strategy.max_contraction * res0);
+    }
+  }
+
+
   /* ***************************************************************** */
   /*  Intermediary structure for Newton algorithms with getfem::model. */
   /* ***************************************************************** */
@@ -622,6 +1166,11 @@ namespace getfem {
     std::shared_ptr<abstract_linear_solver<MATRIX, VECTOR>> p;
     if (bgeot::casecmp(name, "superlu") == 0)
       return std::make_shared<linear_solver_superlu<MATRIX, VECTOR>>();
+    else if (bgeot::casecmp(name, "superlu_mixed") == 0)
+      return std::make_shared<linear_solver_superlu_mixed<MATRIX, VECTOR>>();
+    else if (bgeot::casecmp(name, "gmres/superlu_mixed") == 0)
+      return std::make_shared
+	<linear_solver_superlu_mixed<MATRIX, VECTOR>>(true);
     else if (bgeot::casecmp(name, "dense_lu") == 0)
       return std::make_shared<linear_solver_dense_lu<MATRIX, VECTOR>>();
     else if (bgeot::casecmp(name, "mumps") == 0) {
@@ -648,6 +1197,12 @@ namespace getfem {
     else if (bgeot::casecmp(name, "gmres/ilutp") == 0)
       return std::make_shared
 	<linear_solver_gmres_preconditioned_ilutp<MATRIX, VECTOR>>();
+    else if (bgeot::casecmp(name, "cg/amg") == 0)
+      return std::make_shared
+	<linear_solver_cg_preconditioned_amg<MATRIX, VECTOR>>(md);
+    else if (bgeot::casecmp(name, "gmres/amg") == 0)
+      return std::make_shared
+	<linear_solver_gmres_preconditioned_amg<MATRIX, VECTOR>>(md);
     else if (bgeot::casecmp(name, "auto") == 0)
       return default_linear_solver<MATRIX, VECTOR>(md);
     else
@@ -710,6 +1265,22 @@ namespace getfem {
 
   void standard_solve(model &md, gmm::iteration &iter);
 
+  /** Same as the standard solve for a nonlinear model, with a Newton
+      variant reusing the factorization of the tangent matrix (see
+      newton_tangent_reuse). Giving the same linear solver object from one
+      call to the next one allows to keep the factorization across the
+      time steps. Linear models are solved as by the standard solve.
+  */
+  void standard_solve(model &md, gmm::iteration &iter,
+                      rmodel_plsolver_type lsolver,
+                      abstract_newton_line_search &ls,
+                      newton_tangent_reuse &strategy);
+
+  void standard_solve(model &md, gmm::iteration &iter,
+                      cmodel_plsolver_type lsolver,
+                      abstract_newton_line_search &ls,
+                      newton_tangent_reuse &strategy);
+
 }  /* end of namespace getfem.                                             */
 
 
@@ -124,6 +124,10 @@ namespace getfem {
     bool is_linear_;
     bool is_symmetric_;
     bool is_coercive_;
+    bool colored_assembly_;
+    bool assembly_profiling_;
+    ga_assembly_profile assembly_profile_;
+    bool incremental_assembly_;
     mutable model_real_sparse_matrix rTM;    // tangent matrix, real version
     mutable model_complex_sparse_matrix cTM; // tangent matrix, complex version
     mutable model_real_plain_vector rrhs;
@@ -325,6 +329,32 @@ namespace getfem {
           cveclist_sym(1)  { }
     };
 
+    // Contribution of a linear brick to the constant part of the tangent
+    // matrix (incremental assembly). Each term j is added with the
+    // coefficient alpha to the block (I1, I2) and, for a symmetric term,
+    // transposed to the block (I2, I1).
+    struct constant_term_description {
+      size_type j, i1, n1, i2, n2;
+      scalar_type alpha;
+      bool sym;
+      bool operator ==(const constant_term_description &t) const {
+        return j == t.j && i1 == t.i1 && n1 == t.n1 && i2 == t.i2
+          && n2 == t.n2 && alpha == t.alpha && sym == t.sym;
+      }
+    };
+    struct constant_contribution {
+      gmm::uint64_type v_num;
+      std::vector<constant_term_description> terms;
+      bool operator ==(const constant_contribution &c) const
+      { return v_num == c.v_num && terms == c.terms; }
+      bool operator !=(const constant_contribution &c) const
+      { return !(*this == c); }
+    };
+    typedef std::map<size_type, constant_contribution> constant_contributions;
+    mutable model_real_sparse_matrix rTM_const; // Constant part of rTM
+    mutable constant_contributions rTM_const_contributions;
+    void update_constant_tangent_part(constant_contributions &contribs);
+
     typedef std::map<std::string, var_description> VAR_SET;
     mutable VAR_SET variables;             // Variables list of the model
     std::vector<brick_description> bricks; // Bricks list of the model
@@ -377,6 +407,13 @@ namespace getfem {
     
     mutable std::list<gen_expr> generic_expressions;
 
+    // Workspace of the generic expressions kept from one assembly to the
+    // next one, with the signature of the expressions and variables it has
+    // been built with.
+    mutable std::shared_ptr<ga_workspace> generic_workspace;
+    mutable std::string generic_workspace_signature;
+    mutable model_real_plain_vector generic_residual;
+
     // Groups of variables for interpolation on different meshes
     // generic assembly
     std::map<std::string, std::vector<std::string> > variable_groups;
@@ -594,6 +631,43 @@ namespace getfem {
     /** Return true if all the model terms are linear. */
     bool is_linear() const { return is_linear_; }
 
+    /** Select the multithreaded strategy for the assembly of the generic
+        expressions. When true, a single workspace is used whose elements
+        are distributed to the threads by a coloring (see
+        ga_workspace::set_colored_assembly), avoiding a copy of the tangent
+        matrix per thread. Otherwise, each thread assembles a part of the
+        region into its own copy which are summed at the end. */
+    void set_colored_assembly(bool b) { colored_assembly_ = b; }
+    bool is_colored_assembly() const { return colored_assembly_; }
+
+    /** Enable or disable the profiling of the assembly. When enabled, the
+        time spent in each brick is accumulated, together with the time
+        spent in each expression and each instruction of the generic
+        expressions. When each thread assembles a part of the region (see
+        set_colored_assembly), the profiles of the threads are summed. */
+    void set_assembly_profiling(bool b) { assembly_profiling_ = b; }
+    bool is_assembly_profiling() const { return assembly_profiling_; }
+    const ga_assembly_profile &assembly_profile() const
+    { return assembly_profile_; }
+    void clear_assembly_profile() { assembly_profile_.clear(); }
+
+    /** Enable or disable the incremental assembly of the tangent matrix
+        (real version only). When enabled, the matrix terms of the linear
+        bricks are summed once into a constant part of the tangent matrix
+        which is kept from one assembly to the next one. Only the blocks
+        concerned by a brick whose terms have been recomputed (change of
+        data, of variable status or of coefficient, touch_brick ...) are
+        rebuilt, the other ones are just added to the nonlinear terms.
+        Bricks with global terms, with a time dispatcher or to be computed
+        each time are not concerned. This costs a copy of the linear part
+        of the tangent matrix. */
+    void set_incremental_assembly(bool b) {
+      incremental_assembly_ = b;
+      rTM_const = model_real_sparse_matrix();
+      rTM_const_contributions.clear();
+    }
+    bool is_incremental_assembly() const { return incremental_assembly_; }
+
     /** Total number of degrees of freedom in the model. */
     size_type nb_dof() const;
 
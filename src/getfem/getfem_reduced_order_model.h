@@ -0,0 +1,251 @@
+/* -*- c++ -*- (enables emacs c++ mode) */
+/*===========================================================================
+
+ Copyright (C) 2017-2017 Yves Renard
+
+ This file is a part of GetFEM++
+
+ GetFEM++  is  free software;  you  can  redistribute  it  and/or modify it
+ under  the  terms  of the  GNU  Lesser General Public License as published
+ by  the  Free Software Foundation;  either version 3 of the License,  or
+ (at your option) any later version along with the GCC Runtime Library
+ Exception either version 3.1 or (at your option) any later version.
+ This program  is  distributed  in  the  hope  that it will be useful,  but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ or  FITNESS  FOR  A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License and GCC Runtime Library Exception for more details.
+ You  should  have received a copy of the GNU Lesser General Public License
+ along  with  this program;  if not, write to the Free Software Foundation,
+ Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ As a special exception, you  may use  this file  as it is a part of a free
+ software  library  without  restriction.  Specifically,  if   other  files
+ instantiate  templates  or  use macros or inline functions from this file,
+ or  you compile this  file  and  link  it  with other files  to produce an
+ executable, this file  does  not  by itself cause the resulting executable
+ to be covered  by the GNU Lesser General Public License.  This   exception
+ does not  however  invalidate  any  other  reasons why the executable file
+ might be covered by the GNU Lesser General Public License.
+
+===========================================================================*/
+
+/**@file getfem_reduced_order_model.h
+   @author  Yves Renard <Yves.Renard@insa-lyon.fr>
+   @date 2017.
+   @brief Reduced order models (POD/Galerkin with DEIM hyper-reduction)
+   built on top of a getfem::model.
+*/
+
+#ifndef GETFEM_REDUCED_ORDER_MODEL_H__
+#define GETFEM_REDUCED_ORDER_MODEL_H__
+
+#include "getfem_models.h"
+#include "gmm/gmm_iter.h"
+
+namespace getfem {
+
+  /** Proper orthogonal decomposition of a set of snapshot vectors.
+   *  The basis is computed by the method of snapshots: the eigenvalues
+   *  of the correlation matrix of the snapshots are the squares of their
+   *  singular values. The relative accuracy of the basis is thus limited
+   *  to the square root of the machine precision.
+   */
+  class APIDECL pod_basis {
+    std::vector<model_real_plain_vector> snapshots;
+    gmm::dense_matrix<scalar_type> B;
+    std::vector<scalar_type> sv;
+
+  public:
+    void add_snapshot(const model_real_plain_vector &V);
+    size_type nb_snapshots() const { return snapshots.size(); }
+    const model_real_plain_vector &snapshot(size_type i) const
+    { return snapshots[i]; }
+    void clear_snapshots() { snapshots.clear(); }
+
+    /** Compute an orthonormal basis of the snapshots keeping the
+     *  smallest number of modes such that the relative energy of the
+     *  discarded modes (the square root of the sum of their squared
+     *  singular values over the total one) is less than tol, and at most
+     *  max_size modes. Return the size of the basis.
+     */
+    size_type compute(scalar_type tol, size_type max_size = size_type(-1));
+
+    /** The basis vectors, stored column-wise. */
+    const gmm::dense_matrix<scalar_type> &basis() const { return B; }
+    size_type size() const { return gmm::mat_ncols(B); }
+    /** The singular values of the kept modes, in decreasing order. */
+    const std::vector<scalar_type> &singular_values() const { return sv; }
+  };
+
+  /** Greedy selection of the interpolation indices of the discrete
+   *  empirical interpolation method (DEIM) for the basis stored in the
+   *  columns of U.
+   */
+  void APIDECL deim_interpolation_indices
+  (const gmm::dense_matrix<scalar_type> &U, std::vector<size_type> &ind);
+
+  /** POD/Galerkin reduced order model of a real model.
+
+      The snapshots of the model state are added by add_snapshot() after
+      each solve of the full model (for a set of training parameters for
+      instance). The function build() computes the POD basis B of the
+      states and projects on it the tangent matrix and right hand side of
+      the model, so that the online solve of solve() works on vectors of
+      the size of the basis.
+
+      The nonlinear terms have to be added with add_hyper_reduced_term(),
+      which adds them to the model as nonlinear generic assembly bricks.
+      The residual of each of these terms is stored at each snapshot, and
+      build() computes a POD basis U of these residuals and its DEIM
+      interpolation indices. The online evaluation of the term is then
+      restricted to the elements of the region which contain one of the
+      sampled dofs, and the term is approximated by
+      U (U(ind,:))^{-1} r(ind). These elements are copied in a sample mesh
+      on which the term is evaluated, the variables and data being
+      restricted to the dofs of this mesh. This is not possible (and the
+      term is then evaluated on the sampled elements of the complete mesh,
+      with a cost depending on the size of the full model) when the term
+      uses a variable or data defined on a reduced finite element method
+      or on another mesh, an im_data, a variable without finite element
+      method or an interpolate or elementary transformation. The linear
+      part of a nonlinear term is
+      better let in a linear brick, the residual of the whole term at the
+      snapshots being in a space of small dimension when the other terms
+      are only source terms. All the other bricks of the model are
+      supposed to be linear. Their projected contribution is computed by
+      build() for the current value of the data and update_linear_part()
+      has to be called if some data of these bricks changes, except for
+      the scalar data declared with add_affine_parameter() on which they
+      depend affinely. The projection
+      is done for the Euclidean scalar product of the dofs, so that a
+      Galerkin reduction of a saddle point problem (Dirichlet conditions
+      with multipliers for instance) may be singular.
+  */
+  class APIDECL reduced_order_model {
+
+    // Restriction of a finite element variable or data to a sample mesh.
+    struct sampled_field {
+      std::string name;
+      bool is_variable;
+      const mesh_fem *mf;
+      std::shared_ptr<mesh_fem> mf_s;
+      std::vector<size_type> dofs;      // Dof of mf of each dof of mf_s.
+      gmm::sub_interval I_s;            // Interval in the sample unknowns.
+      model_real_plain_vector V_s;      // Values of a data.
+    };
+
+    struct hyper_reduced_term {
+      size_type ib;           // Brick of the term in the model.
+      const mesh_im *mim;
+      std::string expr;
+      size_type region;
+      pod_basis residuals;    // POD basis of the residuals of the term.
+      std::vector<size_type> ind;       // DEIM interpolation indices.
+      mesh_region sampled_region;
+      gmm::dense_matrix<scalar_type> P; // B^T U (U(ind,:))^{-1}
+      std::shared_ptr<mesh> sample_mesh;  // Copy of the sampled elements.
+      std::shared_ptr<mesh_im> sample_mim;
+      mesh_region sample_region;
+      std::vector<sampled_field> fields;
+      std::vector<size_type> ind_s;     // Sampled dofs in the sample unknowns.
+      gmm::dense_matrix<scalar_type> B_s; // Rows of B of the sample unknowns.
+      model_real_plain_vector U_s;
+      std::shared_ptr<ga_workspace> workspace;
+      model_real_plain_vector V;
+      model_real_sparse_matrix K;
+    };
+
+    model &md;
+    pod_basis states;
+    std::vector<hyper_reduced_term> terms;
+    gmm::dense_matrix<scalar_type> Kr0; // Projection of the linear part.
+    model_real_plain_vector Fr0;
+    std::vector<std::string> affine_params;
+    std::vector<gmm::dense_matrix<scalar_type> > Krq; // Affine terms of
+    std::vector<model_real_plain_vector> Frq;        // the linear part.
+    model_real_plain_vector ar;         // Current reduced state.
+    bool built;
+
+    void assemble_term_residual(const hyper_reduced_term &t,
+                                model_real_plain_vector &V) const;
+    void build_sampled_region(hyper_reduced_term &t) const;
+    bool build_sample_mesh(hyper_reduced_term &t) const;
+    void project_linear_part(gmm::dense_matrix<scalar_type> &Kr,
+                             model_real_plain_vector &Fr);
+
+  public:
+
+    /** Add the nonlinear term given by the assembly string expr to the
+     *  model as a nonlinear generic assembly brick whose evaluation will
+     *  be hyper-reduced. Return the brick index in the model.
+     */
+    size_type add_hyper_reduced_term(const mesh_im &mim,
+                                     const std::string &expr,
+                                     size_type region = size_type(-1),
+                                     const std::string &brickname = "");
+
+    /** Declare the scalar data dataname as a parameter on which the
+     *  linear bricks depend affinely. The projection of the linear part is
+     *  then computed by build() for each of these parameters and combined
+     *  by solve() for their current values.
+     */
+    void add_affine_parameter(const std::string &dataname);
+
+    /** Store the current state of the model (after a solve) as a snapshot
+     *  together with the residual of each hyper-reduced term.
+     */
+    void add_snapshot();
+
+    /** Compute the POD basis of the states with the relative tolerance
+     *  tol (and at most max_size modes), the POD bases of the residuals of
+     *  the hyper-reduced terms with the tolerance tol_hr, their DEIM
+     *  sampling and project the linear part of the model.
+     */
+    void build(scalar_type tol = 1E-6, scalar_type tol_hr = 1E-8,
+               size_type max_size = size_type(-1));
+
+    /** Project again the linear part of the model (to be called when some
+     *  data of the linear bricks has changed).
+     */
+    void update_linear_part();
+
+    /** Solve the reduced problem with a Newton method starting from the
+     *  previous reduced solution (the projection of the state of the
+     *  model at build()). The convergence is tested on the norm of the
+     *  reduced residual. If expand is true, the solution is stored in the
+     *  model variables, which is the only part of the solve whose cost
+     *  depends on the size of the full model when all the hyper-reduced
+     *  terms are evaluated on their sample mesh.
+     */
+    void solve(gmm::iteration &iter, bool expand = true);
+
+    /** Coordinates of the last reduced solution in the state basis. */
+    const model_real_plain_vector &reduced_solution() const { return ar; }
+
+    const pod_basis &state_basis() const { return states; }
+    size_type reduced_size() const { return states.size(); }
+    size_type nb_hyper_reduced_terms() const { return terms.size(); }
+    /** Number of DEIM interpolation indices of the hyper-reduced term i. */
+    size_type nb_sampled_dofs(size_type i) const
+    { return terms[i].ind.size(); }
+    /** Elements (or faces) on which the hyper-reduced term i is evaluated
+     *  online. */
+    const mesh_region &sampled_region(size_type i) const
+    { return terms[i].sampled_region; }
+    /** Says if the hyper-reduced term i is evaluated on a sample mesh. */
+    bool has_sample_mesh(size_type i) const
+    { return bool(terms[i].sample_mesh); }
+    /** Number of sample unknowns of the hyper-reduced term i. */
+    size_type nb_sample_dofs(size_type i) const
+    { return gmm::vect_size(terms[i].U_s); }
+
+    reduced_order_model(model &md_) : md(md_), built(false) {
+      GMM_ASSERT1(!md.is_complex(),
+                  "Reduced order models are only available for real models");
+    }
+  };
+
+}  /* end of namespace getfem.                                             */
+
+
+#endif /* GETFEM_REDUCED_ORDER_MODEL_H__  */
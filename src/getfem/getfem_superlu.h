@@ -86,7 +86,9 @@ namespace gmm {
   public :
     enum { LU_NOTRANSP, LU_TRANSP, LU_CONJUGATED };
 
-    /** Do the factorization of the supplied sparse matrix. */
+    /** Do the factorization of the supplied sparse matrix. The ordering
+        and the symbolic analysis are reused when the matrix has the same
+        sparsity pattern as the one of the previous factorization. */
     template <class MAT> void build_with(const MAT &A,  int permc_spec = 3) {
       int m = int(mat_nrows(A)), n = int(mat_ncols(A));
       gmm::csc_matrix<T> csc_A(m,n); 
@@ -110,6 +112,15 @@ namespace gmm {
     std::vector<T> &rhs() const;
     SuperLU_factor();
     float memsize() const;
+    /** True if the last factorization reused the symbolic analysis of the
+        previous one. */
+    bool analysis_reused() const;
+    /** Enable the estimation of the reciprocal condition number by the
+        following factorizations (disabled by default). */
+    void set_rcond_estimation(bool b);
+    /** Reciprocal condition number estimated by the last factorization,
+        zero if it has not been estimated. */
+    double rcond() const;
     SuperLU_factor(const SuperLU_factor& other);
     SuperLU_factor& operator=(const SuperLU_factor& other);
   };
@@ -123,6 +134,16 @@ namespace gmm {
   void transposed_mult(const SuperLU_factor<T>& P,const V1 &v1,const V2 &v2) {
     P.solve(v2, v1, SuperLU_factor<T>::LU_TRANSP);
   }
+
+  template <typename T, typename V1, typename V2> inline
+  void mult(const SuperLU_factor<T>& P, const V1 &v1, V2 &v2) {
+    P.solve(v2,v1);
+  }
+
+  template <typename T, typename V1, typename V2> inline
+  void transposed_mult(const SuperLU_factor<T>& P, const V1 &v1, V2 &v2) {
+    P.solve(v2, v1, SuperLU_factor<T>::LU_TRANSP);
+  }
 }
 
 extern "C" void set_superlu_callback(int (*cb)());
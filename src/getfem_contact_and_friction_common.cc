@@ -197,11 +197,10 @@ namespace getfem {
     if (!found) sfi.push_back(face_info(ib, ie, iff));
   }
 
+  // The influence boxes are kept to be updated at the next detection.
   void multi_contact_frame::clear_aux_info() {
     boundary_points = std::vector<base_node>();
     boundary_points_info = std::vector<boundary_point>();
-    element_boxes.clear();
-    element_boxes_info = std::vector<influence_box>();
     potential_pairs = std::vector<std::vector<face_info> >();
   }
 
@@ -560,6 +559,26 @@ namespace getfem {
     base_matrix G;
     model_real_plain_vector coeff;
 
+    // If the master faces are the same as at the previous call, the
+    // influence boxes are moved and the rtree is refitted instead of
+    // being rebuilt.
+    bool update_boxes = true;
+    size_type nb_boxes = 0;
+    for (size_type i = 0; i < contact_boundaries.size(); ++i)
+      if (!is_slave_boundary(i)) {
+        const mesh &m = mfdisp_of_boundary(i).linked_mesh();
+        mesh_region region = m.region(region_of_boundary(i));
+        for (getfem::mr_visitor v(region,m); !v.finished(); ++v, ++nb_boxes)
+          if (nb_boxes >= element_boxes_info.size()
+              || element_boxes_info[nb_boxes].ind_boundary != i
+              || element_boxes_info[nb_boxes].ind_element != v.cv()
+              || element_boxes_info[nb_boxes].ind_face != v.f())
+            update_boxes = false;
+      }
+    if (nb_boxes != element_boxes.nb_boxes()) update_boxes = false;
+    if (!update_boxes) element_boxes.clear();
+    element_boxes_info.resize(0);
+
     for (size_type i = 0; i < contact_boundaries.size(); ++i)
       if (!is_slave_boundary(i)) {
         size_type bnum = region_of_boundary(i);
@@ -647,7 +666,10 @@ namespace getfem {
             { bmin[k] -= release_distance; bmax[k] += release_distance; }
 
           // Store the influence box and additional information.
-          element_boxes.add_box(bmin, bmax, element_boxes_info.size());
+          if (update_boxes)
+            element_boxes.set_box(element_boxes_info.size(), bmin, bmax);
+          else
+            element_boxes.add_box(bmin, bmax, element_boxes_info.size());
           n_mean /= gmm::vect_norm2(n_mean);
           element_boxes_info.push_back(influence_box(i, cv, v.f(), n_mean));
         }
@@ -661,17 +683,18 @@ namespace getfem {
     potential_pairs = std::vector<std::vector<face_info> >();
     potential_pairs.resize(boundary_points.size());
 
+    std::vector<size_type> offsets;
+    bgeot::rtree::pbox_cont bset;
+    element_boxes.find_boxes_at_points(boundary_points, offsets, bset);
+
     for (size_type ip = 0; ip < boundary_points.size(); ++ip) {
 
-      bgeot::rtree::pbox_set bset;
-      element_boxes.find_boxes_at_point(boundary_points[ip], bset);
       boundary_point *pt_info = &(boundary_points_info[ip]);
       const mesh_fem &mf1 = mfdisp_of_boundary(pt_info->ind_boundary);
       size_type ib1 = pt_info->ind_boundary;
 
-      bgeot::rtree::pbox_set::iterator it = bset.begin();
-      for (; it != bset.end(); ++it) {
-        influence_box &ibx = element_boxes_info[(*it)->id];
+      for (size_type j = offsets[ip]; j < offsets[ip+1]; ++j) {
+        influence_box &ibx = element_boxes_info[bset[j]->id];
         size_type ib2 = ibx.ind_boundary;
         const mesh_fem &mf2 = mfdisp_of_boundary(ib2);
 
@@ -1399,7 +1422,26 @@ namespace getfem {
       fem_precomp_pool fppool;
       base_matrix G;
       model_real_plain_vector coeff;
-      face_boxes.clear();
+
+      // The boxes of the previous assembly are moved and the rtree is
+      // refitted if the master faces are unchanged.
+      bool update_boxes = true;
+      size_type nb_boxes = 0;
+      for (size_type i = 0; i < contact_boundaries.size(); ++i) {
+        const contact_boundary &cb = contact_boundaries[i];
+        if (! cb.slave) {
+          const mesh &m = cb.mfu->linked_mesh();
+          mesh_region region = m.region(cb.region);
+          for (getfem::mr_visitor v(region,m); !v.finished(); ++v, ++nb_boxes)
+            if (nb_boxes >= face_boxes_info.size()
+                || face_boxes_info[nb_boxes].ind_boundary != i
+                || face_boxes_info[nb_boxes].ind_element != v.cv()
+                || face_boxes_info[nb_boxes].ind_face != v.f())
+              update_boxes = false;
+        }
+      }
+      if (nb_boxes != face_boxes.nb_boxes()) update_boxes = false;
+      if (!update_boxes) face_boxes.clear();
       face_boxes_info.resize(0);
 
       for (size_type i = 0; i < contact_boundaries.size(); ++i) {
@@ -1470,7 +1512,10 @@ namespace getfem {
               { bmin[k] -= h * 0.15; bmax[k] += h * 0.15; }
             
             // Store the bounding box and additional information.
-            face_boxes.add_box(bmin, bmax, face_boxes_info.size());
+            if (update_boxes)
+              face_boxes.set_box(face_boxes_info.size(), bmin, bmax);
+            else
+              face_boxes.add_box(bmin, bmax, face_boxes_info.size());
             n_mean /= gmm::vect_norm2(n_mean);
             face_boxes_info.push_back(face_box_info(i, cv, v.f(), n_mean));
           }
@@ -1584,8 +1629,7 @@ namespace getfem {
     };
 
     void finalize() const {
-      face_boxes.clear();
-      face_boxes_info = std::vector<face_box_info>();
+      // face_boxes and face_boxes_info are kept for the next assembly.
       for (const contact_boundary &cb : contact_boundaries)
         cb.U_unred = model_real_plain_vector();
     }
@@ -1717,7 +1761,7 @@ namespace getfem {
       //
       // Determine the potential contact pairs with deformable bodies
       //
-      bgeot::rtree::pbox_set bset;
+      bgeot::rtree::pbox_cont bset;
       base_node bmin(pt_x), bmax(pt_x);
       for (size_type i = 0; i < N; ++i)
         { bmin[i] -= release_distance; bmax[i] += release_distance; }
@@ -2145,7 +2189,7 @@ namespace getfem {
       //
       // Determine the potential contact pairs with deformable bodies
       //
-      bgeot::rtree::pbox_set bset;
+      bgeot::rtree::pbox_cont bset;
       base_node bmin(pt_x), bmax(pt_x);
       for (size_type i = 0; i < N; ++i)
         { bmin[i] -= release_distance; bmax[i] += release_distance; }
@@ -2685,12 +2729,12 @@ namespace getfem {
     
     // Value : (lambda.n+rg)_- n - P_B(n, f(lambda.n+rg)_-)(lambda-r Vs)
     void value(const arg_list &args, base_tensor &result) const {
-      const base_vector &lambda = *(args[0]);
-      const base_vector &n = *(args[1]);
-      const base_vector &Vs = *(args[2]);
-      base_vector &F = result;
+      const auto &lambda = args[0]->as_vector();
+      const auto &n = args[1]->as_vector();
+      const auto &Vs = args[2]->as_vector();
+      auto &F = result.as_vector();
       scalar_type g = (*(args[3]))[0];
-      const base_vector &f = *(args[4]);
+      const auto &f = args[4]->as_vector();
       scalar_type r = (*(args[5]))[0];
       
 
@@ -2723,13 +2767,13 @@ namespace getfem {
     void derivative(const arg_list &args, size_type nder,
                     base_tensor &result) const { // Can be optimized ?
       size_type N = args[0]->size();
-      const base_vector &lambda = *(args[0]);
-      const base_vector &n = *(args[1]);
-      const base_vector &Vs = *(args[2]);
+      const auto &lambda = args[0]->as_vector();
+      const auto &n = args[1]->as_vector();
+      const auto &Vs = args[2]->as_vector();
       base_vector F(N), dg(N);
       base_matrix dVs(N,N), dn(N,N);
       scalar_type g = (*(args[3]))[0];
-      const base_vector &f = *(args[4]);
+      const auto &f = args[4]->as_vector();
       scalar_type r = (*(args[5]))[0];
 
       scalar_type nn = gmm::vect_norm2(n);
@@ -2669,6 +2669,10 @@ namespace getfem {
 
     scalar_type theta;
     bool contact_only;
+    // Bounding boxes of the elements of mf_d2, kept from an assembly to
+    // the next one.
+    mutable bgeot::rtree tree;
+    mutable std::vector<size_type> box_convexes;
 
     virtual void asm_real_tangent_terms(const model &md, size_type /* ib */,
                                         const model::varnamelist &vl,
@@ -2753,12 +2757,17 @@ namespace getfem {
 
       // cout << "Computing projection ..." << endl;
 
-      bgeot::rtree tree;
+      // The tree is only refitted if the elements are unchanged.
+      bool update_boxes = true;
+      size_type nb_boxes = 0;
+      for (dal::bv_visitor cv(mf_d2.convex_index()); !cv.finished();
+           ++cv, ++nb_boxes)
+        if (nb_boxes >= box_convexes.size() || box_convexes[nb_boxes] != cv)
+          update_boxes = false;
+      if (nb_boxes != box_convexes.size()) update_boxes = false;
+      if (!update_boxes) { tree.clear(); box_convexes.resize(0); }
+      nb_boxes = 0;
 
-
-	    
-	    
-      
       for (dal::bv_visitor cv(mf_d2.convex_index()); !cv.finished(); ++cv) {
 	base_node min,max;
 //      base_node min = m.points_of_convex(cv)[0], max = min;
@@ -2787,9 +2796,12 @@ namespace getfem {
  
  
  
-        tree.add_box(min, max, cv);
-
-
+        if (update_boxes)
+          tree.set_box(nb_boxes++, min, max);
+        else {
+          tree.add_box(min, max, cv);
+          box_convexes.push_back(cv);
+        }
       }
 
       // cout << "Projection computed." << endl;
@@ -2815,6 +2827,7 @@ namespace getfem {
       base_tensor tG1, tGdu1, tGddu1, tbv1, tbv2;
       scalar_type gap, u1n, u2n;
       size_type cv2(-1),qdim1,qdim2;
+      bgeot::rtree::pbox_cont pbs;
 
       bgeot::multi_index sizes_tGdu1(1), sizes_tGddu1(3);
       sizes_tGdu1[0] = N;
@@ -2911,11 +2924,9 @@ namespace getfem {
                    y0);
 	     
 	  
-          bgeot::rtree::pbox_set pbs;
-	  
           tree.find_boxes_at_point(y0, pbs);
 	   
-          bgeot::rtree::pbox_set::const_iterator it = pbs.begin();
+          bgeot::rtree::pbox_cont::const_iterator it = pbs.begin();
 	  
 	  
           bool found = false;
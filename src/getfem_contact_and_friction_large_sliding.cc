@@ -1535,7 +1535,7 @@ namespace getfem {
     // Selection of influence boxes
     // ----------------------------------------------------------
 
-    bgeot::rtree::pbox_set bset;
+    bgeot::rtree::pbox_cont bset;
     element_boxes.find_boxes_at_point(x, bset);
 
     if (noisy) cout << "Number of boxes found : " << bset.size() << endl;
@@ -1545,12 +1545,12 @@ namespace getfem {
     // criterion : should at least eliminate the original element.
     // ----------------------------------------------------------
 
-    bgeot::rtree::pbox_set::iterator it = bset.begin(), itnext;
-    for (; it != bset.end(); it = itnext) {
-      itnext = it; ++itnext;
-      if (gmm::vect_sp(unit_normal_of_elements[(*it)->id], n)
-          >= -scalar_type(1)/scalar_type(20)) bset.erase(it);
-    }
+    bset.erase(std::remove_if(bset.begin(), bset.end(),
+                              [&](const bgeot::box_index *b) {
+                                return gmm::vect_sp(unit_normal_of_elements
+                                                    [b->id], n)
+                                  >= -scalar_type(1)/scalar_type(20);
+                              }), bset.end());
 
     if (noisy)
       cout << "Number of boxes satisfying the unit normal criterion : "
@@ -1563,7 +1563,7 @@ namespace getfem {
     // situations with a test on |x0-y0|
     // ----------------------------------------------------------
 
-    it = bset.begin();
+    bgeot::rtree::pbox_cont::iterator it = bset.begin();
     std::vector<base_node> y0s;
     std::vector<base_small_vector> n0_y0s;
     std::vector<scalar_type> d0s;
@@ -28,6 +28,10 @@
 #include "getfem/bgeot_rtree.h"
 #include "getfem/bgeot_geotrans_inv.h"
 #include "getfem/getfem_copyable_ptr.h"
+#include <chrono>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
 
 /**
    Providing for special Math functions unavailable on Intel or MSVS C++
@@ -2010,6 +2014,33 @@ namespace getfem {
     return false;
   }
 
+  // Matrix with a fixed pattern in which the matrix terms are assembled
+  // when the compiled instructions are reused. The pattern is recorded
+  // during a first assembly (RECORD) and the following ones add the
+  // element matrices directly to the values of the compressed sparse column
+  // matrix A (ASSEMBLE).
+  struct ga_pattern_matrix {
+    enum { NONE, RECORD, ASSEMBLE } mode;
+    bool active;                     // Used by the current assembly
+    model_real_sparse_matrix P;      // Recorded pattern
+    gmm::csc_matrix<scalar_type> A;
+    ga_pattern_matrix() : mode(NONE), active(false) {}
+  };
+
+  // Mesh_fem and first dofs of the two variables of a matrix term
+  // assembled into a block sparse row matrix.
+  struct ga_bsr_coupling {
+    const mesh_fem *mf;
+    size_type first1, first2;
+    bool operator <(const ga_bsr_coupling &c) const {
+      if (mf != c.mf) return mf < c.mf;
+      if (first1 != c.first1) return first1 < c.first1;
+      return first2 < c.first2;
+    }
+    ga_bsr_coupling(const mesh_fem *m, size_type f1, size_type f2)
+      : mf(m), first1(f1), first2(f2) {}
+  };
+
   struct ga_instruction_set {
 
     papprox_integration pai;       // Current approximation method
@@ -2036,6 +2067,10 @@ namespace getfem {
     std::map<std::string, base_vector> really_extended_vars;
     std::map<std::string, gmm::sub_interval> var_intervals;
     size_type nb_dof, max_dof;
+    ga_pattern_matrix pattern;
+    std::set<ga_bsr_coupling> bsr_couplings; // Terms assembled in K_bsr
+    bool bsr_pattern_built;        // The pattern of K_bsr has been built
+    bool profiling;                // Execution statistics to be gathered
 
     struct variable_group_info {
       const mesh_fem *mf;
@@ -2102,9 +2137,51 @@ namespace getfem {
       ga_instruction_list instructions;
       std::map<scalar_type, std::list<pga_tree_node> > node_list;
 
+      // Index in the workspace of the tree which produced each instruction
+      // of the three lists above, and execution statistics of these
+      // instructions for the profiling of the assembly.
+      std::vector<size_type> begin_trees, elt_trees, trees_of_instructions;
+      std::vector<ga_assembly_profile::entry> begin_stats, elt_stats, stats;
+      ga_assembly_profile::entry exec_stats;
+
+      // Slots of the arena of the instruction set holding the tensors of
+      // the nodes compiled in these lists (see ga_arena_place). A slot is
+      // held by the nodes using its tensor. Once released by all of them,
+      // it can be given to a node compiled afterwards, unless it is
+      // permanent. It keeps its tensor until then.
+      struct arena_slot {
+        scalar_type *p;
+        size_type n, refs;
+        bool permanent;
+        const base_tensor *owner;
+      };
+      std::vector<arena_slot> slots;
+      std::map<const base_tensor *, size_type> slot_of;
+
       region_mim_instructions(): m(0) {}
     };
 
+    // Storage of the intermediary tensors of the trees. It is allocated by
+    // blocks which are never moved, the instructions keeping references to
+    // the components of the tensors. The tensors of consecutive nodes are
+    // then contiguous, and a tensor of two test functions only evaluated on
+    // the current integration point shares its slot with the tensors whose
+    // values are no longer used when it is computed. The other tensors may
+    // be found equivalent to nodes of the trees compiled afterwards and
+    // keep their slot.
+    std::list<base_vector> arena;
+    size_type arena_used;
+
+    scalar_type *arena_alloc(size_type n) {
+      if (arena.empty() || arena_used + n > arena.back().size()) {
+        arena.push_back(base_vector(std::max(n, size_type(1024))));
+        arena_used = 0;
+      }
+      scalar_type *p = &(arena.back()[arena_used]);
+      arena_used += n;
+      return p;
+    }
+
     std::list<ga_tree> trees; // The trees are stored mainly because they
                               // contain the intermediary tensors.
     std::list<ga_tree> interpolation_trees;
@@ -2113,7 +2190,10 @@ namespace getfem {
 
     instructions_set  whole_instructions;
 
-    ga_instruction_set() { max_dof = nb_dof = 0; need_elt_size = false; ipt=0; }
+    ga_instruction_set() {
+      max_dof = nb_dof = 0; need_elt_size = false; profiling = false; ipt=0;
+      bsr_pattern_built = false; arena_used = 0;
+    }
   };
 
 
@@ -2141,7 +2221,7 @@ namespace getfem {
   static void ga_exec(ga_instruction_set &gis, ga_workspace &workspace);
   static void ga_function_exec(ga_instruction_set &gis);
   static void ga_compile(ga_workspace &workspace, ga_instruction_set &gis,
-                         size_type order);
+                         size_type order, bool with_residual = false);
   static void ga_compile_function(ga_workspace &workspace,
                                   ga_instruction_set &gis, bool scalar);
   static std::string ga_derivative_scalar_function(const std::string &expr,
@@ -2152,6 +2232,57 @@ namespace getfem {
 
   using instruction_set = omp_distribute<ga_instruction_set>;
 
+  static bool ga_colored_exec_possible(const ga_workspace &workspace,
+                                       const ga_instruction_set &gis,
+                                       size_type order,
+                                       std::vector<const mesh_fem *> &mfs);
+  struct ga_element_coloring;
+  typedef std::map<ga_instruction_set::region_mim,
+                   std::shared_ptr<ga_element_coloring>> ga_coloring_map;
+  static void ga_exec_colored(instruction_set &gist,
+                              const std::vector<const mesh_fem *> &mfs,
+                              ga_coloring_map &colorings);
+  static void ga_update_profile(ga_workspace &workspace,
+                                ga_instruction_set &gis,
+                                ga_assembly_profile &profile);
+
+  //=========================================================================
+  // Compiled instructions kept from one assembly to the next one
+  //=========================================================================
+
+  // What the compiled instructions depend on apart from the context
+  // dependencies: storage and intervals of the variables, and the values
+  // of fixed size data and of the time step which are evaluated at compile
+  // time.
+  struct ga_compilation_signature {
+    std::vector<const void *> addresses;
+    std::vector<size_type> sizes;
+    std::vector<scalar_type> values;
+
+    bool operator ==(const ga_compilation_signature &s) const {
+      return addresses == s.addresses && sizes == s.sizes
+        && values == s.values;
+    }
+  };
+
+  // The compiled instructions of a workspace for a given order. They are
+  // invalidated by any change of the meshes, mesh_ims, mesh_fems and
+  // im_datas involved, through the context dependencies.
+  struct ga_workspace::compiled_instructions : public context_dependencies {
+    const ga_workspace *owner;  // The workspace that compiled them
+    ga_compilation_signature signature;
+    ga_instruction_set gis;
+    // Instructions of each thread and colorings for the colored execution
+    instruction_set gist;
+    bool gist_compiled;
+    std::vector<const mesh_fem *> mfs;
+    ga_coloring_map colorings;
+
+    void update_from_context() const {}
+    compiled_instructions(const ga_workspace *w)
+      : owner(w), gist_compiled(false) {}
+  };
+
   class ga_predef_function {
     size_type ftype_; // 0 : C++ function with C++ derivative(s)
                       // 1 : function defined by an string expression.
@@ -3126,7 +3257,84 @@ namespace getfem {
       : t(tt), ctx(ct), mf(mf_), pfp(pfp_) {}
   };
 
+  // Gradients or Hessians of the base functions of a standard fem computed
+  // for all the integration points of an element at once, when the
+  // geometric transformation is linear, the transformation matrix (B for
+  // the gradients, B3 for the Hessians) being then constant on the element.
+  // The reference derivatives of the points are stored point-contiguously
+  // in ref(M*npt_ref, P) so that the product with the transformation matrix
+  // is done on long vectorizable loops. The per-point execution then only
+  // copies its slice.
+  struct ga_batched_base_derivatives {
+    bool hess;
+    pfem_precomp pfp_ref;
+    base_vector ref, res;
+    size_type M, P, N, npt_ref, first_ii, nb_batch, cv_batch;
+
+    const base_tensor &ref_derivative(const pfem_precomp &pfp, size_type i)
+    { return hess ? pfp->hess(i) : pfp->grad(i); }
+
+    // Called at the first point of an element.
+    void compute(const fem_interpolation_context &ctx,
+                 const pfem_precomp &pfp, size_type nbpt) {
+      nb_batch = 0;
+      if (!pfp || !(pfp->get_pfem()->is_standard()) || nbpt < 2
+          || !(ctx.pgt()->is_linear()) || ctx.ii() == size_type(-1))
+        return;
+      if (pfp != pfp_ref) {
+        const base_tensor &g0 = ref_derivative(pfp, 0);
+        pfp_ref = pfp; npt_ref = 0;
+        if (g0.size() == 0) return; // The fem has no Hessian.
+        npt_ref = pfp->get_ppoint_tab()->size();
+        M = g0.sizes()[0] * g0.sizes()[1]; P = g0.size() / M;
+        ref.resize(M * npt_ref * P);
+        for (size_type ip = 0; ip < npt_ref; ++ip) {
+          auto itg = ref_derivative(pfp, ip).begin();
+          for (size_type k = 0; k < P; ++k, itg += M)
+            std::copy(itg, itg+M, ref.begin() + (k*npt_ref + ip)*M);
+        }
+      }
+      if (ctx.ii() + nbpt > npt_ref) return;
+      first_ii = ctx.ii(); nb_batch = nbpt; cv_batch = ctx.convex_num();
+      const base_matrix &B = hess ? ctx.B3() : ctx.B();
+      N = B.nrows();
+      size_type L = M * nb_batch;
+      res.resize(L * N);
+      for (size_type j = 0; j < N; ++j) {  // res_j = sum_k B(j,k) ref_k
+        auto itc = res.begin() + j*L;
+        auto ita = ref.cbegin() + first_ii*M;
+        scalar_type b = B(j, 0);
+        for (size_type l = 0; l < L; ++l) itc[l] = b * ita[l];
+        for (size_type k = 1; k < P; ++k) {
+          ita += npt_ref*M; b = B(j, k);
+          for (size_type l = 0; l < L; ++l) itc[l] += b * ita[l];
+        }
+      }
+    }
+
+    // Copy the result of the point ipt into t if it has been computed.
+    bool copy(base_tensor &t, const fem_interpolation_context &ctx,
+              const pfem_precomp &pfp, size_type ipt) {
+      if (ipt >= nb_batch || ctx.ii() != first_ii + ipt
+          || ctx.convex_num() != cv_batch || pfp != pfp_ref)
+        return false;
+      const bgeot::multi_index &s = ref_derivative(pfp, ctx.ii()).sizes();
+      t.adjust_sizes(s[0], s[1], N);
+      auto itc = res.cbegin() + ipt*M;
+      for (size_type j = 0; j < N; ++j, itc += M*nb_batch)
+        std::copy(itc, itc+M, t.begin() + j*M);
+      return true;
+    }
+
+    ga_batched_base_derivatives(bool h)
+      : hess(h), pfp_ref(0), M(0), P(0), N(0), npt_ref(0), first_ii(0),
+        nb_batch(0), cv_batch(size_type(-1)) {}
+  };
+
   struct ga_instruction_grad_base : public ga_instruction_val_base {
+    const size_type &nbpt, &ipt;
+    bool batched;
+    ga_batched_base_derivatives bd;
 
     virtual int exec() { // --> t(ndof,target_dim,N)
       GA_DEBUG_INFO("Instruction: compute gradient of base functions");
@@ -3134,8 +3342,11 @@ namespace getfem {
       // else ctx.set_pf(mf.fem_of_element(ctx.convex_num()));
       // GMM_ASSERT1(ctx.pf(), "Undefined finite element method");
       // ctx.grad_base_value(t);
-      if (ctx.have_pgp()) ctx.pfp_grad_base_value(t, pfp);
-      else {
+      if (ctx.have_pgp()) {
+        if (batched && ipt == 0) bd.compute(ctx, pfp, nbpt);
+        if (!batched || !(bd.copy(t, ctx, pfp, ipt)))
+          ctx.pfp_grad_base_value(t, pfp);
+      } else {
         ctx.set_pf(mf.fem_of_element(ctx.convex_num()));
         GMM_ASSERT1(ctx.pf(), "Undefined finite element method");
         ctx.grad_base_value(t);
@@ -3144,9 +3355,11 @@ namespace getfem {
     }
 
     ga_instruction_grad_base(base_tensor &tt, fem_interpolation_context &ct,
-                             const mesh_fem &mf_, pfem_precomp &pfp_)
-    : ga_instruction_val_base(tt, ct, mf_, pfp_)
-    {}
+                             const mesh_fem &mf_, pfem_precomp &pfp_,
+                             const size_type &nbpt_, const size_type &ipt_,
+                             bool batched_)
+      : ga_instruction_val_base(tt, ct, mf_, pfp_), nbpt(nbpt_), ipt(ipt_),
+        batched(batched_), bd(false) {}
   };
 
   struct ga_instruction_xfem_plus_grad_base : public ga_instruction_val_base {
@@ -3193,10 +3406,17 @@ namespace getfem {
 
 
   struct ga_instruction_hess_base : public ga_instruction_val_base {
+    const size_type &nbpt, &ipt;
+    bool batched;
+    ga_batched_base_derivatives bd;
 
     virtual int exec() { // --> t(ndof,target_dim,N*N)
       GA_DEBUG_INFO("Instruction: compute Hessian of base functions");
-      if (ctx.have_pgp()) ctx.set_pfp(pfp);
+      if (ctx.have_pgp()) {
+        if (batched && ipt == 0) bd.compute(ctx, pfp, nbpt);
+        if (batched && bd.copy(t, ctx, pfp, ipt)) return 0;
+        ctx.set_pfp(pfp);
+      }
       else ctx.set_pf(mf.fem_of_element(ctx.convex_num()));
       GMM_ASSERT1(ctx.pf(), "Undefined finite element method");
       ctx.hess_base_value(t);
@@ -3204,9 +3424,11 @@ namespace getfem {
     }
 
     ga_instruction_hess_base(base_tensor &tt, fem_interpolation_context &ct,
-                             const mesh_fem &mf_, pfem_precomp &pfp_)
-    : ga_instruction_val_base(tt, ct, mf_, pfp_)
-    {}
+                             const mesh_fem &mf_, pfem_precomp &pfp_,
+                             const size_type &nbpt_, const size_type &ipt_,
+                             bool batched_)
+      : ga_instruction_val_base(tt, ct, mf_, pfp_), nbpt(nbpt_), ipt(ipt_),
+        batched(batched_), bd(true) {}
   };
 
   struct ga_instruction_xfem_plus_hess_base : public ga_instruction_val_base {
@@ -3363,6 +3585,252 @@ namespace getfem {
 
   };
 
+  //=========================================================================
+  // Sum factorization for tensor product fems and integration methods
+  //=========================================================================
+
+  // Grid structure of a set of points: the sorted distinct coordinates in
+  // each direction and the lexicographic index (first direction fastest) of
+  // each point in the grid. Returns false if the points do not form a full
+  // grid.
+  static bool ga_grid_structure(const bgeot::stored_point_tab &pts,
+                                size_type nb, size_type P,
+                                std::vector<base_vector> &coords,
+                                std::vector<size_type> &ind) {
+    const scalar_type eps = 1E-10;
+    coords.assign(P, base_vector());
+    for (size_type d = 0; d < P; ++d) {
+      base_vector &c = coords[d];
+      for (size_type i = 0; i < nb; ++i) c.push_back(pts[i][d]);
+      std::sort(c.begin(), c.end());
+      size_type k = 0;
+      for (size_type i = 0; i < c.size(); ++i)
+        if (k == 0 || c[i] - c[k-1] > eps) c[k++] = c[i];
+      c.resize(k);
+    }
+    size_type n = 1;
+    for (size_type d = 0; d < P; ++d) n *= coords[d].size();
+    if (n != nb) return false;
+    ind.assign(nb, 0);
+    std::vector<bool> found(nb, false);
+    for (size_type i = 0; i < nb; ++i) {
+      size_type stride = 1;
+      for (size_type d = 0; d < P; ++d) {
+        const base_vector &c = coords[d];
+        size_type k = std::lower_bound(c.begin(), c.end(), pts[i][d] - eps)
+          - c.begin();
+        if (k == c.size() || gmm::abs(c[k] - pts[i][d]) > eps) return false;
+        ind[i] += k * stride; stride *= c.size();
+      }
+      if (found[ind[i]]) return false;
+      found[ind[i]] = true;
+    }
+    return true;
+  }
+
+  // Tensor product structure of a scalar Lagrange fem on a parallelepiped
+  // and of the integration points of the element: values and derivatives of
+  // the 1D base functions on the 1D points, and grid indices of the dofs and
+  // of the points. The structure is verified against the fem_precomp.
+  struct ga_tensor_product_structure {
+    size_type P, nbpt, ndof;
+    std::vector<size_type> nd, np;   // Number of 1D dofs and points
+    std::vector<base_matrix> val, der;  // (np[d], nd[d]) 1D tables
+    std::vector<size_type> dof_ind, pt_ind; // Grid indices
+
+    bool build(const pfem_precomp &pfp, size_type cv, size_type nbpt_) {
+      pfem pf = pfp->get_pfem();
+      P = pf->dim(); nbpt = nbpt_; ndof = pf->nb_dof(cv);
+      std::vector<base_vector> nodes, pts;
+      if (!ga_grid_structure(*(pf->node_tab(cv)), ndof, P, nodes, dof_ind)
+          || !ga_grid_structure(*(pfp->get_ppoint_tab()), nbpt, P, pts,
+                                pt_ind))
+        return false;
+      nd.resize(P); np.resize(P); val.resize(P); der.resize(P);
+      for (size_type d = 0; d < P; ++d) {
+        const base_vector &x = nodes[d], &y = pts[d];
+        nd[d] = x.size(); np[d] = y.size();
+        val[d].resize(np[d], nd[d]); der[d].resize(np[d], nd[d]);
+        for (size_type r = 0; r < np[d]; ++r)
+          for (size_type a = 0; a < nd[d]; ++a) {
+            scalar_type v(1), dv(0);
+            for (size_type b = 0; b < nd[d]; ++b)
+              if (b != a) {
+                scalar_type f = (y[r] - x[b]) / (x[a] - x[b]);
+                dv = dv * f + v / (x[a] - x[b]);
+                v *= f;
+              }
+            val[d](r, a) = v; der[d](r, a) = dv;
+          }
+      }
+      // Verification of the factorization of the values and gradients, with
+      // a tolerance allowing for the rounding errors of the evaluation of
+      // the high degree polynomials of the fem.
+      std::vector<size_type> ia(P), ip(P);
+      for (size_type i = 0; i < nbpt; ++i) {
+        for (size_type d = 0, k = pt_ind[i]; d < P; ++d)
+          { ip[d] = k % np[d]; k /= np[d]; }
+        const base_tensor &tv = pfp->val(i), &tg = pfp->grad(i);
+        for (size_type j = 0; j < ndof; ++j) {
+          for (size_type d = 0, k = dof_ind[j]; d < P; ++d)
+            { ia[d] = k % nd[d]; k /= nd[d]; }
+          scalar_type v(1);
+          for (size_type d = 0; d < P; ++d) v *= val[d](ip[d], ia[d]);
+          if (gmm::abs(v - tv[j]) > 1E-6) return false;
+          for (size_type e = 0; e < P; ++e) {
+            scalar_type g(1);
+            for (size_type d = 0; d < P; ++d)
+              g *= (d == e) ? der[d](ip[d], ia[d]) : val[d](ip[d], ia[d]);
+            if (gmm::abs(g - tg[j + e*ndof])
+                > 1E-6 * std::max(scalar_type(1), gmm::abs(g)))
+              return false;
+          }
+        }
+      }
+      return true;
+    }
+  };
+
+  // Contraction of the direction of size n of a tensor of sizes
+  // (inner, n, outer) with the 1D table A(m, n).
+  static void ga_tensor_product_contraction(const base_matrix &A,
+                                            const scalar_type *in,
+                                            scalar_type *out, size_type inner,
+                                            size_type n, size_type m,
+                                            size_type outer) {
+    for (size_type o = 0; o < outer; ++o, in += inner*n, out += inner*m)
+      for (size_type r = 0; r < m; ++r) {
+        scalar_type *itout = out + r*inner;
+        std::fill(itout, itout + inner, scalar_type(0));
+        for (size_type a = 0; a < n; ++a) {
+          scalar_type c = A(r, a);
+          const scalar_type *itin = in + a*inner;
+          for (size_type i = 0; i < inner; ++i) itout[i] += c * itin[i];
+        }
+      }
+  }
+
+  // Value (or gradient) of a fem variable whose values (or reference
+  // gradients) on all the integration points of the element are computed
+  // at the first point by sum factorization, when the fem and the
+  // integration method have a tensor product structure. Otherwise, the
+  // standard instructions are executed.
+  struct ga_instruction_val_sum_factorization : public ga_instruction {
+    base_tensor &t;
+    fem_interpolation_context &ctx;
+    const pfem_precomp &pfp;
+    const base_vector &coeff;
+    size_type qdim;
+    const size_type &nbpt, &ipt;
+    bool grad;
+    base_tensor Z;
+    std::shared_ptr<ga_instruction> base_instr, val_instr;
+    pfem_precomp pfp_ref;
+    std::shared_ptr<ga_tensor_product_structure> tps;
+    base_vector values, work1, work2; // values(q, point grid, component)
+    size_type cv_batch;
+
+    bool compute_batch() {
+      if (!ctx.have_pgp() || !pfp || ctx.ii() != 0) return false;
+      if (pfp != pfp_ref) {
+        pfp_ref = pfp;
+        tps = std::make_shared<ga_tensor_product_structure>();
+        if (!(tps->build(pfp, ctx.convex_num(), nbpt))) tps.reset();
+      }
+      if (!tps || tps->nbpt != nbpt) return false;
+      size_type P = tps->P, ndof = tps->ndof, nc = grad ? P : 1;
+      GA_DEBUG_ASSERT(coeff.size() == ndof*qdim, "Wrong size for coeff");
+      values.resize(qdim * nbpt * nc);
+      size_type ws = ndof;
+      for (size_type d = 0, n = ndof; d < P; ++d)
+        { n = n / tps->nd[d] * tps->np[d]; ws = std::max(ws, n); }
+      work1.resize(ws); work2.resize(ws);
+      for (size_type q = 0; q < qdim; ++q)
+        for (size_type c = 0; c < nc; ++c) {
+          for (size_type j = 0; j < ndof; ++j)
+            work1[tps->dof_ind[j]] = coeff[j*qdim+q];
+          size_type inner = 1, outer = ndof;
+          for (size_type d = 0; d < P; ++d) {
+            outer /= tps->nd[d];
+            const base_matrix &A = (grad && c == d) ? tps->der[d]
+                                                    : tps->val[d];
+            ga_tensor_product_contraction(A, &(work1[0]), &(work2[0]), inner,
+                                          tps->nd[d], tps->np[d], outer);
+            inner *= tps->np[d];
+            std::swap(work1, work2);
+          }
+          std::copy(work1.begin(), work1.begin() + nbpt,
+                    values.begin() + (q*nc + c)*nbpt);
+        }
+      return true;
+    }
+
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: variable value or gradient by sum "
+                    "factorization");
+      if (ipt == 0) cv_batch = compute_batch() ? ctx.convex_num()
+                                               : size_type(-1);
+      if (cv_batch == size_type(-1) || ctx.convex_num() != cv_batch
+          || ctx.ii() != ipt) {
+        base_instr->exec();
+        return val_instr->exec();
+      }
+      size_type ip = tps->pt_ind[ipt];
+      if (!grad) {
+        for (size_type q = 0; q < qdim; ++q) t[q] = values[q*nbpt + ip];
+      } else {
+        const base_matrix &B = ctx.B(); // gradient = B * reference gradient
+        size_type N = B.nrows(), P = tps->P;
+        for (size_type q = 0; q < qdim; ++q)
+          for (size_type k = 0; k < N; ++k) {
+            scalar_type a(0);
+            for (size_type d = 0; d < P; ++d)
+              a += B(k, d) * values[(q*P + d)*nbpt + ip];
+            t[q + k*qdim] = a;
+          }
+      }
+      return 0;
+    }
+
+    ga_instruction_val_sum_factorization
+    (base_tensor &tt, fem_interpolation_context &ctx_, const mesh_fem &mf,
+     pfem_precomp &pfp_, const base_vector &co, size_type q,
+     const size_type &nbpt_, const size_type &ipt_, bool grad_,
+     bool batched)
+      : t(tt), ctx(ctx_), pfp(pfp_), coeff(co), qdim(q),
+        nbpt(nbpt_), ipt(ipt_), grad(grad_), pfp_ref(0),
+        cv_batch(size_type(-1)) {
+      if (grad) {
+        base_instr = std::make_shared<ga_instruction_grad_base>
+          (Z, ctx, mf, pfp_, nbpt, ipt, batched);
+        val_instr = std::make_shared<ga_instruction_grad>(t, Z, coeff, qdim);
+      } else {
+        base_instr = std::make_shared<ga_instruction_val_base>
+          (Z, ctx, mf, pfp_);
+        val_instr = std::make_shared<ga_instruction_val>(t, Z, coeff, qdim);
+      }
+    }
+  };
+
+  // Tests if the values and gradients of a variable may be computed by sum
+  // factorization: uniform scalar polynomial fem of degree at least 2 on
+  // parallelepipeds. The tensor product structure of the fem and of the
+  // integration method is verified at execution.
+  static bool ga_sum_factorization_candidate(const mesh_fem &mf) {
+    if (!(mf.is_uniform()) || mf.convex_index().card() == 0
+        || (mf.get_qdim() > 1 && !(mf.is_uniformly_vectorized())))
+      return false;
+    size_type cv = mf.convex_index().first_true();
+    pfem pf = mf.fem_of_element(cv);
+    if (!pf || pf->target_dim() != 1 || pf->dim() < 2
+        || !(pf->is_equivalent()) || !(pf->is_polynomial())
+        || pf->basic_structure(cv) != bgeot::parallelepiped_structure(pf->dim()))
+      return false;
+    size_type n3 = 1;
+    for (size_type d = 0; d < pf->dim(); ++d) n3 *= 3;
+    return pf->nb_dof(cv) >= n3;
+  }
+
   struct ga_instruction_hess : public ga_instruction_val {
     // Z(ndof,target_dim,N*N), coeff(Qmult,ndof) --> t(target_dim*Qmult,N,N)
     virtual int exec() {
@@ -4371,14 +4839,14 @@ namespace getfem {
   };
 
   struct ga_instruction_copy_vect : public ga_instruction {
-    base_vector &t;
+    base_tensor &t;
     const base_vector &t1;
     virtual int exec() {
       GA_DEBUG_INFO("Instruction: fixed size tensor copy");
-      gmm::copy(t1, t);
+      gmm::copy(t1, t.as_vector());
       return 0;
     }
-    ga_instruction_copy_vect(base_vector &t_, const base_vector &t1_)
+    ga_instruction_copy_vect(base_tensor &t_, const base_vector &t1_)
       : t(t_), t1(t1_) {}
   };
 
@@ -4720,6 +5188,159 @@ namespace getfem {
       : t(t_), tc1(tc1_), tc2(tc2_) {}
   };
 
+  //=========================================================================
+  // Fixed size instructions for the operations on small tensors
+  //=========================================================================
+
+  // Versions of the basic operations for the tensors which do not depend
+  // on the test functions and whose size is known at compile time (the
+  // strain and stress tensors of a constitutive law evaluated at each Gauss
+  // point for instance). The loops are fully unrolled by the compiler,
+  // which removes most of the interpretation overhead on these small
+  // tensors.
+  template <int N>
+  struct ga_instruction_add_unrolled : public ga_instruction {
+    base_tensor &t;
+    const base_tensor &tc1, &tc2;
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: unrolled addition of size " << N);
+      GA_DEBUG_ASSERT(t.size() == N && tc1.size() == N && tc2.size() == N,
+                      "Wrong sizes");
+      base_tensor::iterator it = t.begin();
+      base_tensor::const_iterator it1 = tc1.begin(), it2 = tc2.begin();
+      for (int i = 0; i < N; ++i) it[i] = it1[i] + it2[i];
+      return 0;
+    }
+    ga_instruction_add_unrolled(base_tensor &t_, const base_tensor &tc1_,
+                                const base_tensor &tc2_)
+      : t(t_), tc1(tc1_), tc2(tc2_) {}
+  };
+
+  template <int N>
+  struct ga_instruction_sub_unrolled : public ga_instruction {
+    base_tensor &t;
+    const base_tensor &tc1, &tc2;
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: unrolled subtraction of size " << N);
+      GA_DEBUG_ASSERT(t.size() == N && tc1.size() == N && tc2.size() == N,
+                      "Wrong sizes");
+      base_tensor::iterator it = t.begin();
+      base_tensor::const_iterator it1 = tc1.begin(), it2 = tc2.begin();
+      for (int i = 0; i < N; ++i) it[i] = it1[i] - it2[i];
+      return 0;
+    }
+    ga_instruction_sub_unrolled(base_tensor &t_, const base_tensor &tc1_,
+                                const base_tensor &tc2_)
+      : t(t_), tc1(tc1_), tc2(tc2_) {}
+  };
+
+  template <int N>
+  struct ga_instruction_scalar_mult_unrolled : public ga_instruction {
+    base_tensor &t;
+    const base_tensor &tc1;
+    const scalar_type &c;
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: unrolled multiplication of a tensor of size "
+                    << N << " by a scalar");
+      GA_DEBUG_ASSERT(t.size() == N && tc1.size() == N, "Wrong sizes");
+      base_tensor::iterator it = t.begin();
+      base_tensor::const_iterator it1 = tc1.begin();
+      scalar_type a = c;
+      for (int i = 0; i < N; ++i) it[i] = a * it1[i];
+      return 0;
+    }
+    ga_instruction_scalar_mult_unrolled(base_tensor &t_,
+                                        const base_tensor &tc1_,
+                                        const scalar_type &c_)
+      : t(t_), tc1(tc1_), c(c_) {}
+  };
+
+  // Performs Aij Bjk -> Cik for N x N matrices.
+  template <int N>
+  struct ga_instruction_matrix_mult_unrolled : public ga_instruction {
+    base_tensor &t;
+    const base_tensor &tc1, &tc2;
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: unrolled matrix multiplication of size "
+                    << N);
+      GA_DEBUG_ASSERT(t.size() == N*N && tc1.size() == N*N
+                      && tc2.size() == N*N, "Wrong sizes");
+      base_tensor::iterator it = t.begin();
+      base_tensor::const_iterator it1 = tc1.begin(), it2 = tc2.begin();
+      for (int k = 0; k < N; ++k)
+        for (int i = 0; i < N; ++i) {
+          scalar_type a(0);
+          for (int j = 0; j < N; ++j) a += it1[i+j*N] * it2[j+k*N];
+          it[i+k*N] = a;
+        }
+      return 0;
+    }
+    ga_instruction_matrix_mult_unrolled(base_tensor &t_,
+                                        const base_tensor &tc1_,
+                                        const base_tensor &tc2_)
+      : t(t_), tc1(tc1_), tc2(tc2_) {}
+  };
+
+  template <int N>
+  struct ga_instruction_transpose_unrolled : public ga_instruction {
+    base_tensor &t;
+    const base_tensor &tc1;
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: unrolled transpose of size " << N);
+      GA_DEBUG_ASSERT(t.size() == N*N && tc1.size() == N*N, "Wrong sizes");
+      base_tensor::iterator it = t.begin();
+      base_tensor::const_iterator it1 = tc1.begin();
+      for (int j = 0; j < N; ++j)
+        for (int i = 0; i < N; ++i) it[i+j*N] = it1[j+i*N];
+      return 0;
+    }
+    ga_instruction_transpose_unrolled(base_tensor &t_, const base_tensor &tc1_)
+      : t(t_), tc1(tc1_) {}
+  };
+
+  template <int N>
+  struct ga_instruction_trace_unrolled : public ga_instruction {
+    base_tensor &t;
+    const base_tensor &tc1;
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: unrolled trace of size " << N);
+      GA_DEBUG_ASSERT(t.size() == 1 && tc1.size() == N*N, "Wrong sizes");
+      base_tensor::const_iterator it1 = tc1.begin();
+      scalar_type a(0);
+      for (int i = 0; i < N; ++i) a += it1[i*(N+1)];
+      t[0] = a;
+      return 0;
+    }
+    ga_instruction_trace_unrolled(base_tensor &t_, const base_tensor &tc1_)
+      : t(t_), tc1(tc1_) {}
+  };
+
+  // Selection of the fixed size instruction, if any. Return a null pointer
+  // when the size is not handled.
+  template <template <int> class INSTR, class... Args>
+  pga_instruction ga_unrolled_instruction(size_type n, Args&... args) {
+    switch(n) {
+    case 2 : return std::make_shared<INSTR<2>>(args...);
+    case 3 : return std::make_shared<INSTR<3>>(args...);
+    case 4 : return std::make_shared<INSTR<4>>(args...);
+    case 5 : return std::make_shared<INSTR<5>>(args...);
+    case 6 : return std::make_shared<INSTR<6>>(args...);
+    case 7 : return std::make_shared<INSTR<7>>(args...);
+    case 8 : return std::make_shared<INSTR<8>>(args...);
+    case 9 : return std::make_shared<INSTR<9>>(args...);
+    default: return pga_instruction();
+    }
+  }
+
+  template <template <int> class INSTR, class... Args>
+  pga_instruction ga_unrolled_matrix_instruction(size_type n, Args&... args) {
+    switch(n) {
+    case 2 : return std::make_shared<INSTR<2>>(args...);
+    case 3 : return std::make_shared<INSTR<3>>(args...);
+    default: return pga_instruction();
+    }
+  }
+
 
   // Performs Ani Bmi -> Cmn
   struct ga_instruction_reduction : public ga_instruction {
@@ -4987,13 +5608,13 @@ namespace getfem {
   };
 
   template<int N> inline void reduc_elem_unrolled_opt1_
-  (const base_vector::iterator &it, const base_vector::iterator &it1,
+  (const base_tensor::iterator &it, const base_tensor::iterator &it1,
    scalar_type a, size_type s1) {
     it[N-1] = it1[(N-1)*s1] * a;
     reduc_elem_unrolled_opt1_<N-1>(it, it1, a, s1);
   }
   template<> inline void reduc_elem_unrolled_opt1_<1>
-  (const base_vector::iterator &it, const base_vector::iterator &it1,
+  (const base_tensor::iterator &it, const base_tensor::iterator &it1,
    scalar_type a, size_type /* s1 */)
   { *it = (*it1) * a; }
 
@@ -6187,6 +6808,9 @@ namespace getfem {
     papprox_integration &pai;
     bgeot::geotrans_precomp_pool &gp_pool;
     std::map<gauss_pt_corresp, bgeot::pstored_point_tab> &neighbour_corresp;
+    // Compact copy of the mesh, kept with the compiled instructions which
+    // are not reused after a modification of the mesh.
+    std::shared_ptr<const bgeot::mesh_structure_csr> pms;
 
     virtual int exec() {
       bool cancel_optimization = false;
@@ -6199,7 +6823,9 @@ namespace getfem {
           // Test if the situation has already been encountered
           size_type cv = ctx.convex_num();
           short_type f = ctx.face_num();
-          auto adj_face = m.adjacent_face(cv, f);
+          if (!pms) pms = m.frozen_structure();
+          const bgeot::mesh_structure_csr &ms = *pms;
+          auto adj_face = ms.adjacent_face(cv, f);
           if (adj_face.cv == size_type(-1)) {
             inin.ctx.invalid_convex_num();
           } else {
@@ -6207,9 +6833,9 @@ namespace getfem {
             gpc.pgt1 = m.trans_of_convex(cv);
             gpc.pgt2 = m.trans_of_convex(adj_face.cv);
             gpc.pai = pai;
-            auto inds_pt1 = m.ind_points_of_face_of_convex(cv, f);
-            auto inds_pt2 = m.ind_points_of_face_of_convex(adj_face.cv,
-                                                           adj_face.f);
+            auto inds_pt1 = ms.ind_points_of_face_of_convex(cv, f);
+            auto inds_pt2 = ms.ind_points_of_face_of_convex(adj_face.cv,
+                                                            adj_face.f);
             auto str1 = gpc.pgt1->structure();
             auto str2 = gpc.pgt2->structure();
             size_type nbptf1 = str1->nb_points_of_face(f);
@@ -6519,6 +7145,172 @@ namespace getfem {
   }
   
 
+  // Addition of the element matrices of a matrix assembly instruction,
+  // either directly to K or to the fixed pattern matrix of the instruction
+  // set. In the latter case, the positions in A.pr of the entries of the
+  // element matrices are computed at the first addition on each element
+  // and then reused.
+  struct ga_elem_matrix_adder {
+    ga_pattern_matrix *pattern; // Null if the instruction cannot use it
+    std::vector<size_type> first; // First position of each element in pos
+    std::vector<unsigned> pos;
+    size_type cur;
+    bool known;
+
+    int mode() const
+    { return (pattern && pattern->active) ? pattern->mode
+                                          : ga_pattern_matrix::NONE; }
+    bool records() const { return mode() == ga_pattern_matrix::RECORD; }
+
+    // To be called before the additions on element cv.
+    void element(size_type cv) {
+      if (mode() != ga_pattern_matrix::ASSEMBLE) return;
+      if (first.size() <= cv) first.resize(cv+1, size_type(-1));
+      known = (first[cv] != size_type(-1));
+      if (known) cur = first[cv]; else first[cv] = pos.size();
+    }
+
+    template <class MAT>
+    void add(MAT &K, const std::vector<size_type> &dofs1,
+             const std::vector<size_type> &dofs2,
+             std::vector<size_type> &dofs1_sort,
+             base_vector &elem, scalar_type threshold, size_type N) {
+      switch (mode()) {
+      case ga_pattern_matrix::NONE:
+        add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, threshold, N);
+        break;
+      case ga_pattern_matrix::RECORD:
+        add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, threshold, N);
+        add_elem_matrix_(pattern->P, dofs1, dofs2, dofs1_sort, elem,
+                         scalar_type(-1), N);
+        break;
+      case ga_pattern_matrix::ASSEMBLE:
+        {
+          gmm::csc_matrix<scalar_type> &A = pattern->A;
+          size_type s = dofs1.size() * dofs2.size();
+          auto it = elem.cbegin();
+          if (known) {
+            auto itp = pos.cbegin() + cur;
+            scalar_type *pr = &(A.pr[0]);
+            for (size_type k = 0; k < s; ++k) pr[*itp++] += *it++;
+            cur += s;
+          } else {
+            for (const size_type &dof2 : dofs2) {
+              auto itb = A.ir.begin() + A.jc[dof2];
+              auto ite = A.ir.begin() + A.jc[dof2+1];
+              for (const size_type &dof1 : dofs1) {
+                auto itr = std::lower_bound(itb, ite, unsigned(dof1));
+                GMM_ASSERT1(itr != ite && *itr == dof1, "Internal error");
+                unsigned p = unsigned(itr - A.ir.begin());
+                pos.push_back(p);
+                A.pr[p] += *it++;
+              }
+            }
+          }
+        }
+        break;
+      }
+    }
+
+    ga_elem_matrix_adder(ga_pattern_matrix *p)
+      : pattern(p), cur(0), known(false) {}
+  };
+
+  // Pattern of the block sparse row matrix K of size n given by the element
+  // connectivity of the mesh_fems of the terms assembled into it.
+  static void ga_build_bsr_pattern(gmm::bsr_matrix<scalar_type> &K,
+                                   const std::set<ga_bsr_coupling> &couplings,
+                                   size_type n) {
+    size_type bs = 0;
+    for (const ga_bsr_coupling &c : couplings) {
+      GMM_ASSERT1(bs == 0 || bs == c.mf->get_qdim(), "The variables "
+                  "assembled into a block sparse row matrix should have "
+                  "the same dimension");
+      bs = c.mf->get_qdim();
+    }
+    if (bs == 0) bs = 1;
+    GMM_ASSERT1(n % bs == 0, "The number of dofs is not a multiple of the "
+                "block size");
+    std::vector<std::vector<unsigned>> rows(n / bs);
+    std::vector<size_type> nodes;
+    for (const ga_bsr_coupling &c : couplings) {
+      GMM_ASSERT1(c.first1 % bs == 0 && c.first2 % bs == 0, "The first "
+                  "dof of each variable should be a multiple of the block "
+                  "size");
+      for (dal::bv_visitor cv(c.mf->convex_index()); !cv.finished(); ++cv) {
+        GMM_ASSERT1(c.mf->fem_of_element(cv)->target_dim() == 1,
+                    "Vector elements cannot be assembled by blocks");
+        nodes.resize(0);
+        for (size_type d : c.mf->ind_scalar_basic_dof_of_element(cv))
+          nodes.push_back(d / bs);
+        for (size_type a : nodes)
+          for (size_type b : nodes)
+            rows[c.first1/bs + a].push_back(unsigned(c.first2/bs + b));
+      }
+    }
+    for (std::vector<unsigned> &row : rows) {
+      std::sort(row.begin(), row.end());
+      row.erase(std::unique(row.begin(), row.end()), row.end());
+    }
+    K.init_with_pattern(n, n, bs, rows);
+  }
+
+  // Conversion of the recorded pattern into the compressed sparse column
+  // matrix A.
+  static void ga_build_pattern_matrix(ga_pattern_matrix &pattern) {
+    gmm::csc_matrix<scalar_type> &A = pattern.A;
+    const model_real_sparse_matrix &P = pattern.P;
+    A.nr = gmm::mat_nrows(P); A.nc = gmm::mat_ncols(P);
+    A.jc.resize(A.nc+1);
+    A.jc[0] = 0;
+    for (size_type j = 0; j < A.nc; ++j)
+      A.jc[j+1] = unsigned(A.jc[j] + P.col(j).nb_stored());
+    A.ir.resize(A.jc[A.nc]);
+    A.pr.resize(A.jc[A.nc]);
+    auto itr = A.ir.begin();
+    for (size_type j = 0; j < A.nc; ++j)
+      for (const gmm::elt_rsvector_<scalar_type> &ev : P.col(j))
+        *itr++ = unsigned(ev.c);
+    gmm::clear(pattern.P);
+    gmm::resize(pattern.P, 0, 0);
+  }
+
+  // Addition of the fixed pattern matrix to K. As for the element matrices,
+  // the entries below a relative threshold of 1E-14 (with respect to the
+  // maximal entry of the column) are skipped.
+  static void ga_add_pattern_matrix(const gmm::csc_matrix<scalar_type> &A,
+                                    model_real_sparse_matrix &K) {
+    std::vector<gmm::elt_rsvector_<scalar_type>> aux;
+    gmm::elt_rsvector_<scalar_type> ev;
+    for (size_type j = 0; j < A.nc; ++j) {
+      size_type kb = A.jc[j], ke = A.jc[j+1];
+      scalar_type threshold(0);
+      for (size_type k = kb; k < ke; ++k)
+        threshold = std::max(threshold, gmm::abs(A.pr[k]));
+      if (threshold == scalar_type(0)) continue;
+      threshold *= 1E-14;
+      std::vector<gmm::elt_rsvector_<scalar_type>> &col = K[j];
+      if (col.empty()) {
+        col.reserve(ke - kb);
+        for (size_type k = kb; k < ke; ++k)
+          if (gmm::abs(A.pr[k]) > threshold)
+            { ev.c = A.ir[k]; ev.e = A.pr[k]; col.push_back(ev); }
+      } else { // column merge
+        aux.resize(0);
+        auto it = col.cbegin(), ite = col.cend();
+        for (size_type k = kb; k < ke; ++k) {
+          if (gmm::abs(A.pr[k]) <= threshold) continue;
+          ev.c = A.ir[k]; ev.e = A.pr[k];
+          for (; it != ite && it->c < ev.c; ++it) aux.push_back(*it);
+          if (it != ite && it->c == ev.c) { ev.e += it->e; ++it; }
+          aux.push_back(ev);
+        }
+        aux.insert(aux.end(), it, ite);
+        col.swap(aux);
+      }
+    }
+  }
+
   template <class MAT = model_real_sparse_matrix>
   struct ga_instruction_matrix_assembly : public ga_instruction {
     const base_tensor &t;
@@ -6659,6 +7451,7 @@ namespace getfem {
     const size_type &nbpt, &ipt;
     base_vector elem;
     std::vector<size_type> dofs1, dofs2, dofs1_sort;
+    ga_elem_matrix_adder adder;
     virtual int exec() {
       GA_DEBUG_INFO("Instruction: matrix term assembly for standard "
                     "scalar fems");
@@ -6689,10 +7482,11 @@ namespace getfem {
         GA_DEBUG_ASSERT(I1.size() && I2.size(), "Internal error");
 
         scalar_type ninf = gmm::vect_norminf(elem);
-        if (ninf == scalar_type(0)) return 0;
+        if (ninf == scalar_type(0) && !adder.records()) return 0;
 
         size_type cv1 = ctx1.convex_num(), cv2 = ctx2.convex_num(), N=ctx1.N();
         if (cv1 == size_type(-1)) return 0;
+        adder.element(cv1);
         auto &ct1 = pmf1->ind_scalar_basic_dof_of_element(cv1);
         GA_DEBUG_ASSERT(ct1.size() == t.sizes()[0], "Internal error");
 	dofs1.resize(ct1.size());
@@ -6701,12 +7495,12 @@ namespace getfem {
 
         if (pmf2 == pmf1 && cv1 == cv2) {
 	  if (I1.first() == I2.first()) {
-	    add_elem_matrix_(K, dofs1, dofs1, dofs1_sort, elem, ninf*1E-14, N);
+	    adder.add(K, dofs1, dofs1, dofs1_sort, elem, ninf*1E-14, N);
 	  } else {
 	    dofs2.resize(dofs1.size());
 	    for (size_type i = 0; i < dofs1.size(); ++i)
 	      dofs2[i] =  dofs1[i] + I2.first() - I1.first();
-	    add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
+	    adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
 	  }
 	} else {
 	  if (cv2 == size_type(-1)) return 0;
@@ -6715,7 +7509,7 @@ namespace getfem {
 	  dofs2.resize(ct2.size());
 	  for (size_type i = 0; i < ct2.size(); ++i)
 	    dofs2[i] = ct2[i] + I2.first();
-	  add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
+	  adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
 	}
       }
       return 0;
@@ -6728,9 +7522,68 @@ namespace getfem {
      const mesh_fem *mfn1_, const mesh_fem *mfn2_,
      const scalar_type &coeff_, const scalar_type &alpha2_,
      const scalar_type &alpha1_,
-     const size_type &nbpt_, const size_type &ipt_)
+     const size_type &nbpt_, const size_type &ipt_,
+     ga_pattern_matrix *pattern_)
       : t(t_), K(Kn_), ctx1(ctx1_), ctx2(ctx2_),
         I1(In1_), I2(In2_),  pmf1(mfn1_), pmf2(mfn2_),
+        coeff(coeff_), alpha1(alpha1_), alpha2(alpha2_),
+        nbpt(nbpt_), ipt(ipt_), adder(pattern_) {}
+  };
+
+  // Assembly of the element matrices of two variables sharing the same
+  // vector mesh_fem directly into the blocks of a block sparse row matrix
+  // whose pattern contains those of the elements.
+  struct ga_instruction_matrix_assembly_bsr: public ga_instruction {
+    const base_tensor &t;
+    gmm::bsr_matrix<scalar_type> &K;
+    const fem_interpolation_context &ctx;
+    const gmm::sub_interval &I1, &I2;
+    const mesh_fem *pmf;
+    const scalar_type &coeff, &alpha1, &alpha2;
+    const size_type &nbpt, &ipt;
+    base_vector elem;
+    virtual int exec() {
+      GA_DEBUG_INFO("Instruction: matrix term assembly into a block sparse "
+                    "row matrix");
+      scalar_type e = coeff*alpha1*alpha2;
+      if (ipt == 0) {
+        elem.resize(t.size());
+        auto itt = t.begin(); auto it = elem.begin(), ite = elem.end();
+        for (; it != ite;) *it++ = (*itt++) * e;
+      } else {
+        auto itt = t.begin(); auto it = elem.begin(), ite = elem.end();
+        for (; it != ite;) *it++ += (*itt++) * e;
+      }
+      if (ipt == nbpt-1) {
+        size_type cv = ctx.convex_num();
+        if (cv == size_type(-1)) return 0;
+        auto &ct = pmf->ind_scalar_basic_dof_of_element(cv);
+        size_type bs = K.block_size(), s1 = t.sizes()[0], nn = ct.size();
+        GA_DEBUG_ASSERT(nn*bs == s1 && s1 == t.sizes()[1], "Internal error");
+        size_type b1 = I1.first() / bs, b2 = I2.first() / bs;
+        for (size_type b = 0; b < nn; ++b) {
+          size_type jb = b2 + ct[b] / bs;
+          for (size_type a = 0; a < nn; ++a) {
+            scalar_type *blk = K.block(b1 + ct[a] / bs, jb);
+            GMM_ASSERT1(blk, "The block sparse row matrix has not the "
+                        "expected pattern");
+            // Block (a, b) of the element matrix stored by columns.
+            auto it = elem.cbegin() + (a + b*s1)*bs;
+            for (size_type c = 0; c < bs; ++c, it += s1)
+              for (size_type r = 0; r < bs; ++r) blk[r*bs+c] += it[r];
+          }
+        }
+      }
+      return 0;
+    }
+    ga_instruction_matrix_assembly_bsr
+    (const base_tensor &t_, gmm::bsr_matrix<scalar_type> &K_,
+     const fem_interpolation_context &ctx_,
+     const gmm::sub_interval &In1_, const gmm::sub_interval &In2_,
+     const mesh_fem *mfn_, const scalar_type &coeff_,
+     const scalar_type &alpha2_, const scalar_type &alpha1_,
+     const size_type &nbpt_, const size_type &ipt_)
+      : t(t_), K(K_), ctx(ctx_), I1(In1_), I2(In2_), pmf(mfn_),
         coeff(coeff_), alpha1(alpha1_), alpha2(alpha2_),
         nbpt(nbpt_), ipt(ipt_) {}
   };
@@ -6746,6 +7599,7 @@ namespace getfem {
     const size_type &nbpt, &ipt;
     mutable base_vector elem;
     mutable std::vector<size_type> dofs1, dofs2, dofs1_sort;
+    ga_elem_matrix_adder adder;
     virtual int exec() {
       GA_DEBUG_INFO("Instruction: matrix term assembly for standard "
                         "vector fems");
@@ -6780,11 +7634,12 @@ namespace getfem {
         GA_DEBUG_ASSERT(I1.size() && I2.size(), "Internal error");
 
         scalar_type ninf = gmm::vect_norminf(elem);
-        if (ninf == scalar_type(0)) return 0;
+        if (ninf == scalar_type(0) && !adder.records()) return 0;
         size_type s1 = t.sizes()[0], s2 = t.sizes()[1], N = ctx1.N();
 
         size_type cv1 = ctx1.convex_num(), cv2 = ctx2.convex_num();
         if (cv1 == size_type(-1)) return 0;
+        adder.element(cv1);
         auto &ct1 = pmf1->ind_scalar_basic_dof_of_element(cv1);
         size_type qmult1 = pmf1->get_qdim();
         if (qmult1 > 1) qmult1 /= pmf1->fem_of_element(cv1)->target_dim();
@@ -6796,12 +7651,12 @@ namespace getfem {
 
 	if (pmf2 == pmf1 && cv1 == cv2) {
 	  if (I1.first() == I2.first()) {
-	    add_elem_matrix_(K, dofs1, dofs1, dofs1_sort, elem, ninf*1E-14, N);
+	    adder.add(K, dofs1, dofs1, dofs1_sort, elem, ninf*1E-14, N);
 	  } else {
 	    dofs2.resize(dofs1.size());
 	    for (size_type i = 0; i < dofs1.size(); ++i)
 	      dofs2[i] =  dofs1[i] + I2.first() - I1.first();
-	    add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
+	    adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
 	  }
 	} else {
 	  if (cv2 == size_type(-1)) return 0;
@@ -6814,7 +7669,7 @@ namespace getfem {
 	    for (size_type q = 0; q < qmult2; ++q)
 	      *itd++ += *itt + q;
 	  
-	  add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
+	  adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf*1E-14, N);
 	}
       }
       return 0;
@@ -6827,11 +7682,11 @@ namespace getfem {
      const mesh_fem *mfn1_, const mesh_fem *mfn2_,
      const scalar_type &coeff_, const scalar_type &alpha2_,
      const scalar_type &alpha1_, const size_type &nbpt_,
-     const size_type &ipt_)
+     const size_type &ipt_, ga_pattern_matrix *pattern_)
       : t(t_), K(Kn_), ctx1(ctx1_), ctx2(ctx2_),
         I1(In1_), I2(In2_),  pmf1(mfn1_), pmf2(mfn2_),
         coeff(coeff_), alpha1(alpha1_), alpha2(alpha2_),
-        nbpt(nbpt_), ipt(ipt_), dofs1(0), dofs2(0) {}
+        nbpt(nbpt_), ipt(ipt_), dofs1(0), dofs2(0), adder(pattern_) {}
   };
 
   struct ga_instruction_matrix_assembly_standard_vector_opt10_2
@@ -6845,6 +7700,7 @@ namespace getfem {
     const size_type &nbpt, &ipt;
     mutable base_vector elem;
     mutable std::vector<size_type> dofs1, dofs2, dofs1_sort;
+    ga_elem_matrix_adder adder;
     virtual int exec() {
       GA_DEBUG_INFO("Instruction: matrix term assembly for standard "
 		    "vector fems optimized for format 10 qdim 2");
@@ -6871,37 +7727,38 @@ namespace getfem {
         GA_DEBUG_ASSERT(I1.size() && I2.size(), "Internal error");
 
         scalar_type ninf = gmm::vect_norminf(elem) * 1E-14;
-        if (ninf == scalar_type(0)) return 0;
+        if (ninf == scalar_type(0) && !adder.records()) return 0;
         size_type N = ctx1.N();
         size_type cv1 = ctx1.convex_num(), cv2 = ctx2.convex_num();
 	size_type i1 = I1.first(), i2 = I2.first();
         if (cv1 == size_type(-1)) return 0;
+        adder.element(cv1);
         auto &ct1 = pmf1->ind_scalar_basic_dof_of_element(cv1);
 	dofs1.resize(ss1);
 	for (size_type i = 0; i < ss1; ++i) dofs1[i] = i1 + ct1[i];
 	
 	if (pmf2 == pmf1 && cv1 == cv2) {
 	  if (i1 == i2) {
-	    add_elem_matrix_(K, dofs1, dofs1, dofs1_sort, elem, ninf, N);
+	    adder.add(K, dofs1, dofs1, dofs1_sort, elem, ninf, N);
 	    for (size_type i = 0; i < ss1; ++i) (dofs1[i])++;
-	    add_elem_matrix_(K, dofs1, dofs1, dofs1_sort, elem, ninf, N);
+	    adder.add(K, dofs1, dofs1, dofs1_sort, elem, ninf, N);
 	  } else {
 	    dofs2.resize(ss2);
 	    for (size_type i = 0; i < ss2; ++i) dofs2[i] = i2 + ct1[i];
-	    add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
+	    adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
 	    for (size_type i = 0; i < ss1; ++i) (dofs1[i])++;
 	    for (size_type i = 0; i < ss2; ++i) (dofs2[i])++;
-	    add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
+	    adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
 	  }
 	} else {
 	  if (cv2 == size_type(-1)) return 0;
 	  auto &ct2 = pmf2->ind_scalar_basic_dof_of_element(cv2);
 	  dofs2.resize(ss2);
 	  for (size_type i = 0; i < ss2; ++i) dofs2[i] = i2 + ct2[i];
-	  add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
+	  adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
 	  for (size_type i = 0; i < ss1; ++i) (dofs1[i])++;
 	  for (size_type i = 0; i < ss2; ++i) (dofs2[i])++;
-	  add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
+	  adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
 	}
       }
       return 0;
@@ -6914,11 +7771,11 @@ namespace getfem {
      const mesh_fem *mfn1_, const mesh_fem *mfn2_,
      const scalar_type &coeff_, const scalar_type &alpha2_,
      const scalar_type &alpha1_, const size_type &nbpt_,
-     const size_type &ipt_)
+     const size_type &ipt_, ga_pattern_matrix *pattern_)
       : t(t_), K(Kn_), ctx1(ctx1_), ctx2(ctx2_),
         I1(In1_), I2(In2_),  pmf1(mfn1_), pmf2(mfn2_),
         coeff(coeff_), alpha1(alpha1_), alpha2(alpha2_),
-        nbpt(nbpt_), ipt(ipt_), dofs1(0), dofs2(0) {}
+        nbpt(nbpt_), ipt(ipt_), dofs1(0), dofs2(0), adder(pattern_) {}
   };
 
   struct ga_instruction_matrix_assembly_standard_vector_opt10_3
@@ -6932,6 +7789,7 @@ namespace getfem {
     const size_type &nbpt, &ipt;
     mutable base_vector elem;
     mutable std::vector<size_type> dofs1, dofs2, dofs1_sort;
+    ga_elem_matrix_adder adder;
     virtual int exec() {
       GA_DEBUG_INFO("Instruction: matrix term assembly for standard "
 		    "vector fems optimized for format 10 qdim 3");
@@ -6958,45 +7816,46 @@ namespace getfem {
         GA_DEBUG_ASSERT(I1.size() && I2.size(), "Internal error");
 
         scalar_type ninf = gmm::vect_norminf(elem)*1E-14;
-        if (ninf == scalar_type(0)) return 0;
+        if (ninf == scalar_type(0) && !adder.records()) return 0;
         size_type N = ctx1.N();
         size_type cv1 = ctx1.convex_num(), cv2 = ctx2.convex_num();
 	size_type i1 = I1.first(), i2 = I2.first();
         if (cv1 == size_type(-1)) return 0;
+        adder.element(cv1);
         auto &ct1 = pmf1->ind_scalar_basic_dof_of_element(cv1);
 	dofs1.resize(ss1);
 	for (size_type i = 0; i < ss1; ++i) dofs1[i] = i1 + ct1[i];
 	
 	if (pmf2 == pmf1 && cv1 == cv2) {
 	  if (i1 == i2) {
-	    add_elem_matrix_(K, dofs1, dofs1, dofs1_sort, elem, ninf, N);
+	    adder.add(K, dofs1, dofs1, dofs1_sort, elem, ninf, N);
 	    for (size_type i = 0; i < ss1; ++i) (dofs1[i])++;
-	    add_elem_matrix_(K, dofs1, dofs1, dofs1_sort, elem, ninf, N);
+	    adder.add(K, dofs1, dofs1, dofs1_sort, elem, ninf, N);
 	    for (size_type i = 0; i < ss1; ++i) (dofs1[i])++;
-	    add_elem_matrix_(K, dofs1, dofs1, dofs1_sort, elem, ninf, N);
+	    adder.add(K, dofs1, dofs1, dofs1_sort, elem, ninf, N);
 	  } else {
 	    dofs2.resize(ss2);
 	    for (size_type i = 0; i < ss2; ++i) dofs2[i] = i2 + ct1[i];
-	    add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
+	    adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
 	    for (size_type i = 0; i < ss1; ++i) (dofs1[i])++;
 	    for (size_type i = 0; i < ss2; ++i) (dofs2[i])++;
-	    add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
+	    adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
 	    for (size_type i = 0; i < ss1; ++i) (dofs1[i])++;
 	    for (size_type i = 0; i < ss2; ++i) (dofs2[i])++;
-	    add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
+	    adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
 	  }
 	} else {
 	  if (cv2 == size_type(-1)) return 0;
 	  auto &ct2 = pmf2->ind_scalar_basic_dof_of_element(cv2);
 	  dofs2.resize(ss2);
 	  for (size_type i = 0; i < ss2; ++i) dofs2[i] = i2 + ct2[i];
-	  add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
+	  adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
 	  for (size_type i = 0; i < ss1; ++i) (dofs1[i])++;
 	  for (size_type i = 0; i < ss2; ++i) (dofs2[i])++;
-	  add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
+	  adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
 	  for (size_type i = 0; i < ss1; ++i) (dofs1[i])++;
 	  for (size_type i = 0; i < ss2; ++i) (dofs2[i])++;
-	  add_elem_matrix_(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
+	  adder.add(K, dofs1, dofs2, dofs1_sort, elem, ninf, N);
 	}
       }
       return 0;
@@ -7009,11 +7868,11 @@ namespace getfem {
      const mesh_fem *mfn1_, const mesh_fem *mfn2_,
      const scalar_type &coeff_, const scalar_type &alpha2_,
      const scalar_type &alpha1_, const size_type &nbpt_,
-     const size_type &ipt_)
+     const size_type &ipt_, ga_pattern_matrix *pattern_)
       : t(t_), K(Kn_), ctx1(ctx1_), ctx2(ctx2_),
         I1(In1_), I2(In2_),  pmf1(mfn1_), pmf2(mfn2_),
         coeff(coeff_), alpha1(alpha1_), alpha2(alpha2_),
-        nbpt(nbpt_), ipt(ipt_), dofs1(0), dofs2(0) {}
+        nbpt(nbpt_), ipt(ipt_), dofs1(0), dofs2(0), adder(pattern_) {}
   };
 
 
@@ -7038,12 +7897,14 @@ namespace getfem {
   void ga_workspace::add_fem_variable
   (const std::string &name, const mesh_fem &mf,
    const gmm::sub_interval &I, const model_real_plain_vector &VV) {
+    compiled.clear();
     variables[name] = var_description(true, true, &mf, I, &VV, 0, 1);
   }
 
   void ga_workspace::add_fixed_size_variable
   (const std::string &name,
    const gmm::sub_interval &I, const model_real_plain_vector &VV) {
+    compiled.clear();
     variables[name] = var_description(true, false, 0, I, &VV, 0,
                                       dim_type(gmm::vect_size(VV)));
   }
@@ -7055,12 +7916,14 @@ namespace getfem {
                              << "has zero degrees of freedom.");
     size_type Q = gmm::vect_size(VV)/mf.nb_dof();
     if (Q == 0) Q = size_type(1);
+    compiled.clear();
     variables[name] = var_description(false, true, &mf,
                                       gmm::sub_interval(), &VV, 0, Q);
   }
 
   void ga_workspace::add_fixed_size_constant
   (const std::string &name, const model_real_plain_vector &VV) {
+    compiled.clear();
     variables[name] = var_description(false, false, 0,
                                       gmm::sub_interval(), &VV, 0,
                                       gmm::vect_size(VV));
@@ -7068,6 +7931,7 @@ namespace getfem {
 
   void ga_workspace::add_im_data(const std::string &name, const im_data &imd,
                                  const model_real_plain_vector &VV) {
+    compiled.clear();
     variables[name] = var_description
       (false, false, 0, gmm::sub_interval(), &VV, &imd,
        gmm::vect_size(VV)/(imd.nb_filtered_index() * imd.nb_tensor_elem()));
@@ -7346,6 +8210,7 @@ namespace getfem {
     if (transformations.find(name) != transformations.end())
       GMM_ASSERT1(name.compare("neighbour_elt"), "neighbour_elt is a "
                   "reserved interpolate transformation name");
+    compiled.clear();
     transformations[name] = ptrans;
   }
 
@@ -7477,6 +8342,7 @@ namespace getfem {
                               size_type add_derivative_order,
                               bool function_expr, size_type for_interpolation,
 			      const std::string varname_interpolation) {
+    compiled.clear();
     if (tree.root) {
 
       // Eliminate the term if it corresponds to disabled variables
@@ -7808,6 +8674,7 @@ namespace getfem {
                   "Two variables in a group cannot share the same mesh");
       ms.insert(&(mf->linked_mesh()));
     }
+    compiled.clear();
     variable_groups[group_name] = nl;
   }
 
@@ -7824,28 +8691,108 @@ namespace getfem {
   }
 
 
-  void ga_workspace::assembly(size_type order) {
+  // Signature of the variables and data involved in the expressions of a
+  // workspace, together with the objects the compiled instructions depend on.
+  static void ga_compilation_signature_of
+  (ga_workspace &workspace, const void *K, const void *V, bool time_step,
+   ga_compilation_signature &sig,
+   std::set<const context_dependencies *> &deps) {
+    std::set<var_trans_pair> vars;
+    std::set<std::string> names;
+    for (size_type i = 0; i < workspace.nb_trees(); ++i) {
+      const ga_workspace::tree_description &td = workspace.tree_info(i);
+      deps.insert(td.mim); deps.insert(td.m);
+      if (td.ptree->root)
+        ga_extract_variables(td.ptree->root, workspace, *(td.m), vars, false);
+      for (const std::string &name : {td.name_test1, td.name_test2,
+                                      td.varname_interpolation}) {
+        if (name.empty()) continue;
+        if (workspace.variable_group_exists(name)) {
+          for (const std::string &t : workspace.variable_group(name))
+            names.insert(t);
+        } else names.insert(name);
+      }
+    }
+    for (const var_trans_pair &vt : vars) names.insert(vt.varname);
+
+    sig.addresses.push_back(K); sig.addresses.push_back(V);
+    for (const std::string &name : names) {
+      const mesh_fem *mf = workspace.associated_mf(name);
+      const im_data *imd = workspace.associated_im_data(name);
+      const model_real_plain_vector &U = workspace.value(name);
+      sig.addresses.push_back(&U);
+      sig.addresses.push_back(mf);
+      sig.addresses.push_back(imd);
+      sig.sizes.push_back(gmm::vect_size(U));
+      if (!(workspace.is_constant(name))) {
+        const gmm::sub_interval &I = workspace.interval_of_variable(name);
+        sig.sizes.push_back(I.first()); sig.sizes.push_back(I.size());
+      }
+      if (mf) deps.insert(mf);
+      else if (imd) deps.insert(imd);
+      else sig.values.insert(sig.values.end(), U.begin(), U.end());
+    }
+    if (time_step) sig.values.push_back(workspace.get_time_step());
+  }
+
+  // Update of the extension of the reduced fem variables, which are
+  // computed at compile time.
+  static void ga_update_extended_vars(const ga_workspace &workspace,
+                                      ga_instruction_set &gis) {
+    for (auto &&v : gis.really_extended_vars)
+      workspace.associated_mf(v.first)->extend_vector(workspace.value(v.first),
+                                                      v.second);
+  }
+
+  void ga_workspace::assembly(size_type order, bool with_residual) {
     size_type ndof;
+    bool with_vector = (order == 1 || (order == 2 && with_residual));
     const ga_workspace *w = this;
     while (w->parent_workspace) w = w->parent_workspace;
     if (w->md) ndof = w->md->nb_dof(); // To eventually call actualize_sizes()
 
     GA_TIC;
-    ga_instruction_set gis;
-    ga_compile(*this, gis, order);
+    // The instructions compiled by a previous assembly are reused if nothing
+    // they depend on has changed.
+    ga_compilation_signature sig;
+    std::set<const context_dependencies *> deps;
+    ga_compilation_signature_of(*this, K.get(), V.get(), w->md != 0,
+                                sig, deps);
+    sig.addresses.push_back(K_bsr);
+    std::shared_ptr<compiled_instructions> &pci
+      = compiled[(order == 2 && with_residual) ? 3 : order];
+    bool reuse = pci && pci->owner == this && pci->is_context_valid()
+      && !(pci->context_check()) && pci->signature == sig;
+    if (reuse) {
+      ga_update_extended_vars(*this, pci->gis);
+      GA_TOCTIC("Reuse of the compiled instructions");
+    } else {
+      pci = std::make_shared<compiled_instructions>(this);
+      pci->signature = sig;
+      for (const context_dependencies *cd : deps) pci->add_dependency(*cd);
+      ga_compile(*this, pci->gis, order, with_residual);
+      GA_TOCTIC("Compile time");
+    }
+    ga_instruction_set &gis = pci->gis;
     ndof = gis.nb_dof;
     size_type max_dof =  gis.max_dof;
-    GA_TOCTIC("Compile time");
 
     if (order == 2) {
-      if (K.use_count()) {
+      if (K_bsr) {
+        if (gis.bsr_pattern_built && gmm::mat_nrows(*K_bsr) == max_dof)
+          gmm::clear(*K_bsr);
+        else {
+          ga_build_bsr_pattern(*K_bsr, gis.bsr_couplings, max_dof);
+          gis.bsr_pattern_built = true;
+        }
+      } else if (K.use_count()) {
 	gmm::clear(*K);
         gmm::resize(*K, max_dof, max_dof);
       }
       gmm::clear(unreduced_K);
       gmm::resize(unreduced_K, ndof, ndof);
     }
-    if (order == 1) {
+    if (with_vector) {
       if (V.use_count()) {
         gmm::clear(*V);
         gmm::resize(*V, max_dof);
@@ -7856,10 +8803,59 @@ namespace getfem {
     E = 0;
     GA_TOCTIC("Init time");
 
-    ga_exec(gis, *this);
+    bool colored = colored_assembly && num_threads() > 1
+      && !me_is_multithreaded_now()
+      && ga_colored_exec_possible(*this, gis, order, pci->mfs);
+
+    // The pattern of the matrix terms is recorded at the first reuse of
+    // the compiled instructions, then used by the following assemblies.
+    ga_pattern_matrix &pattern = gis.pattern;
+    pattern.active = (order == 2 && reuse && fixed_pattern_assembly
+                      && !colored && !K_bsr);
+    if (pattern.active) {
+      if (pattern.mode == ga_pattern_matrix::ASSEMBLE)
+        std::fill(pattern.A.pr.begin(), pattern.A.pr.end(), scalar_type(0));
+      else {
+        pattern.mode = ga_pattern_matrix::RECORD;
+        gmm::clear(pattern.P);
+        gmm::resize(pattern.P, max_dof, max_dof);
+      }
+    }
+
+    if (colored) {
+      if (pci->gist_compiled) {
+        for (size_type t = 0; t < num_threads(); ++t)
+          ga_update_extended_vars(*this, pci->gist(t));
+      } else {
+        for (size_type t = 0; t < num_threads(); ++t)
+          ga_compile(*this, pci->gist(t), order, with_residual);
+        pci->gist_compiled = true;
+        GA_TOCTIC("Compile time for the threads");
+      }
+      for (size_type t = 0; t < num_threads(); ++t)
+        pci->gist(t).profiling = (profile != 0);
+      ga_exec_colored(pci->gist, pci->mfs, pci->colorings);
+      if (profile)
+        for (size_type t = 0; t < num_threads(); ++t)
+          ga_update_profile(*this, pci->gist(t), *profile);
+    } else {
+      gis.profiling = (profile != 0);
+      ga_exec(gis, *this);
+      if (profile) ga_update_profile(*this, gis, *profile);
+    }
     GA_TOCTIC("Exec time");
 
-    if (order == 1) {
+    if (pattern.active) {
+      if (pattern.mode == ga_pattern_matrix::RECORD) {
+        ga_build_pattern_matrix(pattern);
+        pattern.mode = ga_pattern_matrix::ASSEMBLE;
+      } else
+        ga_add_pattern_matrix(pattern.A, *K);
+      pattern.active = false;
+      GA_TOCTIC("Fixed pattern matrix time");
+    }
+
+    if (with_vector) {
       MPI_SUM_VECTOR(assembled_vector());
       MPI_SUM_VECTOR(unreduced_V);
     }
@@ -7870,7 +8866,7 @@ namespace getfem {
       std::set<std::pair<std::string, std::string> > vars_mat_done;
       for (ga_tree &tree : gis.trees) {
         if (tree.root) {
-          if (order == 1) {
+          if (tree.root->name_test2.empty()) {
             const std::string &name = tree.root->name_test1;
             const std::vector<std::string> vnames_(1,name);
             const std::vector<std::string> &vnames
@@ -7942,6 +8938,7 @@ namespace getfem {
   }
 
   void ga_workspace::clear_expressions() {
+    compiled.clear();
     trees.clear();
     macro_trees.clear();
   }
@@ -10256,6 +11253,93 @@ namespace getfem {
   }
 
 
+  //=========================================================================
+  // Matrix-free tangent operator
+  //=========================================================================
+
+  // Replacement of the second test functions of a tree by the fields of
+  // the given data, which turns an order 2 term into an order 1 one.
+  static void ga_replace_test2_by_data
+  (pga_tree_node pnode, const ga_workspace &workspace,
+   const std::map<std::string, std::string> &datanames) {
+    for (pga_tree_node child : pnode->children)
+      ga_replace_test2_by_data(child, workspace, datanames);
+
+    switch (pnode->node_type) {
+    case GA_NODE_VAL_TEST: case GA_NODE_GRAD_TEST:
+    case GA_NODE_HESS_TEST: case GA_NODE_DIVERG_TEST:
+    case GA_NODE_INTERPOLATE_VAL_TEST: case GA_NODE_INTERPOLATE_GRAD_TEST:
+    case GA_NODE_INTERPOLATE_HESS_TEST: case GA_NODE_INTERPOLATE_DIVERG_TEST:
+    case GA_NODE_ELEMENTARY_VAL_TEST: case GA_NODE_ELEMENTARY_GRAD_TEST:
+    case GA_NODE_ELEMENTARY_HESS_TEST: case GA_NODE_ELEMENTARY_DIVERG_TEST:
+    case GA_NODE_XFEM_PLUS_VAL_TEST: case GA_NODE_XFEM_PLUS_GRAD_TEST:
+    case GA_NODE_XFEM_PLUS_HESS_TEST: case GA_NODE_XFEM_PLUS_DIVERG_TEST:
+    case GA_NODE_XFEM_MINUS_VAL_TEST: case GA_NODE_XFEM_MINUS_GRAD_TEST:
+    case GA_NODE_XFEM_MINUS_HESS_TEST: case GA_NODE_XFEM_MINUS_DIVERG_TEST:
+      if (pnode->test_function_type == 2) {
+        GMM_ASSERT1(!(workspace.variable_group_exists(pnode->name)),
+                    "Variable groups are not taken into account by the "
+                    "matrix-free tangent operator");
+        // In each family, the value node types precede the test ones by 4.
+        pnode->node_type = GA_NODE_TYPE(pnode->node_type - 4);
+        pnode->name = datanames.at(pnode->name);
+      }
+      break;
+    case GA_NODE_INTERPOLATE_DERIVATIVE:
+      GMM_ASSERT1(pnode->test_function_type != 2, "Derivatives with respect "
+                  "to interpolate transformations are not taken into account "
+                  "by the matrix-free tangent operator");
+      break;
+    case GA_NODE_ZERO:
+      pnode->name_test2 = "";
+      break;
+    default: break;
+    }
+  }
+
+  ga_tangent_operator::ga_tangent_operator(ga_workspace &w)
+    : parent(w), workspace(true, w) {
+    std::map<std::string, std::string> datanames;
+    for (size_type i = 0; i < parent.nb_trees(); ++i) {
+      const ga_workspace::tree_description &td = parent.tree_info(i);
+      if (td.order == 2 && td.interpolation == 0 && td.ptree->root
+          && datanames.find(td.name_test2) == datanames.end()) {
+        const std::string &name = td.name_test2;
+        const mesh_fem *mf = parent.associated_mf(name);
+        GMM_ASSERT1(mf && !(parent.variable_group_exists(name)),
+                    "The matrix-free tangent operator is only defined for "
+                    "fem variables");
+        datanames[name] = "Tangent_operator_x_" + name;
+        X[name].resize(parent.interval_of_variable(name).size());
+      }
+    }
+    for (auto &x : X)
+      workspace.add_fem_constant(datanames[x.first],
+                                 *(parent.associated_mf(x.first)), x.second);
+
+    for (size_type i = 0; i < parent.nb_trees(); ++i) {
+      const ga_workspace::tree_description &td = parent.tree_info(i);
+      if (td.order == 2 && td.interpolation == 0 && td.ptree->root) {
+        ga_tree local_tree = *(td.ptree);
+        ga_replace_test2_by_data(local_tree.root, parent, datanames);
+        workspace.add_expression(ga_tree_to_string(local_tree), *(td.mim),
+                                 *(td.rg), 1);
+      }
+    }
+  }
+
+  void ga_tangent_operator::mult(const base_vector &x, base_vector &y) const {
+    for (auto &xv : X)
+      gmm::copy(gmm::sub_vector(x, parent.interval_of_variable(xv.first)),
+                xv.second);
+    workspace.assembly(1);
+    const base_vector &V = workspace.assembled_vector();
+    gmm::clear(y);
+    gmm::sub_interval I(0, std::min(gmm::vect_size(V), gmm::vect_size(y)));
+    gmm::copy(gmm::sub_vector(V, I), gmm::sub_vector(y, I));
+  }
+
+
   //=========================================================================
   // Extract Neumann terms
   //=========================================================================
@@ -11278,6 +12362,72 @@ namespace getfem {
     }
   }
 
+  // Place the tensor t of a node being compiled in the arena of the
+  // instruction set, in the smallest released slot large enough if any and
+  // if reuse is true. The tensor has to be placed before the instructions
+  // of the node are built. Return true if the slot had been used by
+  // another tensor.
+  static bool ga_arena_place(ga_instruction_set &gis,
+                             ga_instruction_set::region_mim_instructions &rmi,
+                             base_tensor &t, bool reuse) {
+    size_type n = t.size(), ibest = rmi.slots.size();
+    for (size_type i = 0; reuse && i < rmi.slots.size(); ++i) {
+      const auto &s = rmi.slots[i];
+      if (!(s.permanent) && s.refs == 0 && s.n >= n &&
+          (ibest == rmi.slots.size() || s.n < rmi.slots[ibest].n))
+        ibest = i;
+    }
+    bool reused = (ibest < rmi.slots.size());
+    if (!reused) {
+      ga_instruction_set::region_mim_instructions::arena_slot s;
+      s.p = gis.arena_alloc(n); s.n = n; s.permanent = false;
+      rmi.slots.push_back(s);
+    }
+    auto &s = rmi.slots[ibest];
+    s.refs = 1; s.owner = &t;
+    rmi.slot_of[&t] = ibest;
+    t.set_storage(s.p, s.n);
+    return reused;
+  }
+
+  // False if t has been placed in a slot since given to another tensor.
+  static bool ga_arena_valid
+  (const ga_instruction_set::region_mim_instructions &rmi,
+   const base_tensor &t) {
+    auto it = rmi.slot_of.find(&t);
+    return it == rmi.slot_of.end() || rmi.slots[it->second].owner == &t;
+  }
+
+  static void ga_arena_hold(ga_instruction_set::region_mim_instructions &rmi,
+                            const base_tensor &t) {
+    auto it = rmi.slot_of.find(&t);
+    if (it != rmi.slot_of.end() && rmi.slots[it->second].owner == &t)
+      ++(rmi.slots[it->second].refs);
+  }
+
+  static void ga_arena_release
+  (ga_instruction_set::region_mim_instructions &rmi, const base_tensor &t) {
+    auto it = rmi.slot_of.find(&t);
+    if (it != rmi.slot_of.end()) {
+      auto &s = rmi.slots[it->second];
+      GA_DEBUG_ASSERT(s.owner == &t && s.refs, "Internal error");
+      if (s.owner == &t && s.refs) --(s.refs);
+    }
+  }
+
+  // Put back on the heap a tensor placed in the arena for which no
+  // instruction has been built.
+  static void ga_arena_remove
+  (ga_instruction_set::region_mim_instructions &rmi, base_tensor &t) {
+    auto it = rmi.slot_of.find(&t);
+    if (it != rmi.slot_of.end()) {
+      auto &s = rmi.slots[it->second];
+      if (s.owner == &t) { s.owner = 0; s.refs = 0; }
+      rmi.slot_of.erase(it);
+      t.set_storage(0, 0);
+    }
+  }
+
   static void ga_clear_node_list
   (pga_tree_node pnode, std::map<scalar_type,
    std::list<pga_tree_node> > &node_list) {
@@ -11393,11 +12543,14 @@ namespace getfem {
       std::list<pga_tree_node> &node_list = rmi.node_list[pnode->hash_value];
       for (std::list<pga_tree_node>::iterator it = node_list.begin();
            it != node_list.end(); ++it) {
+        // The slot of an equivalent node may have been reused.
+        if (!ga_arena_valid(rmi, (*it)->tensor())) continue;
         // cout << "found potential equivalent nodes ";
         // ga_print_node(pnode, cout);
         // cout << " and "; ga_print_node(*it, cout); cout << endl;
         if (sub_tree_are_equal(pnode, *it, workspace, 1)) {
 	  pnode->t.set_to_copy((*it)->t);
+          ga_arena_hold(rmi, pnode->tensor());
           return;
         }
         if (sub_tree_are_equal(pnode, *it, workspace, 2)) {
@@ -11413,6 +12566,7 @@ namespace getfem {
 	    rmi.instructions.push_back(std::move(pgai));
           } else {
 	    pnode->t.set_to_copy((*it)->t);
+            ga_arena_hold(rmi, pnode->tensor());
           }
           return;
         }
@@ -11425,6 +12579,7 @@ namespace getfem {
       }
     }
 
+    bool resized_on_exec = pgai && !is_uniform;
     if (pgai) { // resize instruction if needed and no equivalent node detected
       if (is_uniform) { pgai->exec(); }
       else {
@@ -11461,15 +12616,38 @@ namespace getfem {
       ga_clear_node_list(pnode->children[0], rmi.node_list);
     }
 
+    // The tensor of the node is placed in the arena once the children are
+    // compiled, so that it does not share its slot with them. A tensor of
+    // vectorized base functions or computed from one may be sparse, its
+    // zeros being set once (see tensor_to_clear below). It is given a slot
+    // of its own.
+    bool in_arena = workspace.is_tensor_arena() && !resized_on_exec
+      && pnode->node_type != GA_NODE_ZERO
+      && pnode->node_type != GA_NODE_INTERPOLATE_FILTER
+      && pnode->tensor().size() > 0;
+    bool may_be_sparse = pnode->node_type == GA_NODE_VAL_TEST
+      || pnode->node_type == GA_NODE_GRAD_TEST;
+    for (size_type i = 0; i < pnode->children.size(); ++i)
+      if (pnode->children[i]->t.sparsity()) may_be_sparse = true;
+    bool arena_reused = in_arena
+      && ga_arena_place(gis, rmi, pnode->tensor(), !may_be_sparse);
+    size_type nb_inst = rmi.instructions.size();
+    size_type nb_elt_inst = rmi.elt_instructions.size();
+    size_type nb_begin_inst = rmi.begin_instructions.size();
+
     static scalar_type minus = -scalar_type(1);
     size_type nbch = pnode->children.size();
     pga_tree_node child0 = (nbch > 0) ? pnode->children[0] : 0;
     pga_tree_node child1 = (nbch > 1) ? pnode->children[1] : 0;
     bgeot::multi_index mi;
     const bgeot::multi_index &size0 = child0 ? child0->t.sizes() : mi;
-    // const bgeot::multi_index &size1 = child1 ? child1->t.sizes() : mi;
+    const bgeot::multi_index &size1 = child1 ? child1->t.sizes() : mi;
     size_type dim0 = child0 ? child0->tensor_order() : 0;
     size_type dim1 = child1 ? child1->tensor_order() : 0;
+    // Fixed size instructions for the small tensors not depending on the
+    // test functions.
+    bool unrolled = workspace.is_unrolled_instructions()
+      && pnode->test_function_type == 0;
 
     switch (pnode->node_type) {
 
@@ -11582,7 +12760,7 @@ namespace getfem {
             (pnode->tensor()[0], (workspace.value(pnode->name))[0]);
         else
           pgai = std::make_shared<ga_instruction_copy_vect>
-            (pnode->tensor().as_vector(), workspace.value(pnode->name));
+            (pnode->tensor(), workspace.value(pnode->name));
         rmi.instructions.push_back(std::move(pgai));
       } else {
         const mesh_fem *mf = workspace.associated_mf(pnode->name);
@@ -11627,6 +12805,20 @@ namespace getfem {
               rmi.instructions.push_back(std::move(pgai));
           }
 
+          // Value or gradient computed by sum factorization
+          if ((pnode->node_type == GA_NODE_VAL ||
+               pnode->node_type == GA_NODE_GRAD) &&
+              workspace.is_sum_factorization() &&
+              ga_sum_factorization_candidate(*mf)) {
+            pgai = std::make_shared<ga_instruction_val_sum_factorization>
+              (pnode->tensor(), gis.ctx, *mf, rmi.pfps[mf],
+               rmi.local_dofs[pnode->name], workspace.qdim(pnode->name),
+               gis.nbpt, gis.ipt, pnode->node_type == GA_NODE_GRAD,
+               workspace.is_batched_base_evaluation());
+            rmi.instructions.push_back(std::move(pgai));
+            break;
+          }
+
           // An instruction for the base value
           pgai = pga_instruction();
           switch (pnode->node_type) {
@@ -11660,7 +12852,8 @@ namespace getfem {
                 !(if_hierarchy.is_compatible(rmi.grad_hierarchy[mf]))) {
               rmi.grad_hierarchy[mf].push_back(if_hierarchy);
               pgai = std::make_shared<ga_instruction_grad_base>
-                (rmi.grad[mf], gis.ctx, *mf, rmi.pfps[mf]);
+                (rmi.grad[mf], gis.ctx, *mf, rmi.pfps[mf], gis.nbpt, gis.ipt,
+                 workspace.is_batched_base_evaluation());
             }
             break;
           case GA_NODE_XFEM_PLUS_GRAD: case GA_NODE_XFEM_PLUS_DIVERG:
@@ -11684,7 +12877,8 @@ namespace getfem {
                 !(if_hierarchy.is_compatible(rmi.hess_hierarchy[mf]))) {
               rmi.hess_hierarchy[mf].push_back(if_hierarchy);
               pgai = std::make_shared<ga_instruction_hess_base>
-                (rmi.hess[mf], gis.ctx, *mf, rmi.pfps[mf]);
+                (rmi.hess[mf], gis.ctx, *mf, rmi.pfps[mf], gis.nbpt, gis.ipt,
+                 workspace.is_batched_base_evaluation());
             }
             break;
           case GA_NODE_XFEM_PLUS_HESS:
@@ -11942,7 +13136,8 @@ namespace getfem {
                 !(if_hierarchy.is_compatible(rmi.grad_hierarchy[mf]))) {
               rmi.grad_hierarchy[mf].push_back(if_hierarchy);
               pgai = std::make_shared<ga_instruction_grad_base>
-                (rmi.grad[mf], gis.ctx, *mf, rmi.pfps[mf]);
+                (rmi.grad[mf], gis.ctx, *mf, rmi.pfps[mf], gis.nbpt, gis.ipt,
+                 workspace.is_batched_base_evaluation());
             }
             break;
           case GA_NODE_XFEM_PLUS_GRAD_TEST: case GA_NODE_XFEM_PLUS_DIVERG_TEST:
@@ -11967,7 +13162,8 @@ namespace getfem {
                 !(if_hierarchy.is_compatible(rmi.hess_hierarchy[mf]))) {
               rmi.hess_hierarchy[mf].push_back(if_hierarchy);
               pgai = std::make_shared<ga_instruction_hess_base>
-                (rmi.hess[mf], gis.ctx, *mf, rmi.pfps[mf]);
+                (rmi.hess[mf], gis.ctx, *mf, rmi.pfps[mf], gis.nbpt, gis.ipt,
+                 workspace.is_batched_base_evaluation());
             }
             break;
           case GA_NODE_XFEM_PLUS_HESS_TEST:
@@ -12189,8 +13385,14 @@ namespace getfem {
            pgai = std::make_shared<ga_instruction_scalar_add>
              (pnode->tensor()[0], child0->tensor()[0], child1->tensor()[0]);
          } else {
-           pgai = std::make_shared<ga_instruction_add>
-             (pnode->tensor(), child0->tensor(), child1->tensor());
+           pgai = pga_instruction();
+           if (unrolled)
+             pgai = ga_unrolled_instruction<ga_instruction_add_unrolled>
+               (pnode->tensor().size(), pnode->tensor(), child0->tensor(),
+                child1->tensor());
+           if (!pgai)
+             pgai = std::make_shared<ga_instruction_add>
+               (pnode->tensor(), child0->tensor(), child1->tensor());
          }
 	 if (child0->t.sparsity() == child1->t.sparsity()
 	     && child0->t.qdim() == child1->t.qdim())
@@ -12207,8 +13409,14 @@ namespace getfem {
            pgai = std::make_shared<ga_instruction_scalar_sub>
              (pnode->tensor()[0], child0->tensor()[0], child1->tensor()[0]);
          } else {
-           pgai = std::make_shared<ga_instruction_sub>
-             (pnode->tensor(), child0->tensor(), child1->tensor());
+           pgai = pga_instruction();
+           if (unrolled)
+             pgai = ga_unrolled_instruction<ga_instruction_sub_unrolled>
+               (pnode->tensor().size(), pnode->tensor(), child0->tensor(),
+                child1->tensor());
+           if (!pgai)
+             pgai = std::make_shared<ga_instruction_sub>
+               (pnode->tensor(), child0->tensor(), child1->tensor());
          }
 	 if (child0->t.sparsity() == child1->t.sparsity()
 	     && child0->t.qdim() == child1->t.qdim())
@@ -12249,13 +13457,27 @@ namespace getfem {
              }
              else if (child0->tensor().size() == 1) {
 	       pnode->t.set_sparsity(child1->t.sparsity(), child1->t.qdim());
-               pgai = std::make_shared<ga_instruction_scalar_mult>
-                 (pnode->tensor(), child1->tensor(), child0->tensor()[0]);
+               pgai = pga_instruction();
+               if (unrolled)
+                 pgai = ga_unrolled_instruction
+                   <ga_instruction_scalar_mult_unrolled>
+                   (pnode->tensor().size(), pnode->tensor(), child1->tensor(),
+                    child0->tensor()[0]);
+               if (!pgai)
+                 pgai = std::make_shared<ga_instruction_scalar_mult>
+                   (pnode->tensor(), child1->tensor(), child0->tensor()[0]);
 	     }
              else if (child1->tensor().size() == 1) {
 	       pnode->t.set_sparsity(child0->t.sparsity(), child0->t.qdim());
-               pgai = std::make_shared<ga_instruction_scalar_mult>
-                 (pnode->tensor(), child0->tensor(), child1->tensor()[0]);
+               pgai = pga_instruction();
+               if (unrolled)
+                 pgai = ga_unrolled_instruction
+                   <ga_instruction_scalar_mult_unrolled>
+                   (pnode->tensor().size(), pnode->tensor(), child0->tensor(),
+                    child1->tensor()[0]);
+               if (!pgai)
+                 pgai = std::make_shared<ga_instruction_scalar_mult>
+                   (pnode->tensor(), child0->tensor(), child1->tensor()[0]);
 	     }
              else if (pnode->test_function_type < 3) {
                if (child0->tensor_proper_size() == 1) {
@@ -12350,8 +13572,15 @@ namespace getfem {
                  else
                    pgai = std::make_shared<ga_instruction_simple_tmult>
                      (pnode->tensor(), child0->tensor(), child1->tensor());
-               } else {
-                 if (dim0 == 2)
+               } else if (dim0 == 2) {
+                 size_type n = size0.back();
+                 if (unrolled && size0.size() == 2
+                     && size0[0] == n && size1.size() == 2
+                     && size1[0] == n && size1[1] == n)
+                   pgai = ga_unrolled_matrix_instruction
+                     <ga_instruction_matrix_mult_unrolled>
+                     (n, pnode->tensor(), child0->tensor(), child1->tensor());
+                 if (!pgai)
                    pgai = std::make_shared<ga_instruction_matrix_mult>
                      (pnode->tensor(), child0->tensor(), child1->tensor());
                }
@@ -12420,8 +13649,15 @@ namespace getfem {
 
        case GA_QUOTE:
          if (pnode->tensor_proper_size() != 1) {
-           pgai = std::make_shared<ga_instruction_transpose>
-             (pnode->tensor(), child0->tensor());
+           pgai = pga_instruction();
+           if (unrolled && size0.size() == 2
+               && size0[0] == size0[1])
+             pgai = ga_unrolled_matrix_instruction
+               <ga_instruction_transpose_unrolled>
+               (size0[0], pnode->tensor(), child0->tensor());
+           if (!pgai)
+             pgai = std::make_shared<ga_instruction_transpose>
+               (pnode->tensor(), child0->tensor());
            rmi.instructions.push_back(std::move(pgai));
          } else {
 	   pnode->t.set_to_copy(child0->t);
@@ -12451,9 +13687,15 @@ namespace getfem {
            size_type N = (child0->tensor_proper_size() == 1) ? 1:size0.back();
 	   if (N == 1) {
 	     pnode->t.set_to_copy(child0->t);
-	   } else { 
-	     pgai = std::make_shared<ga_instruction_trace>
-	       (pnode->tensor(), child0->tensor(), N);
+	   } else {
+             pgai = pga_instruction();
+             if (unrolled && size0.size() == 2)
+               pgai = ga_unrolled_matrix_instruction
+                 <ga_instruction_trace_unrolled>
+                 (N, pnode->tensor(), child0->tensor());
+             if (!pgai)
+               pgai = std::make_shared<ga_instruction_trace>
+                 (pnode->tensor(), child0->tensor(), N);
 	     rmi.instructions.push_back(std::move(pgai));
 	   }
          }
@@ -12735,6 +13977,38 @@ namespace getfem {
 	rmi.elt_instructions.push_back(std::move(pgai));
       } 
     }
+
+    if (in_arena) {
+      base_tensor &t = pnode->t.t;
+      if (pnode->t.is_copied) { // The node uses the tensor of a child
+        ga_arena_release(rmi, t);
+        ga_arena_hold(rmi, pnode->tensor());
+      } else if (rmi.instructions.size() == nb_inst) {
+        // Tensor not evaluated on each integration point.
+        if (rmi.elt_instructions.size() == nb_elt_inst &&
+            rmi.begin_instructions.size() == nb_begin_inst)
+          ga_arena_remove(rmi, t);
+        else {
+          GMM_ASSERT1(!arena_reused, "Internal error");
+          rmi.slots[rmi.slot_of[&t]].permanent = true;
+        }
+      } else if (tensor_to_clear) {
+        // Only the non-zero components are evaluated on each integration
+        // point. The zeros are kept in the slot or restored.
+        if (arena_reused) {
+          pgai = std::make_shared<ga_instruction_clear_tensor>(t);
+          rmi.instructions.insert(rmi.instructions.begin() + nb_inst,
+                                  std::move(pgai));
+        } else
+          rmi.slots[rmi.slot_of[&t]].permanent = true;
+      } else if (pnode->nb_test_functions() < 2)
+        // May be found equivalent to a node of a tree compiled afterwards.
+        rmi.slots[rmi.slot_of[&t]].permanent = true;
+    }
+    // The tensors of the children are no longer used.
+    for (size_type i = 0; i < nbch; ++i)
+      ga_arena_release(rmi, pnode->children[i]->tensor());
+
     rmi.node_list[pnode->hash_value].push_back(pnode);
     
   }
@@ -12893,18 +14167,26 @@ namespace getfem {
     }
   }
 
+  // Compilation of the terms of the given order. With with_residual, the
+  // terms of order one are compiled together with the terms of order two,
+  // in the same instruction lists, so that the nodes common to the trees
+  // of both orders are evaluated only once.
   static void ga_compile(ga_workspace &workspace,
-                         ga_instruction_set &gis, size_type order) {
+                         ga_instruction_set &gis, size_type order,
+                         bool with_residual) {
     gis.transformations.clear();
     gis.whole_instructions.clear();
+    bool both = with_residual && order == 2;
     for (size_type version : std::array<size_type, 3>{1, 0, 2}) {
       for (size_type i = 0; i < workspace.nb_trees(); ++i) {
 	ga_workspace::tree_description &td = workspace.tree_info(i);
 	
 	if ((version == td.interpolation) &&
-	    ((version == 0 && td.order == order) || // Assembly
+	    ((version == 0 && (td.order == order ||       // Assembly
+			       (both && td.order == 1))) ||
 	     ((version > 0 && (td.order == size_type(-1) || // Assignment
-				td.order == size_type(-2) - order))))) {
+				td.order == size_type(-2) - order ||
+				(both && td.order == size_type(-3))))))) {
 	  ga_tree *added_tree = 0;
 	  if (td.interpolation) {
 	    gis.interpolation_trees.push_back(*(td.ptree));
@@ -12949,7 +14231,7 @@ namespace getfem {
 	    } else { // assembly
 	      // Addition of an assembly instruction
 	      pga_instruction pgai;
-	      switch(order) {
+	      switch(td.order) {
 	      case 0:
 		pgai = std::make_shared<ga_instruction_scalar_assembly>
 		  (root->tensor(), workspace.assembled_potential(), gis.coeff);
@@ -13012,6 +14294,10 @@ namespace getfem {
 		  
 		  add_interval_to_gis(workspace, root->name_test1, gis);
 		  add_interval_to_gis(workspace, root->name_test2, gis);
+		  // The fixed pattern assembly needs the two test functions to
+		  // be evaluated on the current element.
+		  ga_pattern_matrix *pattern
+		    = (intn1.empty() && intn2.empty()) ? &(gis.pattern) : 0;
 		  
 		  const gmm::sub_interval *Ir1 = 0, *In1 = 0, *Ir2 = 0, *In2=0;
 		  const scalar_type *alpha1 = 0, *alpha2 = 0;
@@ -13048,14 +14334,29 @@ namespace getfem {
 		    In2 = &(workspace.interval_of_variable(root->name_test2));
 		  }
 		  
-		  if (!interpolate && mfg1 == 0 && mfg2 == 0 && mf1 && mf2
-		      && mf1->get_qdim() == 1 && mf2->get_qdim() == 1
-		      && !(mf1->is_reduced()) && !(mf2->is_reduced())) {
+		  if (workspace.assembled_bsr_matrix()) {
+		    GMM_ASSERT1(intn1.empty() && intn2.empty() && mfg1 == 0
+				&& mfg2 == 0 && mf1 && mf1 == mf2
+				&& !(mf1->is_reduced()), "The assembly into "
+				"a block sparse row matrix needs all the "
+				"matrix terms to be on variables sharing the "
+				"same non reduced mesh_fem, without "
+				"interpolate transformation");
+		    gis.bsr_couplings.insert
+		      (ga_bsr_coupling(mf1, In1->first(), In2->first()));
+		    pgai = std::make_shared<ga_instruction_matrix_assembly_bsr>
+		      (root->tensor(), *(workspace.assembled_bsr_matrix()),
+		       ctx1, *In1, *In2, mf1,
+		       gis.coeff, *alpha1, *alpha2, gis.nbpt, gis.ipt);
+		  } else if (!interpolate && mfg1 == 0 && mfg2 == 0 && mf1
+			     && mf2 && mf1->get_qdim() == 1
+			     && mf2->get_qdim() == 1
+			     && !(mf1->is_reduced()) && !(mf2->is_reduced())) {
 		    pgai = std::make_shared
 		      <ga_instruction_matrix_assembly_standard_scalar<>>
 		      (root->tensor(), workspace.assembled_matrix(), ctx1, ctx2,
 		       *In1, *In2, mf1, mf2,
-		       gis.coeff, *alpha1, *alpha2, gis.nbpt, gis.ipt);
+		       gis.coeff, *alpha1, *alpha2, gis.nbpt, gis.ipt, pattern);
 		  } else if (!interpolate && mfg1 == 0 && mfg2==0 && mf1 && mf2
 			     && !(mf1->is_reduced()) && !(mf2->is_reduced())) {
 		    if (root->sparsity() == 10 && root->t.qdim()==2)
@@ -13063,19 +14364,22 @@ namespace getfem {
 			<ga_instruction_matrix_assembly_standard_vector_opt10_2>
 			(root->tensor(), workspace.assembled_matrix(),ctx1,ctx2,
 			 *In1, *In2, mf1, mf2,
-			 gis.coeff, *alpha1, *alpha2, gis.nbpt, gis.ipt);
+			 gis.coeff, *alpha1, *alpha2, gis.nbpt, gis.ipt,
+			 pattern);
 		    else if (root->sparsity() == 10 && root->t.qdim()==3)
 		      pgai = std::make_shared
 			<ga_instruction_matrix_assembly_standard_vector_opt10_3>
 			(root->tensor(), workspace.assembled_matrix(),ctx1,ctx2,
 			 *In1, *In2, mf1, mf2,
-			 gis.coeff, *alpha1, *alpha2, gis.nbpt, gis.ipt);
+			 gis.coeff, *alpha1, *alpha2, gis.nbpt, gis.ipt,
+			 pattern);
 		    else
 		      pgai = std::make_shared
 			<ga_instruction_matrix_assembly_standard_vector<>>
 			(root->tensor(), workspace.assembled_matrix(),ctx1,ctx2,
 			 *In1, *In2, mf1, mf2,
-			 gis.coeff, *alpha1, *alpha2, gis.nbpt, gis.ipt);
+			 gis.coeff, *alpha1, *alpha2, gis.nbpt, gis.ipt,
+			 pattern);
 		    
 		  } else {
 		    pgai = std::make_shared<ga_instruction_matrix_assembly<>>
@@ -13092,6 +14396,10 @@ namespace getfem {
 		gis.whole_instructions[rm].instructions.push_back
 		  (std::move(pgai));
 	    }
+	    // Tree which produced the new instructions, for the profiling.
+	    rmi.begin_trees.resize(rmi.begin_instructions.size(), i);
+	    rmi.elt_trees.resize(rmi.elt_instructions.size(), i);
+	    rmi.trees_of_instructions.resize(rmi.instructions.size(), i);
 	  }
 	}
       }
@@ -13230,22 +14538,181 @@ namespace getfem {
     }
   }
 
-  static void ga_exec(ga_instruction_set &gis, ga_workspace &workspace) {
+  // Sequence of elements (or faces of elements) given by an explicit list,
+  // with the same interface as mr_visitor for the element loop of ga_exec.
+  struct ga_element_list_visitor {
+    std::vector<convex_face>::const_iterator it, ite;
+    size_type cv() const { return it->cv; }
+    short_type f() const { return it->f; }
+    bool finished() const { return it == ite; }
+    void operator++() { ++it; }
+    ga_element_list_visitor(std::vector<convex_face>::const_iterator it_,
+                            std::vector<convex_face>::const_iterator ite_)
+      : it(it_), ite(ite_) {}
+  };
+
+  typedef std::chrono::steady_clock ga_clock;
+
+  static scalar_type ga_elapsed(ga_clock::time_point t0) {
+    return std::chrono::duration<scalar_type>(ga_clock::now() - t0).count();
+  }
+
+  // Execution of a list of instructions accumulating the execution time and
+  // the number of executions of each instruction. The clock is read once
+  // between two instructions. The cost of a reading is included in the
+  // time of each execution and subtracted when the profile is updated.
+  static void ga_exec_profiled(const ga_instruction_list &gil,
+                               std::vector<ga_assembly_profile::entry> &st) {
+    ga_clock::time_point t0 = ga_clock::now(), t1;
+    for (size_type j = 0; j < gil.size(); ++j) {
+      int k = gil[j]->exec();
+      t1 = ga_clock::now();
+      st[j].time += std::chrono::duration<scalar_type>(t1 - t0).count();
+      ++(st[j].count);
+      t0 = t1; j += k;
+    }
+  }
+
+  // Cost of a reading of ga_clock, measured once as the minimum mean time
+  // over several series of consecutive readings.
+  static scalar_type ga_clock_overhead() {
+    static const scalar_type overhead = [] {
+      const size_type nb = 1000;
+      scalar_type tmin(0);
+      for (size_type s = 0; s < 10; ++s) {
+        ga_clock::time_point t0 = ga_clock::now(), t1 = t0;
+        for (size_type i = 0; i < nb; ++i) t1 = ga_clock::now();
+        scalar_type dt = std::chrono::duration<scalar_type>(t1 - t0).count()
+          / scalar_type(nb);
+        if (s == 0 || dt < tmin) tmin = dt;
+      }
+      return tmin;
+    }();
+    return overhead;
+  }
+
+  // Execution of the instructions of a region_mim on a sequence of
+  // elements (or faces of elements).
+  template <class VISITOR>
+  static void ga_exec_elements
+  (ga_instruction_set &gis, const mesh_im &mim, const mesh &m,
+   ga_instruction_set::region_mim_instructions &rmi, VISITOR &v) {
     base_matrix G;
     base_small_vector un;
     scalar_type J(0);
+    const ga_instruction_list &gilb = rmi.begin_instructions;
+    const ga_instruction_list &gile = rmi.elt_instructions;
+    const ga_instruction_list &gil = rmi.instructions;
+    bool profiling = gis.profiling;
+    if (profiling) {
+      rmi.begin_stats.resize(gilb.size());
+      rmi.elt_stats.resize(gile.size());
+      rmi.stats.resize(gil.size());
+    }
+
+    // iteration on elements (or faces of elements)
+    size_type old_cv = size_type(-1);
+    bgeot::pgeometric_trans pgt = 0, pgt_old = 0;
+    pintegration_method pim = 0;
+    papprox_integration pai = 0;
+    bgeot::pstored_point_tab pspt = 0, old_pspt = 0;
+    bgeot::pgeotrans_precomp pgp = 0;
+    bool first_gp = true;
+    for (; !v.finished(); ++v) {
+      if (mim.convex_index().is_in(v.cv())) {
+        // cout << "proceed with elt " << v.cv() << " face " << v.f() << endl;
+        if (v.cv() != old_cv) {
+          pgt = m.trans_of_convex(v.cv());
+          pim = mim.int_method_of_element(v.cv());
+          m.points_of_convex(v.cv(), G);
 
+          if (pim->type() == IM_NONE) continue;
+          GMM_ASSERT1(pim->type() == IM_APPROX, "Sorry, exact methods cannot "
+                      "be used in high level generic assembly");
+          pai = pim->approx_method();
+          pspt = pai->pintegration_points();
+          if (pspt->size()) {
+            if (pgp && gis.pai == pai && pgt_old == pgt) {
+              gis.ctx.change(pgp, 0, 0, G, v.cv(), v.f());
+            } else {
+              if (pai->is_built_on_the_fly()) {
+                gis.ctx.change(pgt, 0, (*pspt)[0], G, v.cv(), v.f());
+                pgp = 0;
+              } else {
+                pgp = gis.gp_pool(pgt, pspt);
+                gis.ctx.change(pgp, 0, 0, G, v.cv(), v.f());
+              }
+              pgt_old = pgt; gis.pai = pai;
+            }
+            if (gis.need_elt_size)
+              gis.elt_size = convex_radius_estimate(pgt, G)*scalar_type(2);
+          }
+          old_cv = v.cv();
+        } else {
+          if (pim->type() == IM_NONE) continue;
+          gis.ctx.set_face_num(v.f());
+        }
+        if (pspt != old_pspt) { first_gp = true; old_pspt = pspt; }
+        if (pspt->size()) {
+          // iterations on Gauss points
+          gis.nbpt = pai->nb_points_on_convex();
+          size_type first_ind = 0;
+          if (v.f() != short_type(-1)) {
+            gis.nbpt = pai->nb_points_on_face(v.f());
+            first_ind = pai->ind_first_point_on_face(v.f());
+          }
+          for (gis.ipt = 0; gis.ipt < gis.nbpt; ++(gis.ipt)) {
+            if (pgp) gis.ctx.set_ii(first_ind+gis.ipt);
+            else gis.ctx.set_xref((*pspt)[first_ind+gis.ipt]);
+            if (gis.ipt == 0 || !(pgt->is_linear())) {
+              J = gis.ctx.J();
+              // Computation of unit normal vector in case of a boundary
+              if (v.f() != short_type(-1)) {
+                gis.Normal.resize(G.nrows());
+                un.resize(pgt->dim());
+                gmm::copy(pgt->normals()[v.f()], un);
+                gmm::mult(gis.ctx.B(), un, gis.Normal);
+                scalar_type nup = gmm::vect_norm2(gis.Normal);
+                J *= nup;
+                gmm::scale(gis.Normal, 1.0/nup);
+                gmm::clean(gis.Normal, 1e-13);
+              } else gis.Normal.resize(0);
+            }
+            gis.coeff = J * pai->coeff(first_ind+gis.ipt);
+            if (profiling) {
+              if (first_gp)
+                { ga_exec_profiled(gilb, rmi.begin_stats); first_gp = false; }
+              if (gis.ipt == 0) ga_exec_profiled(gile, rmi.elt_stats);
+              ga_exec_profiled(gil, rmi.stats);
+              continue;
+            }
+            if (first_gp) {
+              for (size_type j = 0; j < gilb.size(); ++j) j+=gilb[j]->exec();
+              first_gp = false;
+            }
+            if (gis.ipt == 0) {
+              for (size_type j = 0; j < gile.size(); ++j) j+=gile[j]->exec();
+            }
+            for (size_type j = 0; j < gil.size(); ++j) j+=gil[j]->exec();
+            GA_DEBUG_INFO("");
+          }
+        }
+      }
+    }
+  }
+
+  static void ga_exec(ga_instruction_set &gis, ga_workspace &workspace) {
     for (const std::string &t : gis.transformations)
       workspace.interpolate_transformation(t)->init(workspace);
 
-    for (const auto &instr : gis.whole_instructions) {
+    for (auto &instr : gis.whole_instructions) {
       const getfem::mesh_im &mim = *(instr.first.mim());
       const getfem::mesh &m = *(instr.second.m);
       GMM_ASSERT1(&m == &(mim.linked_mesh()), "Incompatibility of meshes");
+#if 0
       const ga_instruction_list &gilb = instr.second.begin_instructions;
       const ga_instruction_list &gile = instr.second.elt_instructions;
       const ga_instruction_list &gil = instr.second.instructions;
-#if 0
       if (gilb.size()) cout << "Begin instructions\n";
       for (size_type j = 0; j < gilb.size(); ++j)
 	cout << typeid(*(gilb[j])).name() << endl;
@@ -13257,88 +14724,12 @@ namespace getfem {
 	cout << typeid(*(gil[j])).name() << endl;
 #endif
       const mesh_region &region = *(instr.first.region());
-
-      // iteration on elements (or faces of elements)
-      size_type old_cv = size_type(-1);
-      bgeot::pgeometric_trans pgt = 0, pgt_old = 0;
-      pintegration_method pim = 0;
-      papprox_integration pai = 0;
-      bgeot::pstored_point_tab pspt = 0, old_pspt = 0;
-      bgeot::pgeotrans_precomp pgp = 0;
-      bool first_gp = true;
-      for (getfem::mr_visitor v(region, m, true); !v.finished(); ++v) {
-	if (mim.convex_index().is_in(v.cv())) {
-          // cout << "proceed with elt " << v.cv() << " face " << v.f() << endl;
-          if (v.cv() != old_cv) {
-            pgt = m.trans_of_convex(v.cv());
-	    pim = mim.int_method_of_element(v.cv());
-	    m.points_of_convex(v.cv(), G);
-
-            if (pim->type() == IM_NONE) continue;
-            GMM_ASSERT1(pim->type() == IM_APPROX, "Sorry, exact methods cannot "
-                        "be used in high level generic assembly");
-            pai = pim->approx_method();
-            pspt = pai->pintegration_points();
-            if (pspt->size()) {
-              if (pgp && gis.pai == pai && pgt_old == pgt) {
-		gis.ctx.change(pgp, 0, 0, G, v.cv(), v.f());
-              } else {
-                if (pai->is_built_on_the_fly()) {
-                  gis.ctx.change(pgt, 0, (*pspt)[0], G, v.cv(), v.f());
-		  pgp = 0;
-                } else {
-		  pgp = gis.gp_pool(pgt, pspt);
-                  gis.ctx.change(pgp, 0, 0, G, v.cv(), v.f());
-                }
-		pgt_old = pgt; gis.pai = pai;
-              }
-              if (gis.need_elt_size) 
-                gis.elt_size = convex_radius_estimate(pgt, G)*scalar_type(2);
-            }
-            old_cv = v.cv();
-          } else {
-            if (pim->type() == IM_NONE) continue;
-            gis.ctx.set_face_num(v.f());
-          }
-          if (pspt != old_pspt) { first_gp = true; old_pspt = pspt; }
-          if (pspt->size()) {
-            // iterations on Gauss points
-            gis.nbpt = pai->nb_points_on_convex();
-            size_type first_ind = 0;
-            if (v.f() != short_type(-1)) {
-              gis.nbpt = pai->nb_points_on_face(v.f());
-              first_ind = pai->ind_first_point_on_face(v.f());
-            }
-            for (gis.ipt = 0; gis.ipt < gis.nbpt; ++(gis.ipt)) {
-	      if (pgp) gis.ctx.set_ii(first_ind+gis.ipt);
-              else gis.ctx.set_xref((*pspt)[first_ind+gis.ipt]);
-              if (gis.ipt == 0 || !(pgt->is_linear())) {
-                J = gis.ctx.J();
-                // Computation of unit normal vector in case of a boundary
-                if (v.f() != short_type(-1)) {
-		  gis.Normal.resize(G.nrows());
-		  un.resize(pgt->dim());
-		  gmm::copy(pgt->normals()[v.f()], un);
-                  gmm::mult(gis.ctx.B(), un, gis.Normal);
-                  scalar_type nup = gmm::vect_norm2(gis.Normal);
-                  J *= nup;
-                  gmm::scale(gis.Normal, 1.0/nup);
-                  gmm::clean(gis.Normal, 1e-13);
-                } else gis.Normal.resize(0);
-              }
-              gis.coeff = J * pai->coeff(first_ind+gis.ipt);
-              if (first_gp) {
-                for (size_type j = 0; j < gilb.size(); ++j) j+=gilb[j]->exec();
-                first_gp = false;
-              }
-	      if (gis.ipt == 0) {
-		for (size_type j = 0; j < gile.size(); ++j) j+=gile[j]->exec();
-	      }
-              for (size_type j = 0; j < gil.size(); ++j) j+=gil[j]->exec();
-              GA_DEBUG_INFO("");
-            }
-          }
-        }
+      getfem::mr_visitor v(region, m, true);
+      ga_clock::time_point t0 = ga_clock::now();
+      ga_exec_elements(gis, mim, m, instr.second, v);
+      if (gis.profiling) {
+        instr.second.exec_stats.time += ga_elapsed(t0);
+        ++(instr.second.exec_stats.count);
       }
       GA_DEBUG_INFO("-----------------------------");
     }
@@ -13346,6 +14737,272 @@ namespace getfem {
       workspace.interpolate_transformation(t)->finalize();
   }
 
+  //=========================================================================
+  // Multithreaded execution with a coloring of the elements
+  //=========================================================================
+
+  // Partition of the elements of a region into colors such that two
+  // elements of the same color do not share any basic dof of the involved
+  // finite element methods. The elements of a color can then be assembled
+  // concurrently into the same global matrix or vector.
+  struct ga_element_coloring {
+    std::vector<convex_face> elts; // Elements (or faces) sorted by color
+    std::vector<size_type> groups; // First face of each element in elts
+    std::vector<size_type> colors; // First element of each color in groups
+
+    size_type nb_colors() const { return colors.size() - 1; }
+
+    ga_element_coloring(const mesh_region &region, const mesh &m,
+                        const std::vector<const mesh_fem *> &mfs) {
+      std::vector<convex_face> faces;
+      std::vector<size_type> fgroups;
+      for (getfem::mr_visitor v(region, m, true); !v.finished(); ++v) {
+        if (faces.empty() || faces.back().cv != v.cv())
+          fgroups.push_back(faces.size());
+        faces.push_back(convex_face(v.cv(), v.f()));
+      }
+      fgroups.push_back(faces.size());
+      size_type nbg = fgroups.size() - 1;
+
+      std::vector<size_type> offsets(mfs.size()+1, 0);
+      for (size_type i = 0; i < mfs.size(); ++i)
+        offsets[i+1] = offsets[i] + mfs[i]->nb_basic_dof();
+      std::vector<size_type> stamp(offsets.back(), size_type(-1));
+
+      // Greedy coloring: each sweep on the remaining elements builds a
+      // color with the elements not conflicting with the ones already taken.
+      std::vector<size_type> order, remaining(nbg), postponed;
+      for (size_type i = 0; i < nbg; ++i) remaining[i] = i;
+      colors.push_back(0);
+      for (size_type c = 0; !remaining.empty(); ++c) {
+        postponed.resize(0);
+        for (size_type ig : remaining) {
+          size_type cv = faces[fgroups[ig]].cv;
+          bool conflict = false;
+          for (size_type i = 0; i < mfs.size() && !conflict; ++i)
+            if (mfs[i]->convex_index().is_in(cv))
+              for (size_type dof : mfs[i]->ind_basic_dof_of_element(cv))
+                if (stamp[offsets[i]+dof] == c) { conflict = true; break; }
+          if (conflict) { postponed.push_back(ig); continue; }
+          for (size_type i = 0; i < mfs.size(); ++i)
+            if (mfs[i]->convex_index().is_in(cv))
+              for (size_type dof : mfs[i]->ind_basic_dof_of_element(cv))
+                stamp[offsets[i]+dof] = c;
+          order.push_back(ig);
+        }
+        colors.push_back(order.size());
+        std::swap(remaining, postponed);
+      }
+
+      for (size_type ig : order) {
+        groups.push_back(elts.size());
+        for (size_type j = fgroups[ig]; j < fgroups[ig+1]; ++j)
+          elts.push_back(faces[j]);
+      }
+      groups.push_back(elts.size());
+    }
+  };
+
+  // Tests if the compiled instructions only scatter into the dofs of the
+  // current element, which is required by the colored execution, and
+  // collects the involved finite element methods.
+  static bool ga_colored_exec_possible(const ga_workspace &workspace,
+                                       const ga_instruction_set &gis,
+                                       size_type order,
+                                       std::vector<const mesh_fem *> &mfs) {
+    if ((order != 1 && order != 2) || gis.transformations.size()
+        || gis.interpolation_trees.size()) return false;
+    std::set<const mesh_fem *> mfset;
+    for (const ga_tree &tree : gis.trees) {
+      if (!(tree.root)) continue;
+      if (tree.root->interpolate_name_test1.size() ||
+          tree.root->interpolate_name_test2.size()) return false;
+      size_type tree_order = tree.root->name_test2.empty() ? 1 : 2;
+      for (size_type i = 0; i < tree_order; ++i) {
+        const std::string &name
+          = (i == 0) ? tree.root->name_test1 : tree.root->name_test2;
+        if (workspace.variable_group_exists(name)) return false;
+        const mesh_fem *mf = workspace.associated_mf(name);
+        if (!mf) return false;
+        mfset.insert(mf);
+      }
+    }
+    mfs.assign(mfset.begin(), mfset.end());
+    return true;
+  }
+
+  // Execution of the assembly on several threads, each thread having its
+  // own compiled instruction set and all threads adding their element
+  // contributions to the same global matrix or vector.
+  static void ga_exec_colored(instruction_set &gist,
+                              const std::vector<const mesh_fem *> &mfs,
+                              ga_coloring_map &colorings) {
+    for (auto &instr : gist(0).whole_instructions) {
+      const getfem::mesh_im &mim = *(instr.first.mim());
+      const getfem::mesh &m = *(instr.second.m);
+      GMM_ASSERT1(&m == &(mim.linked_mesh()), "Incompatibility of meshes");
+      ga_clock::time_point t0 = ga_clock::now();
+      std::shared_ptr<ga_element_coloring> &pcoloring = colorings[instr.first];
+      if (!pcoloring)
+        pcoloring = std::make_shared<ga_element_coloring>
+          (*(instr.first.region()), m, mfs);
+      const ga_element_coloring &coloring = *pcoloring;
+
+      for (size_type c = 0; c < coloring.nb_colors(); ++c) {
+        gmm::standard_locale locale;
+        open_mp_is_running_properly check;
+        thread_exception exception;
+        #pragma omp parallel default(shared)
+        {
+          exception.run([&]
+          {
+            size_type t = this_thread(), nt = num_threads();
+            size_type g0 = coloring.colors[c], g1 = coloring.colors[c+1];
+            size_type gb = g0 + ((g1 - g0) * t) / nt;
+            size_type ge = g0 + ((g1 - g0) * (t+1)) / nt;
+            ga_instruction_set &gis = gist(t);
+            ga_element_list_visitor
+              v(coloring.elts.begin() + coloring.groups[gb],
+                coloring.elts.begin() + coloring.groups[ge]);
+            ga_exec_elements(gis, mim, m,
+                             gis.whole_instructions.at(instr.first), v);
+          });
+        }
+        exception.rethrow();
+      }
+      if (gist(0).profiling) {
+        instr.second.exec_stats.time += ga_elapsed(t0);
+        ++(instr.second.exec_stats.count);
+      }
+    }
+  }
+
+  //=========================================================================
+  // Profiling of the assembly
+  //=========================================================================
+
+  static std::string ga_instruction_name(const ga_instruction &instr) {
+    std::string name = typeid(instr).name();
+#ifdef __GNUG__
+    int status = 0;
+    char *dname = abi::__cxa_demangle(name.c_str(), 0, 0, &status);
+    if (dname) {
+      if (status == 0) name = dname;
+      free(dname);
+    }
+#endif
+    if (name.compare(0, 8, "getfem::") == 0) name = name.substr(8);
+    return name;
+  }
+
+  static void ga_add_profile_entry(ga_assembly_profile::entry &e,
+                                   scalar_type time, size_type count)
+  { e.time += time; e.count += count; }
+
+  // Transfer of the execution statistics of the instructions of an
+  // instruction set into a profile. The statistics are reset. The cost of
+  // the readings of the clock is subtracted from the times.
+  static void ga_update_profile(ga_workspace &workspace,
+                                ga_instruction_set &gis,
+                                ga_assembly_profile &profile) {
+    std::map<size_type, std::string> labels;
+    scalar_type overhead = ga_clock_overhead();
+    profile.clock_overhead = overhead;
+    for (auto &instr : gis.whole_instructions) {
+      ga_instruction_set::region_mim_instructions &rmi = instr.second;
+      const ga_instruction_list *gils[3]
+        = { &(rmi.begin_instructions), &(rmi.elt_instructions),
+            &(rmi.instructions) };
+      std::vector<ga_assembly_profile::entry> *stats[3]
+        = { &(rmi.begin_stats), &(rmi.elt_stats), &(rmi.stats) };
+      const std::vector<size_type> *trees[3]
+        = { &(rmi.begin_trees), &(rmi.elt_trees),
+            &(rmi.trees_of_instructions) };
+      if (rmi.exec_stats.count) {
+        size_type nb_readings = 0;
+        for (size_type l = 0; l < 3; ++l)
+          for (const ga_assembly_profile::entry &e : *(stats[l]))
+            nb_readings += e.count;
+        std::stringstream ss;
+        ss << "mim " << instr.first.mim() << " region "
+           << instr.first.region()->id();
+        ga_add_profile_entry(profile.regions[ss.str()],
+                             std::max(scalar_type(0), rmi.exec_stats.time
+                                      - scalar_type(nb_readings) * overhead),
+                             rmi.exec_stats.count);
+        rmi.exec_stats = ga_assembly_profile::entry();
+      }
+      for (size_type l = 0; l < 3; ++l)
+        for (size_type j = 0; j < stats[l]->size(); ++j) {
+          ga_assembly_profile::entry &e = (*stats[l])[j];
+          if (!(e.count)) continue;
+          e.time = std::max(scalar_type(0),
+                            e.time - scalar_type(e.count) * overhead);
+          ga_add_profile_entry
+            (profile.instructions[ga_instruction_name(*((*gils[l])[j]))],
+             e.time, e.count);
+          size_type i = (j < trees[l]->size()) ? (*trees[l])[j]
+                                               : size_type(-1);
+          std::string &label = labels[i];
+          if (label.empty()) {
+            if (i < workspace.nb_trees()) {
+              const ga_workspace::tree_description &td
+                = workspace.tree_info(i);
+              std::stringstream ss;
+              ss << "order " << int(td.order) << " : "
+                 << ga_tree_to_string(*(td.ptree));
+              label = ss.str();
+            } else label = "unknown";
+          }
+          ga_add_profile_entry(profile.expressions[label], e.time, e.count);
+          e = ga_assembly_profile::entry();
+        }
+    }
+  }
+
+  void ga_assembly_profile::clear() {
+    instructions.clear(); expressions.clear();
+    regions.clear(); bricks.clear(); clock_overhead = scalar_type(0);
+  }
+
+  void ga_assembly_profile::add(const ga_assembly_profile &p) {
+    std::map<std::string, entry> *tabs[4]
+      = { &bricks, &regions, &expressions, &instructions };
+    const std::map<std::string, entry> *ptabs[4]
+      = { &(p.bricks), &(p.regions), &(p.expressions), &(p.instructions) };
+    for (size_type l = 0; l < 4; ++l)
+      for (const auto &e : *(ptabs[l]))
+        ga_add_profile_entry((*(tabs[l]))[e.first], e.second.time,
+                             e.second.count);
+    clock_overhead = std::max(clock_overhead, p.clock_overhead);
+  }
+
+  void ga_assembly_profile::print(std::ostream &ost) const {
+    const std::map<std::string, entry> *tabs[4]
+      = { &bricks, &regions, &expressions, &instructions };
+    const char *titles[4]
+      = { "Bricks", "Integration methods and regions", "Expressions",
+          "Instructions" };
+    for (size_type l = 0; l < 4; ++l) {
+      if (tabs[l]->empty()) continue;
+      std::vector<std::pair<scalar_type, const std::string *>> order;
+      for (const auto &e : *(tabs[l]))
+        order.push_back(std::make_pair(-(e.second.time), &(e.first)));
+      std::sort(order.begin(), order.end());
+      ost << titles[l] << " :" << endl;
+      ost << std::setw(12) << "time (s)" << std::setw(12) << "count"
+          << "  name" << endl;
+      for (const auto &o : order) {
+        const entry &e = tabs[l]->at(*(o.second));
+        ost << std::setw(12) << e.time << std::setw(12) << e.count << "  "
+            << *(o.second) << endl;
+      }
+    }
+    if (clock_overhead > scalar_type(0))
+      ost << "Cost of a reading of the clock, subtracted from the time of "
+          << "each instruction : " << clock_overhead << " s" << endl;
+  }
+
   //=========================================================================
   // User defined functions
   //=========================================================================
@@ -127,6 +127,7 @@ namespace getfem {
     modified = true;
 #endif
     cuthill_mckee_uptodate = false;
+    frozen_uptodate = false;
   }
 
   mesh::mesh(const std::string name) : name_(name)  { init(); }
@@ -217,12 +218,52 @@ namespace getfem {
   }
 #endif
 
+  /* Permute the objects numbered from 0 to ord.size()-1 with a sequence
+     of swaps such that the object i becomes the object ord[i] of the
+     original numbering. */
+  template <typename SWAP>
+  static void apply_ordering(const std::vector<size_type> &ord, SWAP swap) {
+    size_type n = ord.size();
+    std::vector<size_type> iord(n), iordinv(n);
+    for (size_type i = 0; i < n; ++i) iord[i] = iordinv[i] = i;
+    for (size_type i = 0; i < n; ++i) {
+      size_type j = iordinv[ord[i]];
+      if (i != j) {
+        swap(i, j);
+        std::swap(iord[i], iord[j]);
+        std::swap(iordinv[iord[i]], iordinv[iord[j]]);
+      }
+    }
+  }
+
+  void mesh::permute_convexes(const std::vector<size_type> &ord) {
+    std::vector<size_type> new_num(ord.size());
+    for (size_type i = 0; i < ord.size(); ++i) new_num[ord[i]] = i;
+    apply_ordering(ord, [this](size_type i, size_type j)
+                   { swap_convex_except_regions(i, j); });
+    for (dal::bv_visitor i(valid_cvf_sets); !i.finished(); ++i)
+      cvf_sets[i].renumber_convexes(new_num);
+    touch();
+  }
+
   void mesh::optimize_structure(bool with_renumbering) {
     pts.resort();
-    size_type i, j = nb_convex(), nbc = j;
-    for (i = 0; i < j; i++)
-      if (!convex_tab.index_valid(i))
-        swap_convex(i, convex_tab.ind_last());
+    size_type i, j = nb_convex();
+    if (j && convex_tab.ind_last() >= j) {
+      // Fill the holes with the last convexes and renumber the regions
+      // once at the end.
+      std::vector<size_type> new_num(convex_tab.ind_last()+1);
+      for (i = 0; i < new_num.size(); ++i) new_num[i] = i;
+      for (i = 0; i < j; i++)
+        if (!convex_tab.index_valid(i)) {
+          size_type k = convex_tab.ind_last();
+          swap_convex_except_regions(i, k);
+          new_num[i] = k; new_num[k] = i;
+        }
+      for (dal::bv_visitor ir(valid_cvf_sets); !ir.finished(); ++ir)
+        cvf_sets[ir].renumber_convexes(new_num);
+      touch();
+    }
     if (pts.size())
       for (i = 0, j = pts.size()-1;
            i < j && j != ST_NIL; ++i, --j) {
@@ -231,19 +272,97 @@ namespace getfem {
         if (i < j && j != ST_NIL ) swap_points(i, j);
       }
     if (with_renumbering) { // Could be optimized no using only swap_convex
-      std::vector<size_type> cmk, iord(nbc), iordinv(nbc);
-      for (i = 0; i < nbc; ++i) iord[i] = iordinv[i] = i;
-      
+      std::vector<size_type> cmk;
       bgeot::cuthill_mckee_on_convexes(*this, cmk);
-      for (i = 0; i < nbc; ++i) {
-	j = iordinv[cmk[i]];
-	if (i != j) {
-	  swap_convex(i, j);
-	  std::swap(iord[i], iord[j]);
-	  std::swap(iordinv[iord[i]], iordinv[iord[j]]);
-	}
+      permute_convexes(cmk);
+    }
+  }
+
+  /* Position along a Hilbert curve (or a Morton curve if hilbert is false)
+     of the point of integer coordinates X[0..n-1] of b bits each (n*b has
+     to be less than 64). Hilbert curve computed with the transposition
+     algorithm of J. Skilling, "Programming the Hilbert curve", 2004. */
+  static gmm::uint64_type space_filling_curve_key
+  (std::vector<gmm::uint64_type> &X, unsigned b, bool hilbert) {
+    size_type n = X.size();
+    if (hilbert) {
+      gmm::uint64_type M = gmm::uint64_type(1) << (b-1), P, Q, t;
+      for (Q = M; Q > 1; Q >>= 1) { // Inverse undo
+        P = Q - 1;
+        for (size_type i = 0; i < n; ++i)
+          if (X[i] & Q) X[0] ^= P;
+          else { t = (X[0] ^ X[i]) & P; X[0] ^= t; X[i] ^= t; }
+      }
+      for (size_type i = 1; i < n; ++i) X[i] ^= X[i-1]; // Gray encode
+      t = 0;
+      for (Q = M; Q > 1; Q >>= 1) if (X[n-1] & Q) t ^= Q - 1;
+      for (size_type i = 0; i < n; ++i) X[i] ^= t;
+    }
+    gmm::uint64_type key = 0;
+    for (unsigned k = b; k-- > 0; )
+      for (size_type i = 0; i < n; ++i) key = (key << 1) | ((X[i] >> k) & 1);
+    return key;
+  }
+
+  void mesh::reorder(mesh_ordering ord) {
+    optimize_structure(false);
+    size_type nbc = nb_convex(), N = dim();
+    if (nbc == 0) return;
+    std::vector<size_type> cvord;
+
+    if (ord == MESH_ORDERING_RCM) {
+      bgeot::cuthill_mckee_on_convexes(*this, cvord);
+      std::reverse(cvord.begin(), cvord.end());
+    } else {
+      base_node Pmin, Pmax, G(N);
+      bounding_box(Pmin, Pmax);
+      unsigned b = unsigned(std::min(size_type(32), 63 / N));
+      scalar_type nb_cells = scalar_type((gmm::uint64_type(1) << b) - 1);
+      std::vector<gmm::uint64_type> X(N);
+      std::vector<std::pair<gmm::uint64_type, size_type>> keys(nbc);
+      for (size_type ic = 0; ic < nbc; ++ic) {
+        gmm::clear(G);
+        for (size_type ip : ind_points_of_convex(ic)) gmm::add(pts[ip], G);
+        gmm::scale(G, scalar_type(1) / scalar_type(nb_points_of_convex(ic)));
+        for (size_type k = 0; k < N; ++k) {
+          scalar_type l = Pmax[k] - Pmin[k];
+          X[k] = (l > 0) ? gmm::uint64_type((G[k] - Pmin[k]) / l * nb_cells)
+                         : 0;
+        }
+        keys[ic].first = space_filling_curve_key(X, b,
+                                                 ord == MESH_ORDERING_HILBERT);
+        keys[ic].second = ic;
       }
+      std::stable_sort(keys.begin(), keys.end());
+      cvord.resize(nbc);
+      for (size_type i = 0; i < nbc; ++i) cvord[i] = keys[i].second;
     }
+    permute_convexes(cvord);
+
+    // Points numbered in the order of their first appearance in the convexes
+    std::vector<size_type> ptord; ptord.reserve(nb_points());
+    dal::bit_vector seen;
+    for (size_type ic = 0; ic < nbc; ++ic)
+      for (size_type ip : ind_points_of_convex(ic))
+        if (!seen.is_in(ip)) { seen.add(ip); ptord.push_back(ip); }
+    for (dal::bv_visitor ip(pts.index()); !ip.finished(); ++ip)
+      if (!seen.is_in(ip)) ptord.push_back(ip);
+    apply_ordering(ptord, [this](size_type i1, size_type i2)
+                   { swap_points(i1, i2); });
+    touch();
+  }
+
+  std::shared_ptr<const bgeot::mesh_structure_csr>
+  mesh::frozen_structure() const {
+    local_guard lock = frozen_locks_.get_lock();
+    if (!frozen_uptodate || !frozen) {
+      frozen.reset();
+      auto f = std::make_shared<bgeot::mesh_structure_csr>(*this);
+      f->copy_points(pts, dim());
+      frozen = f;
+      frozen_uptodate = true;
+    }
+    return frozen;
   }
 
   void mesh::translation(const base_small_vector &V)
@@ -320,14 +439,19 @@ namespace getfem {
     touch();
   }
 
+  void mesh::swap_convex_except_regions(size_type i, size_type j) {
+    bgeot::mesh_structure::swap_convex(i,j);
+    trans_exists.swap(i, j);
+    gtab.swap(i,j);
+    if (Bank_info.get()) Bank_swap_convex(i,j);
+    cvs_v_num[i] = cvs_v_num[j] = act_counter();
+  }
+
   void mesh::swap_convex(size_type i, size_type j) {
     if (i != j) {
-      bgeot::mesh_structure::swap_convex(i,j);
-      trans_exists.swap(i, j);
-      gtab.swap(i,j);
+      swap_convex_except_regions(i, j);
       swap_convex_in_regions(i, j);
-      if (Bank_info.get()) Bank_swap_convex(i,j);
-      cvs_v_num[i] = cvs_v_num[j] = act_counter(); touch();
+      touch();
     }
   }
 
@@ -326,6 +326,11 @@ namespace getfem {
     // Dof counter
     size_type nbdof = 0;
 
+    // Read-only compact copy of the mesh, faster to traverse
+    auto pms = linked_mesh().frozen_structure();
+    const bgeot::mesh_structure_csr &ms = *pms;
+    size_type N = ms.dim();
+
     // Information stored per element
     size_type nb_max_cv = linked_mesh().nb_allocated_convex();
     std::vector<bgeot::kdtree> dof_nodes(nb_max_cv);
@@ -351,11 +356,13 @@ namespace getfem {
     for (dal::bv_visitor cv(linked_mesh().convex_index());
       	 !cv.finished(); ++cv) {
       if (fe_convex.is_in(cv)) {
-	gmm::copy(linked_mesh().points_of_convex(cv)[0], bmin);
+	bgeot::mesh_structure_csr::ind_ct ipts = ms.ind_points_of_convex(cv);
+	const scalar_type *pt0 = ms.coordinates_of_point(ipts[0]);
+	std::copy(pt0, pt0 + N, bmin.begin());
 	gmm::copy(bmin, bmax);
-	for (size_type i = 0; i <  linked_mesh().nb_points_of_convex(cv); ++i) {
-	  const base_node &pt = linked_mesh().points_of_convex(cv)[i];
-	  for (size_type d = 1; d < bmin.size(); ++d) {
+	for (size_type ip : ipts) {
+	  const scalar_type *pt = ms.coordinates_of_point(ip);
+	  for (size_type d = 1; d < N; ++d) {
 	    bmin[d] = std::min(bmin[d], pt[d]);
 	    bmax[d] = std::max(bmax[d], pt[d]);
 	  }
@@ -412,7 +419,7 @@ namespace getfem {
           if (idof == nbdof) {
 	    nbdof += Qdim / pf->target_dim();
 
-	    linked_mesh().neighbours_of_convex(cv, pf->faces_of_dof(cv, i), s);
+	    ms.neighbours_of_convex(cv, pf->faces_of_dof(cv, i), s);
 	    for (size_type ncv : s) { // For each unscanned neighbour
 	      if (!cv_done[ncv] && fe_convex.is_in(ncv)) { // add the dof
 
@@ -22,13 +22,64 @@
 #include "getfem/getfem_mesh_region.h"
 #include "getfem/getfem_mesh.h"
 #include "getfem/getfem_omp.h"
+#include <algorithm>
 
 namespace getfem {
   typedef mesh_region::face_bitset face_bitset;
+  typedef mesh_region::flat_map_t flat_map_t;
+
+  /* Position of the entry of convex cv in m, or of the first entry after
+     it if cv is not in m. */
+  template <typename IT>
+  static IT lower_bound_cv(IT itb, IT ite, size_type cv) {
+    return std::lower_bound(itb, ite, cv,
+                            [](const flat_map_t::value_type &e, size_type c)
+                            { return e.first < c; });
+  }
+
+  static flat_map_t::const_iterator find_cv(const flat_map_t &m,
+                                            size_type cv) {
+    flat_map_t::const_iterator it = lower_bound_cv(m.begin(), m.end(), cv);
+    return (it != m.end() && it->first == cv) ? it : m.end();
+  }
+
+  /* Set the faces of convex cv to bs, removing the entry if bs is empty. */
+  static void set_entry(flat_map_t &m, size_type cv, face_bitset bs) {
+    flat_map_t::iterator it = lower_bound_cv(m.begin(), m.end(), cv);
+    bool found = (it != m.end() && it->first == cv);
+    if (bs.any()) {
+      if (found) it->second = bs;
+      else m.insert(it, std::make_pair(cv, bs));
+    } else if (found) m.erase(it);
+  }
+
+  /* Sort the pending entries and merge them into m in a single pass. */
+  void mesh_region::impl::merge_pending() const {
+    getfem::local_guard lock = locks_.get_lock();
+    if (!has_pending) return;
+    std::stable_sort(pending.begin(), pending.end(),
+                     [](const flat_map_t::value_type &a,
+                        const flat_map_t::value_type &b)
+                     { return a.first < b.first; });
+    flat_map_t r; r.reserve(m.size() + pending.size());
+    flat_map_t::const_iterator it = m.begin(), ite = m.end();
+    for (flat_map_t::const_iterator itp = pending.begin();
+         itp != pending.end(); ++itp) {
+      if (!r.empty() && r.back().first == itp->first)
+        { r.back().second |= itp->second; continue; }
+      for (; it != ite && it->first < itp->first; ++it) r.push_back(*it);
+      r.push_back(*itp);
+      if (it != ite && it->first == itp->first)
+        { r.back().second |= it->second; ++it; }
+    }
+    r.insert(r.end(), it, ite);
+    m.swap(r);
+    flat_map_t().swap(pending);
+    has_pending = false;
+  }
 
   mesh_region::mesh_region(const mesh_region &other)
-    : p(std::make_shared<impl>()), id_(size_type(-2)), parent_mesh(0),
-      index_updated(false)
+    : p(std::make_shared<impl>()), id_(size_type(-2)), parent_mesh(0)
   {
     this->operator=(other);
   }
@@ -36,25 +87,24 @@ namespace getfem {
 
   mesh_region::mesh_region() : p(std::make_shared<impl>()), id_(size_type(-2)),
 			       type_(size_type(-1)),
-    partitioning_allowed(true), parent_mesh(0), index_updated(false)
+    partitioning_allowed(true), parent_mesh(0)
   { 
     if (me_is_multithreaded_now()) prohibit_partitioning();
   }
 
   mesh_region::mesh_region(size_type id__) : id_(id__), type_(size_type(-1)),
-    partitioning_allowed(true), parent_mesh(0), index_updated(false)
+    partitioning_allowed(true), parent_mesh(0)
   { }
 
   mesh_region::mesh_region(mesh& m, size_type id__, size_type type) : 
-    p(std::make_shared<impl>()), id_(id__), type_(type), partitioning_allowed(true), parent_mesh(&m),
-    index_updated(false)
+    p(std::make_shared<impl>()), id_(id__), type_(type), partitioning_allowed(true), parent_mesh(&m)
   { 
     if (me_is_multithreaded_now()) prohibit_partitioning();  
   }
 
   mesh_region::mesh_region(const dal::bit_vector &bv) : 
     p(std::make_shared<impl>()), id_(size_type(-2)), type_(size_type(-1)),
-    partitioning_allowed(true), parent_mesh(0), index_updated(false)
+    partitioning_allowed(true), parent_mesh(0)
   { 
     if (me_is_multithreaded_now()) prohibit_partitioning();  
     add(bv); 
@@ -80,7 +130,6 @@ namespace getfem {
         *r = m.region(id_);
       }
     }
-    index_updated = false;
     return *this;
   }
 
@@ -120,7 +169,6 @@ namespace getfem {
       }
       touch_parent_mesh();
     }
-    index_updated = false;
     return *this;
   }
 
@@ -133,24 +181,17 @@ namespace getfem {
     if (this->p.get() && !(mr.p.get())) return false;
     if (!(this->p.get()) && (mr.p.get())) return false;
     if (this->p.get())
-      if (this->p.get()->m != mr.p.get()->m) return false;
+      if (this->rp().m != mr.rp().m) return false;
     return true;
   }
 
   face_bitset mesh_region::operator[](size_t cv) const 
   {
-    map_t::const_iterator it = rp().m.find(cv);
+    const_iterator it = find_cv(rp().m, cv);
     if (it != rp().m.end()) return (*it).second;
     else return face_bitset();
   }
 
-  void mesh_region::update_partition_iterators() const
-  {
-    if (index_updated) return;
-    itbegin = partition_begin();
-    itend   = partition_end  ();
-    index_updated = true;
-  }
   mesh_region::const_iterator 
     mesh_region::partition_begin( ) const
   {
@@ -165,10 +206,7 @@ namespace getfem {
        static_cast<scalar_type >(num_threads())));
     size_type index_begin = partition_size * this_thread();
     if (index_begin >= region_size ) return  rp().m.end();
-
-    const_iterator it = rp().m.begin();
-    for (size_type i=0;i<index_begin;++i) ++it;
-    return it;
+    return rp().m.begin() + index_begin;
   }
 
   mesh_region::const_iterator 
@@ -182,29 +220,20 @@ namespace getfem {
        static_cast<scalar_type >(num_threads())));
     size_type index_end = partition_size * (this_thread() + 1);
     if (index_end >= region_size ) return  rp().m.end();
-
-    const_iterator it = rp().m.begin();
-    for (size_type i=0;i<index_end && it!=rp().m.end();++i) ++it;
-    return it;
+    return rp().m.begin() + index_end;
   }
 
   mesh_region::const_iterator mesh_region::begin( ) const 
   {
     if (me_is_multithreaded_now() && partitioning_allowed) 
-    { 
-      update_partition_iterators();
-      return itbegin;
-    }
+      return partition_begin();
     else return rp().m.begin();
   }
 
   mesh_region::const_iterator mesh_region::end  ( ) const 
   { 
     if (me_is_multithreaded_now() && partitioning_allowed) 
-    { 
-      update_partition_iterators();
-      return itend;
-    }
+      return partition_end();
     else return rp().m.end();
   }
 
@@ -239,82 +268,100 @@ namespace getfem {
 
   void mesh_region::add(const dal::bit_vector &bv) 
   {
+    flat_map_t &m = wp().m;
+    flat_map_t r; r.reserve(m.size() + bv.card());
+    flat_map_t::const_iterator it = m.begin(), ite = m.end();
     for (dal::bv_visitor i(bv); !i.finished(); ++i)
     {
-      wp().m[i].set(0,1);
+      for (; it != ite && it->first < i; ++it) r.push_back(*it);
+      r.push_back(std::make_pair(size_type(i), face_bitset(1)));
+      if (it != ite && it->first == i) { r.back().second |= it->second; ++it; }
     }
+    r.insert(r.end(), it, ite);
+    m.swap(r);
     touch_parent_mesh();
-    index_updated = false;
   }
 
+  /* Convexes coming in increasing order are appended to m. The other
+     ones, when not already in m, are stacked in pending and merged all
+     at once at the next access to the region, so that filling a region
+     in an arbitrary order does not cost a vector insertion each time. */
   void mesh_region::add(size_type cv, short_type f) 
   {
-    wp().m[cv].set(short_type(f+1),1); 
+    impl &r = *p.get();
+    face_bitset bs; bs.set(short_type(f+1),1);
+    if (!r.has_pending) {
+      flat_map_t &m = r.m;
+      if (m.empty() || m.back().first < cv)
+        m.push_back(std::make_pair(cv, bs));
+      else {
+        flat_map_t::iterator it = lower_bound_cv(m.begin(), m.end(), cv);
+        if (it->first == cv) it->second |= bs;
+        else { r.pending.push_back(std::make_pair(cv, bs)); r.has_pending = true; }
+      }
+    }
+    else r.pending.push_back(std::make_pair(cv, bs));
     touch_parent_mesh();
-    index_updated = false;
   }
 
   void mesh_region::sup_all(size_type cv) 
   { 
-    map_t::iterator it = wp().m.find(cv);
-    if (it != wp().m.end()) {
-      wp().m.erase(it);
+    if (find_cv(rp().m, cv) != rp().m.end()) {
+      set_entry(wp().m, cv, face_bitset());
       touch_parent_mesh();
     }
-    index_updated = false;
   }
 
   void mesh_region::sup(size_type cv, short_type f) 
   { 
-    map_t::iterator it = wp().m.find(cv);
-    if (it != wp().m.end()) {
-      (*it).second.set(short_type(f+1),0);
-      if ((*it).second.none()) wp().m.erase(it); 
+    const_iterator it = find_cv(rp().m, cv);
+    if (it != rp().m.end()) {
+      face_bitset bs = (*it).second;
+      bs.set(short_type(f+1),0);
+      set_entry(wp().m, cv, bs);
       touch_parent_mesh();
     }
-    index_updated = false;
   }
 
   void mesh_region::clear() 
   { 
     wp().m.clear(); touch_parent_mesh();
-    index_updated = false;
   }
 
   void mesh_region::clean() 
   {
-    for (map_t::iterator it = wp().m.begin(), itn; 
-      it != wp().m.end(); it = itn) 
-    {
-      itn = it; 
-      ++itn;
-      if ( !(*it).second.any() ) wp().m.erase(it);
-    }
+    flat_map_t &m = wp().m;
+    m.erase(std::remove_if(m.begin(), m.end(),
+                           [](const flat_map_t::value_type &e)
+                           { return e.second.none(); }), m.end());
     touch_parent_mesh();
-    index_updated = false;
   }
 
 
   void mesh_region::swap_convex(size_type cv1, size_type cv2)
   {
-    map_t::iterator it1 = wp().m.find(cv1), it2 = wp().m.find(cv2),
-      ite = wp().m.end();
-    face_bitset f1, f2;
+    face_bitset f1 = (*this)[cv1], f2 = (*this)[cv2];
+    set_entry(wp().m, cv1, f2);
+    set_entry(wp().m, cv2, f1);
+    touch_parent_mesh();
+  }
 
-    if (it1 != ite) f1 = it1->second;
-    if (it2 != ite) f2 = it2->second;
-    if (!f1.none()) wp().m[cv2] = f1;
-    else if (it2 != ite) wp().m.erase(it2);
-    if (!f2.none()) wp().m[cv1] = f2;
-    else if (it1 != ite) wp().m.erase(it1);
+  void mesh_region::renumber_convexes(const std::vector<size_type> &new_num)
+  {
+    flat_map_t &m = wp().m;
+    for (flat_map_t::value_type &e : m)
+      if (e.first < new_num.size()) e.first = new_num[e.first];
+    std::sort(m.begin(), m.end(),
+              [](const flat_map_t::value_type &e1,
+                 const flat_map_t::value_type &e2)
+              { return e1.first < e2.first; });
     touch_parent_mesh();
-    index_updated = false;
   }
 
   bool mesh_region::is_in(size_type cv, short_type f) const 
   {
     GMM_ASSERT1(p.get(), "Use from mesh on that region before");
-    map_t::const_iterator it = rp().m.find(cv);
+    const_iterator it = find_cv(rp().m, cv);
     if (it == rp().m.end() || short_type(f+1) >= MAX_FACES_PER_CV) return false;
     return ((*it).second)[short_type(f+1)];
   }
@@ -322,7 +369,7 @@ namespace getfem {
   bool mesh_region::is_in(size_type cv, short_type f, const mesh &m) const 
   {
     if (p.get()) {
-      map_t::const_iterator it = rp().m.find(cv);
+      const_iterator it = find_cv(rp().m, cv);
       if (it == rp().m.end() || short_type(f+1) >= MAX_FACES_PER_CV)
 	return false;
       return ((*it).second)[short_type(f+1)];
@@ -354,7 +401,7 @@ namespace getfem {
 
   face_bitset mesh_region::faces_of_convex(size_type cv) const 
   {
-    map_t::const_iterator it = rp().m.find(cv);
+    const_iterator it = find_cv(rp().m, cv);
     if (it != rp().m.end()) return ((*it).second) >> 1; 
     else return face_bitset();
   }
@@ -364,7 +411,7 @@ namespace getfem {
     face_bitset bs; 
     if (rp().m.empty()) return bs;
     bs.set();
-    for (map_t::const_iterator it = rp().m.begin(); it != rp().m.end(); ++it)
+    for (const_iterator it = rp().m.begin(); it != rp().m.end(); ++it)
       if ( (*it).second.any() )  bs &= (*it).second;
     return bs;
   }
@@ -373,7 +420,7 @@ namespace getfem {
   {
     face_bitset bs; 
     if (rp().m.empty()) return bs;
-    for (map_t::const_iterator it = rp().m.begin(); it != rp().m.end(); ++it)
+    for (const_iterator it = rp().m.begin(); it != rp().m.end(); ++it)
       if ( (*it).second.any() )  bs |= (*it).second;
     return bs;
   }
@@ -381,7 +428,7 @@ namespace getfem {
   size_type mesh_region::size() const 
   {
     size_type sz=0;
-    for (map_t::const_iterator it = begin(); it != end(); ++it)
+    for (const_iterator it = begin(); it != end(); ++it)
       sz += (*it).second.count();
     return sz;
   }
@@ -389,7 +436,7 @@ namespace getfem {
   size_type mesh_region::unpartitioned_size() const 
   {
     size_type sz=0;
-    for (map_t::const_iterator it = rp().m.begin(); it != rp().m.end(); ++it)
+    for (const_iterator it = rp().m.begin(); it != rp().m.end(); ++it)
       sz += (*it).second.count();
     return sz;
   }
@@ -409,16 +456,16 @@ namespace getfem {
 		"are not supported for set operations");
     if (a.id() == size_type(-1)) 
     {
-      for (const_iterator it = b.begin();it != b.end(); ++it) r.wp().m.insert(*it);
+      r.wp().m.assign(b.begin(), b.end());
       return r;
     }
     else if (b.id() == size_type(-1)) 
     {
-      for (const_iterator it = a.begin();it != a.end(); ++it) r.wp().m.insert(*it);
+      r.wp().m.assign(a.begin(), a.end());
       return r;
     }
 
-    map_t::const_iterator 
+    const_iterator 
       ita = a.begin(), enda = a.end(),
       itb = b.begin(), endb = b.end();
 
@@ -430,7 +477,7 @@ namespace getfem {
         if (maska[0] && !maskb[0]) bs = maskb;
         else if (maskb[0] && !maska[0]) bs = maska;
         else bs = maska & maskb;
-        if (bs.any()) r.wp().m.insert(r.wp().m.end(), std::make_pair(ita->first,bs));
+        if (bs.any()) r.wp().m.push_back(std::make_pair(ita->first,bs));
         ++ita; ++itb;
       }
     }
@@ -445,13 +492,20 @@ namespace getfem {
     GMM_ASSERT1(a.id() != size_type(-1) &&
       b.id() != size_type(-1), "the 'all_convexes' regions "
       "are not supported for set operations");
-    for (const_iterator it = a.begin();it != a.end(); ++it)
-    { 
-      r.wp().m.insert(*it);
-    }
-    for (const_iterator it = b.begin();it != b.end(); ++it)
-    {
-      r.wp().m[it->first] |= it->second;
+    const_iterator 
+      ita = a.begin(), enda = a.end(),
+      itb = b.begin(), endb = b.end();
+
+    while (ita != enda || itb != endb) {
+      if (itb == endb || (ita != enda && ita->first < itb->first))
+        r.wp().m.push_back(*ita++);
+      else if (ita == enda || itb->first < ita->first)
+        r.wp().m.push_back(*itb++);
+      else {
+        r.wp().m.push_back(std::make_pair(ita->first,
+                                          ita->second | itb->second));
+        ++ita; ++itb;
+      }
     }
     return r;
   }
@@ -465,17 +519,13 @@ namespace getfem {
     GMM_ASSERT1(a.id() != size_type(-1) &&
       b.id() != size_type(-1), "the 'all_convexes' regions "
       "are not supported for set operations");
-    for (const_iterator ita = a.begin();ita != a.end(); ++ita) 
-      r.wp().m.insert(*ita);
-
-    for (const_iterator itb = b.begin();itb != b.end(); ++itb) 
+    const_iterator itb = b.begin(), endb = b.end();
+    for (const_iterator ita = a.begin(); ita != a.end(); ++ita) 
     {
-      size_type cv = itb->first;
-      map_t::iterator it = r.wp().m.find(cv);
-      if (it != r.wp().m.end()){
-		it->second &= ~(itb->second);
-		if (it->second.none()) r.wp().m.erase(it);
-	  }
+      while (itb != endb && itb->first < ita->first) ++itb;
+      face_bitset bs = ita->second;
+      if (itb != endb && itb->first == ita->first) bs &= ~(itb->second);
+      if (bs.any()) r.wp().m.push_back(std::make_pair(ita->first, bs));
     }
     return r;
   }
@@ -660,11 +660,11 @@ namespace getfem {
     exec_(&nrefine[0], 1, cvlst);
   }
 
-  static bool check_orient(size_type cv, bgeot::pgeometric_trans pgt,
-			   const mesh& m) {
-    if (pgt->dim() == m.dim() && m.dim()>=2) { /* no orient check for 
-                                                  convexes of lower dim */
-      base_matrix G; bgeot::vectors_to_base_matrix(G,m.points_of_convex(cv));
+  /* G : coordinates of the points of the convex */
+  static bool check_orient(bgeot::pgeometric_trans pgt, const base_matrix &G,
+			   size_type N) {
+    if (pgt->dim() == N && N>=2) { /* no orient check for 
+                                      convexes of lower dim */
       base_node g(pgt->dim()); g.fill(.5); 
       base_matrix pc; pgt->poly_vector_grad(g,pc);
       base_matrix K(pgt->dim(),pgt->dim());
@@ -673,7 +673,6 @@ namespace getfem {
       // bgeot::geotrans_interpolation_context ctx(pgp,0,G);
       // scalar_type J = gmm::lu_det(ctx.B()); // pb car inverse K mme
       if (J < 0) return true;
-      //cout << "cv = " << cv << ", J = " << J << "\n";
     }
     return false;
   }
@@ -693,7 +692,8 @@ namespace getfem {
     for (mr_visitor it(cvlst); !it.finished(); ++it) {
       size_type nrefine = pnrefine[it.cv()*nref_stride];
       update_cv_data(it.cv(),it.f());      
-      bool revert_orientation = check_orient(cv, pgt,m);
+      base_matrix G; bgeot::vectors_to_base_matrix(G,m.points_of_convex(cv));
+      bool revert_orientation = check_orient(pgt, G, m.dim());
 
       /* update structure-dependent data */
       if (prev_cvr != cvr || nrefine != prev_nrefine) {
@@ -822,6 +822,10 @@ namespace getfem {
     bgeot::pgeotrans_precomp pgp = 0;
     std::vector<slice_node::faces_ct> points_on_faces;
     bool prev_discont = true;
+    /* the points of the convexes are read in the compact copy of the mesh */
+    auto pms = m.frozen_structure();
+    size_type N = m.dim();
+    base_matrix Gcv;
 
     cvlst.from_mesh(m);
     size_type prev_nrefine = 0;
@@ -829,7 +833,13 @@ namespace getfem {
     for (mr_visitor it(cvlst); !it.finished(); ++it) {
       size_type nrefine = pnrefine[it.cv()*nref_stride];
       update_cv_data(it.cv(),it.f());
-      bool revert_orientation = check_orient(cv, pgt,m);
+      bgeot::mesh_structure_csr::ind_ct ipts = pms->ind_points_of_convex(cv);
+      Gcv.base_resize(N, ipts.size());
+      for (size_type k = 0; k < ipts.size(); ++k) {
+        const scalar_type *pt = pms->coordinates_of_point(ipts[k]);
+        std::copy(pt, pt + N, Gcv.begin() + k*N);
+      }
+      bool revert_orientation = check_orient(pgt, Gcv, N);
 
       /* update structure-dependent data */
       /* TODO : fix levelset handling when slicing faces .. */
@@ -897,8 +907,7 @@ namespace getfem {
               nodes.back().pt_ref = cvm_pts[*itp] + 0.01*(G - cvm_pts[*itp]);
             }
             nodes.back().faces = points_on_faces[*itp];
-            nodes.back().pt.resize(m.dim()); nodes.back().pt.fill(0.);
-            pgp->transform(m.points_of_convex(cv), *itp, nodes.back().pt);
+            nodes.back().pt = pgp->transform(*itp, Gcv);
             //nodes.back().pt = pgt->transform(G, m.points_of_convex(cv));
             //cerr << "G = " << G << " -> pt = " << nodes.back().pt << "\n";
           }
@@ -36,6 +36,103 @@ namespace getfem {
                                  model_complex_plain_vector>(md);
   }
 
+  void rigid_body_modes(const mesh_fem &mf,
+                        gmm::dense_matrix<scalar_type> &B) {
+    size_type nbd = mf.nb_basic_dof(), Q = mf.get_qdim();
+    size_type N = mf.linked_mesh().dim(), nr = 0;
+    if (Q == N && N == 2) nr = 1;
+    if (Q == N && N == 3) nr = 3;
+
+    // Derivative dofs of Hermite type elements (Argyris, HCT ...). The
+    // modes being affine, a first derivative dof (der = direction) has no
+    // translation component and a constant rotation one. The second and
+    // normal derivative dofs (der = N) are left to zero, which is exact for
+    // the translations.
+    std::vector<size_type> der(nbd, size_type(-1));
+    for (dal::bv_visitor cv(mf.convex_index()); !cv.finished(); ++cv) {
+      pfem pf = mf.fem_of_element(cv);
+      if (pf->is_lagrange()) continue;
+      dim_type d = pf->dim();
+      size_type qmult = Q / pf->target_dim();
+      mesh_fem::ind_dof_ct dofs = mf.ind_basic_dof_of_element(cv);
+      for (size_type k = 0; k < pf->nb_dof(cv); ++k) {
+        pdof_description pdd = pf->dof_types()[k];
+        size_type r = size_type(-1);
+        for (dim_type j = 0; j < d; ++j) {
+          if (dof_description_compare(pdd, derivative_dof(d, j)) == 0) r = j;
+          for (dim_type l = 0; l < d; ++l)
+            if (dof_description_compare(pdd, second_derivative_dof(d, j, l))
+                == 0) r = N;
+        }
+        if (dof_description_compare(pdd, normal_derivative_dof(d)) == 0)
+          r = N;
+        if (r != size_type(-1))
+          for (size_type q = 0; q < qmult; ++q) der[dofs[k*qmult+q]] = r;
+      }
+    }
+
+    base_node c(N); // rotations around the center of the dofs.
+    for (size_type i = 0; i < nbd; ++i) gmm::add(mf.point_of_basic_dof(i), c);
+    if (nbd) gmm::scale(c, scalar_type(1) / scalar_type(nbd));
+
+    gmm::dense_matrix<scalar_type> BB(nbd, Q + nr);
+    for (size_type i = 0; i < nbd; ++i) {
+      size_type q = mf.basic_dof_qdim(i);
+      base_node x = mf.point_of_basic_dof(i) - c;
+      if (der[i] == N) continue;
+      if (der[i] != size_type(-1)) { // derivative of the rotations
+        gmm::clear(x); x[der[i]] = scalar_type(1);
+      } else
+        BB(i, q) = scalar_type(1);
+      if (nr == 1)
+        BB(i, Q) = (q == 0) ? -x[1] : x[0];
+      else if (nr == 3) {
+        switch (q) {
+        case 0 : BB(i, Q) = -x[1]; BB(i, Q+2) = x[2]; break;
+        case 1 : BB(i, Q) = x[0]; BB(i, Q+1) = -x[2]; break;
+        case 2 : BB(i, Q+1) = x[1]; BB(i, Q+2) = -x[0]; break;
+        }
+      }
+    }
+
+    gmm::resize(B, mf.nb_dof(), Q + nr);
+    if (mf.is_reduced())
+      gmm::mult(mf.reduction_matrix(), BB, B);
+    else
+      gmm::copy(BB, B);
+  }
+
+  void model_near_nullspace(const model &md,
+                            gmm::dense_matrix<scalar_type> &B,
+                            size_type &bs) {
+    model::varnamelist vl, vlu;
+    md.variable_list(vl);
+    size_type nc = 0, nbvar = 0;
+    for (const std::string &v : vl)
+      if (!md.is_data(v) && !md.is_affine_dependent_variable(v)) {
+        ++nbvar;
+        const mesh_fem *mf = md.pmesh_fem_of_variable(v);
+        if (mf) {
+          vlu.push_back(v);
+          size_type Q = mf->get_qdim(), N = mf->linked_mesh().dim();
+          nc = std::max(nc, Q + ((Q == N && N > 1) ? (N == 2 ? 1 : 3) : 0));
+        }
+      }
+
+    gmm::resize(B, md.nb_dof(), nc); gmm::clear(B);
+    bs = 1;
+    if (nc == 0) return;
+    for (const std::string &v : vlu) {
+      const mesh_fem &mf = md.mesh_fem_of_variable(v);
+      gmm::dense_matrix<scalar_type> Bv;
+      rigid_body_modes(mf, Bv);
+      const gmm::sub_interval &I = md.interval_of_variable(v);
+      gmm::copy(Bv, gmm::sub_matrix(B, I,
+                                    gmm::sub_interval(0, gmm::mat_ncols(Bv))));
+      if (nbvar == 1 && I.size() == md.nb_dof()) bs = mf.get_qdim();
+    }
+  }
+
   void default_newton_line_search::init_search(double r, size_t git, double) {
     alpha_min_ratio = 0.9;
     alpha_min = 1e-10;
@@ -126,7 +223,8 @@ namespace getfem {
   void standard_solve(model &md, gmm::iteration &iter,
                       PLSOLVER lsolver,
                       abstract_newton_line_search &ls, const MATRIX &K,
-                      const VECTOR &rhs) {
+                      const VECTOR &rhs,
+                      newton_tangent_reuse *pstrategy = 0) {
 
     VECTOR state(md.nb_dof());
     md.from_variables(state); // copy the model variables in the state vector
@@ -147,7 +245,10 @@ namespace getfem {
     }
     else {
       model_pb<MATRIX, VECTOR> mdpb(md, ls, state, rhs, K);
-      classical_Newton(mdpb, iter, *lsolver);
+      if (pstrategy)
+        Newton_with_tangent_reuse(mdpb, iter, *lsolver, *pstrategy);
+      else
+        classical_Newton(mdpb, iter, *lsolver);
     }
     md.to_variables(state); // copy the state vector into the model variables
   }
@@ -166,6 +267,22 @@ namespace getfem {
                    md.complex_rhs());
   }
 
+  void standard_solve(model &md, gmm::iteration &iter,
+                      rmodel_plsolver_type lsolver,
+                      abstract_newton_line_search &ls,
+                      newton_tangent_reuse &strategy) {
+    standard_solve(md, iter, lsolver, ls, md.real_tangent_matrix(),
+                   md.real_rhs(), &strategy);
+  }
+
+  void standard_solve(model &md, gmm::iteration &iter,
+                      cmodel_plsolver_type lsolver,
+                      abstract_newton_line_search &ls,
+                      newton_tangent_reuse &strategy) {
+    standard_solve(md, iter, lsolver, ls, md.complex_tangent_matrix(),
+                   md.complex_rhs(), &strategy);
+  }
+
 
   void standard_solve(model &md, gmm::iteration &iter,
                       rmodel_plsolver_type lsolver) {
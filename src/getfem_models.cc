@@ -20,6 +20,8 @@
 ===========================================================================*/
 
 #include <iomanip>
+#include <chrono>
+#include <array>
 #include "gmm/gmm_range_basis.h"
 #include "gmm/gmm_solver_cg.h"
 #include "gmm/gmm_condition_number.h"
@@ -90,6 +92,9 @@ namespace getfem {
   model::model(bool comp_version) {
     init(); complex_version = comp_version;
     is_linear_ = is_symmetric_ = is_coercive_ = true;
+    colored_assembly_ = false;
+    assembly_profiling_ = false;
+    incremental_assembly_ = false;
     leading_dim = 0;
     time_integration = 0; init_step = false; time_step = scalar_type(1);
     add_interpolate_transformation
@@ -364,6 +369,8 @@ namespace getfem {
     else {
       gmm::resize(rTM, tot_size, tot_size);
       gmm::resize(rrhs, tot_size);
+      rTM_const = model_real_sparse_matrix();
+      rTM_const_contributions.clear();
     }
 
     for (dal::bv_visitor ib(valid_bricks); !ib.finished(); ++ib)
@@ -2503,6 +2510,66 @@ namespace getfem {
 
 
 
+  // Rebuilds the blocks of the constant part of the tangent matrix
+  // concerned by a linear brick whose contribution has changed since the
+  // previous assembly, then adds the constant part to the tangent matrix.
+  void model::update_constant_tangent_part(constant_contributions &contribs) {
+    typedef std::array<size_type, 4> block_type; // first and size of I1, I2
+    size_type nbd = gmm::mat_nrows(rTM);
+    bool rebuild_all = (gmm::mat_nrows(rTM_const) != nbd);
+    std::set<block_type> dirty_blocks;
+
+    auto add_blocks = [&dirty_blocks](const constant_contribution &c) {
+      for (const constant_term_description &t : c.terms) {
+        dirty_blocks.insert(block_type{{t.i1, t.n1, t.i2, t.n2}});
+        if (t.sym) dirty_blocks.insert(block_type{{t.i2, t.n2, t.i1, t.n1}});
+      }
+    };
+
+    if (rebuild_all) {
+      gmm::resize(rTM_const, nbd, nbd);
+      gmm::clear(rTM_const);
+    } else {
+      for (const auto &c : rTM_const_contributions) {
+        auto it = contribs.find(c.first);
+        if (it == contribs.end() || it->second != c.second)
+          add_blocks(c.second);
+      }
+      for (const auto &c : contribs) {
+        auto it = rTM_const_contributions.find(c.first);
+        if (it == rTM_const_contributions.end() || it->second != c.second)
+          add_blocks(c.second);
+      }
+      for (const block_type &b : dirty_blocks)
+        gmm::clear(gmm::sub_matrix(rTM_const, gmm::sub_interval(b[0], b[1]),
+                                   gmm::sub_interval(b[2], b[3])));
+    }
+
+    if (rebuild_all || dirty_blocks.size()) {
+      GMM_TRACE2("Update of the constant part of the tangent matrix, "
+                 << (rebuild_all ? nbd : dirty_blocks.size())
+                 << (rebuild_all ? " dofs" : " blocks"));
+      for (const auto &c : contribs) {
+        const brick_description &brick = bricks[c.first];
+        for (const constant_term_description &t : c.second.terms) {
+          gmm::sub_interval I1(t.i1, t.n1), I2(t.i2, t.n2);
+          if (rebuild_all
+              || dirty_blocks.count(block_type{{t.i1, t.n1, t.i2, t.n2}}))
+            gmm::add(gmm::scaled(brick.rmatlist[t.j], t.alpha),
+                     gmm::sub_matrix(rTM_const, I1, I2));
+          if (t.sym && (rebuild_all
+              || dirty_blocks.count(block_type{{t.i2, t.n2, t.i1, t.n1}})))
+            gmm::add(gmm::scaled(gmm::transposed(brick.rmatlist[t.j]),
+                                 t.alpha),
+                     gmm::sub_matrix(rTM_const, I2, I1));
+        }
+      }
+    }
+
+    rTM_const_contributions.swap(contribs);
+    gmm::add(rTM_const, rTM);
+  }
+
   void model::assembly(build_version version) {
 
 #if GETFEM_PARA_LEVEL > 1
@@ -2524,6 +2591,10 @@ namespace getfem {
 
     if (version & BUILD_RHS) approx_external_load_ = scalar_type(0);
 
+    bool incremental = incremental_assembly_ && !is_complex()
+      && (version & BUILD_MATRIX);
+    constant_contributions contribs;
+
     for (dal::bv_visitor ib(active_bricks); !ib.finished(); ++ib) {
 
       brick_description &brick = bricks[ib];
@@ -2536,10 +2607,26 @@ namespace getfem {
       }
       if (auto_disabled_brick) continue;
 
+      std::chrono::steady_clock::time_point brick_t0
+        = std::chrono::steady_clock::now();
       update_brick(ib, version);
 
       bool cplx = is_complex() && brick.pbr->is_complex();
 
+      // Matrix terms of a linear brick go to the constant part of the
+      // tangent matrix in case of incremental assembly.
+      constant_contribution *pconst = 0;
+      if (incremental && brick.pbr->is_linear() && !(brick.pdispatch)
+          && !(brick.pbr->is_to_be_computed_each_time())) {
+        bool has_global_term = false;
+        for (const term_description &term : brick.tlist)
+          if (term.is_global) has_global_term = true;
+        if (!has_global_term) {
+          pconst = &(contribs[ib]);
+          pconst->v_num = brick.v_num;
+        }
+      }
+
       scalar_type coeff0 = scalar_type(1);
       if (brick.pdispatch) coeff0 = brick.matrix_coeff;
 
@@ -2714,11 +2801,19 @@ namespace getfem {
           if (term.is_matrix_term && (version & BUILD_MATRIX) && !isprevious
               && (isg || (!(it1->second.is_disabled)
                           && !(it2->second.is_disabled)))) {
-            gmm::add(gmm::scaled(brick.rmatlist[j], alpha),
-                     gmm::sub_matrix(rTM, I1, I2));
-            if (term.is_symmetric && I1.first() != I2.first()) {
-              gmm::add(gmm::scaled(gmm::transposed(brick.rmatlist[j]), alpha),
-                       gmm::sub_matrix(rTM, I2, I1));
+            if (pconst) {
+              constant_term_description t = {
+                j, I1.first(), I1.size(), I2.first(), I2.size(), alpha,
+                term.is_symmetric && I1.first() != I2.first() };
+              pconst->terms.push_back(t);
+            } else {
+              gmm::add(gmm::scaled(brick.rmatlist[j], alpha),
+                       gmm::sub_matrix(rTM, I1, I2));
+              if (term.is_symmetric && I1.first() != I2.first()) {
+                gmm::add(gmm::scaled(gmm::transposed(brick.rmatlist[j]),
+                                     alpha),
+                         gmm::sub_matrix(rTM, I2, I1));
+              }
             }
           }
           if (version & BUILD_RHS) {
@@ -2796,20 +2891,133 @@ namespace getfem {
 
 
       if (version & BUILD_RHS) approx_external_load_ += brick.external_load;
+
+      if (assembly_profiling_) {
+        std::stringstream name;
+        name << "brick " << ib << " : " << brick.pbr->brick_name();
+        ga_assembly_profile::entry &e = assembly_profile_.bricks[name.str()];
+        e.time += std::chrono::duration<scalar_type>
+          (std::chrono::steady_clock::now() - brick_t0).count();
+        ++(e.count);
+      }
     }
 
+    if (incremental) update_constant_tangent_part(contribs);
+
     if (version & BUILD_RHS) {
       if (is_complex()) MPI_SUM_VECTOR(crhs); else MPI_SUM_VECTOR(rrhs);
     }
 
     // Generic expressions
     if (generic_expressions.size()) {
-      model_real_plain_vector residual;
-      if (version & BUILD_RHS) gmm::resize(residual, gmm::vect_size(rrhs));
-
-      { //need parentheses for constructor/destructor semantics of distro
+      model_real_plain_vector &residual = generic_residual;
+      if (version & BUILD_RHS) {
+        gmm::resize(residual, gmm::vect_size(rrhs));
+        gmm::clear(residual);
+      }
+
+      auto add_generic_expressions = [&](ga_workspace &workspace) {
+        for (const auto &ad : assignments)
+          workspace.add_assignment_expression
+            (ad.varname, ad.expr, ad.region, ad.order, ad.before);
+
+        for (const auto &ge : generic_expressions)
+          workspace.add_expression(ge.expr, ge.mim, ge.region);
+      };
+
+      auto generic_assembly = [&](ga_workspace &workspace,
+                                  model_real_plain_vector &res,
+                                  model_real_sparse_matrix &tangent) {
+        if (version & BUILD_RHS)
+          GMM_TRACE2("Global generic assembly RHS");
+        if (version & BUILD_MATRIX)
+          GMM_TRACE2("Global generic assembly tangent term");
+
+        if ((version & BUILD_RHS) && (version & BUILD_MATRIX)) {
+          // Residual and tangent terms assembled in a single loop on the
+          // elements, sharing their common subexpressions.
+          if (is_complex()) {
+            GMM_ASSERT1(false, "to be done");
+          } else {
+            workspace.set_assembled_vector(res);
+            workspace.set_assembled_matrix(tangent);
+            workspace.assembly(2, true);
+          }
+        } else if (version & BUILD_RHS) {
+          if (is_complex()) {
+            GMM_ASSERT1(false, "to be done");
+          } else {
+            workspace.set_assembled_vector(res);
+            workspace.assembly(1);
+          }
+        } else if (version & BUILD_MATRIX) {
+          if (is_complex()) {
+            GMM_ASSERT1(false, "to be done");
+          } else {
+            workspace.set_assembled_matrix(tangent);
+            workspace.assembly(2);
+          }
+        }
+      };
+
+      if (num_threads() == 1 || colored_assembly_) {
+        // The workspace is kept from one assembly to the next one, so that
+        // its compiled instructions are reused, as long as the expressions
+        // and the variables are unchanged.
+        std::stringstream sig;
+        sig << this << ";";
+        for (const auto &ad : assignments)
+          sig << ad.varname << ";" << ad.expr << ";" << ad.region << ";"
+              << ad.order << ";" << ad.before << ";";
+        for (const auto &ge : generic_expressions)
+          sig << ge.expr << ";" << &(ge.mim) << ";" << ge.region << ";";
+        for (const auto &v : variables) {
+          sig << v.first << ";" << v.second.is_variable
+              << v.second.is_disabled << v.second.is_affine_dependent << ";"
+              << v.second.passociated_mf() << ";" << v.second.pim_data << ";"
+              << v.second.qdims << ";";
+          if (!(v.second.is_fem_dofs) && !(v.second.pim_data))
+            sig << v.second.size() << ";";
+        }
+        for (const auto &vg : variable_groups) {
+          sig << vg.first << ";";
+          for (const std::string &name : vg.second) sig << name << ";";
+        }
+        for (const auto &ma : macros) sig << ma.first << ";" << ma.second << ";";
+        for (const auto &tr : transformations)
+          sig << tr.first << ";" << tr.second.get() << ";";
+        for (const auto &tr : elem_transformations)
+          sig << tr.first << ";" << tr.second.get() << ";";
+
+        if (!generic_workspace || sig.str() != generic_workspace_signature) {
+          generic_workspace = std::make_shared<ga_workspace>(*this);
+          add_generic_expressions(*generic_workspace);
+          generic_workspace_signature = sig.str();
+        }
+        // With several threads, they are distributed by the workspace on a
+        // coloring of the elements, without any copy of the residual and
+        // tangent matrix.
+        std::chrono::steady_clock::time_point generic_t0
+          = std::chrono::steady_clock::now();
+        generic_workspace->set_colored_assembly(colored_assembly_);
+        generic_workspace->set_assembly_profile
+          (assembly_profiling_ ? &assembly_profile_ : 0);
+        generic_assembly(*generic_workspace, residual, rTM);
+        if (assembly_profiling_) {
+          ga_assembly_profile::entry &e
+            = assembly_profile_.bricks["generic expressions"];
+          e.time += std::chrono::duration<scalar_type>
+            (std::chrono::steady_clock::now() - generic_t0).count();
+          ++(e.count);
+        }
+      } else { //need parentheses for constructor/destructor semantics of distro
         distro<decltype(rrhs)> residual_distributed(residual);
         distro<decltype(rTM)>  tangent_matrix_distributed(rTM);
+        // Each thread profiles its own workspace, the profiles being
+        // gathered after the parallel section.
+        omp_distribute<ga_assembly_profile> thread_profiles;
+        std::chrono::steady_clock::time_point generic_t0
+          = std::chrono::steady_clock::now();
 
         /*running the assembly in parallel*/
         gmm::standard_locale locale;
@@ -2819,46 +3027,29 @@ namespace getfem {
         {
           exception.run([&]
           {
-	    if (version & BUILD_RHS)
-	      GMM_TRACE2("Global generic assembly RHS");
-	    if (version & BUILD_MATRIX)
-	      GMM_TRACE2("Global generic assembly tangent term");
-
             ga_workspace workspace(*this);
-
-	    for (const auto &ad : assignments)
-	      workspace.add_assignment_expression
-		(ad.varname, ad.expr, ad.region, ad.order, ad.before);
-
-            for (const auto &ge : generic_expressions)
-	      workspace.add_expression(ge.expr, ge.mim, ge.region);
-
-            if (version & BUILD_RHS) {
-              if (is_complex()) {
-                GMM_ASSERT1(false, "to be done");
-              } else {
-                workspace.set_assembled_vector(residual_distributed);
-                workspace.assembly(1);
-              }
-            }
-
-            if (version & BUILD_MATRIX) {
-              if (is_complex()) {
-                GMM_ASSERT1(false, "to be done");
-              } else {
-                workspace.set_assembled_matrix(tangent_matrix_distributed);
-                workspace.assembly(2);
-              }
-            }
+            add_generic_expressions(workspace);
+            if (assembly_profiling_)
+              workspace.set_assembly_profile(&(thread_profiles.thrd_cast()));
+            generic_assembly(workspace, residual_distributed,
+                             tangent_matrix_distributed);
           });//exception.run(
         } //#pragma omp parallel
         exception.rethrow();
+        if (assembly_profiling_) {
+          for (size_type t = 0; t < num_threads(); ++t)
+            assembly_profile_.add(thread_profiles(t));
+          ga_assembly_profile::entry &e
+            = assembly_profile_.bricks["generic expressions"];
+          e.time += std::chrono::duration<scalar_type>
+            (std::chrono::steady_clock::now() - generic_t0).count();
+          ++(e.count);
+        }
       } //end of distro scope
 
       if (version & BUILD_RHS) gmm::add(gmm::scaled(residual, scalar_type(-1)), rrhs);
 
     }
-
     // Post simplification for dof constraints
     if ((version & BUILD_RHS) || (version & BUILD_MATRIX)) {
       if (is_complex()) {
@@ -3229,6 +3420,8 @@ model_complex_plain_vector &
     complex_dof_constraints.clear();
     bricks.resize(0);
     rTM = model_real_sparse_matrix();
+    rTM_const = model_real_sparse_matrix();
+    rTM_const_contributions.clear();
     cTM = model_complex_sparse_matrix();
     rrhs = model_real_plain_vector();
     crhs = model_complex_plain_vector();
@@ -0,0 +1,538 @@
+/*===========================================================================
+
+ Copyright (C) 2017-2017 Yves Renard
+
+ This file is a part of GetFEM++
+
+ GetFEM++  is  free software;  you  can  redistribute  it  and/or modify it
+ under  the  terms  of the  GNU  Lesser General Public License as published
+ by  the  Free Software Foundation;  either version 3 of the License,  or
+ (at your option) any later version along with the GCC Runtime Library
+ Exception either version 3.1 or (at your option) any later version.
+ This program  is  distributed  in  the  hope  that it will be useful,  but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ or  FITNESS  FOR  A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License and GCC Runtime Library Exception for more details.
+ You  should  have received a copy of the GNU Lesser General Public License
+ along  with  this program;  if not, write to the Free Software Foundation,
+ Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+
+===========================================================================*/
+
+#include "getfem/getfem_reduced_order_model.h"
+#include "gmm/gmm_dense_qr.h"
+#include "gmm/gmm_dense_lu.h"
+
+namespace getfem {
+
+  /* ***************************************************************** */
+  /*     Proper orthogonal decomposition.                              */
+  /* ***************************************************************** */
+
+  void pod_basis::add_snapshot(const model_real_plain_vector &V) {
+    GMM_ASSERT1(snapshots.empty() || gmm::vect_size(V)
+                == gmm::vect_size(snapshots[0]), "Snapshots of different "
+                "sizes, the model has changed");
+    snapshots.push_back(V);
+  }
+
+  size_type pod_basis::compute(scalar_type tol, size_type max_size) {
+    size_type ns = snapshots.size();
+    size_type n = ns ? gmm::vect_size(snapshots[0]) : 0;
+    sv.resize(0); gmm::resize(B, n, 0);
+    if (ns == 0) return 0;
+
+    // Correlation matrix of the snapshots and its eigen decomposition.
+    gmm::dense_matrix<scalar_type> C(ns, ns), Q(ns, ns);
+    for (size_type i = 0; i < ns; ++i)
+      for (size_type j = 0; j <= i; ++j)
+        C(i, j) = C(j, i) = gmm::vect_sp(snapshots[i], snapshots[j]);
+    std::vector<scalar_type> lambda(ns);
+    gmm::symmetric_qr_algorithm(C, lambda, Q);
+
+    std::vector<size_type> order(ns);
+    for (size_type i = 0; i < ns; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&lambda](size_type i, size_type j)
+              { return lambda[i] > lambda[j]; });
+
+    scalar_type lmax = std::max(lambda[order[0]], scalar_type(0)), total(0);
+    for (size_type i = 0; i < ns; ++i)
+      total += std::max(lambda[i], scalar_type(0));
+    if (lmax <= scalar_type(0)) return 0;
+
+    // Eigenvalues under this threshold are dominated by rounding errors.
+    scalar_type lmin = lmax * scalar_type(ns)
+                     * gmm::default_tol(scalar_type());
+    size_type k = 0;
+    scalar_type discarded = total;
+    while (k < ns && k < max_size && lambda[order[k]] > lmin
+           && discarded > tol * tol * total)
+      discarded -= lambda[order[k++]];
+
+    // Modes computed from the eigenvectors, then orthonormalized again
+    // (twice) to remove the rounding errors of the correlation matrix.
+    std::vector<model_real_plain_vector> modes;
+    model_real_plain_vector W(n);
+    for (size_type j = 0; j < k; ++j) {
+      gmm::clear(W);
+      for (size_type i = 0; i < ns; ++i)
+        gmm::add(gmm::scaled(snapshots[i], Q(i, order[j])), W);
+      scalar_type nw = gmm::vect_norm2(W);
+      for (size_type pass = 0; pass < 2; ++pass)
+        for (const model_real_plain_vector &M : modes)
+          gmm::add(gmm::scaled(M, -gmm::vect_sp(M, W)), W);
+      scalar_type nw2 = gmm::vect_norm2(W);
+      if (nw2 <= nw * scalar_type(1E-8)) continue;
+      gmm::scale(W, scalar_type(1) / nw2);
+      modes.push_back(W);
+      sv.push_back(gmm::sqrt(lambda[order[j]]));
+    }
+
+    gmm::resize(B, n, modes.size());
+    for (size_type j = 0; j < modes.size(); ++j)
+      gmm::copy(modes[j], gmm::mat_col(B, j));
+    return modes.size();
+  }
+
+  void deim_interpolation_indices(const gmm::dense_matrix<scalar_type> &U,
+                                  std::vector<size_type> &ind) {
+    size_type n = gmm::mat_nrows(U), m = gmm::mat_ncols(U);
+    ind.resize(0);
+    if (m == 0) return;
+    model_real_plain_vector r(n);
+
+    for (size_type l = 0; l < m; ++l) {
+      gmm::copy(gmm::mat_const_col(U, l), r);
+      if (l > 0) {
+        // Residual of the interpolation of the l-th vector by the
+        // previous ones at the already selected indices.
+        gmm::dense_matrix<scalar_type> A(l, l);
+        model_real_plain_vector b(l), c(l);
+        for (size_type i = 0; i < l; ++i) {
+          for (size_type j = 0; j < l; ++j) A(i, j) = U(ind[i], j);
+          b[i] = U(ind[i], l);
+        }
+        gmm::lu_solve(A, c, b);
+        for (size_type j = 0; j < l; ++j)
+          gmm::add(gmm::scaled(gmm::mat_const_col(U, j), -c[j]), r);
+      }
+      size_type imax = 0;
+      for (size_type i = 1; i < n; ++i)
+        if (gmm::abs(r[i]) > gmm::abs(r[imax])) imax = i;
+      ind.push_back(imax);
+    }
+  }
+
+  /* ***************************************************************** */
+  /*     Reduced order model.                                          */
+  /* ***************************************************************** */
+
+  size_type reduced_order_model::add_hyper_reduced_term
+  (const mesh_im &mim, const std::string &expr, size_type region,
+   const std::string &brickname) {
+    hyper_reduced_term t;
+    t.ib = add_nonlinear_generic_assembly_brick(md, mim, expr, region, false,
+                                                false, brickname);
+    t.mim = &mim; t.expr = expr; t.region = region;
+    terms.push_back(t);
+    built = false;
+    return t.ib;
+  }
+
+  void reduced_order_model::assemble_term_residual
+  (const hyper_reduced_term &t, model_real_plain_vector &V) const {
+    gmm::resize(V, md.nb_dof()); gmm::clear(V);
+    ga_workspace workspace(md);
+    workspace.add_expression(t.expr, *(t.mim), t.region);
+    workspace.set_assembled_vector(V);
+    workspace.assembly(1);
+  }
+
+  void reduced_order_model::add_affine_parameter(const std::string &name) {
+    GMM_ASSERT1(md.is_data(name) && gmm::vect_size(md.real_variable(name))
+                == 1, name << " is not a scalar data of the model");
+    affine_params.push_back(name);
+    built = false;
+  }
+
+  void reduced_order_model::add_snapshot() {
+    model_real_plain_vector U(md.nb_dof()), V;
+    md.from_variables(U);
+    states.add_snapshot(U);
+    for (hyper_reduced_term &t : terms) {
+      assemble_term_residual(t, V);
+      t.residuals.add_snapshot(V);
+    }
+  }
+
+  // Selects the elements (or faces) of the region of the term on which
+  // one of the sampled dofs has a non zero basis function. The residual
+  // of the term at the sampled dofs is then exactly given by the assembly
+  // on these elements. The whole region is kept when a sampled dof does
+  // not belong to a finite element variable defined on the mesh of the
+  // integration method.
+  void reduced_order_model::build_sampled_region
+  (hyper_reduced_term &t) const {
+    const mesh &m = t.mim->linked_mesh();
+    mesh_region rg = (t.region == size_type(-1))
+      ? mesh_region(t.mim->convex_index()) : m.region(t.region);
+
+    dal::bit_vector sampled;
+    for (size_type i : t.ind) sampled.add(i);
+
+    bool whole_region = false;
+    std::map<const mesh_fem *, dal::bit_vector> basic_dofs;
+    model::varnamelist vl;
+    md.variable_list(vl);
+    for (const std::string &v : vl) {
+      if (md.is_data(v) || md.is_disabled_variable(v)
+          || md.is_affine_dependent_variable(v)) continue;
+      const gmm::sub_interval &I = md.interval_of_variable(v);
+      bool found = false;
+      for (size_type i = I.first(); i < I.last(); ++i)
+        if (sampled.is_in(i)) { found = true; break; }
+      if (!found) continue;
+
+      const mesh_fem *mf = md.pmesh_fem_of_variable(v);
+      if (!mf || &(mf->linked_mesh()) != &m) { whole_region = true; break; }
+      dal::bit_vector &bd = basic_dofs[mf];
+      if (mf->is_reduced()) {
+        const auto &E = mf->extension_matrix();
+        for (size_type j = 0; j < gmm::mat_nrows(E); ++j) {
+          auto row = gmm::mat_const_row(E, j);
+          auto it = gmm::vect_const_begin(row), ite = gmm::vect_const_end(row);
+          for (; it != ite; ++it)
+            if (*it != scalar_type(0) && sampled.is_in(I.first()+it.index()))
+              { bd.add(j); break; }
+        }
+      } else {
+        for (size_type i = I.first(); i < I.last(); ++i)
+          if (sampled.is_in(i)) bd.add(i - I.first());
+      }
+    }
+
+    if (whole_region) { t.sampled_region = rg; return; }
+
+    t.sampled_region = mesh_region();
+    for (mr_visitor i(rg); !i.finished(); ++i) {
+      bool keep = false;
+      for (const auto &bd : basic_dofs) {
+        if (!(bd.first->convex_index().is_in(i.cv()))) continue;
+        for (size_type d : bd.first->ind_basic_dof_of_element(i.cv()))
+          if (bd.second.is_in(d)) { keep = true; break; }
+        if (keep) break;
+      }
+      if (keep) {
+        if (i.is_face()) t.sampled_region.add(i.cv(), i.f());
+        else t.sampled_region.add(i.cv());
+      }
+    }
+  }
+
+  // Copies the sampled elements in a sample mesh and declares on it the
+  // restrictions of the variables and data used by the term. Returns
+  // false if the term uses a variable, data or transformation which
+  // cannot be restricted to the sample mesh.
+  bool reduced_order_model::build_sample_mesh(hyper_reduced_term &t) const {
+    t.sample_mesh.reset(); t.sample_mim.reset(); t.fields.clear();
+    t.workspace.reset(); t.ind_s.resize(0);
+    const mesh &m = t.mim->linked_mesh();
+
+    std::set<std::string> names;
+    {
+      ga_workspace w(md);
+      size_type order = w.add_expression(t.expr, *(t.mim), t.region);
+      model::varnamelist vl, vl_test1, vl_test2, dl;
+      w.used_variables(vl, vl_test1, vl_test2, dl, order);
+      names.insert(vl.begin(), vl.end());
+      names.insert(dl.begin(), dl.end());
+    }
+    for (const std::string &name : names) {
+      if (!(md.variable_exists(name))) return false;
+      const mesh_fem *mf = md.pmesh_fem_of_variable(name);
+      if (md.is_data(name)) {
+        if (md.pim_data_of_variable(name)) return false;
+      } else if (!mf || md.is_affine_dependent_variable(name)
+                 || md.is_disabled_variable(name)) return false;
+      if (mf && (&(mf->linked_mesh()) != &m || mf->is_reduced()))
+        return false;
+    }
+
+    // Macros of the model used by the term (and by these macros).
+    std::map<std::string, std::string> macros;
+    std::vector<std::string> exprs(1, t.expr);
+    while (exprs.size()) {
+      std::string expr = exprs.back(); exprs.pop_back();
+      for (size_type i = 0; i < expr.size(); ) {
+        if (!isalpha(expr[i]) && expr[i] != '_') { ++i; continue; }
+        size_type j = i;
+        while (j < expr.size() && (isalnum(expr[j]) || expr[j] == '_')) ++j;
+        std::string name = expr.substr(i, j-i); i = j;
+        if (md.interpolate_transformation_exists(name)
+            || md.elementary_transformation_exists(name)) return false;
+        if (md.macro_exists(name) && !macros.count(name)) {
+          macros[name] = md.get_macro(name);
+          exprs.push_back(macros[name]);
+        }
+      }
+    }
+
+    t.sample_mesh = std::make_shared<mesh>();
+    t.sample_mim = std::make_shared<mesh_im>(*(t.sample_mesh));
+    t.sample_region = mesh_region();
+    std::map<size_type, size_type> cvs_of_cv;
+    for (mr_visitor i(t.sampled_region); !i.finished(); ++i) {
+      auto it = cvs_of_cv.find(i.cv());
+      if (it == cvs_of_cv.end()) {
+        size_type cvs = t.sample_mesh->add_convex_by_points
+          (m.trans_of_convex(i.cv()), m.points_of_convex(i.cv()).begin());
+        t.sample_mim->set_integration_method
+          (cvs, t.mim->int_method_of_element(i.cv()));
+        it = cvs_of_cv.insert(std::make_pair(i.cv(), cvs)).first;
+      }
+      if (i.is_face()) t.sample_region.add(it->second, i.f());
+      else t.sample_region.add(it->second);
+    }
+
+    t.workspace = std::make_shared<ga_workspace>();
+    size_type n_s = 0;
+    for (const std::string &name : names) {
+      const mesh_fem *mf = md.pmesh_fem_of_variable(name);
+      if (!mf) { // Fixed size data, read in the model.
+        t.workspace->add_fixed_size_constant(name, md.real_variable(name));
+        continue;
+      }
+      t.fields.push_back(sampled_field());
+      sampled_field &f = t.fields.back();
+      f.name = name; f.is_variable = !(md.is_data(name)); f.mf = mf;
+      f.mf_s = std::make_shared<mesh_fem>(*(t.sample_mesh));
+      f.mf_s->set_qdim(mf->get_qdims());
+      for (const auto &cc : cvs_of_cv)
+        if (mf->convex_index().is_in(cc.first))
+          f.mf_s->set_finite_element(cc.second, mf->fem_of_element(cc.first));
+      f.dofs.resize(f.mf_s->nb_basic_dof());
+      for (const auto &cc : cvs_of_cv)
+        if (mf->convex_index().is_in(cc.first)) {
+          auto ds = f.mf_s->ind_basic_dof_of_element(cc.second);
+          auto d = mf->ind_basic_dof_of_element(cc.first);
+          for (size_type k = 0; k < ds.size(); ++k) f.dofs[ds[k]] = d[k];
+        }
+      if (f.is_variable) {
+        f.I_s = gmm::sub_interval(n_s, f.dofs.size());
+        n_s += f.dofs.size();
+      } else
+        gmm::resize(f.V_s, f.dofs.size());
+    }
+    gmm::resize(t.U_s, n_s);
+    for (const sampled_field &f : t.fields) {
+      if (f.is_variable)
+        t.workspace->add_fem_variable(f.name, *(f.mf_s), f.I_s, t.U_s);
+      else
+        t.workspace->add_fem_constant(f.name, *(f.mf_s), f.V_s);
+    }
+    for (const auto &mc : macros) t.workspace->add_macro(mc.first, mc.second);
+    t.workspace->add_expression(t.expr, *(t.sample_mim), t.sample_region);
+
+    // Rows of the state basis and sampled dofs in the sample unknowns.
+    const gmm::dense_matrix<scalar_type> &B = states.basis();
+    size_type nr = gmm::mat_ncols(B);
+    gmm::resize(t.B_s, n_s, nr);
+    std::map<size_type, size_type> s_of_dof;
+    for (const sampled_field &f : t.fields) {
+      if (!(f.is_variable)) continue;
+      size_type i0 = md.interval_of_variable(f.name).first();
+      for (size_type k = 0; k < f.dofs.size(); ++k) {
+        size_type i = i0 + f.dofs[k], i_s = f.I_s.first() + k;
+        for (size_type j = 0; j < nr; ++j) t.B_s(i_s, j) = B(i, j);
+        s_of_dof[i] = i_s;
+      }
+    }
+    // A sampled dof which is not a dof of the sample mesh has a zero
+    // residual for the term.
+    for (size_type i : t.ind) {
+      auto it = s_of_dof.find(i);
+      t.ind_s.push_back(it == s_of_dof.end() ? size_type(-1) : it->second);
+    }
+    gmm::resize(t.V, n_s);
+    gmm::resize(t.K, n_s, n_s);
+    return true;
+  }
+
+  void reduced_order_model::build(scalar_type tol, scalar_type tol_hr,
+                                  size_type max_size) {
+    GMM_ASSERT1(states.nb_snapshots(), "No snapshot");
+    GMM_ASSERT1(states.compute(tol, max_size), "Empty reduced basis");
+    const gmm::dense_matrix<scalar_type> &B = states.basis();
+    size_type nbd = gmm::mat_nrows(B), nr = gmm::mat_ncols(B);
+
+    for (hyper_reduced_term &t : terms) {
+      size_type m = t.residuals.compute(tol_hr);
+      const gmm::dense_matrix<scalar_type> &U = t.residuals.basis();
+      deim_interpolation_indices(U, t.ind);
+      build_sampled_region(t);
+
+      // P = B^T U (U(ind,:))^{-1}
+      gmm::dense_matrix<scalar_type> G(m, m), BtU(nr, m);
+      for (size_type i = 0; i < m; ++i)
+        for (size_type j = 0; j < m; ++j) G(i, j) = U(t.ind[i], j);
+      if (m) gmm::lu_inverse(G);
+      gmm::mult(gmm::transposed(B), U, BtU);
+      gmm::resize(t.P, nr, m);
+      gmm::mult(BtU, G, t.P);
+
+      if (!build_sample_mesh(t)) {
+        t.workspace = std::make_shared<ga_workspace>(md);
+        t.workspace->add_expression(t.expr, *(t.mim), t.sampled_region);
+        t.ind_s = t.ind;
+        gmm::resize(t.V, nbd);
+        gmm::resize(t.K, nbd, nbd);
+      }
+    }
+    update_linear_part();
+    model_real_plain_vector U(nbd);
+    md.from_variables(U);
+    gmm::resize(ar, nr);
+    gmm::mult(gmm::transposed(B), U, ar);
+    built = true;
+  }
+
+  void reduced_order_model::update_linear_part() {
+    size_type np = affine_params.size();
+    std::vector<scalar_type> values(np);
+    for (size_type q = 0; q < np; ++q) {
+      values[q] = md.real_variable(affine_params[q])[0];
+      md.set_real_variable(affine_params[q])[0] = scalar_type(0);
+    }
+    project_linear_part(Kr0, Fr0);
+    Krq.resize(np); Frq.resize(np);
+    for (size_type q = 0; q < np; ++q) {
+      md.set_real_variable(affine_params[q])[0] = scalar_type(1);
+      project_linear_part(Krq[q], Frq[q]);
+      gmm::add(gmm::scaled(Kr0, scalar_type(-1)), Krq[q]);
+      gmm::add(gmm::scaled(Fr0, scalar_type(-1)), Frq[q]);
+      md.set_real_variable(affine_params[q])[0] = scalar_type(0);
+    }
+    for (size_type q = 0; q < np; ++q)
+      md.set_real_variable(affine_params[q])[0] = values[q];
+  }
+
+  void reduced_order_model::project_linear_part
+  (gmm::dense_matrix<scalar_type> &Kr, model_real_plain_vector &Fr) {
+    const gmm::dense_matrix<scalar_type> &B = states.basis();
+    size_type nbd = gmm::mat_nrows(B), nr = gmm::mat_ncols(B);
+    GMM_ASSERT1(nbd == md.nb_dof(), "The reduced basis is not built or the "
+                "model has changed");
+
+    dal::bit_vector active_terms;
+    for (const hyper_reduced_term &t : terms)
+      if (md.get_active_bricks().is_in(t.ib))
+        { active_terms.add(t.ib); md.disable_brick(t.ib); }
+    for (dal::bv_visitor ib(md.get_active_bricks()); !ib.finished(); ++ib)
+      GMM_ASSERT1(md.brick_pointer(ib)->is_linear(), "Brick " << ib
+                  << " is nonlinear, it should be added as an hyper-reduced "
+                  "term");
+
+    // The complete rhs F - K U is computed at the current state U,
+    // F = rhs + K U is the right hand side of the linear part.
+    md.assembly(model::build_version(model::BUILD_ALL
+                                     | model::BUILD_WITH_COMPLETE_RHS));
+    for (dal::bv_visitor ib(active_terms); !ib.finished(); ++ib)
+      md.enable_brick(ib);
+
+    const model_real_sparse_matrix &K = md.real_tangent_matrix();
+    model_real_plain_vector U(nbd), F(nbd);
+    md.from_variables(U);
+    gmm::mult(K, U, md.real_rhs(), F);
+
+    gmm::dense_matrix<scalar_type> KB(nbd, nr);
+    gmm::mult(K, B, KB);
+    gmm::resize(Kr, nr, nr);
+    gmm::mult(gmm::transposed(B), KB, Kr);
+    gmm::resize(Fr, nr);
+    gmm::mult(gmm::transposed(B), F, Fr);
+  }
+
+  void reduced_order_model::solve(gmm::iteration &iter, bool expand) {
+    GMM_ASSERT1(built, "The reduced order model has to be built first");
+    const gmm::dense_matrix<scalar_type> &B = states.basis();
+    size_type nbd = gmm::mat_nrows(B), nr = gmm::mat_ncols(B);
+    GMM_ASSERT1(nbd == md.nb_dof(), "The model has changed");
+
+    // Linear part for the current values of the affine parameters.
+    gmm::dense_matrix<scalar_type> Krl(nr, nr), Kr(nr, nr);
+    model_real_plain_vector Frl(Fr0), r(nr), da(nr), U;
+    gmm::copy(Kr0, Krl);
+    for (size_type q = 0; q < affine_params.size(); ++q) {
+      scalar_type theta = md.real_variable(affine_params[q])[0];
+      gmm::add(gmm::scaled(Krq[q], theta), Krl);
+      gmm::add(gmm::scaled(Frq[q], theta), Frl);
+    }
+
+    // Data restricted to the sample meshes.
+    bool full_state = false;
+    for (hyper_reduced_term &t : terms) {
+      if (!(t.sample_mesh)) { full_state = true; continue; }
+      for (sampled_field &f : t.fields)
+        if (!(f.is_variable)) {
+          const model_real_plain_vector &D = md.real_variable(f.name);
+          for (size_type k = 0; k < f.dofs.size(); ++k)
+            f.V_s[k] = D[f.dofs[k]];
+        }
+    }
+    if (full_state) gmm::resize(U, nbd);
+
+    iter.set_iteration(0);
+    while (true) {
+      if (full_state) { gmm::mult(B, ar, U); md.to_variables(U); }
+
+      // r = Fr - Kr a - sum P f(ind), Kr = Krl + sum P K(ind,:) B
+      gmm::mult(Krl, gmm::scaled(ar, scalar_type(-1)), Frl, r);
+      gmm::copy(Krl, Kr);
+      for (hyper_reduced_term &t : terms) {
+        size_type m = t.ind.size();
+        if (m == 0 || !(md.get_active_bricks().is_in(t.ib))) continue;
+        const gmm::dense_matrix<scalar_type> &Bt = t.sample_mesh ? t.B_s : B;
+        if (t.sample_mesh) gmm::mult(t.B_s, ar, t.U_s);
+        gmm::clear(t.V); gmm::clear(t.K); // Of the size of the sample mesh.
+        t.workspace->set_assembled_vector(t.V);
+        t.workspace->set_assembled_matrix(t.K);
+        t.workspace->assembly(2, true);
+
+        // Only the rows of the sampled dofs are used.
+        model_real_plain_vector f(m);
+        gmm::dense_matrix<scalar_type> KIB(m, nr);
+        std::map<size_type, size_type> pos;
+        for (size_type i = 0; i < m; ++i)
+          if (t.ind_s[i] != size_type(-1))
+            { f[i] = t.V[t.ind_s[i]]; pos[t.ind_s[i]] = i; }
+        for (size_type j = 0; j < gmm::mat_ncols(t.K); ++j) {
+          auto it = gmm::vect_const_begin(gmm::mat_const_col(t.K, j));
+          auto ite = gmm::vect_const_end(gmm::mat_const_col(t.K, j));
+          for (; it != ite; ++it) {
+            auto ip = pos.find(it.index());
+            if (ip != pos.end())
+              for (size_type k = 0; k < nr; ++k)
+                KIB(ip->second, k) += (*it) * Bt(j, k);
+          }
+        }
+
+        gmm::mult_add(t.P, gmm::scaled(f, scalar_type(-1)), r);
+        gmm::dense_matrix<scalar_type> PK(nr, nr);
+        gmm::mult(t.P, KIB, PK);
+        gmm::add(PK, Kr);
+      }
+
+      if (iter.finished_vect(r)) break;
+      gmm::lu_solve(Kr, da, r);
+      gmm::add(da, ar);
+      ++iter;
+    }
+
+    if (expand) {
+      gmm::resize(U, nbd);
+      gmm::mult(B, ar, U);
+      md.to_variables(U);
+    }
+  }
+
+}  /* end of namespace getfem.                                             */
@@ -230,6 +230,13 @@ namespace gmm {
     float memory_used;
     mutable bool is_init;
     mutable char equed;
+    // Sparsity pattern of the last analysed matrix, the column permutation
+    // and the elimination tree are reused for a matrix having the same one.
+    std::vector<unsigned int> pattern_ir, pattern_jc;
+    int pattern_permc_spec;
+    bool analysis_done, analysis_reused;
+    bool rcond_estimation;
+    double rcond;
     void free_supermatrix() {
       if (is_init) {
 	if (SB.Store) Destroy_SuperMatrix_Store(&SB);
@@ -237,9 +244,12 @@ namespace gmm {
 	if (SA.Store) Destroy_SuperMatrix_Store(&SA);
 	if (SL.Store) Destroy_SuperNode_Matrix(&SL);
 	if (SU.Store) Destroy_CompCol_Matrix(&SU);
+	is_init = false;
       }
     }
-    SuperLU_factor_impl_common() : is_init(false) {}
+    SuperLU_factor_impl_common()
+      : is_init(false), pattern_permc_spec(-1), analysis_done(false),
+	analysis_reused(false), rcond_estimation(false), rcond(0) {}
     virtual ~SuperLU_factor_impl_common() { free_supermatrix(); }
   };
   
@@ -263,6 +273,9 @@ namespace gmm {
      *   permc_spec = 1: use minimum degree ordering on structure of A'*A
      *   permc_spec = 2: use minimum degree ordering on structure of A'+A
      *   permc_spec = 3: use approximate minimum degree column ordering
+     * The ordering and the symbolic analysis of the previous factorization
+     * are kept if A has the same sparsity pattern, only the numeric
+     * factorization is done.
      */
     free_supermatrix();
     int n = int(mat_nrows(A)), m = int(mat_ncols(A)), info = 0;
@@ -277,12 +290,22 @@ namespace gmm {
     set_default_options(&options);
     options.ColPerm = NATURAL;
     options.PrintStat = NO;
-    options.ConditionNumber = NO;
+    options.ConditionNumber = rcond_estimation ? YES : NO;
     switch (permc_spec) {
       case 1 : options.ColPerm = MMD_ATA; break;
       case 2 : options.ColPerm = MMD_AT_PLUS_A; break;
       case 3 : options.ColPerm = COLAMD; break;
     }
+    analysis_reused = analysis_done && permc_spec == pattern_permc_spec
+      && perm_c.size() == size_type(n) && A.jc == pattern_jc
+      && A.ir == pattern_ir;
+    if (analysis_reused)
+      options.Fact = SamePattern; // perm_c and etree are input arguments
+    else {
+      analysis_done = false;
+      pattern_ir = A.ir; pattern_jc = A.jc;
+      pattern_permc_spec = permc_spec;
+    }
     StatInit(&stat);
     
     Create_CompCol_Matrix(&SA, m, n, nz, const_cast<T*>(&A.pr[0]),
@@ -297,7 +320,7 @@ namespace gmm {
     equed = 'B';
     Rscale.resize(m); Cscale.resize(n); etree.resize(n);
     ferr.resize(1); berr.resize(1);
-    R recip_pivot_gross, rcond;
+    R recip_pivot_gross, rcond_est;
     perm_r.resize(m); perm_c.resize(n);
     memory_used = SuperLU_gssvx(&options, &SA, &perm_c[0], &perm_r[0], 
                                 &etree[0] /* output */, &equed /* output        */, 
@@ -309,7 +332,7 @@ namespace gmm {
                                 &SB /* rhs */, &SX /* solution                  */,
                                 &recip_pivot_gross /* reciprocal pivot growth   */
                                 /* factor max_j( norm(A_j)/norm(U_j) ).         */,  
-                                &rcond /*estimate of the reciprocal condition   */
+                                &rcond_est /*estimate of the reciprocal condition*/
                                 /* number of the matrix A after equilibration   */,
                                 &ferr[0] /* estimated forward error             */,
                                 &berr[0] /* relative backward error             */,
@@ -320,16 +343,19 @@ namespace gmm {
     Create_Dense_Matrix(&SB, m, 1, &rhs[0], m);
     Create_Dense_Matrix(&SX, m, 1, &sol[0], m);
     StatFree(&stat);
+    is_init = true; // L and U are allocated, even for a singular matrix
+    analysis_done = (info == 0);
+    rcond = (rcond_estimation && info == 0) ? double(rcond_est) : 0.;
     
     GMM_ASSERT1(info != -333333333, "SuperLU was cancelled.");
     GMM_ASSERT1(info == 0, "SuperLU solve failed: info=" << info);
-    is_init = true;
   }
 
   template <typename T> 
   void SuperLU_factor_impl<T>::solve(int transp) {
     options.Fact = FACTORED;
     options.IterRefine = NOREFINE;
+    options.ConditionNumber = NO; // estimated at the factorization only
     switch (transp) {
       case SuperLU_factor<T>::LU_NOTRANSP: options.Trans = NOTRANS; break;
       case SuperLU_factor<T>::LU_TRANSP: options.Trans = TRANS; break;
@@ -403,6 +429,21 @@ namespace gmm {
     return impl->memory_used;
   }
 
+  template<typename T> bool
+  SuperLU_factor<T>::analysis_reused() const {
+    return impl->analysis_reused;
+  }
+
+  template<typename T> void
+  SuperLU_factor<T>::set_rcond_estimation(bool b) {
+    impl->rcond_estimation = b;
+  }
+
+  template<typename T> double
+  SuperLU_factor<T>::rcond() const {
+    return impl->rcond;
+  }
+
   /*  void force_instantiation() {
     SuperLU_factor<float> a;
     SuperLU_factor<double> b;
@@ -262,6 +262,149 @@ namespace gmm {
 
 
 
+  /** Factorization of a sparse matrix with MUMPS, kept for several
+   *  solves. The analysis phase (ordering and symbolic factorization) is
+   *  done again only when the sparsity pattern of the matrix changes,
+   *  otherwise only the numeric factorization is done.
+   *  Works only with sparse or skyline matrices
+   */
+  template <typename T> class MUMPS_factor {
+    typedef typename mumps_interf<T>::value_type MUMPS_T;
+
+    mutable typename mumps_interf<T>::MUMPS_STRUC_C id;
+    std::vector<int> irn, jcn; // pattern of the analysed matrix
+    std::vector<T> a;
+    mutable std::vector<T> rhs;
+    bool sym, distributed, is_init, analysis_done, analysis_reused_;
+    int rank;
+
+    void init_instance(bool sym_, bool distributed_) {
+      const int JOB_INIT = -1;
+      const int USE_COMM_WORLD = -987654;
+      sym = sym_; distributed = distributed_;
+      id.job = JOB_INIT;
+      id.par = 1;
+      id.sym = sym ? 2 : 0;
+      id.comm_fortran = USE_COMM_WORLD;
+      mumps_interf<T>::mumps_c(id);
+
+      id.ICNTL(1) = -1; // output stream for error messages
+      id.ICNTL(2) = -1; // output stream for other messages
+      id.ICNTL(3) = -1; // output stream for global information
+      id.ICNTL(4) = 0;  // verbosity level
+      if (distributed) {
+        id.ICNTL(5) = 0;  // assembled input matrix (default)
+        id.ICNTL(18) = 3; // strategy for distributed input matrix
+      }
+      id.ICNTL(14) += 80; // small boost to the workspace size
+      is_init = true; analysis_done = false;
+    }
+
+  public :
+    void free_instance() {
+      if (is_init) {
+        const int JOB_END = -2;
+        id.job = JOB_END;
+        mumps_interf<T>::mumps_c(id);
+        is_init = false; analysis_done = false;
+      }
+    }
+
+    /** Factorize A. Return false if A is singular. */
+    template <typename MAT>
+    bool build_with(const MAT &A, bool sym_ = false,
+                    bool distributed_ = false) {
+      GMM_ASSERT2(gmm::mat_nrows(A) == gmm::mat_ncols(A),
+                  "Non-square matrix");
+      if (is_init && (sym != sym_ || distributed != distributed_))
+        free_instance();
+      if (!is_init) init_instance(sym_, distributed_);
+
+      ij_sparse_matrix<T> AA(A, sym);
+      int same_pattern = analysis_done && id.n == int(gmm::mat_nrows(A))
+        && AA.irn == irn && AA.jcn == jcn;
+#ifdef GMM_USES_MPI
+      if (!distributed)
+        MPI_Bcast(&same_pattern, 1, MPI_INT, 0, MPI_COMM_WORLD);
+      else
+        MPI_Allreduce(MPI_IN_PLACE, &same_pattern, 1, MPI_INT, MPI_MIN,
+                      MPI_COMM_WORLD);
+#endif
+      // MUMPS keeps the pointers on the arrays between the phases.
+      irn.swap(AA.irn); jcn.swap(AA.jcn); a.swap(AA.a);
+      if (rank == 0 || distributed) {
+        id.n = int(gmm::mat_nrows(A));
+        if (distributed) {
+          id.nz_loc = int(irn.size());
+          id.irn_loc = &(irn[0]);
+          id.jcn_loc = &(jcn[0]);
+          id.a_loc = (MUMPS_T*)(&(a[0]));
+        } else {
+          id.nz = int(irn.size());
+          id.irn = &(irn[0]);
+          id.jcn = &(jcn[0]);
+          id.a = (MUMPS_T*)(&(a[0]));
+        }
+      }
+
+      analysis_reused_ = (same_pattern != 0);
+      if (!analysis_reused_) {
+        id.job = 1; // analysis
+        mumps_interf<T>::mumps_c(id);
+        if (!mumps_error_check(id)) return false;
+        analysis_done = true;
+      }
+      id.job = 2; // factorization
+      mumps_interf<T>::mumps_c(id);
+      return mumps_error_check(id);
+    }
+
+    /** Solve AX = B with the factorized matrix. */
+    template <typename VECTX, typename VECTB>
+    void solve(const VECTX &X_, const VECTB &B) const {
+      VECTX &X = const_cast<VECTX &>(X_);
+      rhs.resize(gmm::vect_size(B)); gmm::copy(B, rhs);
+      if (rank == 0) id.rhs = (MUMPS_T*)(&(rhs[0]));
+      id.job = 3; // solve
+      mumps_interf<T>::mumps_c(id);
+      mumps_error_check(id);
+#ifdef GMM_USES_MPI
+      MPI_Bcast(&(rhs[0]),id.n,gmm::mpi_type(T()),0,MPI_COMM_WORLD);
+#endif
+      gmm::copy(rhs, X);
+    }
+
+    /** True if the last factorization reused the analysis of the previous
+        one. */
+    bool analysis_reused() const { return analysis_reused_; }
+
+    MUMPS_factor()
+      : sym(false), distributed(false), is_init(false),
+        analysis_done(false), analysis_reused_(false), rank(0) {
+#ifdef GMM_USES_MPI
+      MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#endif
+    }
+    MUMPS_factor(const MUMPS_factor &other)
+      : sym(false), distributed(false), is_init(false),
+        analysis_done(false), analysis_reused_(false), rank(other.rank) {
+      GMM_ASSERT1(!(other.is_init),
+                  "copy of initialized MUMPS_factor is forbidden");
+    }
+    MUMPS_factor& operator=(const MUMPS_factor& other) {
+      GMM_ASSERT1(!(other.is_init) && !is_init,
+                  "assignment of initialized MUMPS_factor is forbidden");
+      return *this;
+    }
+    ~MUMPS_factor() { free_instance(); }
+  };
+
+  template <typename T, typename V1, typename V2> inline
+  void mult(const MUMPS_factor<T>& P, const V1 &v1, const V2 &v2) {
+    P.solve(v2,v1);
+  }
+
+
   template<typename T>
   inline T real_or_complex(std::complex<T> a) { return a.real(); }
   template<typename T>
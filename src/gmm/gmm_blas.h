@@ -393,6 +393,25 @@ namespace gmm {
     for (; it != ite; ++it, ++it2) res += (*it) * (*it2);
     return res;
   }
+
+  template <typename IT1, typename IT2>
+  typename strongest_numeric_type<typename std::iterator_traits<IT1>::value_type,
+				  typename std::iterator_traits<IT2>::value_type>::T
+  vect_sp_dense_threaded_(IT1 it, IT2 it2, size_type n) {
+    typedef typename strongest_numeric_type<typename std::iterator_traits<IT1>::value_type,
+      typename std::iterator_traits<IT2>::value_type>::T T;
+    int nb = threaded_kernels_nb_blocks(n);
+    std::vector<T> partial(nb);
+    #pragma omp parallel for schedule(static)
+    for (int b = 0; b < nb; ++b) {
+      size_type i0 = size_type(b) * threaded_kernels_block;
+      size_type i1 = std::min(n, i0 + threaded_kernels_block);
+      partial[b] = vect_sp_dense_(it + i0, it + i1, it2 + i0);
+    }
+    T res(0);
+    for (int b = 0; b < nb; ++b) res += partial[b];
+    return res;
+  }
   
   template <typename IT1, typename V> inline
     typename strongest_numeric_type<typename std::iterator_traits<IT1>::value_type,
@@ -407,6 +426,9 @@ namespace gmm {
   template <typename V1, typename V2> inline
   typename strongest_value_type<V1,V2>::value_type
     vect_sp(const V1 &v1, const V2 &v2, abstract_dense, abstract_dense) {
+    if (use_threaded_kernels(vect_size(v1)))
+      return vect_sp_dense_threaded_(vect_const_begin(v1),
+				     vect_const_begin(v2), vect_size(v1));
     return vect_sp_dense_(vect_const_begin(v1), vect_const_end(v1),
 			  vect_const_begin(v2));
   }
@@ -542,14 +564,51 @@ namespace gmm {
   typename number_traits<typename linalg_traits<V>::value_type>
   ::magnitude_type
   vect_norm2_sqr(const V &v) {
-    typedef typename linalg_traits<V>::value_type T;
+    return vect_norm2_sqr_(v, typename linalg_traits<V>::storage_type());
+  }
+  ///@cond DOXY_SHOW_ALL_FUNCTIONS
+
+  template <typename IT>
+  typename number_traits<typename std::iterator_traits<IT>::value_type>
+  ::magnitude_type
+  norm2_sqr_(IT it, IT ite) {
+    typedef typename std::iterator_traits<IT>::value_type T;
     typedef typename number_traits<T>::magnitude_type R;
-    auto it = vect_const_begin(v), ite = vect_const_end(v);
     R res(0);
     for (; it != ite; ++it) res += gmm::abs_sqr(*it);
     return res;
   }
 
+  template <typename V, typename STO> inline
+  typename number_traits<typename linalg_traits<V>::value_type>
+  ::magnitude_type
+  vect_norm2_sqr_(const V &v, STO)
+  { return norm2_sqr_(vect_const_begin(v), vect_const_end(v)); }
+
+  template <typename V>
+  typename number_traits<typename linalg_traits<V>::value_type>
+  ::magnitude_type
+  vect_norm2_sqr_(const V &v, abstract_dense) {
+    typedef typename linalg_traits<V>::value_type T;
+    typedef typename number_traits<T>::magnitude_type R;
+    size_type n = vect_size(v);
+    if (!use_threaded_kernels(n))
+      return norm2_sqr_(vect_const_begin(v), vect_const_end(v));
+    auto it = vect_const_begin(v);
+    int nb = threaded_kernels_nb_blocks(n);
+    std::vector<R> partial(nb);
+    #pragma omp parallel for schedule(static)
+    for (int b = 0; b < nb; ++b) {
+      size_type i0 = size_type(b) * threaded_kernels_block;
+      size_type i1 = std::min(n, i0 + threaded_kernels_block);
+      partial[b] = norm2_sqr_(it + i0, it + i1);
+    }
+    R res(0);
+    for (int b = 0; b < nb; ++b) res += partial[b];
+    return res;
+  }
+  ///@endcond
+
   /** Euclidean norm of a vector. */
   template <typename V> inline
    typename number_traits<typename linalg_traits<V>::value_type>
@@ -1411,8 +1470,21 @@ namespace gmm {
   template <typename L1, typename L2, typename L3> inline
   void add(const L1& l1, const L2& l2, L3& l3,
 	   abstract_dense, abstract_dense, abstract_dense) {
-    add_full_(vect_const_begin(l1), vect_const_begin(l2),
-	      vect_begin(l3), vect_end(l3));
+    size_type n = vect_size(l3);
+    if (use_threaded_kernels(n)) {
+      auto it1 = vect_const_begin(l1); auto it2 = vect_const_begin(l2);
+      auto it3 = vect_begin(l3);
+      int nb = threaded_kernels_nb_blocks(n);
+      #pragma omp parallel for schedule(static)
+      for (int b = 0; b < nb; ++b) {
+	size_type i0 = size_type(b) * threaded_kernels_block;
+	size_type i1 = std::min(n, i0 + threaded_kernels_block);
+	add_full_(it1 + i0, it2 + i0, it3 + i0, it3 + i1);
+      }
+    }
+    else
+      add_full_(vect_const_begin(l1), vect_const_begin(l2),
+		vect_begin(l3), vect_end(l3));
   }
   
   // generic function for add(v1, v2, v3).
@@ -1475,6 +1547,19 @@ namespace gmm {
 
   template <typename L1, typename L2>
   void add(const L1& l1, L2& l2, abstract_dense, abstract_dense) {
+    size_type n = vect_size(l2);
+    if (use_threaded_kernels(n)) {
+      auto it1 = vect_const_begin(l1); auto it2 = vect_begin(l2);
+      int nb = threaded_kernels_nb_blocks(n);
+      #pragma omp parallel for schedule(static)
+      for (int b = 0; b < nb; ++b) {
+	size_type i0 = size_type(b) * threaded_kernels_block;
+	size_type i1 = std::min(n, i0 + threaded_kernels_block);
+	auto itb1 = it1 + i0; auto itb2 = it2 + i0, iteb = it2 + i1;
+	for (; itb2 != iteb; ++itb2, ++itb1) *itb2 += *itb1;
+      }
+      return;
+    }
     auto it1 = vect_const_begin(l1); 
     auto it2 = vect_begin(l2), ite = vect_end(l2);
     for (; it2 != ite; ++it2, ++it1) *it2 += *it1;
@@ -1633,8 +1718,66 @@ namespace gmm {
     }
   }
 
+  template <typename L1, typename L2, typename L3>
+  void mult_by_row_threaded_(const L1& l1, const L2& l2, L3& l3, bool acc) {
+    size_type n = mat_nrows(l1);
+    auto it = vect_begin(l3);
+    int nb = threaded_kernels_nb_blocks(n);
+    #pragma omp parallel for schedule(dynamic)
+    for (int b = 0; b < nb; ++b) {
+      size_type i0 = size_type(b) * threaded_kernels_block;
+      size_type i1 = std::min(n, i0 + threaded_kernels_block);
+      auto itb = it + i0;
+      for (size_type i = i0; i < i1; ++i, ++itb)
+	if (acc) *itb += vect_sp(mat_const_row(l1, i), l2);
+	else *itb = vect_sp(mat_const_row(l1, i), l2);
+    }
+  }
+
+  template <typename L1, typename L2, typename L3, typename STO> inline
+  bool mult_add_by_col_threaded_(const L1&, const L2&, L3&, STO)
+  { return false; }
+
+  // The columns are distributed in num_threads() parts, each part being
+  // added to its own vector, which are then summed in the order of the parts.
+  template <typename L1, typename L2, typename L3>
+  bool mult_add_by_col_threaded_(const L1& l1, const L2& l2, L3& l3,
+				 abstract_dense) {
+    typedef typename linalg_traits<L3>::value_type T;
+    size_type nc = mat_ncols(l1), nr = mat_nrows(l1);
+    int nt = int(num_threads());
+    std::vector<std::vector<T> > w(nt-1);
+    auto it2 = vect_const_begin(l2);
+    #pragma omp parallel for schedule(static, 1)
+    for (int t = 0; t < nt; ++t) {
+      size_type j0 = nc * t / nt, j1 = nc * (t+1) / nt;
+      if (t == 0) {
+	for (size_type j = j0; j < j1; ++j)
+	  add(scaled(mat_const_col(l1, j), *(it2 + j)), l3);
+      } else {
+	w[t-1].resize(nr);
+	for (size_type j = j0; j < j1; ++j)
+	  add(scaled(mat_const_col(l1, j), *(it2 + j)), w[t-1]);
+      }
+    }
+    auto it = vect_begin(l3);
+    int nb = threaded_kernels_nb_blocks(nr);
+    #pragma omp parallel for schedule(static)
+    for (int b = 0; b < nb; ++b) {
+      size_type i0 = size_type(b) * threaded_kernels_block;
+      size_type i1 = std::min(nr, i0 + threaded_kernels_block);
+      for (int t = 1; t < nt; ++t) {
+	auto itb = it + i0;
+	for (size_type i = i0; i < i1; ++i, ++itb) *itb += w[t-1][i];
+      }
+    }
+    return true;
+  }
+
   template <typename L1, typename L2, typename L3>
   void mult_by_row(const L1& l1, const L2& l2, L3& l3, abstract_dense) {
+    if (use_threaded_kernels(mat_nrows(l1)))
+      { mult_by_row_threaded_(l1, l2, l3, false); return; }
     typename linalg_traits<L3>::iterator it=vect_begin(l3), ite=vect_end(l3);
     auto itr = mat_row_const_begin(l1); 
     for (; it != ite; ++it, ++itr)
@@ -1646,6 +1789,8 @@ namespace gmm {
   template <typename L1, typename L2, typename L3>
   void mult_by_col(const L1& l1, const L2& l2, L3& l3, abstract_dense) {
     clear(l3);
+    if (use_threaded_kernels(mat_nrows(l1)) && mult_add_by_col_threaded_
+	(l1, l2, l3, typename linalg_traits<L3>::storage_type())) return;
     size_type nc = mat_ncols(l1);
     for (size_type i = 0; i < nc; ++i)
       add(scaled(mat_const_col(l1, i), l2[i]), l3);
@@ -1756,6 +1901,8 @@ namespace gmm {
 
   template <typename L1, typename L2, typename L3>
   void mult_add_by_row(const L1& l1, const L2& l2, L3& l3, abstract_dense) {
+    if (use_threaded_kernels(mat_nrows(l1)))
+      { mult_by_row_threaded_(l1, l2, l3, true); return; }
     auto it=vect_begin(l3), ite=vect_end(l3);
     auto itr = mat_row_const_begin(l1);
     for (; it != ite; ++it, ++itr)
@@ -1764,6 +1911,8 @@ namespace gmm {
 
   template <typename L1, typename L2, typename L3>
   void mult_add_by_col(const L1& l1, const L2& l2, L3& l3, abstract_dense) {
+    if (use_threaded_kernels(mat_nrows(l1)) && mult_add_by_col_threaded_
+	(l1, l2, l3, typename linalg_traits<L3>::storage_type())) return;
     size_type nc = mat_ncols(l1);
     for (size_type i = 0; i < nc; ++i)
       add(scaled(mat_const_col(l1, i), l2[i]), l3);
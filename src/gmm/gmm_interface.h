@@ -232,13 +232,13 @@ namespace gmm {
   };
 }
 namespace std {
-  template <typename T> ostream &operator <<
-  (std::ostream &o, const vector<T>& m) { gmm::write(o,m); return o; }
+  template <typename T, typename alloc> ostream &operator <<
+  (std::ostream &o, const vector<T, alloc>& m) { gmm::write(o,m); return o; }
 }
 namespace gmm {
 
-  template <typename T>
-  inline size_type nnz(const std::vector<T>& l) { return l.size(); }
+  template <typename T, typename alloc>
+  inline size_type nnz(const std::vector<T, alloc>& l) { return l.size(); }
 
   /* ********************************************************************* */
   /*		                                         		   */
@@ -90,6 +90,7 @@ namespace gmm {
 #include "gmm_precond_ilu.h"
 #include "gmm_precond_ilut.h"
 #include "gmm_precond_ilutp.h"
+#include "gmm_precond_amg.h"
 
 
 
@@ -33,7 +33,8 @@
    @author  Yves Renard <Yves.Renard@insa-lyon.fr>
    @date October 13, 2002.
     @brief Declaration of some matrix types (gmm::dense_matrix,
-    gmm::row_matrix, gmm::col_matrix, gmm::csc_matrix, etc.)
+    gmm::row_matrix, gmm::col_matrix, gmm::csc_matrix, gmm::bsr_matrix,
+    etc.)
 */
 
 #ifndef GMM_MATRIX_H__
@@ -788,6 +789,358 @@ namespace gmm
   inline void copy(const Matrix &A, csr_matrix<T, shift>& M)
   { M.init_with(A); }
 
+  /* ******************************************************************** */
+  /*                                                                      */
+  /*	        Block compressed sparse row matrix                        */
+  /*                                                                      */
+  /* ******************************************************************** */
+
+  // Sparse iterator on a row of a bsr_matrix, running over the
+  // corresponding row of each block of the block row.
+  template <typename T> struct bsr_vector_ref_iterator {
+    typedef unsigned int IND_TYPE;
+    const T *pr;          // current value
+    const IND_TYPE *ir;   // block column of the current block
+    size_type bs, c;      // block size, column in the current block
+
+    typedef T value_type;
+    typedef const T *pointer;
+    typedef const T &reference;
+    typedef ptrdiff_t difference_type;
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef bsr_vector_ref_iterator<T> iterator;
+
+    bsr_vector_ref_iterator(void) {}
+    bsr_vector_ref_iterator(const T *p, const IND_TYPE *i, size_type b)
+      : pr(p), ir(i), bs(b), c(0) {}
+
+    inline size_type index(void) const { return size_type(*ir) * bs + c; }
+    iterator &operator ++()
+    { ++pr; if (++c == bs) { c = 0; ++ir; pr += bs*bs - bs; } return *this; }
+    iterator operator ++(int) { iterator tmp = *this; ++(*this); return tmp; }
+    iterator &operator --()
+    { if (c == 0) { c = bs; --ir; pr -= bs*bs - bs; } --c; --pr; return *this; }
+    iterator operator --(int) { iterator tmp = *this; --(*this); return tmp; }
+
+    reference operator  *() const { return *pr; }
+    pointer   operator ->() const { return pr; }
+
+    bool operator ==(const iterator &i) const { return (i.ir==ir && i.c==c); }
+    bool operator !=(const iterator &i) const { return !(i == *this); }
+  };
+
+  // Read only reference on a row of a bsr_matrix.
+  template <typename T> struct bsr_vector_ref {
+    typedef unsigned int IND_TYPE;
+    const T *pr;          // first value of the row in the first block
+    const IND_TYPE *ir;   // block columns of the block row
+    size_type nb, bs, size_;
+
+    typedef T value_type;
+    typedef bsr_vector_ref_iterator<T> const_iterator;
+
+    bsr_vector_ref(const T *p, const IND_TYPE *i, size_type nnb,
+		   size_type b, size_type ns)
+      : pr(p), ir(i), nb(nnb), bs(b), size_(ns) {}
+    bsr_vector_ref(void) {}
+
+    size_type size(void) const { return size_; }
+
+    const_iterator begin(void) const { return const_iterator(pr, ir, bs); }
+    const_iterator end(void) const
+    { return const_iterator(pr + nb*bs*bs, ir + nb, bs); }
+
+    value_type operator[](size_type i) const {
+      const IND_TYPE *p = std::lower_bound(ir, ir + nb, IND_TYPE(i / bs));
+      return (p != ir + nb && *p == i / bs) ? pr[(p - ir)*bs*bs + i % bs]
+	                                    : value_type(0);
+    }
+  };
+
+  template <typename T> struct linalg_traits<bsr_vector_ref<T> > {
+    typedef bsr_vector_ref<T> this_type;
+    typedef linalg_const is_reference;
+    typedef abstract_vector linalg_type;
+    typedef T value_type;
+    typedef T origin_type;
+    typedef T reference;
+    typedef bsr_vector_ref_iterator<T> const_iterator;
+    typedef abstract_null_type iterator;
+    typedef abstract_sparse storage_type;
+    typedef linalg_true index_sorted;
+    static size_type size(const this_type &v) { return v.size(); }
+    static const_iterator begin(const this_type &v) { return v.begin(); }
+    static const_iterator end(const this_type &v) { return v.end(); }
+    static const origin_type* origin(const this_type &v) { return v.pr; }
+    static value_type access(const origin_type *, const const_iterator &b,
+			     const const_iterator &e, size_type i) {
+      const unsigned int *p = std::lower_bound(b.ir, e.ir, i / b.bs);
+      return (p != e.ir && *p == i / b.bs) ? b.pr[(p-b.ir)*b.bs*b.bs + i%b.bs]
+	                                   : value_type(0);
+    }
+  };
+
+  template <typename T> std::ostream &operator <<
+  (std::ostream &o, const bsr_vector_ref<T>& v)
+  { gmm::write(o,v); return o; }
+
+  template <typename T>
+  inline size_type nnz(const bsr_vector_ref<T>& l) { return l.nb * l.bs; }
+
+  template <typename T> struct bsr_matrix;
+
+  template <typename T> struct bsr_row_iterator {
+    typedef bsr_vector_ref<T> value_type;
+    typedef const value_type *pointer;
+    typedef const value_type &reference;
+    typedef ptrdiff_t difference_type;
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef bsr_row_iterator<T> iterator;
+
+    const bsr_matrix<T> *m;
+    size_type i;
+
+    iterator operator ++(int) { iterator tmp = *this; i++; return tmp; }
+    iterator operator --(int) { iterator tmp = *this; i--; return tmp; }
+    iterator &operator ++()   { i++; return *this; }
+    iterator &operator --()   { i--; return *this; }
+    iterator &operator +=(difference_type ii) { i += ii; return *this; }
+    iterator &operator -=(difference_type ii) { i -= ii; return *this; }
+    iterator operator +(difference_type ii) const
+    { iterator itt = *this; return (itt += ii); }
+    iterator operator -(difference_type ii) const
+    { iterator itt = *this; return (itt -= ii); }
+    difference_type operator -(const iterator &ii) const
+    { return difference_type(i) - difference_type(ii.i); }
+
+    bool operator ==(const iterator &ii) const { return ii.i == i; }
+    bool operator !=(const iterator &ii) const { return ii.i != i; }
+    bool operator < (const iterator &ii) const { return i < ii.i; }
+
+    bsr_row_iterator(void) {}
+    bsr_row_iterator(const bsr_matrix<T> *mm, size_type ii) : m(mm), i(ii) {}
+  };
+
+  /** Block compressed sparse row matrix: the matrix is cut into square
+      blocks of size bs, the non-zero blocks being stored by block rows as
+      dense bs x bs row major blocks. For vector fields whose components
+      are numbered consecutively for each node, the index overhead is
+      divided by bs*bs compared to a csr_matrix. The pattern of the blocks
+      is fixed by init_with or init_with_pattern, the values of the blocks
+      of the pattern being modified directly through block().
+  */
+  template <typename T>
+  struct bsr_matrix {
+    typedef unsigned int IND_TYPE;
+
+    std::vector<T> pr;        // values, by blocks of bs*bs stored by rows.
+    std::vector<IND_TYPE> ir; // block col indices.
+    std::vector<IND_TYPE> jc; // block row repartition on ir.
+    size_type nc, nr, bs;
+
+    typedef T value_type;
+    typedef T& access_type;
+
+    template <typename Matrix> void init_with(const Matrix &A, size_type b);
+    template <typename Matrix> void init_with(const Matrix &A)
+    { init_with(A, bs); }
+    /** Build the pattern (with zero values) from the sorted block columns
+	of each block row. */
+    template <typename VECT>
+    void init_with_pattern(size_type nnr, size_type nnc, size_type b,
+			   const std::vector<VECT> &rows);
+
+    /** Values of the block (ib, jb) or a null pointer if the block is not
+	in the pattern. */
+    T *block(size_type ib, size_type jb) {
+      auto itb = ir.begin() + jc[ib], ite = ir.begin() + jc[ib+1];
+      auto it = std::lower_bound(itb, ite, IND_TYPE(jb));
+      return (it != ite && *it == jb) ? &pr[(it - ir.begin())*bs*bs] : 0;
+    }
+    const T *block(size_type ib, size_type jb) const
+    { return const_cast<bsr_matrix<T> *>(this)->block(ib, jb); }
+
+    size_type block_size(void) const { return bs; }
+    size_type nb_blocks(void) const { return ir.size(); }
+    size_type nrows(void) const { return nr; }
+    size_type ncols(void) const { return nc; }
+    void do_clear(void) { std::fill(pr.begin(), pr.end(), T(0)); }
+    void swap(bsr_matrix<T> &m) {
+      std::swap(pr, m.pr);
+      std::swap(ir, m.ir); std::swap(jc, m.jc);
+      std::swap(nc, m.nc); std::swap(nr, m.nr); std::swap(bs, m.bs);
+    }
+
+    value_type operator()(size_type i, size_type j) const {
+      const T *p = block(i / bs, j / bs);
+      return p ? p[(i % bs) * bs + j % bs] : T(0);
+    }
+
+    bsr_matrix(void) : jc(1, 0), nc(0), nr(0), bs(1) {}
+    bsr_matrix(size_type nnr, size_type nnc, size_type b = 1)
+      : nc(nnc), nr(nnr), bs(b) {
+      GMM_ASSERT1(b > 0 && nr % b == 0 && nc % b == 0,
+		  "The dimensions should be multiples of the block size");
+      jc.assign(nr / bs + 1, 0);
+    }
+  };
+
+  template <typename T> template <typename VECT>
+  void bsr_matrix<T>::init_with_pattern(size_type nnr, size_type nnc,
+					size_type b,
+					const std::vector<VECT> &rows) {
+    GMM_ASSERT1(b > 0 && nnr % b == 0 && nnc % b == 0
+		&& rows.size() == nnr / b, "dimensions mismatch");
+    nr = nnr; nc = nnc; bs = b;
+    size_type nbr = nr / bs;
+    jc.resize(nbr + 1); jc[0] = 0;
+    for (size_type ib = 0; ib < nbr; ++ib)
+      jc[ib+1] = IND_TYPE(jc[ib] + rows[ib].size());
+    ir.resize(jc[nbr]);
+    for (size_type ib = 0; ib < nbr; ++ib)
+      std::copy(rows[ib].begin(), rows[ib].end(), ir.begin() + jc[ib]);
+    pr.assign(size_type(jc[nbr]) * bs * bs, T(0));
+  }
+
+  template <typename T> template <typename Matrix>
+  void bsr_matrix<T>::init_with(const Matrix &A, size_type b) {
+    size_type nnr = mat_nrows(A), nnc = mat_ncols(A);
+    GMM_ASSERT1(b > 0 && nnr % b == 0 && nnc % b == 0,
+		"The dimensions should be multiples of the block size");
+    row_matrix<wsvector<T> > B(nnr, nnc);
+    copy(A, B);
+    size_type nbr = nnr / b;
+    std::vector<std::vector<IND_TYPE> > rows(nbr);
+    std::vector<bool> mark(nnc / b, false);
+    for (size_type ib = 0; ib < nbr; ++ib) {
+      for (size_type i = ib * b; i < (ib+1) * b; ++i)
+	for (auto it = B.row(i).begin(); it != B.row(i).end(); ++it)
+	  if (!mark[it->first / b])
+	    { mark[it->first / b] = true; rows[ib].push_back(it->first / b); }
+      std::sort(rows[ib].begin(), rows[ib].end());
+      for (IND_TYPE jb : rows[ib]) mark[jb] = false;
+    }
+    init_with_pattern(nnr, nnc, b, rows);
+    for (size_type i = 0; i < nr; ++i)
+      for (auto it = B.row(i).begin(); it != B.row(i).end(); ++it)
+	block(i / bs, it->first / bs)[(i % bs)*bs + it->first % bs]
+	  = it->second;
+  }
+
+  template <typename T>
+  struct linalg_traits<bsr_matrix<T> > {
+    typedef bsr_matrix<T> this_type;
+    typedef linalg_const is_reference;
+    typedef abstract_matrix linalg_type;
+    typedef T value_type;
+    typedef T origin_type;
+    typedef T reference;
+    typedef abstract_sparse storage_type;
+    typedef abstract_null_type sub_col_type;
+    typedef abstract_null_type const_sub_col_type;
+    typedef abstract_null_type col_iterator;
+    typedef abstract_null_type const_col_iterator;
+    typedef abstract_null_type sub_row_type;
+    typedef bsr_vector_ref<T> const_sub_row_type;
+    typedef bsr_row_iterator<T> const_row_iterator;
+    typedef abstract_null_type row_iterator;
+    typedef row_major sub_orientation;
+    typedef linalg_true index_sorted;
+    static size_type nrows(const this_type &m) { return m.nrows(); }
+    static size_type ncols(const this_type &m) { return m.ncols(); }
+    static const_row_iterator row_begin(const this_type &m)
+    { return const_row_iterator(&m, 0); }
+    static const_row_iterator row_end(const this_type &m)
+    { return const_row_iterator(&m, m.nr); }
+    static const_sub_row_type row(const const_row_iterator &it) {
+      const this_type &m = *(it.m);
+      size_type ib = it.i / m.bs, k = m.jc[ib];
+      return const_sub_row_type(m.pr.data() + (k*m.bs + it.i%m.bs)*m.bs,
+				m.ir.data() + k, m.jc[ib+1] - k, m.bs, m.nc);
+    }
+    static const origin_type* origin(const this_type &m) { return m.pr.data(); }
+    static void do_clear(this_type &m) { m.do_clear(); }
+    static value_type access(const const_row_iterator &itrow, size_type j)
+    { return row(itrow)[j]; }
+  };
+
+  template <typename T>
+  std::ostream &operator << (std::ostream &o, const bsr_matrix<T>& m)
+  { gmm::write(o,m); return o; }
+
+  template <typename Matrix, typename T>
+  inline void copy(const Matrix &A, bsr_matrix<T>& M)
+  { M.init_with(A); }
+
+  // Direct conversion, used for instance by the SuperLU interface.
+  template <typename T, int shift>
+  void copy(const bsr_matrix<T> &A, csc_matrix<T, shift> &M) {
+    typedef typename csc_matrix<T, shift>::IND_TYPE IND_TYPE;
+    size_type bs = A.bs, bs2 = bs*bs, nbr = A.nr / bs;
+    M.nr = A.nr; M.nc = A.nc;
+    M.jc.assign(M.nc + 1, 0);
+    for (size_type k = 0; k < A.ir.size(); ++k)
+      for (size_type c = 0; c < bs; ++c)
+	M.jc[A.ir[k]*bs + c + 1] += IND_TYPE(bs);
+    M.jc[0] = shift;
+    for (size_type j = 0; j < M.nc; ++j) M.jc[j+1] += M.jc[j];
+    M.pr.resize(M.jc[M.nc] - shift); M.ir.resize(M.jc[M.nc] - shift);
+    std::vector<IND_TYPE> pos(M.jc.begin(), M.jc.end() - 1);
+    for (size_type ib = 0; ib < nbr; ++ib)
+      for (size_type r = 0; r < bs; ++r)
+	for (size_type k = A.jc[ib]; k < A.jc[ib+1]; ++k) {
+	  const T *p = &(A.pr[k*bs2 + r*bs]);
+	  for (size_type c = 0; c < bs; ++c) {
+	    IND_TYPE &q = pos[A.ir[k]*bs + c];
+	    M.pr[q - shift] = p[c]; M.ir[q - shift] = IND_TYPE(ib*bs+r+shift);
+	    ++q;
+	  }
+	}
+  }
+
+  // Product by block rows, multithreaded for large matrices.
+  template <typename T, typename L2, typename L3>
+  void mult_bsr_(const bsr_matrix<T> &A, const L2 &l2, L3 &l3, bool acc,
+		 abstract_dense) {
+    size_type bs = A.bs, bs2 = bs*bs;
+    int nbr = int(A.nr / bs);
+    auto itx = vect_const_begin(l2);
+    auto ity = vect_begin(l3);
+    bool th = use_threaded_kernels(A.nr);
+    #pragma omp parallel for schedule(dynamic, 256) if (th)
+    for (int ib = 0; ib < nbr; ++ib) {
+      size_type kb = A.jc[ib], ke = A.jc[ib+1];
+      for (size_type r = 0; r < bs; ++r) {
+	T s(0);
+	for (size_type k = kb; k < ke; ++k) {
+	  const T *p = &(A.pr[k*bs2 + r*bs]);
+	  auto itxb = itx + A.ir[k]*bs;
+	  for (size_type c = 0; c < bs; ++c) s += p[c] * *(itxb + c);
+	}
+	if (acc) *(ity + ib*bs + r) += s; else *(ity + ib*bs + r) = s;
+      }
+    }
+  }
+
+  template <typename T, typename L2, typename L3, typename STO>
+  void mult_bsr_(const bsr_matrix<T> &A, const L2 &l2, L3 &l3, bool acc,
+		 STO) {
+    for (size_type i = 0; i < A.nr; ++i) {
+      T s = vect_sp(mat_const_row(A, i), l2);
+      if (acc) l3[i] += s; else l3[i] = s;
+    }
+  }
+
+  template <typename T, typename L2, typename L3> inline
+  void mult_by_row(const bsr_matrix<T> &A, const L2 &l2, L3 &l3,
+		   abstract_dense)
+  { mult_bsr_(A, l2, l3, false, typename linalg_traits<L2>::storage_type()); }
+
+  template <typename T, typename L2, typename L3> inline
+  void mult_add_by_row(const bsr_matrix<T> &A, const L2 &l2, L3 &l3,
+		       abstract_dense)
+  { mult_bsr_(A, l2, l3, true, typename linalg_traits<L2>::storage_type()); }
+
   /* ******************************************************************** */
   /*		                                            		  */
   /*		Block matrix                                		  */
@@ -1191,6 +1544,9 @@ namespace std {
   template <typename T, int shift> void 
   swap(gmm::csr_matrix<T,shift> &m1, gmm::csr_matrix<T,shift> &m2)
   { m1.swap(m2); }
+  template <typename T> void
+  swap(gmm::bsr_matrix<T> &m1, gmm::bsr_matrix<T> &m2)
+  { m1.swap(m2); }
 }
 
 
@@ -61,7 +61,7 @@
 /**@file gmm_modified_gram_schmidt.h
    @author  Andrew Lumsdaine <lums@osl.iu.edu>, Lie-Quan Lee     <llee@osl.iu.edu>
    @date October 13, 2002.
-   @brief Modified Gram-Schmidt orthogonalization
+   @brief Modified and classical Gram-Schmidt orthogonalization
 */
 
 #ifndef GMM_MODIFIED_GRAM_SCHMIDT_H
@@ -122,6 +122,108 @@ namespace gmm {
   template <typename T, typename VecS, typename VecX>
   void combine(modified_gram_schmidt<T>& V, const VecS& s, VecX& x, size_t i)
   { for (size_t j = 0; j < i; ++j) gmm::add(gmm::scaled(V[j], s[j]), x); }
+
+  /* Same storage, but the new vector is orthogonalized by the classical
+     Gram-Schmidt algorithm, applied a second time only when the norm of
+     the vector is reduced by more than 0.7 (cancellation). The projections
+     on the whole basis and the norm of the vector are computed in a single
+     pass over the rows of the basis, by blocks of rows (multithreaded as
+     the kernels of gmm_blas.h): one reduction per iteration in general
+     instead of one per basis vector for the modified version. */
+  template <typename T>
+  class classical_gram_schmidt2 : public modified_gram_schmidt<T> {
+  public:
+    classical_gram_schmidt2(int restart, size_t s)
+      : modified_gram_schmidt<T>(restart, s) {}
+  };
+
+  /* h = V(:, 0..i)^H V(:, i+1) on the rows [j0, j1), |V(:, i+1)|^2.
+     The columns are taken four by four to load w once for them. */
+  template <typename T>
+  typename number_traits<T>::magnitude_type
+  cgs_project_(const T *V, size_type n, size_type i, T *h,
+	       size_type j0, size_type j1) {
+    typename number_traits<T>::magnitude_type nw2(0);
+    const T *w = V + (i+1) * n;
+    for (size_type j = j0; j < j1; ++j) nw2 += gmm::abs_sqr(w[j]);
+    size_type k = 0;
+    for (; k + 4 <= i+1; k += 4) {
+      const T *v0 = V + k * n, *v1 = v0 + n, *v2 = v1 + n, *v3 = v2 + n;
+      T a0(0), a1(0), a2(0), a3(0);
+      for (size_type j = j0; j < j1; ++j) {
+	T c = w[j];
+	a0 += gmm::conj(v0[j]) * c; a1 += gmm::conj(v1[j]) * c;
+	a2 += gmm::conj(v2[j]) * c; a3 += gmm::conj(v3[j]) * c;
+      }
+      h[k] = a0; h[k+1] = a1; h[k+2] = a2; h[k+3] = a3;
+    }
+    for (; k <= i; ++k) {
+      const T *v = V + k * n;
+      T a(0);
+      for (size_type j = j0; j < j1; ++j) a += gmm::conj(v[j]) * w[j];
+      h[k] = a;
+    }
+    return nw2;
+  }
+
+  /* V(:, i+1) -= V(:, 0..i) h on the rows [j0, j1). */
+  template <typename T>
+  void cgs_subtract_(T *V, size_type n, size_type i, const T *h,
+		     size_type j0, size_type j1) {
+    T *w = V + (i+1) * n;
+    size_type k = 0;
+    for (; k + 4 <= i+1; k += 4) {
+      const T *v0 = V + k * n, *v1 = v0 + n, *v2 = v1 + n, *v3 = v2 + n;
+      T a0 = h[k], a1 = h[k+1], a2 = h[k+2], a3 = h[k+3];
+      for (size_type j = j0; j < j1; ++j)
+	w[j] -= v0[j] * a0 + v1[j] * a1 + v2[j] * a2 + v3[j] * a3;
+    }
+    for (; k <= i; ++k) {
+      const T *v = V + k * n; T a = h[k];
+      for (size_type j = j0; j < j1; ++j) w[j] -= v[j] * a;
+    }
+  }
+
+  template <typename T, typename VecHi>
+  void orthogonalize(classical_gram_schmidt2<T>& V, const VecHi& Hi_,
+		     size_t i) {
+    typedef typename number_traits<T>::magnitude_type R;
+    VecHi& Hi = const_cast<VecHi&>(Hi_);
+    size_type n = V.nrows(), bs = threaded_kernels_block;
+    int nb = threaded_kernels_nb_blocks(n);
+    bool th = use_threaded_kernels(n);
+    T *pV = &(V.mat()(0, 0));
+    std::vector<T> h((i+1) * nb);
+    std::vector<R> nw2(nb);
+    for (size_type k = 0; k <= i; ++k) Hi[k] = T(0);
+
+    for (int pass = 0; pass < 2; ++pass) {
+      #pragma omp parallel for schedule(static) if (th)
+      for (int b = 0; b < nb; ++b)
+	nw2[b] = cgs_project_(pV, n, i, &h[b*(i+1)], size_type(b) * bs,
+			      std::min(n, size_type(b+1) * bs));
+      R nw(0), nh(0);
+      for (int b = 0; b < nb; ++b) nw += nw2[b];
+      for (int b = 1; b < nb; ++b)
+	for (size_type k = 0; k <= i; ++k) h[k] += h[b*(i+1)+k];
+      #pragma omp parallel for schedule(static) if (th)
+      for (int b = 0; b < nb; ++b)
+	cgs_subtract_(pV, n, i, &h[0], size_type(b) * bs,
+		      std::min(n, size_type(b+1) * bs));
+      for (size_type k = 0; k <= i; ++k)
+	{ Hi[k] += h[k]; nh += gmm::abs_sqr(h[k]); }
+      // |w - V h|^2 = |w|^2 - |h|^2 for an orthonormal basis.
+      if (nw - nh >= R(0.49) * nw) break;
+    }
+  }
+
+  template <typename T, typename VecS, typename VecX>
+  void combine(classical_gram_schmidt2<T>& V, const VecS& s, VecX& x,
+	       size_t i) {
+    gmm::mult_add(sub_matrix(V.mat(), sub_interval(0, V.nrows()),
+			     sub_interval(0, i)),
+		  sub_vector(s, sub_interval(0, i)), x);
+  }
 }
 
 #endif
@@ -0,0 +1,373 @@
+/* -*- c++ -*- (enables emacs c++ mode) */
+/*===========================================================================
+
+ Copyright (C) 2017-2017 Yves Renard
+
+ This file is a part of GetFEM++
+
+ GetFEM++  is  free software;  you  can  redistribute  it  and/or modify it
+ under  the  terms  of the  GNU  Lesser General Public License as published
+ by  the  Free Software Foundation;  either version 3 of the License,  or
+ (at your option) any later version along with the GCC Runtime Library
+ Exception either version 3.1 or (at your option) any later version.
+ This program  is  distributed  in  the  hope  that it will be useful,  but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ or  FITNESS  FOR  A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License and GCC Runtime Library Exception for more details.
+ You  should  have received a copy of the GNU Lesser General Public License
+ along  with  this program;  if not, write to the Free Software Foundation,
+ Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+
+ As a special exception, you  may use  this file  as it is a part of a free
+ software  library  without  restriction.  Specifically,  if   other  files
+ instantiate  templates  or  use macros or inline functions from this file,
+ or  you compile this  file  and  link  it  with other files  to produce an
+ executable, this file  does  not  by itself cause the resulting executable
+ to be covered  by the GNU Lesser General Public License.  This   exception
+ does not  however  invalidate  any  other  reasons why the executable file
+ might be covered by the GNU Lesser General Public License.
+
+===========================================================================*/
+
+/**@file gmm_precond_amg.h
+   @author  Yves Renard <Yves.Renard@insa-lyon.fr>
+   @date 2017.
+   @brief Smoothed aggregation algebraic multigrid preconditioner.
+*/
+
+#ifndef GMM_PRECOND_AMG_H
+#define GMM_PRECOND_AMG_H
+
+#include "gmm_precond.h"
+#include "gmm_dense_lu.h"
+
+namespace gmm {
+
+  /** Smoothed aggregation algebraic multigrid preconditioner.
+
+  The unknowns are grouped by blocks of block_size consecutive ones (the
+  components of a vector field on a node). The blocks are aggregated along
+  the strong connections of the matrix (|A_IJ| > theta sqrt(|A_II||A_JJ|)
+  for the Frobenius norm of the blocks). The tentative prolongator is
+  obtained by a local QR factorization of the near nullspace B (whose
+  columns are for instance the rigid body modes of an elasticity problem,
+  the default is the constant vector) on each aggregate and it is smoothed
+  by a damped Jacobi iteration. The coarse matrices are the Galerkin
+  products P^H A P. The application of the preconditioner is a V-cycle
+  with nb_smooth forward Gauss-Seidel sweeps before the coarse correction
+  and nb_smooth backward ones after, so that the preconditioner is
+  symmetric for a symmetric matrix and can be used with the conjugate
+  gradient. The coarsest level is solved by a dense LU factorization.
+  */
+  template <typename Matrix> class amg_precond {
+
+  public :
+    typedef typename linalg_traits<Matrix>::value_type value_type;
+    typedef typename number_traits<value_type>::magnitude_type magnitude_type;
+    typedef csr_matrix<value_type> level_matrix;
+
+    magnitude_type theta;  // Strength of connection threshold.
+    size_type max_levels, coarse_size, nb_smooth;
+
+  protected :
+    struct amg_level {
+      level_matrix A, P, R; // R is the conjugated transpose of P.
+      std::vector<value_type> diag;
+      mutable std::vector<value_type> x, b, r;
+    };
+    std::vector<amg_level> levels;
+    dense_matrix<value_type> coarse_LU;
+    std::vector<int> coarse_ipvt;
+    bool direct_coarse;
+
+    size_type aggregate(const level_matrix &A, size_type bs,
+                        std::vector<size_type> &agg) const;
+    void build_levels(dense_matrix<value_type> &B, size_type bs);
+    void gauss_seidel(const amg_level &L, bool forward) const;
+    void vcycle(size_type l) const;
+
+  public :
+
+    /** Build the hierarchy for the matrix A and the near nullspace B
+        (a matrix of nrows(A) lines). */
+    template <typename MAT2>
+    void build_with(const Matrix &A, const MAT2 &B, size_type bs = 1) {
+      levels.clear(); levels.resize(1);
+      levels[0].A.init_with(A);
+      dense_matrix<value_type> BB(mat_nrows(B), mat_ncols(B));
+      copy(B, BB);
+      GMM_ASSERT1(mat_nrows(BB) == mat_nrows(A) && mat_ncols(BB) > 0,
+                  "Wrong size of the near nullspace");
+      if (bs == 0 || mat_nrows(A) % bs != 0) {
+        GMM_WARNING2("Incompatible block size for the AMG, 1 is used");
+        bs = 1;
+      }
+      build_levels(BB, bs);
+    }
+    void build_with(const Matrix &A) {
+      dense_matrix<value_type> B(mat_nrows(A), 1);
+      std::fill(B.begin(), B.end(), value_type(1));
+      build_with(A, B);
+    }
+
+    /** Apply one V-cycle with a zero initial guess. */
+    template <typename V1, typename V2> void apply(const V1 &b, V2 &x) const {
+      copy(b, levels[0].b);
+      vcycle(0);
+      copy(levels[0].x, x);
+    }
+
+    size_type nb_levels() const { return levels.size(); }
+    size_type nrows(void) const { return mat_nrows(levels[0].A); }
+    size_type ncols(void) const { return mat_ncols(levels[0].A); }
+    size_type memsize() const {
+      size_type m = sizeof(*this)
+        + coarse_LU.size() * sizeof(value_type);
+      for (const amg_level &L : levels)
+        m += (nnz(L.A) + nnz(L.P) + nnz(L.R) + 4 * L.diag.size())
+          * (sizeof(value_type) + sizeof(unsigned));
+      return m;
+    }
+
+    amg_precond(const Matrix &A) : theta(0.08), max_levels(10),
+      coarse_size(500), nb_smooth(1), direct_coarse(false)
+    { build_with(A); }
+    template <typename MAT2>
+    amg_precond(const Matrix &A, const MAT2 &B, size_type bs = 1)
+      : theta(0.08), max_levels(10), coarse_size(500), nb_smooth(1),
+        direct_coarse(false)
+    { build_with(A, B, bs); }
+    amg_precond(void) : theta(0.08), max_levels(10), coarse_size(500),
+      nb_smooth(1), direct_coarse(false) {}
+  };
+
+  /* Aggregation of the blocks along the strong connections. Return the
+     number of aggregates, agg[I] is the aggregate of the block I or
+     size_type(-1) for an isolated block. */
+  template <typename Matrix>
+  size_type amg_precond<Matrix>::aggregate(const level_matrix &A,
+                                           size_type bs,
+                                           std::vector<size_type> &agg)
+    const {
+    typedef magnitude_type R;
+    const size_type none = size_type(-1);
+    size_type nn = mat_nrows(A) / bs;
+
+    // Frobenius norms of the blocks.
+    std::vector<size_type> ptr(nn+1, 0), ind;
+    std::vector<R> val, sdiag(nn, R(0)), acc(nn, R(0));
+    std::vector<size_type> list;
+    for (size_type I = 0; I < nn; ++I) {
+      list.resize(0);
+      for (size_type i = I*bs; i < (I+1)*bs; ++i)
+        for (size_type k = A.jc[i]; k < A.jc[i+1]; ++k) {
+          size_type J = A.ir[k] / bs;
+          if (acc[J] == R(0)) list.push_back(J);
+          acc[J] += gmm::abs_sqr(A.pr[k]) + default_min(R());
+        }
+      for (size_type J : list) {
+        if (J == I) sdiag[I] = gmm::sqrt(acc[J]);
+        else { ind.push_back(J); val.push_back(gmm::sqrt(acc[J])); }
+        acc[J] = R(0);
+      }
+      ptr[I+1] = ind.size();
+    }
+
+    // Strong connections.
+    std::vector<size_type> sptr(nn+1, 0), sind;
+    for (size_type I = 0; I < nn; ++I) {
+      for (size_type k = ptr[I]; k < ptr[I+1]; ++k)
+        if (val[k] > theta * gmm::sqrt(sdiag[I] * sdiag[ind[k]]))
+          sind.push_back(ind[k]);
+      sptr[I+1] = sind.size();
+    }
+
+    agg.assign(nn, none);
+    size_type nagg = 0;
+    // Pass 1: blocks whose strong neighbours are all free.
+    for (size_type I = 0; I < nn; ++I) {
+      if (sptr[I] == sptr[I+1] || agg[I] != none) continue;
+      bool free = true;
+      for (size_type k = sptr[I]; k < sptr[I+1] && free; ++k)
+        free = (agg[sind[k]] == none);
+      if (free) {
+        agg[I] = nagg;
+        for (size_type k = sptr[I]; k < sptr[I+1]; ++k) agg[sind[k]] = nagg;
+        ++nagg;
+      }
+    }
+    // Pass 2: remaining blocks join a neighbouring aggregate.
+    std::vector<size_type> agg1(agg);
+    for (size_type I = 0; I < nn; ++I)
+      if (agg[I] == none)
+        for (size_type k = sptr[I]; k < sptr[I+1]; ++k)
+          if (agg1[sind[k]] != none) { agg[I] = agg1[sind[k]]; break; }
+    // Pass 3: new aggregates with the still free blocks.
+    for (size_type I = 0; I < nn; ++I)
+      if (agg[I] == none && sptr[I] != sptr[I+1]) {
+        agg[I] = nagg;
+        for (size_type k = sptr[I]; k < sptr[I+1]; ++k)
+          if (agg[sind[k]] == none) agg[sind[k]] = nagg;
+        ++nagg;
+      }
+    return nagg;
+  }
+
+  template <typename Matrix>
+  void amg_precond<Matrix>::build_levels(dense_matrix<value_type> &B,
+                                         size_type bs) {
+    typedef value_type T;
+    typedef magnitude_type R;
+    const size_type none = size_type(-1);
+    size_type nk = mat_ncols(B);
+
+    for (;;) {
+      amg_level &L = levels.back();
+      size_type n = mat_nrows(L.A);
+      L.diag.resize(n); L.x.resize(n); L.b.resize(n); L.r.resize(n);
+      for (size_type i = 0; i < n; ++i) {
+        L.diag[i] = T(0);
+        for (size_type k = L.A.jc[i]; k < L.A.jc[i+1]; ++k)
+          if (L.A.ir[k] == i) L.diag[i] = L.A.pr[k];
+        if (L.diag[i] == T(0)) L.diag[i] = T(1);
+      }
+      if (n <= coarse_size || levels.size() >= max_levels) break;
+
+      std::vector<size_type> agg;
+      size_type nagg = aggregate(L.A, bs, agg), nc = nagg * nk;
+      if (nagg == 0 || nc >= n) break;
+
+      // Tentative prolongator by a QR factorization of B on each
+      // aggregate (modified Gram-Schmidt).
+      std::vector<size_type> aptr(nagg+1, 0), arows(n);
+      for (size_type I = 0; I < agg.size(); ++I)
+        if (agg[I] != none) aptr[agg[I]+1] += bs;
+      for (size_type a = 0; a < nagg; ++a) aptr[a+1] += aptr[a];
+      std::vector<size_type> apos(aptr.begin(), aptr.end()-1);
+      for (size_type I = 0; I < agg.size(); ++I)
+        if (agg[I] != none)
+          for (size_type i = I*bs; i < (I+1)*bs; ++i)
+            arows[apos[agg[I]]++] = i;
+
+      row_matrix<wsvector<T> > Pt(n, nc);
+      dense_matrix<T> Bc(nc, nk);
+      for (size_type a = 0; a < nagg; ++a) {
+        size_type m = aptr[a+1] - aptr[a];
+        dense_matrix<T> Q(m, nk);
+        for (size_type i = 0; i < m; ++i)
+          for (size_type c = 0; c < nk; ++c) Q(i, c) = B(arows[aptr[a]+i], c);
+        for (size_type c = 0; c < nk; ++c) {
+          R nc0 = vect_norm2(mat_col(Q, c));
+          for (size_type p = 0; p < c; ++p) {
+            T r = vect_hp(mat_col(Q, c), mat_col(Q, p));
+            add(scaled(mat_col(Q, p), -r), mat_col(Q, c));
+            Bc(a*nk+p, c) = r;
+          }
+          R rcc = vect_norm2(mat_col(Q, c));
+          if (rcc <= R(1E-10) * nc0 || rcc == R(0))
+            clear(mat_col(Q, c)); // Locally dependent column.
+          else {
+            scale(mat_col(Q, c), T(1)/rcc);
+            Bc(a*nk+c, c) = T(rcc);
+          }
+        }
+        for (size_type i = 0; i < m; ++i)
+          for (size_type c = 0; c < nk; ++c)
+            if (Q(i, c) != T(0)) Pt(arows[aptr[a]+i], a*nk+c) = Q(i, c);
+      }
+
+      // Estimation of the spectral radius of D^{-1}A by power iterations.
+      std::vector<T> v(n), w(n);
+      for (size_type i = 0; i < n; ++i) v[i] = T(R(1) + R(i % 7) / R(7));
+      R rho(0);
+      for (size_type it = 0; it < 15; ++it) {
+        R nv = vect_norm2(v);
+        if (nv == R(0)) break;
+        scale(v, T(1)/nv);
+        mult(L.A, v, w);
+        for (size_type i = 0; i < n; ++i) w[i] /= L.diag[i];
+        rho = vect_norm2(w);
+        std::swap(v, w);
+      }
+      if (rho == R(0)) rho = R(1);
+
+      // Smoothed prolongator P = (I - omega D^{-1} A) Pt.
+      R omega = R(4) / (R(3) * rho);
+      row_matrix<wsvector<T> > AP(n, nc);
+      mult(L.A, Pt, AP);
+      for (size_type i = 0; i < n; ++i)
+        add(scaled(mat_row(AP, i), -T(omega) / L.diag[i]), mat_row(Pt, i));
+      L.P.init_with(Pt);
+      L.R.init_with(conjugated(Pt));
+
+      // Galerkin coarse matrix.
+      row_matrix<wsvector<T> > AP2(n, nc), Ac(nc, nc);
+      mult(L.A, L.P, AP2);
+      mult(L.R, AP2, Ac);
+      for (size_type i = 0; i < nc; ++i)
+        if (Ac(i, i) == T(0)) Ac(i, i) = T(1); // Dropped local mode.
+
+      levels.push_back(amg_level());
+      levels.back().A.init_with(Ac);
+      gmm::resize(B, nc, nk); copy(Bc, B);
+      bs = nk;
+    }
+
+    const amg_level &C = levels.back();
+    size_type n = mat_nrows(C.A);
+    direct_coarse = (n <= 5000);
+    if (direct_coarse) {
+      gmm::resize(coarse_LU, n, n); gmm::clear(coarse_LU);
+      copy(C.A, coarse_LU);
+      coarse_ipvt.resize(n);
+      if (lu_factor(coarse_LU, coarse_ipvt)) {
+        GMM_WARNING2("Singular AMG coarse matrix, Gauss-Seidel is used");
+        direct_coarse = false;
+      }
+    }
+    if (!direct_coarse) { gmm::resize(coarse_LU, 0, 0); coarse_ipvt.clear(); }
+  }
+
+  template <typename Matrix>
+  void amg_precond<Matrix>::gauss_seidel(const amg_level &L,
+                                         bool forward) const {
+    size_type n = L.diag.size();
+    for (size_type ii = 0; ii < n; ++ii) {
+      size_type i = forward ? ii : n-1-ii;
+      value_type s = L.b[i];
+      for (size_type k = L.A.jc[i]; k < L.A.jc[i+1]; ++k)
+        s -= L.A.pr[k] * L.x[L.A.ir[k]];
+      L.x[i] += s / L.diag[i];
+    }
+  }
+
+  template <typename Matrix>
+  void amg_precond<Matrix>::vcycle(size_type l) const {
+    const amg_level &L = levels[l];
+    clear(L.x);
+    if (l+1 == levels.size()) {
+      if (direct_coarse)
+        lu_solve(coarse_LU, coarse_ipvt, L.x, L.b);
+      else
+        for (size_type i = 0; i < 10; ++i)
+          { gauss_seidel(L, true); gauss_seidel(L, false); }
+      return;
+    }
+    for (size_type i = 0; i < nb_smooth; ++i) gauss_seidel(L, true);
+    mult(L.A, scaled(L.x, value_type(-1)), L.b, L.r);
+    mult(L.R, L.r, levels[l+1].b);
+    vcycle(l+1);
+    mult_add(L.P, levels[l+1].x, L.x);
+    for (size_type i = 0; i < nb_smooth; ++i) gauss_seidel(L, false);
+  }
+
+  template <typename Matrix, typename V1, typename V2> inline
+  void mult(const amg_precond<Matrix>& P, const V1 &v1, V2 &v2) {
+    GMM_ASSERT2(P.nrows() == vect_size(v2), "dimensions mismatch");
+    P.apply(v1, v2);
+  }
+
+}
+
+#endif
+
@@ -98,6 +98,9 @@ namespace gmm {
     typedef csr_matrix_ref<value_type *, size_type *, size_type *, 0> tm_type;
 
     tm_type U;
+    // Level scheduled solves with U^H and U, built for the multithreaded
+    // kernels (see use_threaded_kernels()).
+    leveled_tri_matrix<value_type> L_lev, U_lev;
 
   protected :
     std::vector<value_type> Tri_val;
@@ -105,8 +108,16 @@ namespace gmm {
  
     template<typename M> void do_ildlt(const M& A, row_major);
     void do_ildlt(const Matrix& A, col_major);
+    void build_levels(size_type n) {
+      L_lev.clear(); U_lev.clear();
+      if (n == 0 || !use_threaded_kernels(n)) return;
+      L_lev.build_with(gmm::conjugated(U), true, true);
+      U_lev.build_with(U, false, true);
+    }
 
   public:
+    bool use_levels(void) const
+    { return !L_lev.empty() && use_threaded_kernels(L_lev.nrows()); }
 
     size_type nrows(void) const { return mat_nrows(U); }
     size_type ncols(void) const { return mat_ncols(U); }
@@ -117,12 +128,14 @@ namespace gmm {
       Tri_ptr.resize(mat_nrows(A)+1);
       do_ildlt(A, typename principal_orientation_type<typename
 		  linalg_traits<Matrix>::sub_orientation>::potype());
+      build_levels(mat_nrows(A));
     }
     ildlt_precond(const Matrix& A)  { build_with(A); }
     size_type memsize() const { 
       return sizeof(*this) + 
 	Tri_val.size() * sizeof(value_type) + 
-	(Tri_ind.size()+Tri_ptr.size()) * sizeof(size_type); 
+	(Tri_ind.size()+Tri_ptr.size()) * sizeof(size_type) +
+	L_lev.memsize() + U_lev.memsize();
     }
   };
 
@@ -201,9 +214,11 @@ namespace gmm {
   template <typename Matrix, typename V1, typename V2> inline
   void mult(const ildlt_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     gmm::copy(v1, v2);
-    gmm::lower_tri_solve(gmm::conjugated(P.U), v2, true);
+    if (P.use_levels()) P.L_lev.solve(v2);
+    else gmm::lower_tri_solve(gmm::conjugated(P.U), v2, true);
     for (size_type i = 0; i < mat_nrows(P.U); ++i) v2[i] /= P.D(i);
-    gmm::upper_tri_solve(P.U, v2, true);
+    if (P.use_levels()) P.U_lev.solve(v2);
+    else gmm::upper_tri_solve(P.U, v2, true);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
@@ -213,13 +228,17 @@ namespace gmm {
   template <typename Matrix, typename V1, typename V2> inline
   void left_mult(const ildlt_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     copy(v1, v2);
-    gmm::lower_tri_solve(gmm::conjugated(P.U), v2, true);
+    if (P.use_levels()) P.L_lev.solve(v2);
+    else gmm::lower_tri_solve(gmm::conjugated(P.U), v2, true);
     for (size_type i = 0; i < mat_nrows(P.U); ++i) v2[i] /= P.D(i);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
-  void right_mult(const ildlt_precond<Matrix>& P, const V1 &v1, V2 &v2)
-  { copy(v1, v2); gmm::upper_tri_solve(P.U, v2, true);  }
+  void right_mult(const ildlt_precond<Matrix>& P, const V1 &v1, V2 &v2) {
+    copy(v1, v2);
+    if (P.use_levels()) P.U_lev.solve(v2);
+    else gmm::upper_tri_solve(P.U, v2, true);
+  }
 
   template <typename Matrix, typename V1, typename V2> inline
   void transposed_left_mult(const ildlt_precond<Matrix>& P, const V1 &v1,
@@ -91,17 +91,35 @@ namespace gmm {
 
     tm_type U, L;
     bool invert;
+    // Level scheduled lower and upper solves of mult, built for the
+    // multithreaded kernels (see use_threaded_kernels()).
+    leveled_tri_matrix<value_type> L_lev, U_lev;
   protected :
     std::vector<value_type> L_val, U_val;
     std::vector<size_type> L_ind, U_ind, L_ptr, U_ptr;
  
     template<typename M> void do_ilu(const M& A, row_major);
     void do_ilu(const Matrix& A, col_major);
+    void eliminate_row(size_type i);
+    void build_levels(size_type n) {
+      L_lev.clear(); U_lev.clear();
+      if (n == 0 || !use_threaded_kernels(n)) return;
+      if (invert) {
+	L_lev.build_with(gmm::transposed(U), true, false);
+	U_lev.build_with(gmm::transposed(L), false, true);
+      }
+      else {
+	L_lev.build_with(L, true, true);
+	U_lev.build_with(U, false, false);
+      }
+    }
 
   public:
     
     size_type nrows(void) const { return mat_nrows(L); }
     size_type ncols(void) const { return mat_ncols(U); }
+    bool use_levels(void) const
+    { return !L_lev.empty() && use_threaded_kernels(L_lev.nrows()); }
     
     void build_with(const Matrix& A) {
       invert = false;
@@ -109,6 +127,7 @@ namespace gmm {
        U_ptr.resize(mat_nrows(A)+1);
        do_ilu(A, typename principal_orientation_type<typename
 	      linalg_traits<Matrix>::sub_orientation>::potype());
+       build_levels(mat_nrows(A));
     }
     ilu_precond(const Matrix& A) { build_with(A); }
     ilu_precond(void) {}
@@ -116,7 +135,8 @@ namespace gmm {
       return sizeof(*this) + 
 	(L_val.size()+U_val.size()) * sizeof(value_type) + 
 	(L_ind.size()+L_ptr.size()) * sizeof(size_type) +
-	(U_ind.size()+U_ptr.size()) * sizeof(size_type); 
+	(U_ind.size()+U_ptr.size()) * sizeof(size_type) +
+	L_lev.memsize() + U_lev.memsize();
     }
   };
 
@@ -173,43 +193,65 @@ namespace gmm {
       GMM_WARNING2("pivot 0 is too small");
     }
 
-    size_type qn, pn, rn;
+    // The elimination of a row does not modify the other rows, so that the
+    // pivots only depend on the diagonal of A and are checked first.
     for (i = 1; i < n; i++) {
-
-      pn = U_ptr[i];
+      size_type pn = U_ptr[i];
       if (gmm::abs(U_val[pn]) <= max_pivot) {
 	U_val[pn] = T(1);
 	GMM_WARNING2("pivot " << i << " is too small");
       }
       max_pivot = std::max(max_pivot,
 			   std::min(gmm::abs(U_val[pn]) * prec, R(1)));
+    }
 
-      for (j = L_ptr[i]; j < L_ptr[i+1]; j++) {
-	pn = U_ptr[L_ind[j]];
-	
-	T multiplier = (L_val[j] /= U_val[pn]);
-	
-	qn = j + 1;
-	rn = U_ptr[i];
-	
-	for (pn++; pn < U_ptr[L_ind[j]+1] && U_ind[pn] < i; pn++) {
-	  while (qn < L_ptr[i+1] && L_ind[qn] < U_ind[pn])
-	    qn++;
-	  if (qn < L_ptr[i+1] && U_ind[pn] == L_ind[qn])
-	    L_val[qn] -= multiplier * U_val[pn];
-	}
-	for (; pn < U_ptr[L_ind[j]+1]; pn++) {
-	  while (rn < U_ptr[i+1] && U_ind[rn] < U_ind[pn])
-	    rn++;
-	  if (rn < U_ptr[i+1] && U_ind[pn] == U_ind[rn])
-	    U_val[rn] -= multiplier * U_val[pn];
+    // A row only depends on the rows of its lower part, the rows of a same
+    // level of L are eliminated in parallel.
+    if (use_threaded_kernels(n)) {
+      std::vector<size_type> lev_ptr, lev_rows;
+      tri_solve_levels(L_ptr, L_ind, n, true, lev_ptr, lev_rows);
+      for (size_type l = 0; l+1 < lev_ptr.size(); ++l) {
+	int b = int(lev_ptr[l]), e = int(lev_ptr[l+1]);
+	if (size_type(e - b) >= tri_solve_levels_min_size) {
+	  #pragma omp parallel for schedule(dynamic, 64)
+	  for (int r = b; r < e; ++r) eliminate_row(lev_rows[r]);
 	}
+	else
+	  for (int r = b; r < e; ++r) eliminate_row(lev_rows[r]);
       }
     }
+    else
+      for (i = 1; i < n; i++) eliminate_row(i);
 
     L = tm_type(&(L_val[0]), &(L_ind[0]), &(L_ptr[0]), n, mat_ncols(A));
     U = tm_type(&(U_val[0]), &(U_ind[0]), &(U_ptr[0]), n, mat_ncols(A));
   }
+
+  template <typename Matrix>
+  void ilu_precond<Matrix>::eliminate_row(size_type i) {
+    size_type qn, pn, rn;
+    for (size_type j = L_ptr[i]; j < L_ptr[i+1]; j++) {
+      pn = U_ptr[L_ind[j]];
+      
+      value_type multiplier = (L_val[j] /= U_val[pn]);
+      
+      qn = j + 1;
+      rn = U_ptr[i];
+      
+      for (pn++; pn < U_ptr[L_ind[j]+1] && U_ind[pn] < i; pn++) {
+	while (qn < L_ptr[i+1] && L_ind[qn] < U_ind[pn])
+	  qn++;
+	if (qn < L_ptr[i+1] && U_ind[pn] == L_ind[qn])
+	  L_val[qn] -= multiplier * U_val[pn];
+      }
+      for (; pn < U_ptr[L_ind[j]+1]; pn++) {
+	while (rn < U_ptr[i+1] && U_ind[rn] < U_ind[pn])
+	  rn++;
+	if (rn < U_ptr[i+1] && U_ind[pn] == U_ind[rn])
+	  U_val[rn] -= multiplier * U_val[pn];
+      }
+    }
+  }
   
   template <typename Matrix>
   void ilu_precond<Matrix>::do_ilu(const Matrix& A, col_major) {
@@ -220,7 +262,11 @@ namespace gmm {
   template <typename Matrix, typename V1, typename V2> inline
   void mult(const ilu_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     gmm::copy(v1, v2);
-    if (P.invert) {
+    if (P.use_levels()) {
+      P.L_lev.solve(v2);
+      P.U_lev.solve(v2);
+    }
+    else if (P.invert) {
       gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
       gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
     }
@@ -246,14 +292,16 @@ namespace gmm {
   template <typename Matrix, typename V1, typename V2> inline
   void left_mult(const ilu_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     copy(v1, v2);
-    if (P.invert) gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
+    if (P.use_levels()) P.L_lev.solve(v2);
+    else if (P.invert) gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
     else gmm::lower_tri_solve(P.L, v2, true);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void right_mult(const ilu_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     copy(v1, v2);
-    if (P.invert) gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
+    if (P.use_levels()) P.U_lev.solve(v2);
+    else if (P.invert) gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
     else gmm::upper_tri_solve(P.U, v2, false);
   }
 
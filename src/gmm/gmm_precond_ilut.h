@@ -108,6 +108,9 @@ namespace gmm {
 
     bool invert;
     LU_Matrix L, U;
+    // Level scheduled lower and upper solves of mult, built for the
+    // multithreaded kernels (see use_threaded_kernels()).
+    leveled_tri_matrix<value_type> L_lev, U_lev;
 
   protected:
     size_type K;
@@ -115,8 +118,23 @@ namespace gmm {
 
     template<typename M> void do_ilut(const M&, row_major);
     void do_ilut(const Matrix&, col_major);
+    void build_levels(size_type n) {
+      L_lev.clear(); U_lev.clear();
+      if (n == 0 || !use_threaded_kernels(n)) return;
+      if (invert) {
+	L_lev.build_with(gmm::transposed(U), true, false);
+	U_lev.build_with(gmm::transposed(L), false, true);
+      }
+      else {
+	L_lev.build_with(L, true, true);
+	U_lev.build_with(U, false, false);
+      }
+    }
 
   public:
+    bool use_levels(void) const
+    { return !L_lev.empty() && use_threaded_kernels(L_lev.nrows()); }
+
     void build_with(const Matrix& A, int k_ = -1, double eps_ = double(-1)) {
       if (k_ >= 0) K = k_;
       if (eps_ >= double(0)) eps = eps_;
@@ -125,6 +143,7 @@ namespace gmm {
       gmm::resize(U, mat_nrows(A), mat_ncols(A));
       do_ilut(A, typename principal_orientation_type<typename
 	      linalg_traits<Matrix>::sub_orientation>::potype());
+      build_levels(mat_nrows(A));
     }
     ilut_precond(const Matrix& A, int k_, double eps_) 
       : L(mat_nrows(A), mat_ncols(A)), U(mat_nrows(A), mat_ncols(A)),
@@ -132,7 +151,8 @@ namespace gmm {
     ilut_precond(size_type k_, double eps_) :  K(k_), eps(eps_) {}
     ilut_precond(void) { K = 10; eps = 1E-7; }
     size_type memsize() const { 
-      return sizeof(*this) + (nnz(U)+nnz(L))*sizeof(value_type);
+      return sizeof(*this) + (nnz(U)+nnz(L))*sizeof(value_type)
+	+ L_lev.memsize() + U_lev.memsize();
     }
   };
 
@@ -204,7 +224,11 @@ namespace gmm {
   template <typename Matrix, typename V1, typename V2> inline
   void mult(const ilut_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     gmm::copy(v1, v2);
-    if (P.invert) {
+    if (P.use_levels()) {
+      P.L_lev.solve(v2);
+      P.U_lev.solve(v2);
+    }
+    else if (P.invert) {
       gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
       gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
     }
@@ -230,14 +254,16 @@ namespace gmm {
   template <typename Matrix, typename V1, typename V2> inline
   void left_mult(const ilut_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     copy(v1, v2);
-    if (P.invert) gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
+    if (P.use_levels()) P.L_lev.solve(v2);
+    else if (P.invert) gmm::lower_tri_solve(gmm::transposed(P.U), v2, false);
     else gmm::lower_tri_solve(P.L, v2, true);
   }
 
   template <typename Matrix, typename V1, typename V2> inline
   void right_mult(const ilut_precond<Matrix>& P, const V1 &v1, V2 &v2) {
     copy(v1, v2);
-    if (P.invert) gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
+    if (P.use_levels()) P.U_lev.solve(v2);
+    else if (P.invert) gmm::upper_tri_solve(gmm::transposed(P.L), v2, true);
     else gmm::upper_tri_solve(P.U, v2, false);
   }
 
@@ -310,11 +310,34 @@ namespace gmm {
   { scale(linalg_const_cast(l), a); }
 
   template <typename L> inline
-  void scale(L& l, typename linalg_traits<L>::value_type a, abstract_vector) {
+  void scale(L& l, typename linalg_traits<L>::value_type a, abstract_vector)
+  { scale_vect_(l, a, typename linalg_traits<L>::storage_type()); }
+
+  template <typename L, typename STO> inline
+  void scale_vect_(L& l, typename linalg_traits<L>::value_type a, STO) {
     typename linalg_traits<L>::iterator it = vect_begin(l), ite = vect_end(l);
     for ( ; it != ite; ++it) *it *= a;
   }
 
+  template <typename L>
+  void scale_vect_(L& l, typename linalg_traits<L>::value_type a,
+		   abstract_dense) {
+    typename linalg_traits<L>::iterator it = vect_begin(l), ite = vect_end(l);
+    size_type n = ite - it;
+    if (use_threaded_kernels(n)) {
+      int nb = threaded_kernels_nb_blocks(n);
+      #pragma omp parallel for schedule(static)
+      for (int b = 0; b < nb; ++b) {
+	size_type i0 = size_type(b) * threaded_kernels_block;
+	size_type i1 = std::min(n, i0 + threaded_kernels_block);
+	typename linalg_traits<L>::iterator itb = it + i0, iteb = it + i1;
+	for ( ; itb != iteb; ++itb) *itb *= a;
+      }
+    }
+    else
+      for ( ; it != ite; ++it) *it *= a;
+  }
+
   template <typename L> 
   void scale(L& l, typename linalg_traits<L>::value_type a, abstract_matrix) {
     scale(l, a, typename principal_orientation_type<typename
@@ -66,7 +66,7 @@
    @author  Lie-Quan Lee <llee@osl.iu.edu>
    @author  Yves Renard <Yves.Renard@insa-lyon.fr>
    @date October 13, 2002.
-   @brief Conjugate gradient iterative solver. 
+   @brief Conjugate gradient iterative solver, standard and pipelined.
 */
 #ifndef GMM_SOLVER_CG_H__
 #define GMM_SOLVER_CG_H__
@@ -174,6 +174,137 @@ namespace gmm {
 	 const Precond &P, iteration &iter)
   { cg(A, x , b , identity_matrix(), P , iter); }
 
+  /* ******************************************************************** */
+  /*		pipelined conjugate gradient                       	  */
+  /* ******************************************************************** */
+  /* Variant of P. Ghysels and W. Vanroose (Parallel Computing 40, 2014): */
+  /* the scalar products of an iteration are computed in a single pass    */
+  /* over the vectors, and the preconditioner and the matrix-vector       */
+  /* product of the iteration do not depend on them. All the vector       */
+  /* updates are also done in a single pass: one reduction and one update */
+  /* per iteration instead of three of each for cg.                       */
+
+  template <typename T> struct pipelined_cg_vectors_ {
+    typedef typename number_traits<T>::magnitude_type R;
+    std::vector<T> x, r, u, w, m, n, z, q, s, p;
+
+    void reduce_(size_type i0, size_type i1, T &gamma, T &delta,
+		 R &nr2) const {
+      gamma = delta = T(0); nr2 = R(0);
+      for (size_type i = i0; i < i1; ++i) {
+	gamma += u[i] * gmm::conj(r[i]);
+	delta += w[i] * gmm::conj(u[i]);
+	nr2 += gmm::abs_sqr(r[i]);
+      }
+    }
+
+    void update_(size_type i0, size_type i1, T alpha, T beta) {
+      for (size_type i = i0; i < i1; ++i) {
+	z[i] = n[i] + beta * z[i]; q[i] = m[i] + beta * q[i];
+	s[i] = w[i] + beta * s[i]; p[i] = u[i] + beta * p[i];
+	x[i] += alpha * p[i]; r[i] -= alpha * s[i];
+	u[i] -= alpha * q[i]; w[i] -= alpha * z[i];
+      }
+    }
+
+    /* (r, u), (w, u) and |r|^2, the partial sums are done by blocks of
+       threaded_kernels_block components as in gmm_blas.h. */
+    void reduce(T &gamma, T &delta, R &nr2) const {
+      size_type N = x.size(), bs = threaded_kernels_block;
+      int nb = threaded_kernels_nb_blocks(N);
+      bool th = use_threaded_kernels(N);
+      std::vector<T> g(nb), d(nb);
+      std::vector<R> nr(nb);
+      #pragma omp parallel for schedule(static) if (th)
+      for (int b = 0; b < nb; ++b)
+	reduce_(size_type(b) * bs, std::min(N, size_type(b+1) * bs),
+		g[b], d[b], nr[b]);
+      gamma = delta = T(0); nr2 = R(0);
+      for (int b = 0; b < nb; ++b)
+	{ gamma += g[b]; delta += d[b]; nr2 += nr[b]; }
+    }
+
+    void update(T alpha, T beta) {
+      size_type N = x.size(), bs = threaded_kernels_block;
+      int nb = threaded_kernels_nb_blocks(N);
+      bool th = use_threaded_kernels(N);
+      #pragma omp parallel for schedule(static) if (th)
+      for (int b = 0; b < nb; ++b)
+	update_(size_type(b) * bs, std::min(N, size_type(b+1) * bs),
+		alpha, beta);
+    }
+
+    pipelined_cg_vectors_(size_type N)
+      : x(N), r(N), u(N), w(N), m(N), n(N), z(N), q(N), s(N), p(N) {}
+  };
+
+  /** Pipelined preconditioned conjugate gradient. Mathematically
+      equivalent to cg (with the euclidean scalar product). The residual
+      and the products by the matrix are computed by recurrence, which
+      lowers the attainable accuracy on badly conditioned problems. They
+      are replaced by the true ones every replacement_period iterations
+      and when the recurrent residual is converged (the iterations go on
+      if the true residual is not converged but still decreases).
+  */
+  template <typename Matrix, typename Precond,
+            typename Vector1, typename Vector2>
+  void pipelined_cg(const Matrix& A, Vector1& x, const Vector2& b,
+		    const Precond &P, iteration &iter,
+		    size_type replacement_period = 50) {
+
+    typedef typename linalg_traits<Vector1>::value_type T;
+    typedef typename number_traits<T>::magnitude_type R;
+
+    iter.set_rhsnorm(gmm::vect_norm2(b));
+    if (iter.get_rhsnorm() == 0.0) { clear(x); return; }
+
+    pipelined_cg_vectors_<T> v(vect_size(x));
+    copy(x, v.x);
+    T gamma, delta, gamma_1(0), alpha(0), beta(0);
+    R nr2, nr_replaced(-1);
+
+    mult(A, scaled(v.x, T(-1)), b, v.r);
+    mult(P, v.r, v.u);
+    mult(A, v.u, v.w);
+
+    for (size_type k = 0; ; ++k) {
+      v.reduce(gamma, delta, nr2);
+      bool finished = iter.finished(gmm::sqrt(nr2));
+      if (finished && (k == 0 || !iter.converged())) break;
+
+      if (finished || (replacement_period && k > 0
+		       && k % replacement_period == 0)) {
+	mult(A, scaled(v.x, T(-1)), b, v.r);
+	R nr = gmm::vect_norm2(v.r);
+	if (finished && (iter.finished(nr)
+			 || (nr_replaced >= R(0) && nr >= nr_replaced)))
+	  break;
+	nr_replaced = nr;
+	mult(P, v.r, v.u); mult(A, v.u, v.w);
+	mult(A, v.p, v.s); mult(P, v.s, v.q); mult(A, v.q, v.z);
+	v.reduce(gamma, delta, nr2);
+      }
+
+      mult(P, v.w, v.m);
+      mult(A, v.m, v.n);
+      if (k == 0)
+	{ beta = T(0); alpha = gamma / delta; }
+      else
+	{ beta = gamma / gamma_1; alpha = gamma / (delta - beta*gamma/alpha); }
+      v.update(alpha, beta);
+      gamma_1 = gamma;
+      ++iter;
+    }
+    copy(v.x, x);
+  }
+
+  template <typename Matrix, typename Precond,
+            typename Vector1, typename Vector2> inline
+  void pipelined_cg(const Matrix& A, const Vector1& x, const Vector2& b,
+		    const Precond &P, iteration &iter,
+		    size_type replacement_period = 50)
+  { pipelined_cg(A, linalg_const_cast(x), b, P, iter, replacement_period); }
+
 }
 
 
@@ -168,6 +168,18 @@ t_ref = MPI_Wtime();
     gmres(A, x, b, M, restart, outer, orth); 
   }
 
+  /** Restarted GMRES with the Krylov basis orthogonalized by the
+      classical Gram-Schmidt algorithm with reorthogonalization (see
+      classical_gram_schmidt2). Less synchronization points per iteration
+      than gmres for the same stability. */
+  template <typename Mat, typename Vec, typename VecB, typename Precond >
+  void gmres_cgs2(const Mat &A, Vec &x, const VecB &b,
+		  const Precond &M, int restart, iteration& outer) {
+    typedef typename linalg_traits<Vec>::value_type T;
+    classical_gram_schmidt2<T> orth(restart, vect_size(x));
+    gmres(A, x, b, M, restart, outer, orth);
+  }
+
 }
 
 #endif
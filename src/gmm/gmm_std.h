@@ -198,6 +198,40 @@ namespace gmm {
 	using std::endl; using std::cout; using std::cerr;
         using std::ends; using std::cin; using std::isnan;
 
+  /* ******************************************************************** */
+  /*	Multithreaded kernels of the iterative solvers.                   */
+  /* ******************************************************************** */
+  /* The sparse matrix-vector product, add, scale, vect_sp and vect_norm2 */
+  /* on dense vectors are multithreaded when compiled with OpenMP, out of */
+  /* a parallel section and for vectors of size at least                  */
+  /* threaded_kernels_min_size(). The vectors are cut into blocks of      */
+  /* threaded_kernels_block components and the partial sums of the        */
+  /* reductions are added in the order of the blocks, so that vect_sp and */
+  /* vect_norm2 do not depend on the number of threads.                   */
+
+  const size_t threaded_kernels_block = 4096;
+
+  inline bool &threaded_kernels_flag_() { static bool b = true; return b; }
+  inline size_t &threaded_kernels_min_size_()
+  { static size_t n = 20000; return n; }
+
+  /** Enable or disable the multithreaded kernels. */
+  inline void set_threaded_kernels(bool b) { threaded_kernels_flag_() = b; }
+  inline bool threaded_kernels() { return threaded_kernels_flag_(); }
+  /** Minimal size of the vectors for the multithreaded kernels. */
+  inline void set_threaded_kernels_min_size(size_t n)
+  { threaded_kernels_min_size_() = n; }
+  inline size_t threaded_kernels_min_size()
+  { return threaded_kernels_min_size_(); }
+
+  inline bool use_threaded_kernels(size_t n) {
+    return threaded_kernels_flag_() && n >= threaded_kernels_min_size_()
+      && num_threads() > 1 && !me_is_multithreaded_now();
+  }
+
+  inline int threaded_kernels_nb_blocks(size_t n)
+  { return int((n + threaded_kernels_block - 1) / threaded_kernels_block); }
+
 #ifdef _WIN32
 
 	class standard_locale {
@@ -253,6 +253,11 @@ namespace gmm {
     mutable std::vector<T> sol;
     mutable bool is_init;
     mutable char equed;
+    std::vector<unsigned int> pattern_ir, pattern_jc;
+    int pattern_permc_spec;
+    bool analysis_done, analysis_reused_;
+    bool rcond_estimation;
+    double rcond_;
 
   public :
     enum { LU_NOTRANSP, LU_TRANSP, LU_CONJUGATED };
@@ -263,11 +268,14 @@ namespace gmm {
        transp = LU_TRANSP     -> solves A'x = B
        transp = LU_CONJUGATED -> solves conj(A)X = B */
     void solve(const VECTX &X_, const VECTB &B, int transp=LU_NOTRANSP) const;
-    SuperLU_factor(void) { is_init = false; }
-    SuperLU_factor(const SuperLU_factor& other) {
+    SuperLU_factor(void)
+      : is_init(false), pattern_permc_spec(-1), analysis_done(false),
+	analysis_reused_(false), rcond_estimation(false), rcond_(0) {}
+    SuperLU_factor(const SuperLU_factor& other)
+      : is_init(false), pattern_permc_spec(-1), analysis_done(false),
+	analysis_reused_(false), rcond_estimation(false), rcond_(0) {
       GMM_ASSERT2(!(other.is_init),
 		 "copy of initialized SuperLU_factor is forbidden");
-      is_init = false;
     }
     SuperLU_factor& operator=(const SuperLU_factor& other) {
       GMM_ASSERT2(!(other.is_init) && !is_init,
@@ -276,6 +284,15 @@ namespace gmm {
     }
     ~SuperLU_factor() { free_supermatrix(); }
     float memsize() { return memory_used; }
+    /* True if the last factorization reused the symbolic analysis of the
+       previous one (same sparsity pattern). */
+    bool analysis_reused() const { return analysis_reused_; }
+    /* Estimation of the reciprocal condition number by the following
+       factorizations (disabled by default). */
+    void set_rcond_estimation(bool b) { rcond_estimation = b; }
+    /* Reciprocal condition number estimated by the last factorization,
+       zero if it has not been estimated. */
+    double rcond() const { return rcond_; }
   };
 
 
@@ -286,6 +303,7 @@ namespace gmm {
 	if (SA.Store) Destroy_SuperMatrix_Store(&SA);
 	if (SL.Store) Destroy_SuperNode_Matrix(&SL);
 	if (SU.Store) Destroy_CompCol_Matrix(&SU);
+	is_init = false;
       }
     }
 
@@ -298,6 +316,8 @@ namespace gmm {
      *   permc_spec = 1: use minimum degree ordering on structure of A'*A
      *   permc_spec = 2: use minimum degree ordering on structure of A'+A
      *   permc_spec = 3: use approximate minimum degree column ordering
+     * The ordering and the elimination tree of the previous factorization
+     * are reused if A has the same sparsity pattern.
      */
       free_supermatrix();
       int n = mat_nrows(A), m = mat_ncols(A), info = 0;
@@ -310,12 +330,22 @@ namespace gmm {
       set_default_options(&options);
       options.ColPerm = NATURAL;
       options.PrintStat = NO;
-      options.ConditionNumber = NO;
+      options.ConditionNumber = rcond_estimation ? YES : NO;
       switch (permc_spec) {
       case 1 : options.ColPerm = MMD_ATA; break;
       case 2 : options.ColPerm = MMD_AT_PLUS_A; break;
       case 3 : options.ColPerm = COLAMD; break;
       }
+      analysis_reused_ = analysis_done && permc_spec == pattern_permc_spec
+	&& perm_c.size() == size_type(n) && csc_A.jc == pattern_jc
+	&& csc_A.ir == pattern_ir;
+      if (analysis_reused_)
+	options.Fact = SamePattern; // perm_c and etree are input arguments
+      else {
+	analysis_done = false;
+	pattern_ir = csc_A.ir; pattern_jc = csc_A.jc;
+	pattern_permc_spec = permc_spec;
+      }
       StatInit(&stat);
 
       Create_CompCol_Matrix(&SA, m, n, nz, (double *)(&(csc_A.pr[0])),
@@ -351,9 +381,11 @@ namespace gmm {
       Create_Dense_Matrix(&SB, m, 1, &rhs[0], m);
       Create_Dense_Matrix(&SX, m, 1, &sol[0], m);
       StatFree(&stat);
+      is_init = true; // L and U are allocated, even for a singular matrix
+      analysis_done = (info == 0);
+      rcond_ = (rcond_estimation && info == 0) ? double(rcond) : 0.;
 
       GMM_ASSERT1(info == 0, "SuperLU solve failed: info=" << info);
-      is_init = true;
     }
     
     template <class T> template <typename VECTX, typename VECTB> 
@@ -363,6 +395,7 @@ namespace gmm {
       gmm::copy(B, rhs);
       options.Fact = FACTORED;
       options.IterRefine = NOREFINE;
+      options.ConditionNumber = NO; // estimated at the factorization only
       switch (transp) {
       case LU_NOTRANSP: options.Trans = NOTRANS; break;
       case LU_TRANSP: options.Trans = TRANS; break;
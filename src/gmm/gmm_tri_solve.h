@@ -212,9 +212,155 @@ namespace gmm {
   }
 
 
- 
+  /* ******************************************************************** */
+  /*	Level scheduling of sparse triangular solves.                     */
+  /* ******************************************************************** */
+  /* The rows of a sparse triangular matrix stored by rows (ptr, ind) are */
+  /* sorted by levels: a row only depends on rows of the previous levels, */
+  /* so that the rows of a same level can be solved in parallel.          */
 
+  template <typename IND>
+  void tri_solve_levels(const std::vector<IND> &ptr,
+			const std::vector<IND> &ind, size_type n, bool lower,
+			std::vector<size_type> &lev_ptr,
+			std::vector<size_type> &lev_rows) {
+    std::vector<size_type> lev(n, 0);
+    size_type nb_lev = 0;
+    for (size_type k = 0; k < n; ++k) {
+      size_type i = lower ? k : n - 1 - k, l = 0;
+      for (size_type p = ptr[i]; p < size_type(ptr[i+1]); ++p) {
+	size_type j = ind[p];
+	if (lower ? (j < i) : (j > i)) l = std::max(l, lev[j] + 1);
+      }
+      lev[i] = l; nb_lev = std::max(nb_lev, l + 1);
+    }
+    lev_ptr.assign(nb_lev + 1, 0);
+    for (size_type i = 0; i < n; ++i) ++(lev_ptr[lev[i]+1]);
+    for (size_type l = 0; l < nb_lev; ++l) lev_ptr[l+1] += lev_ptr[l];
+    lev_rows.resize(n);
+    std::vector<size_type> pos(lev_ptr.begin(), lev_ptr.end() - 1);
+    for (size_type k = 0; k < n; ++k) {
+      size_type i = lower ? k : n - 1 - k;
+      lev_rows[pos[lev[i]]++] = i;
+    }
+  }
+
+  // Minimal number of rows of a level for a multithreaded execution.
+  const size_type tri_solve_levels_min_size = 256;
+
+  /** Copy of a sparse triangular matrix stored by rows with a level
+      scheduling of its rows, for multithreaded triangular solves. The
+      result of solve() does not depend on the number of threads. */
+  template <typename T> class leveled_tri_matrix {
+  protected :
+    std::vector<T> val;
+    std::vector<size_type> ind, ptr, lev_ptr, lev_rows;
+    bool lower, unit;
+
+    template <typename TriMatrix>
+    void copy_rows_(const TriMatrix &A, row_major);
+    template <typename TriMatrix>
+    void copy_rows_(const TriMatrix &A, col_major);
+    template <typename VecX> void solve_row_(size_type i, VecX &x) const;
+
+  public :
+    size_type nrows(void) const { return ptr.empty() ? 0 : ptr.size() - 1; }
+    size_type nb_levels(void) const
+    { return lev_ptr.empty() ? 0 : lev_ptr.size() - 1; }
+    bool empty(void) const { return ptr.empty(); }
+    void clear(void) {
+      val.clear(); ind.clear(); ptr.clear();
+      lev_ptr.clear(); lev_rows.clear();
+    }
+
+    /** Copy the lower (or upper) part of A and compute the levels. */
+    template <typename TriMatrix>
+    void build_with(const TriMatrix &A, bool lower_, bool is_unit) {
+      lower = lower_; unit = is_unit;
+      copy_rows_(A, typename principal_orientation_type<typename
+		 linalg_traits<TriMatrix>::sub_orientation>::potype());
+      tri_solve_levels(ptr, ind, nrows(), lower, lev_ptr, lev_rows);
+    }
+    /** Solve T x = x in place. */
+    template <typename VecX> void solve(VecX &x) const;
+
+    size_type memsize() const {
+      return sizeof(*this) + val.size() * sizeof(T)
+	+ (ind.size() + ptr.size() + lev_ptr.size() + lev_rows.size())
+	* sizeof(size_type);
+    }
+    leveled_tri_matrix(void) : lower(true), unit(false) {}
+  };
 
+  template <typename T> template <typename TriMatrix>
+  void leveled_tri_matrix<T>::copy_rows_(const TriMatrix &A, row_major) {
+    typedef typename linalg_traits<TriMatrix>::storage_type store_type;
+    size_type n = mat_nrows(A);
+    ptr.assign(n+1, 0); ind.resize(0); val.resize(0);
+    for (size_type i = 0; i < n; ++i) {
+      typedef typename linalg_traits<TriMatrix>::const_sub_row_type ROW;
+      ROW r = mat_const_row(A, i);
+      auto it = vect_const_begin(r), ite = vect_const_end(r);
+      for (size_type k = 0; it != ite; ++it, ++k) {
+	size_type j = index_of_it(it, k, store_type());
+	if (lower ? (j <= i) : (j >= i)) { ind.push_back(j); val.push_back(*it); }
+      }
+      ptr[i+1] = ind.size();
+    }
+  }
+
+  template <typename T> template <typename TriMatrix>
+  void leveled_tri_matrix<T>::copy_rows_(const TriMatrix &A, col_major) {
+    typedef typename linalg_traits<TriMatrix>::storage_type store_type;
+    typedef typename linalg_traits<TriMatrix>::const_sub_col_type COL;
+    size_type n = mat_nrows(A), m = mat_ncols(A);
+    ptr.assign(n+1, 0);
+    for (size_type j = 0; j < m; ++j) {
+      COL c = mat_const_col(A, j);
+      auto it = vect_const_begin(c), ite = vect_const_end(c);
+      for (size_type k = 0; it != ite; ++it, ++k) {
+	size_type i = index_of_it(it, k, store_type());
+	if (lower ? (j <= i) : (j >= i)) ++(ptr[i+1]);
+      }
+    }
+    for (size_type i = 0; i < n; ++i) ptr[i+1] += ptr[i];
+    ind.resize(ptr[n]); val.resize(ptr[n]);
+    std::vector<size_type> pos(ptr.begin(), ptr.end() - 1);
+    for (size_type j = 0; j < m; ++j) {
+      COL c = mat_const_col(A, j);
+      auto it = vect_const_begin(c), ite = vect_const_end(c);
+      for (size_type k = 0; it != ite; ++it, ++k) {
+	size_type i = index_of_it(it, k, store_type());
+	if (lower ? (j <= i) : (j >= i))
+	  { ind[pos[i]] = j; val[pos[i]++] = *it; }
+      }
+    }
+  }
+
+  template <typename T> template <typename VecX>
+  inline void leveled_tri_matrix<T>::solve_row_(size_type i, VecX &x) const {
+    typename linalg_traits<VecX>::value_type t = x[i];
+    T d(0);
+    for (size_type p = ptr[i]; p < ptr[i+1]; ++p)
+      if (ind[p] == i) d = val[p]; else t -= val[p] * x[ind[p]];
+    if (!unit) t /= d;
+    x[i] = t;
+  }
+
+  template <typename T> template <typename VecX>
+  void leveled_tri_matrix<T>::solve(VecX &x) const {
+    GMM_ASSERT2(vect_size(x) == nrows(), "dimensions mismatch");
+    bool threaded = use_threaded_kernels(nrows());
+    for (size_type l = 0; l < nb_levels(); ++l) {
+      int b = int(lev_ptr[l]), e = int(lev_ptr[l+1]);
+      if (threaded && size_type(e - b) >= tri_solve_levels_min_size) {
+	#pragma omp parallel for schedule(static)
+	for (int k = b; k < e; ++k) solve_row_(lev_rows[k], x);
+      }
+      else
+	for (int k = b; k < e; ++k) solve_row_(lev_rows[k], x);
+    }
+  }
 
 }
 
@@ -30,6 +30,7 @@
 #include "gmm/gmm_dense_lu.h"
 #include "gmm/gmm_dense_qr.h"
 #include "gmm/gmm_condition_number.h"
+#include <chrono>
 
 using std::endl; using std::cout; using std::cerr;
 using std::ends; using std::cin;
@@ -145,6 +146,88 @@ template<typename VECT> void test_vect_swap(VECT &V, gmm::linalg_false) {
 }
 
 
+// Wall clock time: the cpu time of gmm::uclock_sec sums the time of all
+// the threads and would hide the gain of the threaded kernels.
+typedef std::chrono::steady_clock wall_clock;
+static double elapsed(wall_clock::time_point t0) {
+  return std::chrono::duration<double>(wall_clock::now() - t0).count();
+}
+
+// Compares the serial and the multithreaded versions of the kernels of the
+// iterative solvers (sparse matrix-vector products and BLAS-1).
+template<typename T> void test_threaded_kernels(T) {
+  typedef typename gmm::number_traits<T>::magnitude_type R;
+  R prec = gmm::default_tol(R());
+  size_type n = 200000, nbit = 20, d = 400;
+  gmm::row_matrix<gmm::wsvector<T> > A(n, n);
+  for (size_type i = 0; i < n; ++i) {
+    A(i, i) = T(4);
+    if (i > 0) A(i, i-1) = T(-1);
+    if (i+1 < n) A(i, i+1) = T(-1);
+    if (i >= d) A(i, i-d) = T(-1);
+    if (i+d < n) A(i, i+d) = T(-1);
+  }
+  gmm::csr_matrix<T> A1; gmm::copy(A, A1);
+  gmm::csc_matrix<T> A2; gmm::copy(A, A2);
+  gmm::col_matrix<gmm::rsvector<T> > A3(n, n); gmm::copy(A, A3);
+  gmm::bsr_matrix<T> A4(n, n, 2); gmm::copy(A, A4);
+  std::vector<T> x(n), y(n);
+  gmm::fill_random(x); gmm::fill_random(y);
+
+  const char *names[8] = { "mult csr", "mult csc", "mult col_matrix",
+			   "mult bsr", "add", "scale", "vect_sp", "vect_norm2" };
+  std::vector<T> res[2][6];
+  T sp[2]; R nr[2];
+  double t[2][8];
+  size_type min_size = gmm::threaded_kernels_min_size();
+  gmm::set_threaded_kernels_min_size(10000);
+  for (int k = 0; k < 2; ++k) {
+    gmm::set_threaded_kernels(k == 1);
+    for (int j = 0; j < 6; ++j) res[k][j].resize(n);
+    wall_clock::time_point t0 = wall_clock::now();
+    for (size_type i = 0; i < nbit; ++i) gmm::mult(A1, x, res[k][0]);
+    t[k][0] = elapsed(t0); t0 = wall_clock::now();
+    for (size_type i = 0; i < nbit; ++i) gmm::mult(A2, x, res[k][1]);
+    t[k][1] = elapsed(t0); t0 = wall_clock::now();
+    for (size_type i = 0; i < nbit; ++i) gmm::mult(A3, x, res[k][2]);
+    t[k][2] = elapsed(t0); t0 = wall_clock::now();
+    for (size_type i = 0; i < nbit; ++i) gmm::mult(A4, x, res[k][3]);
+    t[k][3] = elapsed(t0); t0 = wall_clock::now();
+    for (size_type i = 0; i < nbit; ++i)
+      gmm::add(x, gmm::scaled(y, T(-2)), res[k][4]);
+    t[k][4] = elapsed(t0); t0 = wall_clock::now();
+    gmm::copy(y, res[k][5]);
+    for (size_type i = 0; i < nbit; ++i) gmm::scale(res[k][5], T(-1));
+    t[k][5] = elapsed(t0); t0 = wall_clock::now();
+    for (size_type i = 0; i < nbit; ++i) sp[k] = gmm::vect_sp(x, y);
+    t[k][6] = elapsed(t0); t0 = wall_clock::now();
+    for (size_type i = 0; i < nbit; ++i) nr[k] = gmm::vect_norm2(x);
+    t[k][7] = elapsed(t0);
+  }
+  gmm::set_threaded_kernels(true);
+  gmm::set_threaded_kernels_min_size(min_size);
+
+  GMM_ASSERT1(gmm::vect_dist2(res[0][0], res[0][3])
+	      <= prec * R(100) * gmm::vect_norm2(res[0][0]),
+	      "Error too large in mult bsr");
+  for (int j = 0; j < 6; ++j) {
+    R error = gmm::vect_dist2(res[0][j], res[1][j]);
+    GMM_ASSERT1(error <= prec * R(100) * gmm::vect_norm2(res[0][j]),
+		"Error too large in threaded " << names[j] << ": " << error);
+  }
+  GMM_ASSERT1(gmm::abs(sp[0] - sp[1])
+	      <= prec * R(n) * gmm::vect_norm2(x) * gmm::vect_norm2(y),
+	      "Error too large in threaded vect_sp");
+  GMM_ASSERT1(gmm::abs(nr[0] - nr[1]) <= prec * R(n) * nr[0],
+	      "Error too large in threaded vect_norm2");
+
+  cout << "Threaded kernels, " << num_threads() << " thread(s), "
+       << nbit << " runs on vectors of size " << n << endl;
+  for (int j = 0; j < 8; ++j)
+    cout << "  " << names[j] << " : serial " << t[0][j] << "s, threaded "
+	 << t[1][j] << "s" << endl;
+}
+
 template <typename MAT1 , typename MAT2, typename VECT1, typename VECT2,
 	  typename VECT3, typename VECT4>
 bool test_procedure(const MAT1 &m1_, const VECT1 &v1_, const VECT2 &v2_, 
@@ -170,6 +253,20 @@ bool test_procedure(const MAT1 &m1_, const VECT1 &v1_, const VECT2 &v2_,
   gmm::copy(m2, mm2);
   test_procedure2(mm1, v1, v2, mm2, v3, v4);
 
+  if (m % 2 == 0) { // block sparse row matrix with 2x2 blocks
+    gmm::bsr_matrix<T> mm3(m, m, 2);
+    gmm::copy(m1, mm3);
+    test_procedure2(mm3, v1, v2, mm2, v3, v4);
+    gmm::csc_matrix<T> mm4;
+    gmm::copy(mm3, mm4);
+    gmm::dense_matrix<T> m4(m, m);
+    gmm::copy(m1, m4);
+    gmm::add(gmm::scaled(mm4, T(-1)), m4);
+    R error = gmm::mat_euclidean_norm(m4);
+    if (!(error <= prec * R(10000)))
+      GMM_ASSERT1(false, "Error too large: "<< error);
+  }
+
   size_type mm = m / 2, nn = n / 2;
   gmm::sub_interval SUBI(0, mm), SUBJ(0, nn); 
   test_procedure2(gmm::sub_matrix(mm1, SUBI),
@@ -250,7 +347,7 @@ bool test_procedure(const MAT1 &m1_, const VECT1 &v1_, const VECT2 &v2_,
   test_mat_swap(m1, typename gmm::linalg_traits<MAT1>::is_reference());
   test_vect_swap(v1, typename gmm::linalg_traits<VECT1>::is_reference());
   
-  if (nb_iter == 100) return true;
+  if (nb_iter == 100) { test_threaded_kernels(T()); return true; }
   return false;
 }
 
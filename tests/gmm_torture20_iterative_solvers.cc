@@ -87,6 +87,13 @@ struct GMRES {
   { gmm::gmres(m, v1, v2, P, 50, iter); }
 };
 
+struct GMRES_CGS2 {
+  template <typename MAT, typename VECT1, typename VECT2, typename PRECOND>
+  void operator()(const MAT &m, VECT1 &v1, const VECT2 &v2, const PRECOND &P,
+		  gmm::iteration &iter) const
+  { gmm::gmres_cgs2(m, v1, v2, P, 50, iter); }
+};
+
 struct QMR {
   template <typename MAT, typename VECT1, typename VECT2, typename PRECOND>
   void operator()(const MAT &m, VECT1 &v1, const VECT2 &v2, const PRECOND &P,
@@ -101,6 +108,13 @@ struct CG {
   { gmm::cg(m, v1, v2, P, iter); }
 };
 
+struct PIPELINED_CG {
+  template <typename MAT, typename VECT1, typename VECT2, typename PRECOND>
+  void operator()(const MAT &m, VECT1 &v1, const VECT2 &v2, const PRECOND &P,
+		  gmm::iteration &iter) const
+  { gmm::pipelined_cg(m, v1, v2, P, iter); }
+};
+
 template <typename SOLVER, typename PRECOND, typename MAT, typename VECT1,
 	  typename VECT2, typename Rcond>
 void do_test(const SOLVER &solver, const MAT &m1, VECT1 &v1,
@@ -139,6 +153,42 @@ void do_test(const SOLVER &solver, const MAT &m1, VECT1 &v1,
 
 }
 
+// Compares the level scheduled ILU factorization and triangular solves of
+// ilu_precond and ildlt_precond with the serial ones, on a matrix whose
+// levels are large enough to be handled in parallel.
+template <typename T> void test_threaded_incomplete_factorizations(T) {
+  typedef typename gmm::number_traits<T>::magnitude_type R;
+  R prec = gmm::default_tol(R());
+  size_type d = 400, n = d*d;
+  gmm::row_matrix<gmm::wsvector<T> > A(n, n);
+  for (size_type i = 0; i < n; ++i) {
+    A(i, i) = T(4);
+    if (i % d > 0) { A(i, i-1) = T(-1); A(i-1, i) = T(-1); }
+    if (i >= d) { A(i, i-d) = T(-1); A(i-d, i) = T(-1); }
+  }
+  gmm::csr_matrix<T> A1; gmm::copy(A, A1);
+  std::vector<T> x(n), y[2][2];
+  gmm::fill_random(x);
+
+  size_type min_size = gmm::threaded_kernels_min_size();
+  gmm::set_threaded_kernels_min_size(0);
+  for (int k = 0; k < 2; ++k) {
+    gmm::set_threaded_kernels(k == 1);
+    gmm::ilu_precond<gmm::csr_matrix<T> > P(A1);
+    gmm::ildlt_precond<gmm::csr_matrix<T> > Q(A1);
+    y[k][0].resize(n); y[k][1].resize(n);
+    gmm::mult(P, x, y[k][0]);
+    gmm::mult(Q, x, y[k][1]);
+  }
+  gmm::set_threaded_kernels(true);
+  gmm::set_threaded_kernels_min_size(min_size);
+
+  for (int j = 0; j < 2; ++j)
+    GMM_ASSERT1(gmm::vect_dist2(y[0][j], y[1][j])
+		<= prec * R(100) * gmm::vect_norm2(y[0][j]),
+		"Error too large in threaded " << (j ? "ildlt" : "ilu"));
+}
+
 template <typename MAT1, typename VECT1, typename VECT2>
 bool test_procedure(const MAT1 &m1_, const VECT1 &v1_, const VECT2 &v2_) {
   VECT1 &v1 = const_cast<VECT1 &>(v1_);
@@ -184,6 +234,30 @@ bool test_procedure(const MAT1 &m1_, const VECT1 &v1_, const VECT2 &v2_) {
   
   R detmr = gmm::abs(gmm::lu_det(P3.approx_inverse()));
 
+  // Level scheduled triangular solves against the serial ones.
+  std::vector<T> w1(m), w2(m);
+  gmm::fill_random(w1); gmm::copy(w1, w2);
+  gmm::leveled_tri_matrix<T> LL, UU, UUt;
+  LL.build_with(P4.L, true, true);
+  UU.build_with(P4.U, false, false);
+  UUt.build_with(gmm::transposed(P4.U), true, false);
+  gmm::lower_tri_solve(P4.L, w1, true);
+  gmm::upper_tri_solve(P4.U, w1, false);
+  gmm::lower_tri_solve(gmm::transposed(P4.U), w1, false);
+  LL.solve(w2); UU.solve(w2); UUt.solve(w2);
+  gmm::add(gmm::scaled(w1, T(-1)), w2);
+  if (gmm::vect_norm2(w2) > prec * R(100) * gmm::vect_norm2(w1))
+    GMM_ASSERT1(false, "Error in level scheduled triangular solve");
+
+  // Incomplete factorization of a block sparse row matrix.
+  if (m % 2 == 0) {
+    gmm::bsr_matrix<T> mb(m, m, 2);
+    gmm::copy(m1, mb);
+    gmm::ilu_precond<gmm::bsr_matrix<T> > P4b(mb);
+    if (print_debug) cout << "\nGmres with ilu on a bsr matrix\n";
+    do_test(GMRES(), mb, v1, v2, P4b, cond);
+  }
+
   if (sizeof(R) > 4 || m < 15) {
     
     if (print_debug) cout << "\nLeast square CG with no preconditionner\n";
@@ -229,6 +303,12 @@ bool test_procedure(const MAT1 &m1_, const VECT1 &v1_, const VECT2 &v2_) {
   
   if (print_debug) cout << "\nGmres with ilutp preconditionner\n";
   do_test(GMRES(), m1, v1, v2, P5b, cond);
+
+  if (print_debug) cout << "\nGmres/CGS2 with no preconditionner\n";
+  do_test(GMRES_CGS2(), m1, v1, v2, P1, cond);
+
+  if (print_debug) cout << "\nGmres/CGS2 with ilu preconditionner\n";
+  do_test(GMRES_CGS2(), m1, v1, v2, P4, cond);
   
   if (sizeof(R) > 5 || m < 15) {
 
@@ -254,7 +334,17 @@ bool test_procedure(const MAT1 &m1_, const VECT1 &v1_, const VECT2 &v2_) {
   gmm::add(gmm::conjugated(m1), m3);
   gmm::copy(m2, m1);
   gmm::ildlt_precond<MAT1> P6(m1);
+  if (m % 2 == 0) {
+    gmm::bsr_matrix<T> mb(m, m, 2);
+    gmm::copy(m1, mb);
+    gmm::ildlt_precond<gmm::bsr_matrix<T> > P6b(mb);
+    if (print_debug) cout << "\nCG with ildlt on a bsr matrix\n";
+    do_test(CG(), mb, v1, v2, P6b, cond*cond);
+  }
   gmm::ildltt_precond<MAT1> P7(m1, 10, prec);
+  gmm::amg_precond<MAT1> P8;
+  P8.coarse_size = 2; // to have at least two levels
+  P8.build_with(m1);
   
   if (!is_hermitian(m1, prec*R(100)))
     GMM_ASSERT1(false, "The matrix is not hermitian");
@@ -271,7 +361,17 @@ bool test_procedure(const MAT1 &m1_, const VECT1 &v1_, const VECT2 &v2_) {
   if (print_debug) cout << "\nCG with ildltt preconditionner\n";
   do_test(CG(), m1, v1, v2, P7, cond*cond);
 
+  if (print_debug) cout << "\nCG with amg preconditionner\n";
+  do_test(CG(), m1, v1, v2, P8, cond*cond);
+
+  if (print_debug) cout << "\nPipelined CG with no preconditionner\n";
+  do_test(PIPELINED_CG(), m1, v1, v2, P1, cond*cond);
+
+  if (print_debug) cout << "\nPipelined CG with ildlt preconditionner\n";
+  do_test(PIPELINED_CG(), m1, v1, v2, P6, cond*cond);
+
   if (effexpe == 50) {
+    test_threaded_incomplete_factorizations(T());
     cout << "\n\n" << effexpe << " effective experiments with ";
     if (nb_fault > 1)  cout << nb_fault << " faults";
     else if (nb_fault == 1) cout << "1  fault";
@@ -282,8 +382,10 @@ bool test_procedure(const MAT1 &m1_, const VECT1 &v1_, const VECT2 &v2_) {
     print_stat(LEAST_SQUARE_CG(), "solver least square cg");
     print_stat(BICGSTAB(), "solver bicgstab");
     print_stat(GMRES(), "solver gmres");
+    print_stat(GMRES_CGS2(), "solver gmres/cgs2");
     print_stat(QMR(), "solver qmr");
     print_stat(CG(), "solver cg");
+    print_stat(PIPELINED_CG(), "solver pipelined cg");
     print_stat(P1, "no precond");
     print_stat(P2, "diag precond");
     print_stat(P3, "mr precond");
@@ -292,6 +394,7 @@ bool test_procedure(const MAT1 &m1_, const VECT1 &v1_, const VECT2 &v2_) {
     print_stat(P5b, "ilutp precond");
     print_stat(P6, "ildlt precond");
     print_stat(P7, "ildltt precond");
+    print_stat(P8, "amg precond");
     if (sizeof(R) > 4 && ratio_max > 0.16)
       GMM_ASSERT1(false, "something wrong ..");
     if (sizeof(R) <= 4 && ratio_max > 0.3)
@@ -104,14 +104,14 @@ static void check_method(const std::string& im_name, getfem::pintegration_method
 
   matrix_collection &mc = ME[pgt_K_f_idx(pgt,k)];
   pmec->gen_compute(t, m.points_of_convex(0), 0);
-  mc.lst.push_back(t);
+  mc.lst.push_back(base_vector(t.begin(), t.end()));
   mc.im_names.push_back(im_name);
   
   for (short_type f = 0; f < m.structure_of_convex(0)->nb_faces(); ++f) {
     pmec->gen_compute_on_face(t, m.points_of_convex(0), f, 0);
     std::stringstream s; s << im_name << "/FACE" << f;
     matrix_collection &mcf = ME[pgt_K_f_idx(pgt,k,f)];
-    mcf.lst.push_back(t);
+    mcf.lst.push_back(base_vector(t.begin(), t.end()));
     mcf.im_names.push_back(s.str());
     cout << "F" << f << std::flush;
   }
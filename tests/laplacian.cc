@@ -286,11 +286,35 @@ bool laplacian_problem::solve(void) {
     double rcond; 
     gmm::SuperLU_solve(SM, U, B, rcond); 
     cout << "cond = " << 1/rcond << "\n";
+
   }
   
   cout << "Total time to solve : "
        << gmm::uclock_sec() - time << " seconds\n";
 
+  {
+    // Check of the reuse of the symbolic analysis of SuperLU for a second
+    // matrix having the same sparsity pattern.
+    plain_vector U0(gmm::vect_size(U)), V(gmm::vect_size(U));
+    double rcond;
+    gmm::SuperLU_solve(SM, U0, B, rcond);
+    gmm::SuperLU_factor<scalar_type> F;
+    F.build_with(SM);
+    gmm::scale(SM, scalar_type(2));
+    F.set_rcond_estimation(true);
+    F.build_with(SM);
+    gmm::scale(SM, scalar_type(0.5));
+    F.solve(V, B);
+    gmm::add(gmm::scaled(U0, scalar_type(-0.5)), V);
+    GMM_ASSERT1(F.analysis_reused()
+                && gmm::vect_norm2(V) < 1E-8 * gmm::vect_norm2(U0),
+                "Wrong solve with the reused SuperLU analysis");
+    cout << "cond = " << 1/rcond << ", " << 1/F.rcond()
+         << " with the reused analysis\n";
+    GMM_ASSERT1(gmm::abs(F.rcond() - rcond) < 1E-3 * rcond,
+                "Wrong condition number with the reused SuperLU analysis");
+  }
+
   if (gen_dirichlet) {
     std::vector<scalar_type> Uaux(mf_u.nb_dof());
     gmm::mult(NS, U, Ud, Uaux);
@@ -248,6 +248,52 @@ bool laplacian_problem::solve(void) {
   gmm::resize(U, mf_u.nb_dof());
   gmm::copy(model.real_variable("u"), U);
 
+  if (dirichlet_version == 1 && !DG_TERMS) {
+    // Check of the conjugate gradient with the algebraic multigrid
+    // preconditioner on the same (symmetric positive definite) problem.
+    // The penalization of the Dirichlet condition makes the matrix badly
+    // conditioned, hence the smaller residual. The solutions are compared
+    // in L2 norm since the derivative dofs of the Hermite elements (Argyris)
+    // have a very different scale from the value dofs.
+    gmm::clear(model.set_real_variable("u"));
+    gmm::iteration iter_amg(residual * 1E-5, 0, 40000);
+    getfem::default_newton_line_search ls;
+    getfem::standard_solve(model, iter_amg,
+                           getfem::rselect_linear_solver(model, "cg/amg"), ls);
+    plain_vector V(model.real_variable("u"));
+    gmm::add(gmm::scaled(U, -1.0), V);
+    GMM_ASSERT1(iter_amg.converged()
+                && getfem::asm_L2_norm(mim, mf_u, V)
+                   <= 1E-5 * getfem::asm_L2_norm(mim, mf_u, U),
+                "cg/amg gives a wrong solution");
+  }
+
+  // Check of the single precision factorization with iterative refinement.
+  // The refinement alone converges if the condition number is small
+  // compared to the inverse of the single precision, which is the case
+  // except for the Argyris element (about 1E12, the double precision
+  // factorization is then used).
+  typedef getfem::linear_solver_superlu_mixed
+    <getfem::model_real_sparse_matrix, getfem::model_real_plain_vector>
+    mixed_solver;
+  std::shared_ptr<mixed_solver> mixed = std::make_shared<mixed_solver>();
+  gmm::clear(model.set_real_variable("u"));
+  gmm::iteration iter_mixed(residual * 1E-3, 0, 40000);
+  getfem::default_newton_line_search ls_mixed;
+  getfem::standard_solve(model, iter_mixed, mixed, ls_mixed);
+  plain_vector V(model.real_variable("u"));
+  gmm::add(gmm::scaled(U, -1.0), V);
+  GMM_ASSERT1(iter_mixed.converged()
+              && gmm::vect_norm2(V) <= 1E-5 * gmm::vect_norm2(U),
+              "superlu_mixed gives a wrong solution");
+  gmm::SuperLU_factor<scalar_type> Fd;
+  Fd.set_rcond_estimation(true);
+  Fd.build_with(model.real_tangent_matrix());
+  if (Fd.rcond() > 1E-6)
+    GMM_ASSERT1(mixed->nb_refinement_steps() > 0 && !mixed->used_gmres()
+                && !mixed->used_double_precision(),
+                "superlu_mixed did not converge by iterative refinement");
+
   return (iter.converged());
 }
 
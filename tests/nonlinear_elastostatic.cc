@@ -306,6 +306,54 @@ bool elastostatic_problem::solve(plain_vector &U) {
     exp.serie_add_object("deformationsteps");
   }
 
+  // Check of the Newton variants reusing the tangent matrix, restarting
+  // from a perturbation of the solution of the last step. The same linear
+  // solver is kept, hence its factorization (or its preconditioner for
+  // gmres), from one solve to the next.
+  const char *lsolver_names[2] = { "superlu", "gmres/ilu" };
+  for (const char *lsolver_name : lsolver_names) {
+    getfem::rmodel_plsolver_type lsolver
+      = getfem::rselect_linear_solver(model, lsolver_name);
+    for (int m = 0; m < 3; ++m) {
+      getfem::newton_tangent_reuse
+        strategy((getfem::newton_tangent_reuse::method_type)(m));
+      getfem::default_newton_line_search ls;
+      gmm::copy(gmm::scaled(U, 0.95), model.set_real_variable("u"));
+      gmm::iteration it(residual, int(PARAM.int_value("NOISY")), 200);
+      getfem::standard_solve(model, it, lsolver, ls, strategy);
+      cout << "Newton variant " << m << " with " << lsolver_name << " : "
+           << it.get_iteration() << " iterations, "
+           << strategy.nb_factorizations << " factorizations" << endl;
+      plain_vector V(model.real_variable("u"));
+      gmm::add(gmm::scaled(U, -1.0), V);
+      GMM_ASSERT1(it.converged()
+                  && gmm::vect_norm2(V) < 1E-3 * gmm::vect_norm2(U),
+                  "Newton variant " << m << " failed with " << lsolver_name);
+    }
+  }
+  gmm::copy(U, model.set_real_variable("u"));
+
+  // Check of the incremental assembly of the tangent matrix, without and
+  // with a change of the data of the linear Dirichlet condition.
+  model.set_incremental_assembly(true);
+  model.assembly(getfem::model::BUILD_MATRIX);
+  for (int k = 0; k < 2; ++k) {
+    if (k == 1)
+      gmm::copy(gmm::scaled(F2, 0.5), model.set_real_variable("DirichletData"));
+    model.assembly(getfem::model::BUILD_MATRIX);
+    getfem::model_real_sparse_matrix K(model.real_tangent_matrix());
+    model.set_incremental_assembly(false);
+    model.assembly(getfem::model::BUILD_MATRIX);
+    gmm::add(gmm::scaled(model.real_tangent_matrix(), -1.0), K);
+    GMM_ASSERT1(gmm::mat_maxnorm(K)
+                < 1E-8 * gmm::mat_maxnorm(model.real_tangent_matrix()),
+                "Wrong incremental assembly");
+    model.set_incremental_assembly(true);
+    model.assembly(getfem::model::BUILD_MATRIX);
+  }
+  model.set_incremental_assembly(false);
+  gmm::copy(F2, model.set_real_variable("DirichletData"));
+
   // Solution extraction
   gmm::copy(model.real_variable("u"), U);
   
@@ -20,6 +20,7 @@
 ===========================================================================*/
 #include "getfem/getfem_assembling.h"
 #include "getfem/getfem_generic_assembly.h"
+#include "getfem/getfem_models.h"
 #include "getfem/getfem_export.h"
 #include "getfem/getfem_regular_meshes.h"
 #include "getfem/getfem_partial_mesh_fem.h"
@@ -879,9 +880,322 @@ static void test_new_assembly(int N, int NX, int pK) {
                  (K, mim2, mf_u, mf_p, lambda2, mu2));
     }
 
-}
+    if (all) {
+      // The second assembly reuses the instructions compiled by the first
+      // one and has to take into account the new values of the variables
+      // and of the fixed size constants.
+      workspace.clear_expressions();
+      workspace.add_expression("a*u.u", mim);
+      workspace.assembly(0);
+      scalar_type E1 = workspace.assembled_potential();
+      gmm::scale(U, scalar_type(2));
+      workspace.assembly(0);
+      scalar_type E2 = workspace.assembled_potential();
+      a[0] *= scalar_type(2);
+      workspace.assembly(0);
+      scalar_type E3 = workspace.assembled_potential();
+      gmm::scale(U, scalar_type(0.5)); a[0] *= scalar_type(0.5);
+      scalar_type norm_error = gmm::abs(E2 - scalar_type(4)*E1)
+        + gmm::abs(E3 - scalar_type(8)*E1);
+      cout << "Error on reassembly : " << norm_error << endl;
+      GMM_ASSERT1(norm_error < 1E-10 * gmm::abs(E1),
+                  "Error in the reuse of compiled instructions");
+    }
+
+    if (all) {
+      // From the third assembly, the tangent matrix is assembled on the
+      // pattern recorded by the second one. The variables change between
+      // the assemblies and the last matrix is compared to the one of a
+      // fresh workspace.
+      std::vector<scalar_type> U0(U), P0(P);
+      const char *expr = "(a+p*p)*(Grad_u:Grad_Test_u + (u.u)*u.Test_u)";
+      workspace.clear_expressions();
+      workspace.add_expression(expr, mim);
+      for (size_type i = 0; i < 4; ++i) {
+        gmm::fill_random(U); gmm::fill_random(P);
+        workspace.assembly(2);
+      }
+      getfem::model_real_sparse_matrix K1(workspace.assembled_matrix());
+      getfem::ga_workspace workspace3;
+      workspace3.add_fixed_size_constant("a", a);
+      workspace3.add_fem_variable("u", mf_u, Iu, U);
+      workspace3.add_fem_variable("p", mf_p, Ip, P);
+      workspace3.add_fem_variable("chi", mf_chi, Ichi, chi);
+      workspace3.add_expression(expr, mim);
+      workspace3.assembly(2);
+      gmm::add(gmm::scaled(workspace3.assembled_matrix(), scalar_type(-1)),
+               K1);
+      scalar_type norm_error = gmm::mat_norminf(K1);
+      cout << "Error on fixed pattern reassembly : " << norm_error << endl;
+      GMM_ASSERT1(norm_error < 1E-10 * gmm::mat_norminf
+                  (workspace3.assembled_matrix()),
+                  "Error in the fixed pattern assembly");
+      gmm::copy(U0, U); gmm::copy(P0, P);
+    }
+
+    if (all) {
+      // Matrix-free tangent operator compared to the assembled matrix
+      workspace.clear_expressions();
+      workspace.add_expression("a*Grad_Test2_u:Grad_Test_u+Test2_u.Test_u",
+                               mim);
+      workspace.assembly(2);
+      const getfem::model_real_sparse_matrix &KK
+        = workspace.assembled_matrix();
+      getfem::ga_tangent_operator KT(workspace);
+      size_type nbd = gmm::mat_nrows(KK);
+      base_vector X(nbd), Y1(nbd), Y2(nbd), B(nbd);
+      for (size_type i = 0; i < nbd; ++i) X[i] = sin(scalar_type(i));
+      gmm::mult(KK, X, Y1);
+      getfem::mult(KT, X, Y2);
+      gmm::add(gmm::scaled(Y1, scalar_type(-1)), Y2);
+      scalar_type norm_error = gmm::vect_norminf(Y2);
+      cout << "Error on matrix-free operator : " << norm_error << endl;
+      GMM_ASSERT1(norm_error < 1E-10 * gmm::vect_norminf(Y1),
+                  "Error in the matrix-free tangent operator");
+      gmm::copy(Y1, B); gmm::clear(Y2);
+      gmm::iteration iter(1E-12, 0, 10000);
+      gmm::cg(KT, Y2, B, gmm::identity_matrix(), iter);
+      GMM_ASSERT1(iter.converged(), "Matrix-free conjugate gradient "
+                  "did not converge");
+      gmm::add(gmm::scaled(X, scalar_type(-1)), Y2);
+      norm_error = gmm::vect_norminf(Y2);
+      cout << "Error on matrix-free conjugate gradient : " << norm_error
+           << endl;
+      GMM_ASSERT1(norm_error < 1E-6 * gmm::vect_norminf(X),
+                  "Error in the matrix-free conjugate gradient");
+    }
 
+    if (all) {
+      // Batched evaluation of the gradients and Hessians of the base
+      // functions compared to their evaluation at each point.
+      workspace.clear_expressions();
+      workspace.add_expression("(1+u.u)*Grad_u:Grad_Test_u"
+                               "+ (1+p*p)*Hess_p:Hess_Test_p", mim);
+      workspace.assembly(2, true);
+      base_vector V1(workspace.assembled_vector());
+      getfem::model_real_sparse_matrix K1(workspace.assembled_matrix());
+      workspace.set_batched_base_evaluation(false);
+      workspace.assembly(2, true);
+      workspace.set_batched_base_evaluation(true);
+      gmm::add(gmm::scaled(workspace.assembled_vector(), scalar_type(-1)),
+               V1);
+      gmm::add(gmm::scaled(workspace.assembled_matrix(), scalar_type(-1)),
+               K1);
+      scalar_type norm_error = gmm::vect_norminf(V1) + gmm::mat_norminf(K1);
+      cout << "Error on batched base functions evaluation : " << norm_error
+           << endl;
+      GMM_ASSERT1(norm_error < 1E-10 * (gmm::vect_norminf
+                                        (workspace.assembled_vector())
+                                        + gmm::mat_norminf
+                                        (workspace.assembled_matrix())),
+                  "Error in the batched evaluation of the base functions");
+    }
+
+    if (all) {
+      // Fixed size instructions on the small tensors of a Saint-Venant
+      // Kirchhoff law compared to the generic ones.
+      workspace.clear_expressions();
+      workspace.add_macro("F", "Id(meshdim)+Grad_u");
+      workspace.add_macro("E", "(F'*F-Id(meshdim))*0.5");
+      workspace.add_expression("(a*Trace(E)*Id(meshdim)+2*E-E*E')"
+                               ":(F'*Grad_Test_u)", mim);
+      workspace.assembly(2, true);
+      base_vector V1(workspace.assembled_vector());
+      getfem::model_real_sparse_matrix K1(workspace.assembled_matrix());
+      workspace.set_unrolled_instructions(false);
+      workspace.assembly(2, true);
+      workspace.set_unrolled_instructions(true);
+      gmm::add(gmm::scaled(workspace.assembled_vector(), scalar_type(-1)),
+               V1);
+      gmm::add(gmm::scaled(workspace.assembled_matrix(), scalar_type(-1)),
+               K1);
+      scalar_type norm_error = gmm::vect_norminf(V1) + gmm::mat_norminf(K1);
+      cout << "Error on fixed size instructions : " << norm_error << endl;
+      GMM_ASSERT1(norm_error < 1E-10 * (gmm::vect_norminf
+                                        (workspace.assembled_vector())
+                                        + gmm::mat_norminf
+                                        (workspace.assembled_matrix())),
+                  "Error in the fixed size instructions");
+    }
+
+    if (all) {
+      // Intermediary tensors sharing their storage in the arena of the
+      // instruction set compared to separately allocated ones. Some nodes
+      // are common to several terms and some tensors of vectorized base
+      // functions are sparse.
+      workspace.clear_expressions();
+      workspace.add_expression("(a+u.u)*(Grad_u+Grad_u'):Grad_Test_u"
+                               "+ (Grad_u:Grad_u)*(u.Test_u)"
+                               "+ p*Div_u*Test_p + Norm_sqr(Grad_p)*Test_p"
+                               "+ (Grad_u*Grad_p).Grad_Test_p", mim);
+      workspace.assembly(2, true);
+      base_vector V1(workspace.assembled_vector());
+      getfem::model_real_sparse_matrix K1(workspace.assembled_matrix());
+      workspace.set_tensor_arena(false);
+      workspace.assembly(2, true);
+      workspace.set_tensor_arena(true);
+      gmm::add(gmm::scaled(workspace.assembled_vector(), scalar_type(-1)),
+               V1);
+      gmm::add(gmm::scaled(workspace.assembled_matrix(), scalar_type(-1)),
+               K1);
+      scalar_type norm_error = gmm::vect_norminf(V1) + gmm::mat_norminf(K1);
+      cout << "Error on the arena of tensors : " << norm_error << endl;
+      GMM_ASSERT1(norm_error < 1E-10 * (gmm::vect_norminf
+                                        (workspace.assembled_vector())
+                                        + gmm::mat_norminf
+                                        (workspace.assembled_matrix())),
+                  "Error in the arena of the intermediary tensors");
+    }
 
+    if (all) {
+      // Residual and tangent matrix assembled together, compared to their
+      // separate assemblies.
+      workspace.clear_expressions();
+      workspace.add_expression("(a+u.u)*Grad_u:Grad_Test_u", mim);
+      workspace.assembly(1);
+      base_vector V1(workspace.assembled_vector());
+      workspace.assembly(2);
+      getfem::model_real_sparse_matrix K1(workspace.assembled_matrix());
+      workspace.assembly(2, true);
+      gmm::add(gmm::scaled(workspace.assembled_vector(), scalar_type(-1)),
+               V1);
+      gmm::add(gmm::scaled(workspace.assembled_matrix(), scalar_type(-1)),
+               K1);
+      scalar_type norm_error = gmm::vect_norminf(V1) + gmm::mat_norminf(K1);
+      cout << "Error on residual and tangent assembly : " << norm_error
+           << endl;
+      GMM_ASSERT1(norm_error < 1E-10,
+                  "Error in the assembly of the residual and tangent terms");
+    }
+
+    if (all) {
+      // Profiling of the previous assembly. The numbers of executions are
+      // doubled by a second assembly, and each execution of an instruction
+      // is accounted for an expression.
+      getfem::ga_assembly_profile profile;
+      workspace.set_assembly_profile(&profile);
+      workspace.assembly(2, true);
+      getfem::ga_assembly_profile profile1(profile);
+      workspace.assembly(2, true);
+      workspace.set_assembly_profile(0);
+      profile.print(cout);
+      GMM_ASSERT1(profile.regions.size() == 1
+                  && profile.regions.begin()->second.count == 2
+                  && profile.expressions.size() == 2
+                  && profile.instructions.size(), "Error in the profiling");
+      size_type nb_instr(0), nb_expr(0);
+      for (const auto &e : profile.instructions) {
+        GMM_ASSERT1(e.second.count == 2 * profile1.instructions[e.first].count,
+                    "Error in the profiling counts");
+        nb_instr += e.second.count;
+      }
+      for (const auto &e : profile.expressions) {
+        GMM_ASSERT1(e.first.compare(0, 10, "order 1 : ") == 0
+                    || e.first.compare(0, 10, "order 2 : ") == 0,
+                    "Error in the profiling of the expressions");
+        nb_expr += e.second.count;
+      }
+      GMM_ASSERT1(nb_instr && nb_instr == nb_expr,
+                  "Error in the profiling counts");
+    }
+
+    if (all) {
+      // Profiling of the assembly of a model. With several threads and no
+      // coloring, each thread assembles with its own workspace and the
+      // regions are counted once per thread.
+      getfem::model md;
+      md.add_fem_variable("u", mf_u);
+      gmm::copy(U, md.set_real_variable("u"));
+      md.add_initialized_fixed_size_data("a", a);
+      getfem::add_nonlinear_generic_assembly_brick
+        (md, mim, "(a+u.u)*Grad_u:Grad_Test_u");
+      md.set_assembly_profiling(true);
+      md.assembly(getfem::model::BUILD_ALL);
+      md.assembly(getfem::model::BUILD_ALL);
+      const getfem::ga_assembly_profile &mprofile = md.assembly_profile();
+      mprofile.print(cout);
+      size_type nb_regions = md.is_colored_assembly()
+        ? 1 : getfem::num_threads();
+      GMM_ASSERT1(mprofile.bricks.at("generic expressions").count == 2
+                  && mprofile.regions.size() == 1
+                  && mprofile.regions.begin()->second.count == 2*nb_regions
+                  && mprofile.instructions.size(),
+                  "Error in the profiling of a model");
+      size_type nb_instr(0), nb_expr(0);
+      for (const auto &e : mprofile.instructions) nb_instr += e.second.count;
+      for (const auto &e : mprofile.expressions) nb_expr += e.second.count;
+      GMM_ASSERT1(nb_instr && nb_instr == nb_expr,
+                  "Error in the profiling counts of a model");
+    }
+
+    if (all) {
+      // Assembly into a block sparse row matrix, compared to the standard
+      // one. The second assembly reuses the pattern of the blocks.
+      getfem::ga_workspace workspace2;
+      workspace2.add_fixed_size_constant("a", a);
+      workspace2.add_fem_variable("u", mf_u, Iu, U);
+      workspace2.add_expression("a*(Grad_u:Grad_Test_u + u.Test_u)", mim);
+      workspace2.assembly(2);
+      getfem::model_real_sparse_matrix K1(workspace2.assembled_matrix());
+      gmm::bsr_matrix<scalar_type> KB;
+      workspace2.set_assembled_matrix(KB);
+      workspace2.assembly(2);
+      workspace2.assembly(2);
+      GMM_ASSERT1(KB.block_size() == N, "Wrong block size");
+      gmm::add(gmm::scaled(KB, scalar_type(-1)), K1);
+      scalar_type norm_error = gmm::mat_norminf(K1);
+      cout << "Error on block sparse row assembly : " << norm_error << endl;
+      GMM_ASSERT1(norm_error < 1E-10 * gmm::mat_norminf(KB),
+                  "Error in the assembly into a block sparse row matrix");
+    }
+
+}
+
+/* Interpolation of the variables by sum factorization on Lagrange QK
+   elements compared to the standard instructions.                        */
+static void test_sum_factorization(int N, int K) {
+  getfem::mesh m;
+  char Ns[5]; sprintf(Ns, "%d", N);
+  char Ks[5]; sprintf(Ks, "%d", K);
+  std::vector<size_type> nsubdiv(N, 4);
+  getfem::regular_unit_mesh(m, nsubdiv, bgeot::parallelepiped_geotrans
+                            (dim_type(N), 1));
+  getfem::mesh_fem mf_u(m, dim_type(N)), mf_p(m);
+  mf_u.set_finite_element(m.convex_index(), getfem::fem_descriptor
+                          ((std::string("FEM_QK(") + Ns + "," + Ks
+                            + ")").c_str()));
+  mf_p.set_finite_element(m.convex_index(), getfem::fem_descriptor
+                          ((std::string("FEM_QK(") + Ns + "," + Ks
+                            + ")").c_str()));
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(m.convex_index(), getfem::int_method_descriptor
+                             ((std::string("IM_GAUSS_PARALLELEPIPED(") + Ns
+                               + ",6)").c_str()));
+
+  size_type ndofu = mf_u.nb_dof(), ndofp = mf_p.nb_dof();
+  base_vector U(ndofu), P(ndofp);
+  gmm::fill_random(U); gmm::fill_random(P);
+  getfem::ga_workspace workspace;
+  workspace.add_fem_variable("u", mf_u, gmm::sub_interval(0, ndofu), U);
+  workspace.add_fem_variable("p", mf_p, gmm::sub_interval(ndofu, ndofp), P);
+  workspace.add_expression("(1+p*p)*(Grad_u+Grad_u'):Grad_Test_u"
+                           "+ (u.u)*Grad_p.Grad_Test_p"
+                           "+ Norm_sqr(Grad_p)*Test_p", mim);
+  workspace.assembly(2, true);
+  base_vector V1(workspace.assembled_vector());
+  getfem::model_real_sparse_matrix K1(workspace.assembled_matrix());
+  workspace.set_sum_factorization(false);
+  workspace.assembly(2, true);
+  gmm::add(gmm::scaled(workspace.assembled_vector(), scalar_type(-1)), V1);
+  gmm::add(gmm::scaled(workspace.assembled_matrix(), scalar_type(-1)), K1);
+  scalar_type norm_error = gmm::vect_norminf(V1) + gmm::mat_norminf(K1);
+  cout << "Error on sum factorization : " << norm_error << endl;
+  GMM_ASSERT1(norm_error < 1E-10 * (gmm::vect_norminf
+                                    (workspace.assembled_vector())
+                                    + gmm::mat_norminf
+                                    (workspace.assembled_matrix())),
+              "Error in the interpolation by sum factorization");
+}
 
 
 int main(int argc, char *argv[]) {
@@ -891,6 +1205,8 @@ int main(int argc, char *argv[]) {
   
   test_new_assembly(2, 25, 2);
   test_new_assembly(3, 7, 2);
+  test_sum_factorization(2, 3);
+  test_sum_factorization(3, 2);
 
 
   // testbug();
@@ -48,7 +48,62 @@ typedef base_node POINT;
 typedef base_small_vector VECT;
 
 
+void test_frozen_structure(const getfem::mesh &m) {
+  auto pms = m.frozen_structure();
+  const bgeot::mesh_structure_csr &ms = *pms;
+  bgeot::mesh_structure::ind_set s1, s2;
+  GMM_ASSERT1(ms.convex_index() == m.convex_index(), "Wrong convex index");
+  for (dal::bv_visitor ic(m.convex_index()); !ic.finished(); ++ic) {
+    GMM_ASSERT1(ms.structure_of_convex(ic) == m.structure_of_convex(ic)
+		&& std::equal(ms.ind_points_of_convex(ic).begin(),
+			      ms.ind_points_of_convex(ic).end(),
+			      m.ind_points_of_convex(ic).begin()),
+		"Wrong points of convex " << ic);
+    for (size_type ip : m.ind_points_of_convex(ic))
+      for (size_type k = 0; k < m.dim(); ++k)
+	GMM_ASSERT1(ms.coordinates_of_point(ip)[k] == m.points()[ip][k],
+		    "Wrong coordinates of point " << ip);
+    for (bgeot::short_type f = 0; f < m.nb_faces_of_convex(ic); ++f) {
+      GMM_ASSERT1(ms.neighbour_of_convex(ic, f)
+		  == m.neighbour_of_convex(ic, f), "Wrong neighbour");
+      bgeot::convex_face cf1 = ms.adjacent_face(ic, f);
+      bgeot::convex_face cf2 = m.adjacent_face(ic, f);
+      GMM_ASSERT1(cf1.cv == cf2.cv && cf1.f == cf2.f, "Wrong adjacent face");
+      ms.neighbours_of_convex(ic, f, s1); m.neighbours_of_convex(ic, f, s2);
+      GMM_ASSERT1(s1 == s2, "Wrong neighbours of face");
+    }
+    std::vector<bgeot::short_type> ftab(1, 0);
+    ms.neighbours_of_convex(ic, ftab, s1); m.neighbours_of_convex(ic, ftab, s2);
+    GMM_ASSERT1(s1 == s2, "Wrong neighbours of faces");
+    ftab.resize(0);
+    ms.neighbours_of_convex(ic, ftab, s1); m.neighbours_of_convex(ic, ftab, s2);
+    GMM_ASSERT1(s1 == s2, "Wrong neighbours of convex");
+  }
+}
+
+// The compact copy is kept by the mesh until its next modification and
+// stays valid for its holders when the mesh is modified.
+void test_frozen_structure_lifetime(getfem::mesh &m) {
+  std::weak_ptr<const bgeot::mesh_structure_csr> wms = m.frozen_structure();
+  auto pms1 = m.frozen_structure(), pms2 = m.frozen_structure();
+  GMM_ASSERT1(!wms.expired() && pms1 == pms2 && wms.lock() == pms1,
+	      "The compact copy is built twice");
+  pms1.reset(); pms2.reset();
+  pms1 = m.frozen_structure();
+  size_type nbc = m.nb_convex();
+  m.sup_convex(m.convex_index().first_true());
+  GMM_ASSERT1(wms.use_count() == 1, "The compact copy is kept after a "
+	      "modification of the mesh");
+  auto pms3 = m.frozen_structure();
+  GMM_ASSERT1(pms3 != pms1 && pms1->nb_convex() == nbc
+	      && pms3->nb_convex() == nbc - 1, "Wrong update of the copy");
+  pms1.reset();
+  GMM_ASSERT1(wms.expired(), "The old compact copy is not freed");
+  test_frozen_structure(m);
+}
+
 void test_conforming(getfem::mesh &m) {
+  test_frozen_structure(m);
   size_type dim = m.dim();
   getfem::mesh_region border_faces;
   getfem::outer_faces_of_mesh(m, border_faces);
@@ -118,6 +173,101 @@ void test_mesh_matching(size_type dim) {
 }
 
 
+typedef std::vector<std::vector<getfem::scalar_type> > point_list;
+
+static point_list region_barycenters(const getfem::mesh &m,
+				     const getfem::mesh_region &rg) {
+  point_list l;
+  for (getfem::mr_visitor i(rg, m); !i.finished(); ++i) {
+    std::vector<getfem::scalar_type> G(m.dim() + 1, 0.);
+    G[m.dim()] = i.is_face() ? i.f() : -1.;
+    for (const base_node &P : m.points_of_convex(i.cv()))
+      for (size_type k = 0; k < m.dim(); ++k) G[k] += P[k];
+    l.push_back(G);
+  }
+  std::sort(l.begin(), l.end());
+  return l;
+}
+
+static getfem::scalar_type mean_point_distance(const getfem::mesh &m) {
+  getfem::scalar_type d = 0.; size_type n = 0;
+  for (dal::bv_visitor ic(m.convex_index()); !ic.finished(); ++ic)
+    for (size_type i : m.ind_points_of_convex(ic))
+      for (size_type j : m.ind_points_of_convex(ic))
+	{ d += getfem::scalar_type(i > j ? i - j : j - i); ++n; }
+  return d / getfem::scalar_type(n);
+}
+
+void test_reorder(size_type dim, getfem::mesh_ordering ord) {
+  getfem::mesh m;
+  std::vector<size_type> nsubdiv(dim, dim == 2 ? 20 : 6);
+  getfem::regular_unit_mesh(m, nsubdiv, bgeot::simplex_geotrans(dim, 1));
+  getfem::mesh_region border_faces;
+  getfem::outer_faces_of_mesh(m, border_faces);
+  m.region(1) = border_faces;
+  for (dal::bv_visitor ic(m.convex_index()); !ic.finished(); ++ic)
+    if (m.points_of_convex(ic)[0][0] < 0.5) m.region(2).add(ic);
+
+  // Random numbering, as in the meshes produced by some mesh generators
+  srand(7);
+  size_type nbc = m.nb_convex(), nbp = m.nb_points();
+  for (size_type i = 0; i < nbc; ++i) m.swap_convex(i, size_type(rand())%nbc);
+  for (size_type i = 0; i < nbp; ++i) m.swap_points(i, size_type(rand())%nbp);
+
+  point_list l1 = region_barycenters(m, m.region(1));
+  point_list l2 = region_barycenters(m, m.region(2));
+  getfem::scalar_type d0 = mean_point_distance(m);
+  test_frozen_structure(m);
+
+  m.reorder(ord);
+  getfem::scalar_type d1 = mean_point_distance(m);
+  cout << "Mean index distance of the points of a convex: " << d0
+       << " before reordering, " << d1 << " after\n";
+  GMM_ASSERT1(m.nb_convex() == nbc && m.nb_points() == nbp
+	      && m.convex_index().last_true() == nbc - 1
+	      && m.points_index().last_true() == nbp - 1, "Wrong reordering");
+  GMM_ASSERT1(region_barycenters(m, m.region(1)) == l1
+	      && region_barycenters(m, m.region(2)) == l2,
+	      "Regions not correctly renumbered");
+  GMM_ASSERT1(d1 < 0.5 * d0, "Bad locality after reordering");
+  test_frozen_structure(m);
+  test_frozen_structure_lifetime(m);
+}
+
+void test_region_fill_and_compaction(void) {
+  getfem::mesh m;
+  std::vector<size_type> nsubdiv(2, 20);
+  getfem::regular_unit_mesh(m, nsubdiv, bgeot::simplex_geotrans(2, 1));
+  size_type nbc = m.nb_convex();
+
+  // Region filled in a random order, with repeated entries
+  std::vector<size_type> cvs(nbc);
+  for (size_type i = 0; i < nbc; ++i) cvs[i] = i;
+  srand(11);
+  for (size_type i = 0; i < nbc; ++i) std::swap(cvs[i], cvs[rand()%nbc]);
+  for (size_type i = 0; i < nbc; ++i)
+    if (cvs[i] % 3) { m.region(1).add(cvs[i]); m.region(1).add(cvs[i], 1); }
+  for (size_type i = 0; i < nbc; i += 2) m.region(1).add(cvs[i], 0);
+  GMM_ASSERT1(m.region(1).is_in(cvs[0], 0) && m.region(1).is_in(1, 1)
+	      && !m.region(1).is_in(0) && !m.region(1).is_in(1, 2),
+	      "Wrong region after an unordered filling");
+  size_type n = 0;
+  for (getfem::mr_visitor i(m.region(1), m); !i.finished(); ++i) ++n;
+  size_type nexp = 0;
+  for (size_type i = 0; i < nbc; ++i)
+    nexp += ((cvs[i] % 3) ? 2 : 0) + ((i % 2 == 0) ? 1 : 0);
+  GMM_ASSERT1(n == nexp, "Wrong number of region entries");
+
+  // Holes all over the numbering, then compaction
+  for (size_type i = 0; i < nbc; i += 5) m.sup_convex(i);
+  point_list l1 = region_barycenters(m, m.region(1));
+  m.optimize_structure(false);
+  GMM_ASSERT1(m.convex_index().last_true() + 1 == m.nb_convex(),
+	      "Holes left in the convex numbering");
+  GMM_ASSERT1(region_barycenters(m, m.region(1)) == l1,
+	      "Region not correctly renumbered by the compaction");
+}
+
 void test_mesh(getfem::mesh &m) {
     
   POINT pt1, pt2, pt3;
@@ -303,6 +453,17 @@ void test_region() {
   b.add(8);
   r = getfem::mesh_region::intersection(a,b);
   cout << "a=" << a << "\nb=" << b << "a inter b=" << r << "\n";
+  GMM_ASSERT1(r.size() == 4 && r.is_in(2) && r.is_in(3,7) && r.is_in(9,1)
+	      && r.is_in(9,5), "Wrong intersection of regions");
+  r = getfem::mesh_region::merge(a,b);
+  GMM_ASSERT1(r.size() == 10 && r.is_in(3,2) && r.is_in(3,3) && r.is_in(8)
+	      && r.is_in(9) && r.is_in(9,5), "Wrong merge of regions");
+  r = getfem::mesh_region::subtract(a,b);
+  GMM_ASSERT1(r.size() == 4 && r.is_in(3,3) && !r.is_in(3,7) && !r.is_in(2)
+	      && r.is_in(9), "Wrong subtraction of regions");
+  r.swap_convex(4, 100); r.swap_convex(3, 9); r.sup(5);
+  GMM_ASSERT1(r.size() == 3 && r.is_in(100) && !r.is_in(4) && r.is_in(9,3)
+	      && r.is_in(3) && r.index().card() == 3, "Wrong region update");
 }
 
 void test_convex_ref() {
@@ -659,6 +820,13 @@ int main(void) {
   test_refinable(3, 3);
 
   test_incomplete_Q2();
+
+  for (size_type d = 2; d <= 3; ++d) {
+    test_reorder(d, getfem::MESH_ORDERING_RCM);
+    test_reorder(d, getfem::MESH_ORDERING_HILBERT);
+    test_reorder(d, getfem::MESH_ORDERING_MORTON);
+  }
+  test_region_fill_and_compaction();
   
   return 0;
 }
@@ -0,0 +1,136 @@
+/*===========================================================================
+
+ Copyright (C) 2017-2017 Yves Renard
+
+ This file is a part of GetFEM++
+
+ GetFEM++  is  free software;  you  can  redistribute  it  and/or modify it
+ under  the  terms  of the  GNU  Lesser General Public License as published
+ by  the  Free Software Foundation;  either version 3 of the License,  or
+ (at your option) any later version along with the GCC Runtime Library
+ Exception either version 3.1 or (at your option) any later version.
+ This program  is  distributed  in  the  hope  that it will be useful,  but
+ WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ or  FITNESS  FOR  A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License and GCC Runtime Library Exception for more details.
+ You  should  have received a copy of the GNU Lesser General Public License
+ along  with  this program;  if not, write to the Free Software Foundation,
+ Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301, USA.
+
+===========================================================================*/
+
+/* Reduced order model of a parametrized nonlinear diffusion problem
+      -div((1 + c u^2) grad u) = p  in the unit square, u = 0 on the boundary
+   built from the snapshots of the full model for some values of (c, p) and
+   compared to the full model for other values.
+*/
+
+#include "getfem/getfem_regular_meshes.h"
+#include "getfem/getfem_model_solvers.h"
+#include "getfem/getfem_reduced_order_model.h"
+using std::endl; using std::cout; using std::cerr;
+using std::ends; using std::cin;
+using bgeot::scalar_type;
+using bgeot::size_type;
+using bgeot::base_node;
+typedef getfem::model_real_plain_vector plain_vector;
+
+bool quick = false;
+
+static void set_parameters(getfem::model &md, scalar_type c, scalar_type p) {
+  md.set_real_variable("c")[0] = c;
+  md.set_real_variable("p")[0] = p;
+}
+
+static void full_solve(getfem::model &md, scalar_type c, scalar_type p) {
+  set_parameters(md, c, p);
+  gmm::clear(md.set_real_variable("u"));
+  gmm::iteration iter(1E-10, 0, 100);
+  getfem::standard_solve(md, iter);
+  GMM_ASSERT1(iter.converged(), "Full model solve has failed");
+}
+
+static void test_reduced_order_model(size_type N) {
+  getfem::mesh m;
+  std::vector<size_type> nsubdiv(2, N);
+  getfem::regular_unit_mesh(m, nsubdiv, bgeot::simplex_geotrans(2, 1));
+  getfem::mesh_region border_faces;
+  getfem::outer_faces_of_mesh(m, border_faces);
+  m.region(1) = border_faces;
+
+  getfem::mesh_fem mf_u(m);
+  mf_u.set_classical_finite_element(2);
+  getfem::mesh_im mim(m);
+  mim.set_integration_method(4);
+
+  getfem::model md;
+  md.add_fem_variable("u", mf_u);
+  md.add_initialized_scalar_data("c", 0.);
+  md.add_initialized_scalar_data("p", 0.);
+
+  getfem::reduced_order_model rom(md);
+  getfem::add_Laplacian_brick(md, mim, "u");
+  rom.add_hyper_reduced_term(mim, "c*sqr(u)*Grad_u.Grad_Test_u");
+  getfem::add_source_term_generic_assembly_brick(md, mim, "p*Test_u");
+  getfem::add_Dirichlet_condition_with_penalization(md, mim, "u", 1E8, 1);
+
+  // The source term depends affinely on p, so that the reduced linear part
+  // is not projected again for each value of p.
+  rom.add_affine_parameter("p");
+
+  // Offline stage: snapshots for a set of training parameters.
+  scalar_type cs[] = { 0., 1., 3., 6., 10. }, ps[] = { 5., 10., 20. };
+  for (scalar_type p : ps)
+    for (scalar_type c : cs) {
+      full_solve(md, c, p);
+      rom.add_snapshot();
+    }
+  rom.build(1E-6, 1E-8);
+  cout << "Reduced basis of size " << rom.reduced_size() << " for "
+       << md.nb_dof() << " dofs, " << rom.nb_sampled_dofs(0)
+       << " sampled dofs on " << rom.sampled_region(0).index().card()
+       << " elements over " << m.convex_index().card() << " ("
+       << rom.nb_sample_dofs(0) << " dofs on the sample mesh)" << endl;
+  GMM_ASSERT1(rom.reduced_size() > 0 && rom.reduced_size() < md.nb_dof(),
+              "Wrong size of the reduced basis");
+  GMM_ASSERT1(rom.sampled_region(0).index().card()
+              < m.convex_index().card(), "No hyper-reduction");
+  GMM_ASSERT1(rom.has_sample_mesh(0)
+              && rom.nb_sample_dofs(0) < md.nb_dof(), "No sample mesh");
+
+  // Online stage: comparison with the full model for new parameters.
+  scalar_type ctests[] = { 2., 8. }, ptests[] = { 7.5, 15. };
+  plain_vector U(mf_u.nb_dof()), Ur(mf_u.nb_dof());
+  for (scalar_type p : ptests)
+    for (scalar_type c : ctests) {
+      full_solve(md, c, p);
+      gmm::copy(md.real_variable("u"), U);
+
+      // The reduced solve starts from the previous reduced solution.
+      gmm::clear(md.set_real_variable("u"));
+      gmm::iteration iter(1E-10, 0, 50);
+      rom.solve(iter);
+      GMM_ASSERT1(iter.converged(), "Reduced model solve has failed");
+      gmm::copy(md.real_variable("u"), Ur);
+
+      scalar_type err = gmm::vect_dist2(U, Ur) / gmm::vect_norm2(U);
+      cout << "c = " << c << " p = " << p << " : " << iter.get_iteration()
+           << " Newton iterations, relative error " << err << endl;
+      GMM_ASSERT1(err < 1E-5, "Reduced order model gives a wrong solution");
+    }
+}
+
+int main(int argc, char **argv) {
+
+  GMM_SET_EXCEPTION_DEBUG; // Exceptions make a memory fault, to debug.
+  FE_ENABLE_EXCEPT;        // Enable floating point exception for Nan.
+
+  if (argc == 2 && strcmp(argv[1],"-quick")==0) quick = true;
+
+  try {
+    test_reduced_order_model(quick ? 10 : 30);
+  }
+  GMM_STANDARD_CATCH_ERROR;
+
+  return 0;
+}
@@ -124,9 +124,11 @@ static void verify(const std::vector<base_node>& rmin, const std::vector<base_no
       extent[k] = std::max(extent[k], rmax[i][k]-rmin[i][k]);
     }
 
+  std::vector<base_node> bmins, bmaxs;
   for (size_type i=0; i < 100; ++i) {
     base_node min(N), max(N);
     for (size_type k=0; k < N; ++k) { min[k] = gmm::random(double()*1.3); max[k] = min[k]+gmm::random()*0.1; }
+    bmins.push_back(min); bmaxs.push_back(max);
     tree.find_containing_boxes(min,max,pbset);
     brute_force_check(rmin,rmax,pbset,contains_p(min,max));
 
@@ -142,6 +144,28 @@ static void verify(const std::vector<base_node>& rmin, const std::vector<base_no
     tree.find_boxes_at_point(max,pbset);
     brute_force_check(rmin,rmax,pbset,has_point_p(max));
   }
+
+  /* the vector, callback and batched versions give the same boxes */
+  std::vector<size_type> offsets, offsets2, cbset;
+  rtree::pbox_cont boxlst, boxlst2;
+  tree.find_intersecting_boxes(bmins, bmaxs, offsets, boxlst);
+  tree.find_boxes_at_points(bmins, offsets2, boxlst2);
+  for (size_type i=0; i < bmins.size(); ++i) {
+    tree.find_intersecting_boxes(bmins[i],bmaxs[i],pbset);
+    assert(offsets[i+1]-offsets[i] == pbset.size());
+    for (size_type j=0; j < pbset.size(); ++j)
+      assert(boxlst[offsets[i]+j]->id == pbset[j]);
+    cbset.resize(0);
+    tree.for_each_intersecting_box(bmins[i], bmaxs[i],
+      [&cbset](const bgeot::box_index *b) { cbset.push_back(b->id); });
+    std::sort(cbset.begin(), cbset.end());
+    assert(cbset == pbset);
+
+    tree.find_boxes_at_point(bmins[i],pbset);
+    assert(offsets2[i+1]-offsets2[i] == pbset.size());
+    for (size_type j=0; j < pbset.size(); ++j)
+      assert(boxlst2[offsets2[i]+j]->id == pbset[j]);
+  }
   for (size_type i=0; i < rmin.size(); ++i) {
     base_node min2(rmin[i]); for (size_type k=0; k < N; ++k) { min2[k] -= extent[k]*gmm::random()*0.1; }
     base_node max2(rmax[i]); for (size_type k=0; k < N; ++k) { max2[k] += extent[k]*gmm::random()*0.1; }
@@ -179,6 +203,45 @@ static void verify(const std::vector<base_node>& rmin, const std::vector<base_no
   }
 }
 
+static void check_refit() {
+  bgeot::rtree tree;
+  std::vector<base_node> rmin, rmax;
+  cout << "2D refit check\n";
+  for (size_type i=0; i < 2000; ++i) {
+    rmin.push_back(base_node(gmm::random(double()), gmm::random(double())));
+    rmax.push_back(rmin.back() + base_node(1.+gmm::random(), 1.+gmm::random())/100.);
+    tree.add_box(rmin.back(),rmax.back());
+  }
+  verify(rmin, rmax, tree);
+
+  /* a small motion of the boxes keeps the structure of the tree */
+  for (size_type i=0; i < rmin.size(); ++i) {
+    base_node d(gmm::random(double())/200., gmm::random(double())/200.);
+    rmin[i] += d; rmax[i] += d;
+    tree.set_box(i, rmin[i], rmax[i]);
+  }
+  assert(!tree.refit());
+  verify(rmin, rmax, tree);
+
+  /* the same for a motion not followed by an explicit refit */
+  for (size_type i=0; i < rmin.size(); ++i) {
+    base_node d(0.3, -0.2);
+    rmin[i] += d; rmax[i] += d;
+    tree.set_box(i, rmin[i], rmax[i]);
+  }
+  verify(rmin, rmax, tree);
+
+  /* shuffling the boxes degrades the tree, which is rebuilt */
+  for (size_type i=0; i < rmin.size(); ++i) {
+    size_type j = size_type(gmm::random(double()) * double(rmin.size()));
+    if (j >= rmin.size()) j = rmin.size()-1;
+    std::swap(rmin[i], rmin[j]); std::swap(rmax[i], rmax[j]);
+  }
+  for (size_type i=0; i < rmin.size(); ++i) tree.set_box(i, rmin[i], rmax[i]);
+  assert(tree.refit());
+  verify(rmin, rmax, tree);
+}
+
 static void check_tree() {
   bgeot::rtree tree;
   tree.add_box(base_node(1.0,0.),base_node(1.5,0.));
@@ -187,6 +250,9 @@ static void check_tree() {
   std::vector<size_type> pi; tree.find_boxes_at_point(base_node(2.8,0.),pi);
   tree.dump();
   assert(pi.size()==1 && pi[0] == 2);  
+  tree.add_box(base_node(2.5,0.),base_node(2.9,0.),3);
+  tree.find_boxes_at_point(base_node(2.8,0.),pi);
+  assert(pi.size()==2 && pi[0] == 2 && pi[1] == 3);
   tree.clear();
   std::vector<base_node> rmin, rmax;
   cout << "1D checks\n";
@@ -229,6 +295,19 @@ static void check_tree() {
     tree.add_box(rmin.back(),rmax.back());
   }
   verify(rmin, rmax, tree);
+
+  cout << "4D random check\n";
+  tree.clear(); rmin.clear(); rmax.clear();
+  for (size_type i=0; i < 2000; ++i) {
+    base_node a(4), b(4);
+    for (size_type k=0; k < 4; ++k)
+      { a[k] = gmm::random(double()); b[k] = a[k] + gmm::random()/5.; }
+    rmin.push_back(a); rmax.push_back(b);
+    tree.add_box(rmin.back(),rmax.back());
+  }
+  verify(rmin, rmax, tree);
+
+  check_refit();
   cout << "\nthe rtree is ok!\n";
 }
 
@@ -113,5 +113,28 @@ main() {
   cout << sl << endl;
 
   cout << "memory 1: " << sl.memsize() << " bytes\n";
+
+  // The slicer reads the points in the compact copy of the mesh, a copy
+  // held before a modification of the mesh must not be used.
+  {
+    auto pms = m.frozen_structure();
+    getfem::base_small_vector T; bgeot::sc(T) = 1,2;
+    m.translation(T);
+    getfem::stored_mesh_slice slt; slt.build(m, getfem::slicer_none(), 3);
+    GMM_ASSERT1(slt.nb_convex() == 2, "Wrong number of sliced convexes");
+    for (size_type ic = 0; ic < slt.nb_convex(); ++ic) {
+      size_type cv = slt.convex_num(ic);
+      for (const getfem::slice_node &n : slt.nodes(ic)) {
+        getfem::base_node P = m.trans_of_convex(cv)->transform
+          (n.pt_ref, m.points_of_convex(cv));
+        GMM_ASSERT1(gmm::vect_dist2(P, n.pt) < 1E-12,
+                    "Slice built on an outdated copy of the mesh");
+      }
+    }
+    getfem::base_node P0 = m.points()[0] - T;
+    GMM_ASSERT1(gmm::abs(pms->coordinates_of_point(0)[0] - P0[0]) < 1E-12
+                && gmm::abs(pms->coordinates_of_point(0)[1] - P0[1]) < 1E-12,
+                "The held copy of the mesh has been modified");
+  }
   return 0;
 }